@@ -15,6 +15,10 @@ import { DEVICE_BASE_URL, API_PATHS } from './constants';
 const App: React.FC = () => {
   const [status, setStatus] = useState<DeviceStatus | null>(null);
   const [samples, setSamples] = useState<ColorSample[]>([]);
+  const [samplesTotal, setSamplesTotal] = useState(0);
+  const [samplesCursor, setSamplesCursor] = useState<number | null>(null);
+  const [hasMoreSamples, setHasMoreSamples] = useState(false);
+  const [isLoadingMoreSamples, setIsLoadingMoreSamples] = useState(false);
   const [isLoadingStatus, setIsLoadingStatus] = useState(true);
   const [isLoadingSamples, setIsLoadingSamples] = useState(true);
   const [statusError, setStatusError] = useState<string | null>(null);
@@ -51,14 +55,16 @@ const App: React.FC = () => {
     }
   }, []);
 
+  // Loads the newest page; later pages are appended by loadMoreSamples
   const fetchSamples = useCallback(async () => {
     setIsLoadingSamples(true);
     setSamplesError(null);
     try {
-      const data = await apiService.getSavedSamples();
-      // Sort samples by timestamp, newest first
-      const sortedSamples = data.samples.sort((a,b) => b.timestamp - a.timestamp);
-      setSamples(sortedSamples);
+      const page = await apiService.getSamplesPage();
+      setSamples(page.samples);
+      setSamplesTotal(page.total);
+      setSamplesCursor(page.nextCursor);
+      setHasMoreSamples(page.hasMore);
     } catch (err) {
       console.error("Fetch samples failed:", err);
       setSamplesError(err instanceof Error ? err.message : 'Failed to load samples.');
@@ -68,6 +74,24 @@ const App: React.FC = () => {
     }
   }, []);
 
+  const loadMoreSamples = useCallback(async () => {
+    if (!hasMoreSamples || isLoadingMoreSamples || samplesCursor === null) return;
+    setIsLoadingMoreSamples(true);
+    try {
+      const page = await apiService.getSamplesPage({ cursor: samplesCursor });
+      setSamples(prev => [...prev, ...page.samples]);
+      setSamplesTotal(page.total);
+      setSamplesCursor(page.nextCursor);
+      setHasMoreSamples(page.hasMore);
+    } catch (err) {
+      console.error("Load more samples failed:", err);
+      showToast(err instanceof Error ? err.message : 'Failed to load more samples.', 'error');
+    } finally {
+      setIsLoadingMoreSamples(false);
+    }
+  // eslint-disable-next-line react-hooks/exhaustive-deps
+  }, [hasMoreSamples, isLoadingMoreSamples, samplesCursor]);
+
   useEffect(() => {
     fetchStatus();
     fetchSamples();
@@ -78,6 +102,20 @@ const App: React.FC = () => {
   // eslint-disable-next-line react-hooks/exhaustive-deps
   }, []); // Run once on mount
 
+  // Paint matches finish on the device after /save returns; patch them into the list as they arrive
+  useEffect(() => {
+    const unsubscribe = apiService.subscribeMatchEvents((event) => {
+      setSamples(prev => prev.map(sample => sample.id === event.id ? {
+        ...sample,
+        matchState: event.matchState,
+        paintName: event.paintName ?? sample.paintName,
+        paintCode: event.paintCode ?? sample.paintCode,
+        lrv: event.lrv ?? sample.lrv,
+      } : sample));
+    });
+    return unsubscribe;
+  }, []);
+
   const handleSettingsChanged = (newSettings: Partial<DeviceStatus>) => {
     setStatus(prev => prev ? { ...prev, ...newSettings } : null);
     // Trust the partial update instead of immediately re-fetching to avoid race conditions
@@ -142,7 +180,11 @@ const App: React.FC = () => {
           <EnhancedScanControl />
           <SampleList
             samples={samples}
+            total={samplesTotal}
+            hasMore={hasMoreSamples}
             isLoading={isLoadingSamples}
+            isLoadingMore={isLoadingMoreSamples}
+            onLoadMore={loadMoreSamples}
             error={samplesError}
             onSampleDeleted={handleSampleSaved}
             showToast={showToast}
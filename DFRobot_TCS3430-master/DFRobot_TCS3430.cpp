@@ -16,6 +16,14 @@ _pWire(pWire),_deviceAddr(DFRobot_TCS3430_ICC_ADDR)
   _atime = 0;
   _wtime = 0;
   _wlong = 0;
+  _cfg2 = DFRobot_TCS3430_HGAIN_DISABLE;
+  _pers = 0;
+  memset(&_i2cStats, 0, sizeof(_i2cStats));
+  _lastError = eI2COK;
+  _sdaPin = -1;
+  _sclPin = -1;
+  _recovering = false;
+  _lastRecoveryMs = 0;
   _enableReg.pon = 0;
   _enableReg.aen = 0;
   _enableReg.reservedBit2 = 0;
@@ -99,6 +107,7 @@ void DFRobot_TCS3430:: setWaitTimer(bool mode)
 
 void DFRobot_TCS3430:: setInterruptPersistence(uint8_t apers)
 {
+  _pers = apers;
   write(eRegPERSAddr,apers);
 }
 
@@ -190,13 +199,59 @@ uint16_t DFRobot_TCS3430:: getIR2Data()
   return value;
 }
 
-void DFRobot_TCS3430:: setHighGAIN(bool mode)
+bool DFRobot_TCS3430:: getChannelData(uint16_t &z, uint16_t &y, uint16_t &ir1, uint16_t &ch3)
 {
-  if (mode){
-    write(eRegCFG2Addr,DFRobot_TCS3430_HGAIN_ENABLE);
-  }else{
-    write(eRegCFG2Addr,DFRobot_TCS3430_HGAIN_DISABLE);
+  uint8_t buf[8];
+  uint32_t startUs = micros();
+  eI2CError_t error = selectRegister(eRegCH0DATALAddr);
+  if(error != eI2COK){
+    recordTransaction(startUs, 1, 0, error);
+    return false;
+  }
+  uint8_t received = _pWire->requestFrom(_deviceAddr, (uint8_t)8);
+  if(received != 8){
+    while(_pWire->available()){
+      _pWire->read();
+    }
+    recordTransaction(startUs, 1, received, eI2CShortRead);
+    return false;
+  }
+  for(uint8_t i = 0; i < 8; i++){
+    buf[i] = _pWire->read();
+  }
+  recordTransaction(startUs, 1, 8, eI2COK);
+  z = buf[0] | (buf[1]<<8);
+  y = buf[2] | (buf[3]<<8);
+  ir1 = buf[4] | (buf[5]<<8);
+  ch3 = buf[6] | (buf[7]<<8);
+  return true;
+}
+
+uint32_t DFRobot_TCS3430:: getCycleTimeUs()
+{
+  uint32_t cycleUs = (_atime+1)*2780UL;
+  if(_enableReg.wen){
+    cycleUs += (_wtime+1)*(_wlong ? 33400UL : 2780UL);
   }
+  return cycleUs;
+}
+
+void DFRobot_TCS3430:: selectIR2Channel(bool mode)
+{
+  setIR2Channel(mode);
+}
+
+void DFRobot_TCS3430:: restartConversion()
+{
+  disableALSADC();
+  _enableReg.aen = 1;
+  write(eRegENABLEAddr,*((uint8_t*)(&_enableReg)));
+}
+
+void DFRobot_TCS3430:: setHighGAIN(bool mode)
+{
+  _cfg2 = mode ? DFRobot_TCS3430_HGAIN_ENABLE : DFRobot_TCS3430_HGAIN_DISABLE;
+  write(eRegCFG2Addr,_cfg2);
 }
 
 void DFRobot_TCS3430:: setIntReadClear(bool mode)
@@ -292,26 +347,200 @@ void DFRobot_TCS3430:: softReset()
   setALSSaturationInterrupt(false);
 }
 
-void DFRobot_TCS3430:: write(uint8_t regAddr,uint8_t value)
+bool DFRobot_TCS3430:: write(uint8_t regAddr,uint8_t value)
 {
+  uint32_t startUs = micros();
   _pWire->beginTransmission(_deviceAddr);
   _pWire->write(regAddr);
   _pWire->write(value);
-  _pWire->endTransmission();
+  uint8_t status = _pWire->endTransmission();
+  eI2CError_t error = eI2COK;
+  if(status == 2 || status == 3){
+    error = eI2CNack;
+  }else if(status != 0){
+    error = eI2CBusError;
+  }
+  recordTransaction(startUs, 2, 0, error);
+  return error == eI2COK;
 }
 
-uint16_t DFRobot_TCS3430:: read(uint8_t regAddr,uint8_t readNum)
+DFRobot_TCS3430::eI2CError_t DFRobot_TCS3430:: selectRegister(uint8_t regAddr)
 {
-  uint16_t value=0;
   _pWire->beginTransmission(_deviceAddr);
   _pWire->write(regAddr);
-  _pWire->endTransmission();
-  _pWire->requestFrom(_deviceAddr, readNum);
+  uint8_t status = _pWire->endTransmission();
+  if(status == 2 || status == 3){
+    return eI2CNack;
+  }
+  return status == 0 ? eI2COK : eI2CBusError;
+}
+
+uint16_t DFRobot_TCS3430:: read(uint8_t regAddr,uint8_t readNum)
+{
+  uint16_t value=0;
+  uint32_t startUs = micros();
+  eI2CError_t error = selectRegister(regAddr);
+  if(error != eI2COK){
+    recordTransaction(startUs, 1, 0, error);
+    return 0;
+  }
+  uint8_t received = _pWire->requestFrom(_deviceAddr, readNum);
+  if(received != readNum){
+    while(_pWire->available()){
+      _pWire->read();
+    }
+    recordTransaction(startUs, 1, received, eI2CShortRead);
+    return 0;
+  }
   if(readNum==1){
     value = _pWire->read();
   }else if(readNum == 2){
     value = _pWire->read();
     value |= _pWire->read()<<8;
   }
+  recordTransaction(startUs, 1, readNum, eI2COK);
   return value;
 }
+
+void DFRobot_TCS3430:: recordTransaction(uint32_t startUs, uint8_t written, uint8_t readBytes, eI2CError_t error)
+{
+  uint32_t us = micros() - startUs;
+  uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+  if(bucket >= DFRobot_TCS3430_I2C_LATENCY_BUCKETS){
+    bucket = DFRobot_TCS3430_I2C_LATENCY_BUCKETS - 1;
+  }
+  _i2cStats.transactions++;
+  _i2cStats.bytesWritten += written;
+  _i2cStats.bytesRead += readBytes;
+  _i2cStats.totalUs += us;
+  if(us > _i2cStats.maxUs){
+    _i2cStats.maxUs = us;
+  }
+  _i2cStats.latency[bucket]++;
+
+  if(error == eI2COK){
+    _i2cStats.consecutiveFailures = 0;
+    return;
+  }
+  if(error == eI2CNack){
+    _i2cStats.nacks++;
+  }else if(error == eI2CShortRead){
+    _i2cStats.shortReads++;
+  }else{
+    _i2cStats.busErrors++;
+  }
+  if(_lastError == eI2COK){
+    _lastError = error;
+  }
+  _i2cStats.lastError = error;
+  _i2cStats.lastErrorMs = millis();
+  _i2cStats.consecutiveFailures++;
+  if(_i2cStats.consecutiveFailures > _i2cStats.maxConsecutiveFailures){
+    _i2cStats.maxConsecutiveFailures = _i2cStats.consecutiveFailures;
+  }
+  if(!_recovering && _i2cStats.consecutiveFailures >= DFRobot_TCS3430_I2C_RECOVERY_FAILURES &&
+     (_i2cStats.recoveries == 0 || millis() - _lastRecoveryMs >= DFRobot_TCS3430_I2C_RECOVERY_GAP_MS)){
+    recoverBus();
+  }
+}
+
+bool DFRobot_TCS3430:: recoverBus()
+{
+  _recovering = true;
+  _lastRecoveryMs = millis();
+  _i2cStats.recoveries++;
+
+#if defined(ARDUINO_ARCH_ESP32)
+  uint32_t clockHz = _pWire->getClock();
+#endif
+  _pWire->end();
+  if(_sdaPin >= 0 && _sclPin >= 0){
+#ifdef OUTPUT_OPEN_DRAIN
+    const uint8_t drive = OUTPUT_OPEN_DRAIN;
+#else
+    const uint8_t drive = OUTPUT;
+#endif
+    // A slave cut off mid-byte holds SDA low until it has clocked out its bits
+    pinMode(_sdaPin, INPUT_PULLUP);
+    pinMode(_sclPin, drive);
+    digitalWrite(_sclPin, HIGH);
+    for(uint8_t i = 0; i < 9 && digitalRead(_sdaPin) == LOW; i++){
+      digitalWrite(_sclPin, LOW);
+      delayMicroseconds(5);
+      digitalWrite(_sclPin, HIGH);
+      delayMicroseconds(5);
+    }
+    // STOP: SDA rises while SCL is high
+    pinMode(_sdaPin, drive);
+    digitalWrite(_sdaPin, LOW);
+    delayMicroseconds(5);
+    digitalWrite(_sclPin, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(_sdaPin, HIGH);
+    delayMicroseconds(5);
+  }
+#if defined(ARDUINO_ARCH_ESP32)
+  if(_sdaPin >= 0 && _sclPin >= 0){
+    _pWire->begin(_sdaPin, _sclPin, clockHz);
+  }else{
+    _pWire->begin();
+    _pWire->setClock(clockHz);
+  }
+#else
+  _pWire->begin();
+#endif
+
+  uint32_t failuresBefore = _i2cStats.nacks + _i2cStats.busErrors + _i2cStats.shortReads;
+  restoreRegisters();
+  bool restored = _i2cStats.nacks + _i2cStats.busErrors + _i2cStats.shortReads == failuresBefore;
+  if(!restored){
+    _i2cStats.recoveryFailures++;
+  }
+  _i2cStats.consecutiveFailures = 0;
+  _recovering = false;
+  return restored;
+}
+
+void DFRobot_TCS3430:: restoreRegisters()
+{
+  // Power-on reset or a glitched write may have changed any of these; the ALS
+  // is re-enabled last so the next conversion uses the restored settings
+  uint8_t enable = *((uint8_t*)(&_enableReg));
+  write(eRegENABLEAddr,enable & ~0x02);
+  write(eRegATIMEAddr,_atime);
+  write(eRegWTIMEAddr,_wtime);
+  write(eRegCFG0Addr,_wlong ? DFRobot_TCS3430_CONFIG_WLONG : DFRobot_TCS3430_CONFIG_NO_WLONG);
+  write(eRegCFG1Addr,*((uint8_t*)(&_cfg1Reg)));
+  write(eRegCFG2Addr,_cfg2);
+  write(eRegCFG3Addr,*((uint8_t*)(&_cfg3Reg)));
+  write(eRegAZCONFIGAddr,*((uint8_t*)(&_AZCfgReg)));
+  write(eRegPERSAddr,_pers);
+  write(eRegINTENABAddr,*((uint8_t*)(&_intEnabReg)));
+  write(eRegENABLEAddr,enable);
+}
+
+uint8_t DFRobot_TCS3430:: getLastError()
+{
+  return _lastError;
+}
+
+void DFRobot_TCS3430:: clearError()
+{
+  _lastError = eI2COK;
+}
+
+const sI2CStats_t &DFRobot_TCS3430:: getI2CStats()
+{
+  return _i2cStats;
+}
+
+void DFRobot_TCS3430:: resetI2CStats()
+{
+  memset(&_i2cStats, 0, sizeof(_i2cStats));
+}
+
+void DFRobot_TCS3430:: setBusPins(int sda, int scl)
+{
+  _sdaPin = sda;
+  _sclPin = scl;
+}
@@ -19,6 +19,32 @@
 
 #define DFRobot_TCS3430_ICC_ADDR            0x39
 
+#define DFRobot_TCS3430_I2C_LATENCY_BUCKETS    16    /* Power-of-two latency buckets: <1us, <2us ... <16.4ms (last also takes longer) */
+#define DFRobot_TCS3430_I2C_RECOVERY_FAILURES  3     /* Consecutive failed transactions that trigger a bus recovery */
+#define DFRobot_TCS3430_I2C_RECOVERY_GAP_MS    1000  /* Least time between two recoveries */
+
+/*
+ * I2C bus counters, kept from construction or the last resetI2CStats()
+ * A transaction is one register write, or one register-pointer write plus its read.
+ */
+typedef struct {
+  uint32_t transactions;
+  uint32_t bytesWritten;      /* Register addresses and values, excluding the device address */
+  uint32_t bytesRead;
+  uint32_t nacks;             /* endTransmission() returned 2 or 3: address or data not acknowledged */
+  uint32_t busErrors;         /* Any other endTransmission() failure (timeout, arbitration, ...) */
+  uint32_t shortReads;        /* requestFrom() returned fewer bytes than asked for */
+  uint32_t consecutiveFailures;
+  uint32_t maxConsecutiveFailures;
+  uint32_t recoveries;        /* Bus recovery sequences run */
+  uint32_t recoveryFailures;  /* Recoveries after which restoring the registers still failed */
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t latency[DFRobot_TCS3430_I2C_LATENCY_BUCKETS]; /* Bucket b holds [2^(b-1), 2^b) us */
+  uint8_t  lastError;         /* eI2CError_t of the most recent failure */
+  uint32_t lastErrorMs;
+} sI2CStats_t;
+
 /*
    * Enable Register (ENABLE 0x80)
    * ------------------------------------------------------------------------------------------
@@ -320,6 +346,13 @@ public:
     eRegAZCONFIGAddr = 0xD6,
     eRegINTENABAddr = 0xDD,
   } eTCS3430RegisterAddress_t;
+
+  typedef enum {
+    eI2COK = 0,
+    eI2CNack,
+    eI2CBusError,
+    eI2CShortRead,
+  } eI2CError_t;
 public:
   /**
    * @brief  constructed function
@@ -410,6 +443,35 @@ public:
    * @return  the IR2 data
    */
   uint16_t getIR2Data();
+
+  /**
+   * @brief  read channels 0-3 in one I2C transaction
+   * @param  z   : channel 0 (Z data)
+   * @param  y   : channel 1 (Y data)
+   * @param  ir1 : channel 2 (IR1 data)
+   * @param  ch3 : channel 3 (X data, or IR2 data while the IR2 channel is selected)
+   * @return true if all eight data bytes were received
+   */
+  bool getChannelData(uint16_t &z, uint16_t &y, uint16_t &ir1, uint16_t &ch3);
+
+  /**
+   * @brief  time one ALS cycle takes: integration plus the wait time when the wait timer is on
+   * @return the cycle time in microseconds
+   */
+  uint32_t getCycleTimeUs();
+
+  /**
+   * @brief  route IR2 (true) or X (false) to channel 3 without restarting the ALS cycle
+   * @n      the conversion in progress when the channel changes holds mixed data
+   * @param  mode  true : IR2 ; false : X
+   */
+  void selectIR2Channel(bool mode);
+
+  /**
+   * @brief  abort the conversion in progress and start a new ALS cycle
+   * @n      the data registers keep the last completed conversion until the new one ends
+   */
+  void restartConversion();
   /**
    * @brief  Set the ALS High gain 
    * @param  mode  true : enable ; false : disenable
@@ -462,6 +524,46 @@ public:
    */
   void setCH0IntThreshold(uint16_t thresholdL,uint16_t thresholdH);
 
+  /**
+   * @brief  first bus error since the last clearError()
+   * @n      register reads return 0 when they fail, so check this after a group of reads
+   * @return eI2COK, or the eI2CError_t of the first failed transaction
+   */
+  uint8_t getLastError();
+
+  /**
+   * @brief  forget the error reported by getLastError()
+   */
+  void clearError();
+
+  /**
+   * @brief  bus transaction, byte, latency and error counters
+   * @return the counters
+   */
+  const sI2CStats_t &getI2CStats();
+
+  /**
+   * @brief  zero the bus counters
+   */
+  void resetI2CStats();
+
+  /**
+   * @brief  pins used to clock a stuck bus free during recovery
+   * @n      without them recovery only restarts the Wire driver
+   * @param  sda : SDA pin
+   * @param  scl : SCL pin
+   */
+  void setBusPins(int sda, int scl);
+
+  /**
+   * @brief  free a stuck bus and restore the sensor registers
+   * @n      pulses SCL until a slave holding SDA low lets go, sends a STOP, restarts
+   * @n      the Wire driver and rewrites every cached register. Runs by itself after
+   * @n      DFRobot_TCS3430_I2C_RECOVERY_FAILURES consecutive failures.
+   * @return true if the registers were restored without a bus error
+   */
+  bool recoverBus();
+
 private:
 
   /**
@@ -506,17 +608,39 @@ private:
    * @brief  config register
    * @param  regAddr : register address
    * @param  value : Writes the value of the register
+   * @return true if the device acknowledged the write
    */
-  void write(uint8_t regAddr,uint8_t value);
+  bool write(uint8_t regAddr,uint8_t value);
 
   /**
    * @brief  read register
    * @param  regAddr : register address
    * @param  readNum : Number of bytes read
-   * @return Read data from a register
+   * @return Read data from a register, 0 if the read failed
    */
   uint16_t read(uint8_t regAddr,uint8_t readNum);
 
+  /**
+   * @brief  select a register for the following read
+   * @param  regAddr : register address
+   * @return eI2COK or the error
+   */
+  eI2CError_t selectRegister(uint8_t regAddr);
+
+  /**
+   * @brief  add one transaction to the counters and run a recovery when failures repeat
+   * @param  startUs : micros() when the transaction started
+   * @param  written : bytes written
+   * @param  readBytes : bytes read
+   * @param  error : outcome
+   */
+  void recordTransaction(uint32_t startUs, uint8_t written, uint8_t readBytes, eI2CError_t error);
+
+  /**
+   * @brief  rewrite every register the driver caches, after a recovery
+   */
+  void restoreRegisters();
+
 
 private:
   eTCS3430RegisterAddress_t _TCS3430Register;
@@ -530,6 +654,14 @@ private:
   uint16_t _atime;
   uint16_t _wtime;
   uint8_t _wlong;
+  uint8_t _cfg2;
+  uint8_t _pers;
+  sI2CStats_t _i2cStats;
+  uint8_t _lastError;
+  int _sdaPin;
+  int _sclPin;
+  bool _recovering;
+  uint32_t _lastRecoveryMs;
 };
 
 #endif
@@ -0,0 +1,51 @@
+// Benchmark entry point. Builds as a standalone firmware (env:esp32-s3-bench)
+// or a host executable (env:bench-native); both print one JSON report between
+// BENCH_REPORT_BEGIN and BENCH_REPORT_END.
+
+#include "bench_suite.h"
+#include "logging.h"
+#include <LittleFS.h>
+#include <Preferences.h>
+
+// Normally defined in main.cpp, which the benchmark builds leave out
+unsigned long Logger::startTime = 0;
+bool Logger::initialized = false;
+Preferences preferences;
+
+static void runBenchmarks(const char* target, const char* filter) {
+  if (!LittleFS.begin(true)) {
+    Serial.println("LittleFS unavailable - store benchmarks will fail");
+  }
+
+  JsonDocument report;
+  size_t ran = BenchSuite::run(report.to<JsonObject>(), target, filter);
+
+  Serial.println(BENCH_REPORT_BEGIN);
+  serializeJson(report, Serial);
+  Serial.println();
+  Serial.println(BENCH_REPORT_END);
+  Serial.printf("%u benchmark cases completed\n", (unsigned)ran);
+  Serial.flush();
+}
+
+#ifdef BENCH_HOST
+
+// Optional argument: only run cases whose name contains it
+int main(int argc, char** argv) {
+  runBenchmarks("host", argc > 1 ? argv[1] : nullptr);
+  return 0;
+}
+
+#else
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000);  // Give the USB serial port time to enumerate
+  runBenchmarks("esp32-s3", nullptr);
+}
+
+void loop() {
+  delay(1000);
+}
+
+#endif
@@ -0,0 +1,373 @@
+#include "bench_suite.h"
+#include "cie1931.h"
+#include "TCS3430Calibration.h"
+#include "matrix_calibration.h"
+#include "dynamic_sensor.h"
+#include "sample_store.h"
+#include "data_transfer.h"
+#include "perf_profiler.h"
+#include "logging.h"
+#include <LittleFS.h>
+#include <esp_task_wdt.h>
+#include <algorithm>
+#include <math.h>
+
+namespace {
+
+// ============================================================================
+// Inputs
+// ============================================================================
+
+// Synthetic sensor view of the ColorChecker: linear sRGB through a crosstalk
+// mix plus a dark offset, with a little per-patch error so fits are not exact
+struct BenchPatch {
+  uint8_t r, g, b;
+  CIE_XYZ xyz;                 // D65 XYZ, 0-100
+  RawChannelData raw;
+  uint16_t readings[RAPID_SCAN_SAMPLES];
+};
+
+BenchPatch patches[SWEEP_MAX_TARGETS];
+uint8_t patchCount = 0;
+
+MatrixCalibration* matrixCal = nullptr;
+TCS3430Calibration* blendCal = nullptr;
+DynamicSensorManager* statsManager = nullptr;
+
+float linearize(uint8_t value) {
+  float v = value / 255.0f;
+  return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+void prepareInputs() {
+  if (patchCount > 0) {
+    return;
+  }
+  const SweepTarget* targets = MatrixCalibration::getColorCheckerTargets(patchCount);
+  patchCount = min(patchCount, (uint8_t)SWEEP_MAX_TARGETS);
+
+  for (uint8_t i = 0; i < patchCount; i++) {
+    BenchPatch& p = patches[i];
+    p.r = targets[i].r;
+    p.g = targets[i].g;
+    p.b = targets[i].b;
+    float lr = linearize(p.r);
+    float lg = linearize(p.g);
+    float lb = linearize(p.b);
+    p.xyz.X = (0.4124564f * lr + 0.3575761f * lg + 0.1804375f * lb) * 100.0f;
+    p.xyz.Y = (0.2126729f * lr + 0.7151522f * lg + 0.0721750f * lb) * 100.0f;
+    p.xyz.Z = (0.0193339f * lr + 0.1191920f * lg + 0.9503041f * lb) * 100.0f;
+
+    float error = 1.0f + (((i * 37) % 11) - 5) * 0.002f;
+    p.raw.r = 400 + 30000.0f * (0.80f * lr + 0.15f * lg + 0.05f * lb) * error;
+    p.raw.g = 400 + 30000.0f * (0.10f * lr + 0.80f * lg + 0.10f * lb) / error;
+    p.raw.b = 400 + 30000.0f * (0.05f * lr + 0.15f * lg + 0.80f * lb) * error;
+    // IR share swept across the blend range
+    p.raw.ir = (p.raw.r + p.raw.g + p.raw.b) * (5 + (i * 7) % 40) / 100;
+    p.raw.timestamp = 0;
+    p.raw.valid = true;
+    p.raw.saturated = false;
+
+    for (uint8_t k = 0; k < RAPID_SCAN_SAMPLES; k++) {
+      p.readings[k] = p.raw.g + ((i * 7919 + k * 104729) % 61) - 30;
+    }
+  }
+
+  matrixCal = new MatrixCalibration(nullptr);
+  for (uint8_t i = 0; i < patchCount; i++) {
+    const BenchPatch& p = patches[i];
+    matrixCal->addManualCalibrationPoint(p.r, p.g, p.b, p.raw.r, p.raw.g, p.raw.b,
+                                         p.raw.r + p.raw.g + p.raw.b, targets[i].name);
+  }
+
+  blendCal = new TCS3430Calibration(nullptr);
+  blendCal->loadFactoryDefaults();
+
+  statsManager = new DynamicSensorManager(nullptr);
+}
+
+inline uint32_t fold(uint32_t checksum, int32_t value) {
+  return checksum * 31 + (uint32_t)value;
+}
+
+inline uint32_t fold(uint32_t checksum, float value) {
+  return fold(checksum, (int32_t)lroundf(value * 1000.0f));
+}
+
+// ============================================================================
+// Cases
+// ============================================================================
+
+bool benchXYZToSRGB(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    sRGB rgb = convertXYZToSRGB(patches[i % patchCount].xyz);
+    run.checksum = fold(run.checksum, (int32_t)(rgb.r << 16 | rgb.g << 8 | rgb.b));
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+bool benchSmoothStepBlend(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    float x, y, z;
+    if (!blendCal->applySmoothStepBlending(patches[i % patchCount].raw, x, y, z)) {
+      return false;
+    }
+    run.checksum = fold(fold(fold(run.checksum, x), y), z);
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+bool benchComputeMatrix(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    if (!matrixCal->computeCalibrationMatrix()) {
+      return false;
+    }
+  }
+  run.us = PerfProfiler::now() - start;
+  CalibrationStats stats = matrixCal->evaluateCalibration();
+  run.checksum = fold(fold(run.checksum, stats.mean_delta_e), stats.max_delta_e);
+  return true;
+}
+
+bool benchStatistics(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    SampleStatistics stats = statsManager->calculateStatistics(patches[i % patchCount].readings, RAPID_SCAN_SAMPLES);
+    run.checksum = fold(fold(run.checksum, stats.standardDeviation), (int32_t)stats.outlierCount);
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+bool benchDeltaE2000(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    const BenchPatch& a = patches[i % patchCount];
+    const BenchPatch& b = patches[(i + 7) % patchCount];
+    float deltaE = calculateDeltaE2000(convertSRGBToLab(a.r, a.g, a.b), convertSRGBToLab(b.r, b.g, b.b));
+    run.checksum = fold(run.checksum, deltaE);
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+bool benchMatrixDeltaE(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    const BenchPatch& a = patches[i % patchCount];
+    const BenchPatch& b = patches[(i + 7) % patchCount];
+    run.checksum = fold(run.checksum, matrixCal->calculateDeltaE(a.r, a.g, a.b, b.r, b.g, b.b));
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+// Same document as handleScan()
+bool benchScanJson(uint32_t ops, BenchRun& run) {
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    const BenchPatch& p = patches[i % patchCount];
+    JsonDocument doc;
+    doc["r"] = p.r;
+    doc["g"] = p.g;
+    doc["b"] = p.b;
+    doc["x"] = p.raw.r;
+    doc["y"] = p.raw.g;
+    doc["z"] = p.raw.b;
+    doc["ir"] = p.raw.ir;
+    doc["scanId"] = i;
+
+    String response;
+    serializeJson(doc, response);
+    run.checksum = fold(run.checksum, (int32_t)response.length());
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+// A saved sample with raw data, colored from patch i
+void fillSample(ColorSample& sample, uint32_t i) {
+  const BenchPatch& p = patches[i % patchCount];
+  memset(&sample, 0, sizeof(sample));
+  strcpy(sample.paintName, "Benchmark Grey");
+  strcpy(sample.paintCode, "BENCH-001");
+  sample.r = p.r;
+  sample.g = p.g;
+  sample.b = p.b;
+  sample.timestamp = i;
+  sample.lrv = 42.5f;
+  sample.raw.x = p.raw.r;
+  sample.raw.y = p.raw.g;
+  sample.raw.z = p.raw.b;
+  sample.raw.ir1 = p.raw.ir;
+  sample.raw.ir2 = p.raw.ir / 2;
+  for (uint8_t c = 0; c < 5; c++) {
+    sample.raw.sigma[c] = 150 + c * 10;
+  }
+  sample.raw.readings = RAPID_SCAN_SAMPLES;
+  sample.raw.atime = 150;
+  sample.raw.again = 16;
+  sample.raw.calVersion = 1;
+}
+
+// Same document as one element of GET /samples
+bool benchSampleJson(uint32_t ops, BenchRun& run) {
+  ColorSample sample;
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < ops; i++) {
+    fillSample(sample, i);
+    JsonDocument doc;
+    doc["id"] = i + 1;
+    doc["r"] = sample.r;
+    doc["g"] = sample.g;
+    doc["b"] = sample.b;
+    doc["timestamp"] = sample.timestamp;
+    doc["paintName"] = sample.paintName;
+    doc["paintCode"] = sample.paintCode;
+    doc["lrv"] = sample.lrv;
+    doc["matchState"] = "matched";
+    sampleRawToJson(doc, sample);
+
+    String chunk = i ? "," : "";
+    serializeJson(doc, chunk);
+    run.checksum = fold(run.checksum, (int32_t)chunk.length());
+  }
+  run.us = PerfProfiler::now() - start;
+  return true;
+}
+
+#define BENCH_STORE_SCRATCH_PATH SAMPLE_STORE_BENCH_PATH ".tmp"
+
+// Writes a fresh scratch log of `count` samples and returns the time taken
+bool fillStore(uint32_t count, BenchRun& run) {
+  LittleFS.remove(SAMPLE_STORE_BENCH_PATH);
+  LittleFS.remove(BENCH_STORE_SCRATCH_PATH);
+  SampleStore store(SAMPLE_STORE_BENCH_PATH, BENCH_STORE_SCRATCH_PATH);
+  if (!store.begin()) {
+    return false;
+  }
+
+  ColorSample sample;
+  uint32_t start = PerfProfiler::now();
+  for (uint32_t i = 0; i < count; i++) {
+    fillSample(sample, i);
+    uint32_t id;
+    if (!store.append(sample, id)) {
+      return false;
+    }
+    run.checksum = fold(run.checksum, (int32_t)id);
+    if ((i & 0xFF) == 0) {
+      esp_task_wdt_reset();
+    }
+  }
+  bool flushed = store.flush();
+  run.us = PerfProfiler::now() - start;
+  store.end();
+  return flushed;
+}
+
+// Appends, including the flush that writes them to the log
+bool benchSampleInsert(uint32_t ops, BenchRun& run) {
+  bool ok = fillStore(ops, run);
+  LittleFS.remove(SAMPLE_STORE_BENCH_PATH);
+  return ok;
+}
+
+// Boot-time load: reading the log back and rebuilding the index
+bool benchSampleLoad(uint32_t ops, BenchRun& run) {
+  BenchRun fill = {0, ops, 0};
+  if (!fillStore(ops, fill)) {
+    return false;
+  }
+  SampleStore store(SAMPLE_STORE_BENCH_PATH, BENCH_STORE_SCRATCH_PATH);
+  uint32_t start = PerfProfiler::now();
+  bool loaded = store.begin();
+  run.us = PerfProfiler::now() - start;
+  run.ops = store.count();
+  run.checksum = fold(run.checksum, (int32_t)run.ops);
+  store.end();
+  LittleFS.remove(SAMPLE_STORE_BENCH_PATH);
+  return loaded;
+}
+
+const BenchCase cases[] = {
+  {"xyzToSrgb", benchXYZToSRGB, 240 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"smoothStepBlend", benchSmoothStepBlend, 240 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"computeMatrix", benchComputeMatrix, 8 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"statistics", benchStatistics, 240 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"deltaE2000", benchDeltaE2000, 240 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"matrixDeltaE", benchMatrixDeltaE, 240 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"scanJson", benchScanJson, 48 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"sampleJson", benchSampleJson, 48 * BENCH_OPS_SCALE, BENCH_MAX_RUNS},
+  {"sampleInsert", benchSampleInsert, BENCH_STORE_SAMPLES, BENCH_STORE_RUNS},
+  {"sampleLoad", benchSampleLoad, BENCH_STORE_SAMPLES, BENCH_STORE_RUNS},
+};
+
+} // namespace
+
+const BenchCase* BenchSuite::getCases(size_t& count) {
+  count = sizeof(cases) / sizeof(cases[0]);
+  return cases;
+}
+
+bool BenchSuite::runCase(const BenchCase& benchCase, JsonArray out) {
+  JsonObject item = out.add<JsonObject>();
+  item["name"] = benchCase.name;
+
+  // The first run is a warm-up (caches, lazy initialization) and is not timed
+  float nsPerOp[BENCH_MAX_RUNS];
+  uint8_t runs = min(benchCase.runs, (uint8_t)BENCH_MAX_RUNS);
+  BenchRun run;
+  for (int i = -1; i < runs; i++) {
+    run = {0, benchCase.ops, 0};
+    if (!benchCase.run(benchCase.ops, run) || run.ops == 0) {
+      LOG_SYS_ERROR("Benchmark %s failed", benchCase.name);
+      item["failed"] = true;
+      return false;
+    }
+    if (i >= 0) {
+      nsPerOp[i] = run.us * 1000.0f / run.ops;
+    }
+    yield();
+  }
+  std::sort(nsPerOp, nsPerOp + runs);
+
+  item["ops"] = run.ops;
+  item["runs"] = runs;
+  item["minNs"] = nsPerOp[0];
+  item["medianNs"] = nsPerOp[runs / 2];
+  item["maxNs"] = nsPerOp[runs - 1];
+  item["checksum"] = run.checksum;
+  return true;
+}
+
+size_t BenchSuite::run(JsonObject report, const char* target, const char* filter) {
+  prepareInputs();
+
+  report["schema"] = BENCH_SCHEMA_VERSION;
+  report["target"] = target;
+  report["build"] = BENCH_BUILD_ID;
+  report["firmware"] = FIRMWARE_VERSION;
+  report["compiled"] = BUILD_DATE " " BUILD_TIME;
+  report["cpuMHz"] = ESP.getCpuFreqMHz();
+  report["opsScale"] = BENCH_OPS_SCALE;
+
+  JsonArray out = report["cases"].to<JsonArray>();
+  size_t ran = 0;
+  for (const BenchCase& benchCase : cases) {
+    if (filter && !strstr(benchCase.name, filter)) {
+      continue;
+    }
+    unsigned long start = millis();
+    if (runCase(benchCase, out)) {
+      ran++;
+    }
+    LOG_SYS_INFO("Benchmark %s done in %lu ms", benchCase.name, millis() - start);
+  }
+  return ran;
+}
@@ -0,0 +1,79 @@
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define BENCH_SCHEMA_VERSION 1         // Bump when the report layout changes
+#define BENCH_MAX_RUNS 7               // Timed runs per case, after one warm-up run
+#define BENCH_STORE_RUNS 3             // Store cases rebuild a whole log per run
+#define BENCH_STORE_SAMPLES 500        // Samples inserted per store run
+
+// Multiplies the operations per run; the host is fast enough that device-sized
+// runs are too short to time with microsecond resolution
+#ifndef BENCH_OPS_SCALE
+#define BENCH_OPS_SCALE 1
+#endif
+
+// Identifies the build in the report, e.g. -DBENCH_BUILD_ID=\"$(git rev-parse --short HEAD)\"
+#ifndef BENCH_BUILD_ID
+#define BENCH_BUILD_ID "unknown"
+#endif
+
+// The report is printed between these lines so it can be cut out of a serial log
+#define BENCH_REPORT_BEGIN "=== BENCH REPORT BEGIN ==="
+#define BENCH_REPORT_END "=== BENCH REPORT END ==="
+
+// Outcome of one timed run of a case
+struct BenchRun {
+  uint32_t us;                 // Time spent in the measured operations
+  uint32_t ops;                // Operations measured
+  uint32_t checksum;           // Fold of the outputs, so the work cannot be optimized away
+};
+
+/**
+ * @brief Runs `ops` operations of one case and fills in the timing
+ * @return false if the case could not run (its results are then left out)
+ */
+typedef bool (*BenchFunction)(uint32_t ops, BenchRun& run);
+
+struct BenchCase {
+  const char* name;
+  BenchFunction run;
+  uint32_t ops;                // Operations per run
+  uint8_t runs;                // Timed runs, at most BENCH_MAX_RUNS
+};
+
+/**
+ * @brief Fixed-input benchmarks of the firmware's hot paths
+ *
+ * Every case calls the production code on the same synthetic inputs: color
+ * conversion, matrix blending and fitting, reading statistics, ΔE, JSON
+ * serialization of scan and sample responses, and sample store insert and
+ * load. Each case is timed over several runs and reported per operation as
+ * min/median/max nanoseconds, with a checksum of the outputs so a changed
+ * result is as visible as a changed time.
+ *
+ * The same suite builds as a standalone firmware (env:esp32-s3-bench) and as
+ * a host executable (env:bench-native); scripts/bench_compare.py diffs two
+ * reports.
+ */
+class BenchSuite {
+public:
+  /**
+   * @brief Run every case whose name contains filter (all when null) into a report
+   * @param report Receives the build details and one entry per case
+   * @param target Where the suite ran, e.g. "esp32-s3" or "host"
+   * @return Number of cases that ran
+   */
+  static size_t run(JsonObject report, const char* target, const char* filter = nullptr);
+
+  /**
+   * @brief Time one case over its runs and add it to a JSON array
+   */
+  static bool runCase(const BenchCase& benchCase, JsonArray out);
+
+  static const BenchCase* getCases(size_t& count);
+};
+
+#endif // BENCH_SUITE_H
@@ -0,0 +1,259 @@
+#ifndef BENCH_HOST_ARDUINO_H
+#define BENCH_HOST_ARDUINO_H
+
+// Minimal Arduino-ESP32 surface for building the benchmarked modules on a
+// desktop host. Only what those modules use is provided; timing comes from
+// std::chrono and FreeRTOS locks map onto std::recursive_mutex.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ============================================================================
+// Timing
+// ============================================================================
+
+namespace bench_host {
+inline std::chrono::steady_clock::time_point bootTime() {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return start;
+}
+} // namespace bench_host
+
+inline unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                               bench_host::bootTime()).count();
+}
+
+inline unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               bench_host::bootTime()).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() {}
+
+// ============================================================================
+// GPIO (no pins on the host; the sensor library's bus recovery only compiles)
+// ============================================================================
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+
+// ============================================================================
+// String, Print, Stream
+// ============================================================================
+
+class String {
+private:
+  std::string text;
+
+public:
+  String() {}
+  String(const char* value) : text(value ? value : "") {}
+  String(const std::string& value) : text(value) {}
+  String(char value) : text(1, value) {}
+  String(int value) : text(std::to_string(value)) {}
+  String(unsigned int value) : text(std::to_string(value)) {}
+  String(long value) : text(std::to_string(value)) {}
+  String(unsigned long value) : text(std::to_string(value)) {}
+  String(float value, unsigned int decimals = 2) { format(value, decimals); }
+  String(double value, unsigned int decimals = 2) { format(value, decimals); }
+
+  const char* c_str() const { return text.c_str(); }
+  unsigned int length() const { return text.size(); }
+  bool isEmpty() const { return text.empty(); }
+  void reserve(unsigned int size) { text.reserve(size); }
+
+  bool concat(const char* value) { text += value; return true; }
+  bool concat(const char* value, unsigned int size) { text.append(value, size); return true; }
+  bool concat(char value) { text += value; return true; }
+
+  char charAt(unsigned int index) const { return index < text.size() ? text[index] : 0; }
+  void setCharAt(unsigned int index, char value) { if (index < text.size()) text[index] = value; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return atof(text.c_str()); }
+  void toLowerCase() { for (char& c : text) c = tolower(c); }
+  void toUpperCase() { for (char& c : text) c = toupper(c); }
+  bool equalsIgnoreCase(const String& other) const { return strcasecmp(text.c_str(), other.c_str()) == 0; }
+
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  String& operator+=(const char* other) { text += other; return *this; }
+  String& operator+=(char other) { text += other; return *this; }
+
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator==(const char* other) const { return text == other; }
+  bool operator!=(const String& other) const { return text != other.text; }
+  bool operator!=(const char* other) const { return text != other; }
+
+private:
+  void format(double value, unsigned int decimals) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    text = buffer;
+  }
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return printf("%d", value); }
+  size_t print(unsigned int value) { return printf("%u", value); }
+  size_t print(long value) { return printf("%ld", value); }
+  size_t print(unsigned long value) { return printf("%lu", value); }
+  size_t print(double value, int decimals = 2) { return printf("%.*f", decimals, value); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& value) { return print(value) + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (len <= 0) {
+      return 0;
+    }
+    return write((const uint8_t*)buffer, min((size_t)len, sizeof(buffer) - 1));
+  }
+
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+  size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = read();
+      if (c < 0) {
+        break;
+      }
+      buffer[count++] = (char)c;
+    }
+    return count;
+  }
+  void setTimeout(unsigned long) {}
+};
+
+// stdout stands in for the USB serial port
+class HostSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  void flush() override { fflush(stdout); }
+};
+
+extern HostSerial Serial;
+
+// ============================================================================
+// Chip and memory
+// ============================================================================
+
+class HostEsp {
+public:
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getHeapSize() { return 0; }
+  uint32_t getMinFreeHeap() { return 0; }
+  uint32_t getMaxAllocHeap() { return 0; }
+  uint32_t getPsramSize() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+  uint32_t getCpuFreqMHz() { return 0; }
+  const char* getChipModel() { return "host"; }
+};
+
+extern HostEsp ESP;
+
+inline bool psramFound() { return false; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+inline void* ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+
+// ============================================================================
+// FreeRTOS
+// ============================================================================
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef std::recursive_mutex* SemaphoreHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) (ms)
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new std::recursive_mutex(); }
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::recursive_mutex(); }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t) { mutex->lock(); return pdTRUE; }
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) { mutex->unlock(); return pdTRUE; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t) { mutex->lock(); return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) { mutex->unlock(); return pdTRUE; }
+inline void vSemaphoreDelete(SemaphoreHandle_t mutex) { delete mutex; }
+
+struct portMUX_TYPE {
+  std::mutex* lock;
+};
+
+inline void portMUX_INITIALIZE(portMUX_TYPE* mux) { mux->lock = new std::mutex(); }
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) { mux->lock->lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) { mux->lock->unlock(); }
+
+#endif // BENCH_HOST_ARDUINO_H
@@ -0,0 +1,60 @@
+#ifndef BENCH_HOST_FS_H
+#define BENCH_HOST_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+namespace fs {
+
+// Copies share one open handle, like the Arduino File
+class File : public Stream {
+private:
+  std::shared_ptr<FILE> handle;
+
+public:
+  File() {}
+  explicit File(FILE* file) : handle(file, [](FILE* f) { fclose(f); }) {}
+
+  operator bool() const { return handle != nullptr; }
+
+  size_t write(uint8_t c) override { return handle && fputc(c, handle.get()) != EOF ? 1 : 0; }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    return handle ? fwrite(buffer, 1, size, handle.get()) : 0;
+  }
+  using Print::write;
+
+  size_t read(uint8_t* buffer, size_t size) { return handle ? fread(buffer, 1, size, handle.get()) : 0; }
+  int read() override { return handle ? fgetc(handle.get()) : -1; }
+  int available() override { return handle ? (int)(size() - position()) : 0; }
+
+  bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+    static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+    return handle && fseek(handle.get(), pos, whence[mode]) == 0;
+  }
+  size_t position() const { return handle ? ftell(handle.get()) : 0; }
+  size_t size() const {
+    if (!handle) {
+      return 0;
+    }
+    long here = ftell(handle.get());
+    fseek(handle.get(), 0, SEEK_END);
+    long end = ftell(handle.get());
+    fseek(handle.get(), here, SEEK_SET);
+    return end;
+  }
+
+  void flush() override { if (handle) fflush(handle.get()); }
+  void close() { handle.reset(); }
+};
+
+} // namespace fs
+
+using fs::File;
+
+#endif // BENCH_HOST_FS_H
@@ -0,0 +1,30 @@
+#ifndef BENCH_HOST_LITTLEFS_H
+#define BENCH_HOST_LITTLEFS_H
+
+#include <FS.h>
+
+// LittleFS mapped onto a host directory (BENCH_FS_ROOT, default ./bench_fs)
+class HostLittleFS {
+private:
+  std::string root;
+
+  std::string hostPath(const char* path) const { return root + path; }
+
+public:
+  HostLittleFS() : root("bench_fs") {}
+
+  bool begin(bool formatOnFail = false);
+  File open(const char* path, const char* mode);
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+  bool exists(const char* path) const;
+  bool exists(const String& path) const { return exists(path.c_str()); }
+  bool remove(const char* path) { return ::remove(hostPath(path).c_str()) == 0; }
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+  size_t totalBytes() const { return 8 * 1024 * 1024; }
+  size_t usedBytes() const;
+};
+
+extern HostLittleFS LittleFS;
+
+#endif // BENCH_HOST_LITTLEFS_H
@@ -0,0 +1,72 @@
+#ifndef BENCH_HOST_PREFERENCES_H
+#define BENCH_HOST_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+// In-memory NVS; nothing survives the process
+class Preferences {
+private:
+  std::map<std::string, std::vector<uint8_t>> values;
+
+  size_t put(const char* key, const void* value, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    values[key].assign(bytes, bytes + size);
+    return size;
+  }
+
+  template <typename T> T get(const char* key, T defaultValue) const {
+    auto it = values.find(key);
+    if (it == values.end() || it->second.size() != sizeof(T)) {
+      return defaultValue;
+    }
+    T value;
+    memcpy(&value, it->second.data(), sizeof(T));
+    return value;
+  }
+
+public:
+  bool begin(const char*, bool = false) { return true; }
+  void end() {}
+  bool clear() { values.clear(); return true; }
+  bool remove(const char* key) { return values.erase(key) > 0; }
+  bool isKey(const char* key) const { return values.count(key) > 0; }
+
+  size_t putBool(const char* key, bool value) { uint8_t v = value; return put(key, &v, 1); }
+  size_t putUChar(const char* key, uint8_t value) { return put(key, &value, sizeof(value)); }
+  size_t putUShort(const char* key, uint16_t value) { return put(key, &value, sizeof(value)); }
+  size_t putInt(const char* key, int32_t value) { return put(key, &value, sizeof(value)); }
+  size_t putUInt(const char* key, uint32_t value) { return put(key, &value, sizeof(value)); }
+  size_t putULong(const char* key, uint32_t value) { return put(key, &value, sizeof(value)); }
+  size_t putFloat(const char* key, float value) { return put(key, &value, sizeof(value)); }
+  size_t putString(const char* key, const String& value) { return put(key, value.c_str(), value.length()); }
+  size_t putBytes(const char* key, const void* value, size_t size) { return put(key, value, size); }
+
+  bool getBool(const char* key, bool defaultValue = false) const { return get<uint8_t>(key, defaultValue); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) const { return get(key, defaultValue); }
+  uint16_t getUShort(const char* key, uint16_t defaultValue = 0) const { return get(key, defaultValue); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0) const { return get(key, defaultValue); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0) const { return get(key, defaultValue); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) const { return get(key, defaultValue); }
+  float getFloat(const char* key, float defaultValue = 0.0f) const { return get(key, defaultValue); }
+  String getString(const char* key, const String& defaultValue = String()) const {
+    auto it = values.find(key);
+    return it == values.end() ? defaultValue : String(std::string(it->second.begin(), it->second.end()));
+  }
+  size_t getBytesLength(const char* key) const {
+    auto it = values.find(key);
+    return it == values.end() ? 0 : it->second.size();
+  }
+  size_t getBytes(const char* key, void* buffer, size_t size) const {
+    auto it = values.find(key);
+    if (it == values.end() || it->second.size() > size) {
+      return 0;
+    }
+    memcpy(buffer, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+  size_t freeEntries() const { return 500; }
+};
+
+#endif // BENCH_HOST_PREFERENCES_H
@@ -0,0 +1,24 @@
+#ifndef BENCH_HOST_WIRE_H
+#define BENCH_HOST_WIRE_H
+
+#include <Arduino.h>
+
+// No I2C bus on the host; the sensor library only needs to compile
+class TwoWire : public Stream {
+public:
+  bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+  bool end() { return true; }
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t) {}
+  uint8_t endTransmission(bool = true) { return 2; }
+  uint8_t requestFrom(uint8_t, uint8_t, bool = true) { return 0; }
+  size_t write(uint8_t) override { return 0; }
+  size_t write(const uint8_t*, size_t) override { return 0; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif // BENCH_HOST_WIRE_H
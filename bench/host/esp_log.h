@@ -0,0 +1,13 @@
+#ifndef BENCH_HOST_ESP_LOG_H
+#define BENCH_HOST_ESP_LOG_H
+
+// ESP-IDF log macros; errors and warnings go to stderr, the rest is dropped
+#include <cstdio>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do {} while (0)
+#define ESP_LOGD(tag, format, ...) do {} while (0)
+#define ESP_LOGV(tag, format, ...) do {} while (0)
+
+#endif // BENCH_HOST_ESP_LOG_H
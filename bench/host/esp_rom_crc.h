@@ -0,0 +1,18 @@
+#ifndef BENCH_HOST_ESP_ROM_CRC_H
+#define BENCH_HOST_ESP_ROM_CRC_H
+
+#include <cstdint>
+
+// Same result as the ROM routine: reflected CRC-32, running value in and out
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buffer, uint32_t length) {
+  crc = ~crc;
+  while (length--) {
+    crc ^= *buffer++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+#endif // BENCH_HOST_ESP_ROM_CRC_H
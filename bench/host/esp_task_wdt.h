@@ -0,0 +1,6 @@
+#ifndef BENCH_HOST_ESP_TASK_WDT_H
+#define BENCH_HOST_ESP_TASK_WDT_H
+
+inline int esp_task_wdt_reset() { return 0; }
+
+#endif // BENCH_HOST_ESP_TASK_WDT_H
@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Wire.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+HostSerial Serial;
+HostEsp ESP;
+HostLittleFS LittleFS;
+TwoWire Wire;
+
+bool HostLittleFS::begin(bool) {
+  const char* dir = getenv("BENCH_FS_ROOT");
+  root = dir && *dir ? dir : "bench_fs";
+  mkdir(root.c_str(), 0755);
+  struct stat info;
+  return stat(root.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+File HostLittleFS::open(const char* path, const char* mode) {
+  // Arduino modes are text-style; host files must be opened binary
+  std::string hostMode = mode;
+  if (hostMode.find('b') == std::string::npos) {
+    hostMode += 'b';
+  }
+  FILE* file = fopen(hostPath(path).c_str(), hostMode.c_str());
+  return file ? File(file) : File();
+}
+
+bool HostLittleFS::exists(const char* path) const {
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+size_t HostLittleFS::usedBytes() const {
+  size_t used = 0;
+  DIR* dir = opendir(root.c_str());
+  if (!dir) {
+    return 0;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    struct stat info;
+    if (stat((root + "/" + entry->d_name).c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+      used += info.st_size;
+    }
+  }
+  closedir(dir);
+  return used;
+}
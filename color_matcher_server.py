@@ -4,10 +4,14 @@ Temporary Color Matcher Server
 Replaces the broken Google Apps Script for testing ESP32 color matching functionality
 """
 
-from flask import Flask, request, jsonify
+from flask import Flask, request, jsonify, redirect
 from flask_cors import CORS
+from werkzeug.serving import WSGIRequestHandler
+from urllib.parse import urlencode
+import argparse
 import json
 import math
+import secrets
 
 app = Flask(__name__)
 CORS(app)  # Enable CORS for ESP32 requests
@@ -68,6 +72,13 @@ def calculate_color_distance(r1, g1, b1, r2, g2, b2):
     """Calculate Euclidean distance between two RGB colors"""
     return math.sqrt((r1 - r2)**2 + (g1 - g2)**2 + (b1 - b2)**2)
 
+def rank_colors(target_r, target_g, target_b):
+    """All Dulux colors with their distance to the target, closest first"""
+    ranked = [(calculate_color_distance(target_r, target_g, target_b, c['r'], c['g'], c['b']), c)
+              for c in DULUX_COLORS]
+    ranked.sort(key=lambda pair: pair[0])
+    return ranked
+
 def find_closest_color(target_r, target_g, target_b):
     """Find the closest matching Dulux color"""
     best_match = None
@@ -85,6 +96,40 @@ def find_closest_color(target_r, target_g, target_b):
     
     return best_match, min_distance
 
+MAX_BATCH_COLORS = 64
+
+def match_result(r, g, b, k):
+    """Match payload for one color: the best paint plus up to k runners-up"""
+    if not all(isinstance(v, int) and 0 <= v <= 255 for v in (r, g, b)):
+        return {"success": False, "error": "Invalid RGB values. Must be 0-255."}
+
+    match, distance = find_closest_color(r, g, b)
+    if not match:
+        return {"success": False, "error": "No color match found"}
+
+    print(f"[COLOR MATCH] Found match: {match['name']} (distance: {distance:.2f})")
+    return {
+        "success": True,
+        "match": {
+            "name": match["name"],
+            "code": match["code"],
+            "r": match["r"],
+            "g": match["g"],
+            "b": match["b"],
+            "lrv": match["lrv"]
+        },
+        "distance": round(distance, 2),
+        "alternates": [
+            {"name": c["name"], "code": c["code"], "lrv": c["lrv"], "distance": round(d, 2)}
+            for d, c in rank_colors(r, g, b)[1:k + 1]
+        ],
+        "input": {
+            "r": r,
+            "g": g,
+            "b": b
+        }
+    }
+
 @app.route('/', methods=['GET'])
 def color_match():
     """Handle color matching requests from ESP32"""
@@ -93,45 +138,14 @@ def color_match():
         r = int(request.args.get('r', 0))
         g = int(request.args.get('g', 0))
         b = int(request.args.get('b', 0))
+        k = max(0, min(int(request.args.get('k', 0)), 10))  # Runner-up matches wanted
         
         print(f"[COLOR MATCH] Received RGB: ({r}, {g}, {b})")
         
-        # Validate RGB values
-        if not (0 <= r <= 255 and 0 <= g <= 255 and 0 <= b <= 255):
-            return jsonify({
-                "success": False,
-                "error": "Invalid RGB values. Must be 0-255."
-            }), 400
-        
-        # Find closest color match
-        match, distance = find_closest_color(r, g, b)
-        
-        if match:
-            response = {
-                "success": True,
-                "match": {
-                    "name": match["name"],
-                    "code": match["code"],
-                    "r": match["r"],
-                    "g": match["g"],
-                    "b": match["b"],
-                    "lrv": match["lrv"]
-                },
-                "distance": round(distance, 2),
-                "input": {
-                    "r": r,
-                    "g": g,
-                    "b": b
-                }
-            }
-            
-            print(f"[COLOR MATCH] Found match: {match['name']} (distance: {distance:.2f})")
-            return jsonify(response)
-        else:
-            return jsonify({
-                "success": False,
-                "error": "No color match found"
-            }), 404
+        result = match_result(r, g, b, k)
+        if not result["success"]:
+            return jsonify(result), 400 if result["error"].startswith("Invalid") else 404
+        return jsonify(result)
             
     except ValueError as e:
         return jsonify({
@@ -145,6 +159,48 @@ def color_match():
             "error": "Internal server error"
         }), 500
 
+@app.route('/', methods=['POST'])
+def color_match_batch():
+    """Batch lookup: {"k": 3, "colors": [{"r": .., "g": .., "b": ..}, ...]} -> {"results": [...]}
+
+    Results are in request order and each has the same shape as a GET answer;
+    a bad color fails only its own entry.
+    """
+    payload = request.get_json(silent=True)
+    if not isinstance(payload, dict) or not isinstance(payload.get('colors'), list):
+        return jsonify({"success": False, "error": "Expected a JSON object with a colors array"}), 400
+
+    colors = payload['colors']
+    if len(colors) > MAX_BATCH_COLORS:
+        return jsonify({"success": False, "error": f"At most {MAX_BATCH_COLORS} colors per request"}), 413
+    k = payload.get('k', 0)
+    k = max(0, min(k, 10)) if isinstance(k, int) else 0
+
+    print(f"[COLOR MATCH] Received batch of {len(colors)} colors")
+    results = [
+        match_result(c.get('r'), c.get('g'), c.get('b'), k) if isinstance(c, dict)
+        else {"success": False, "error": "Invalid color entry"}
+        for c in colors
+    ]
+    return jsonify({"success": True, "count": len(results), "results": results})
+
+@app.route('/exec', methods=['GET'])
+def apps_script_exec():
+    """Behave like a deployed Apps Script: answer with a one-off echo redirect"""
+    query = request.args.to_dict()
+    query['user_content_key'] = secrets.token_urlsafe(16)
+    return redirect('/echo?' + urlencode(query), code=302)
+
+@app.route('/echo', methods=['GET'])
+def apps_script_echo():
+    """Redirect target of /exec (script.googleusercontent.com in production)"""
+    return color_match()
+
+@app.route('/moved', methods=['GET'])
+def moved_endpoint():
+    """Permanently moved endpoint that keeps the query; the ESP32 caches this redirect"""
+    return redirect('/?' + urlencode(request.args.to_dict()), code=301)
+
 @app.route('/health', methods=['GET'])
 def health_check():
     """Health check endpoint"""
@@ -155,6 +211,17 @@ def health_check():
     })
 
 if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Color matcher backend stand-in")
+    parser.add_argument('--host', default='0.0.0.0')
+    parser.add_argument('--port', type=int, default=5000)
+    parser.add_argument('--tls', nargs=2, metavar=('CERT', 'KEY'),
+                        help="Serve HTTPS with this certificate and key (stand-in for script.google.com)")
+    args = parser.parse_args()
+
+    # HTTP/1.1 so the ESP32 client can keep connections alive between lookups
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+    scheme = 'https' if args.tls else 'http'
+
     print("🎨 Color Matcher Server")
     print("======================")
     print("Temporary replacement for Google Apps Script")
@@ -164,8 +231,10 @@ if __name__ == '__main__':
     for color in DULUX_COLORS:
         print(f"  - {color['name']} ({color['code']}) RGB({color['r']},{color['g']},{color['b']})")
     print("")
-    print("Starting server on http://localhost:5000")
-    print("To use with ESP32, update GOOGLE_SCRIPT_URL to: http://YOUR_IP:5000")
+    print(f"Starting server on {scheme}://localhost:{args.port}")
+    print(f"To use with ESP32, update GOOGLE_SCRIPT_URL to: {scheme}://YOUR_IP:{args.port}")
+    print(f"Apps Script-style redirect: {scheme}://YOUR_IP:{args.port}/exec")
     print("")
-    
-    app.run(host='0.0.0.0', port=5000, debug=True)
+
+    app.run(host=args.host, port=args.port, debug=True,
+            ssl_context=tuple(args.tls) if args.tls else None)
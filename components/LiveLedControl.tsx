@@ -161,7 +161,7 @@ const LiveLedControl: React.FC<LiveLedControlProps> = ({ showToast, initialLedSt
 
   const fetchMetrics = async () => {
     try {
-      const response = await fetch(`${DEVICE_BASE_URL}/live-metrics`, {
+      const response = await fetch(`${DEVICE_BASE_URL}/live-metrics?maxAge=2000`, {
         method: 'GET',
         headers: { 'Accept': 'application/json' },
       });
@@ -80,7 +80,7 @@ export default function LiveSensorMetrics({
 
   const fetchMetrics = async () => {
     try {
-      const response = await fetch(`${DEVICE_BASE_URL}/live-metrics`, {
+      const response = await fetch(`${DEVICE_BASE_URL}/live-metrics?maxAge=${updateInterval}`, {
         method: 'GET',
         headers: {
           'Accept': 'application/json',
@@ -1,4 +1,4 @@
-import React, { useState } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
 import { ColorSample } from '../types';
 import Card from './ui/Card';
 import ColorSwatch from './ColorSwatch';
@@ -7,7 +7,11 @@ import * as apiService from '../services/apiService';
 
 interface SampleListProps {
   samples: ColorSample[];
+  total: number; // Samples stored on the device, including pages not yet loaded
+  hasMore: boolean;
   isLoading: boolean;
+  isLoadingMore: boolean;
+  onLoadMore: () => void; // Fetch the next page when the end of the list scrolls into view
   error: string | null;
   onSampleDeleted: () => void; // Callback to refresh samples list
   showToast: (message: string, type: 'success' | 'error', customDuration?: number) => void;
@@ -15,11 +19,10 @@ interface SampleListProps {
 
 interface SampleItemProps {
   sample: ColorSample;
-  index: number;
-  onDelete: (index: number) => void;
+  onDelete: (id: number) => void;
 }
 
-const SampleItem: React.FC<SampleItemProps> = ({ sample, index, onDelete }) => {
+const SampleItem: React.FC<SampleItemProps> = ({ sample, onDelete }) => {
   const [isDeleting, setIsDeleting] = useState(false);
 
   const handleDelete = async (e: React.MouseEvent) => {
@@ -29,7 +32,7 @@ const SampleItem: React.FC<SampleItemProps> = ({ sample, index, onDelete }) => {
     if (window.confirm('Are you sure you want to delete this sample?')) {
       setIsDeleting(true);
       try {
-        await onDelete(index);
+        await onDelete(sample.id as number);
       } finally {
         setIsDeleting(false);
       }
@@ -74,13 +77,39 @@ const SampleItem: React.FC<SampleItemProps> = ({ sample, index, onDelete }) => {
   );
 };
 
-const SampleList: React.FC<SampleListProps> = ({ samples, isLoading, error, onSampleDeleted, showToast }) => {
+const SampleList: React.FC<SampleListProps> = ({
+  samples,
+  total,
+  hasMore,
+  isLoading,
+  isLoadingMore,
+  onLoadMore,
+  error,
+  onSampleDeleted,
+  showToast
+}) => {
   const [isDeleting, setIsDeleting] = useState(false);
   const [showDeleteAllConfirm, setShowDeleteAllConfirm] = useState(false);
+  const listRef = useRef<HTMLUListElement>(null);
+  const sentinelRef = useRef<HTMLLIElement>(null);
 
-  const handleDeleteSample = async (index: number) => {
+  // Infinite scroll: request the next page once the sentinel at the end of the list is visible
+  useEffect(() => {
+    const sentinel = sentinelRef.current;
+    if (!sentinel || !hasMore) return;
+    const observer = new IntersectionObserver(
+      entries => {
+        if (entries[0].isIntersecting) onLoadMore();
+      },
+      { root: listRef.current, rootMargin: '120px' }
+    );
+    observer.observe(sentinel);
+    return () => observer.disconnect();
+  }, [hasMore, onLoadMore, samples.length]);
+
+  const handleDeleteSample = async (id: number) => {
     try {
-      const result = await apiService.deleteSample(index);
+      const result = await apiService.deleteSample(id);
       if (result.success) {
         showToast('Sample deleted successfully!', 'success');
         onSampleDeleted(); // Refresh the samples list
@@ -141,18 +170,23 @@ const SampleList: React.FC<SampleListProps> = ({ samples, isLoading, error, onSa
           </div>
 
           {/* Samples List */}
-          <ul className="space-y-3 max-h-96 overflow-y-auto pr-2">
-            {samples.map((sample, index) => (
-              // Assuming timestamp can be a unique enough key for this context
-              // For production, a stable unique ID per sample would be better
+          <ul ref={listRef} className="space-y-3 max-h-96 overflow-y-auto pr-2">
+            {samples.map(sample => (
               <SampleItem
-                key={`${sample.timestamp}-${index}`}
+                key={sample.id}
                 sample={sample}
-                index={index}
                 onDelete={handleDeleteSample}
               />
             ))}
+            {hasMore && (
+              <li ref={sentinelRef} className="py-2 text-center text-xs text-slate-400">
+                {isLoadingMore ? 'Loading more samples...' : ' '}
+              </li>
+            )}
           </ul>
+          <p className="mt-2 text-xs text-slate-500">
+            Showing {samples.length} of {total} samples
+          </p>
 
           {/* Confirmation Dialog */}
           {showDeleteAllConfirm && (
@@ -160,7 +194,7 @@ const SampleList: React.FC<SampleListProps> = ({ samples, isLoading, error, onSa
               <div className="bg-slate-800 p-6 rounded-lg shadow-xl max-w-md w-full mx-4">
                 <h3 className="text-lg font-semibold text-slate-100 mb-4">Confirm Delete All</h3>
                 <p className="text-slate-300 mb-6">
-                  Are you sure you want to delete all {samples.length} saved samples? This action cannot be undone.
+                  Are you sure you want to delete all {total} saved samples? This action cannot be undone.
                 </p>
                 <div className="flex justify-end space-x-3">
                   <button
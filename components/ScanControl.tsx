@@ -38,7 +38,7 @@ const ScanControl: React.FC<ScanControlProps> = ({ onSampleSaved, showToast }) =
     }
     setIsSaving(true);
     try {
-      await apiService.saveSample(scannedColor.r, scannedColor.g, scannedColor.b);
+      await apiService.saveSample(scannedColor.r, scannedColor.g, scannedColor.b, scannedColor.scanId);
       showToast('Sample saved!', 'success');
       onSampleSaved(); // Trigger samples refresh
       setScannedColor(null); // Clear after saving
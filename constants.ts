@@ -14,6 +14,9 @@ export const API_PATHS = {
   BRIGHTNESS: '/brightness',
 } as const;
 
+// Sample list paging - page size must not exceed SAMPLE_PAGE_MAX_LIMIT on the ESP32
+export const SAMPLE_PAGE_SIZE = 50;
+
 // UI Constants
 export const COLORS = {
   PRIMARY: 'blue',
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+Benchmark Report Compare
+Prints a benchmark report, or diffs two reports from the bench firmware or the
+host build. Each input may be the bare JSON report or a serial/console log that
+contains it between the BENCH REPORT BEGIN/END marker lines.
+
+  python scripts/bench_compare.py new.log
+  python scripts/bench_compare.py baseline.log new.log --threshold 10
+
+Cases are compared on their fastest run by default, which is the least
+disturbed by other work on the machine; --metric median is available too.
+Exits with 1 when any case is slower than the threshold or its checksum
+changed, so it can gate a build.
+"""
+
+import argparse
+import json
+import sys
+
+BEGIN_MARKER = "=== BENCH REPORT BEGIN ==="
+END_MARKER = "=== BENCH REPORT END ==="
+
+
+def load_report(path):
+    """Load a report from a JSON file or from the marked section of a log"""
+    with open(path, encoding="utf-8", errors="replace") as f:
+        text = f.read()
+    if BEGIN_MARKER in text:
+        text = text.split(BEGIN_MARKER, 1)[1].split(END_MARKER, 1)[0]
+    report = json.loads(text.strip())
+    if report.get("schema") != 1:
+        raise ValueError(f"{path}: unsupported report schema {report.get('schema')}")
+    return report
+
+
+def describe(report):
+    return (f"{report.get('target')} build {report.get('build')} "
+            f"({report.get('compiled')}, ops x{report.get('opsScale')})")
+
+
+def print_report(report):
+    print(describe(report))
+    print(f"{'case':<18}{'ops':>8}{'min ns':>14}{'median ns':>14}{'max ns':>14}")
+    for case in report["cases"]:
+        if case.get("failed"):
+            print(f"{case['name']:<18}{'FAILED':>8}")
+            continue
+        print(f"{case['name']:<18}{case['ops']:>8}{case['minNs']:>14.1f}"
+              f"{case['medianNs']:>14.1f}{case['maxNs']:>14.1f}")
+
+
+def compare(baseline, current, threshold, metric):
+    """Print per-case changes in one metric; returns the number of problems found"""
+    if baseline.get("target") != current.get("target"):
+        print(f"warning: comparing {baseline.get('target')} with {current.get('target')}")
+    if baseline.get("opsScale") != current.get("opsScale"):
+        print("warning: reports use different operation counts")
+
+    print(f"baseline: {describe(baseline)}")
+    print(f"current:  {describe(current)}")
+    print(f"{'case':<18}{'baseline ns':>14}{'current ns':>14}{'change':>10}  note ({metric})")
+
+    base_cases = {c["name"]: c for c in baseline["cases"]}
+    problems = 0
+    for case in current["cases"]:
+        name = case["name"]
+        base = base_cases.pop(name, None)
+        if case.get("failed"):
+            print(f"{name:<18}{'':>14}{'FAILED':>14}")
+            problems += 1
+            continue
+        if base is None or base.get("failed"):
+            print(f"{name:<18}{'-':>14}{case[metric]:>14.1f}{'':>10}  new")
+            continue
+
+        change = (case[metric] - base[metric]) / base[metric] * 100.0
+        notes = []
+        if change > threshold:
+            notes.append("REGRESSION")
+            problems += 1
+        elif change < -threshold:
+            notes.append("faster")
+        if case.get("checksum") != base.get("checksum"):
+            notes.append("OUTPUT CHANGED")
+            problems += 1
+        print(f"{name:<18}{base[metric]:>14.1f}{case[metric]:>14.1f}{change:>+9.1f}%  {' '.join(notes)}")
+
+    for name in base_cases:
+        print(f"{name:<18}{'':>14}{'missing':>14}")
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Print or compare benchmark reports")
+    parser.add_argument("reports", nargs="+", help="report or log: one to print, two to compare")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="slowdown in percent that counts as a regression (default 10)")
+    parser.add_argument("--metric", choices=["min", "median"], default="min",
+                        help="per-operation time to compare (default min)")
+    args = parser.parse_args()
+
+    if len(args.reports) > 2:
+        parser.error("give one report to print or two to compare")
+
+    reports = [load_report(path) for path in args.reports]
+    if len(reports) == 1:
+        print_report(reports[0])
+        return 0
+
+    problems = compare(reports[0], reports[1], args.threshold, args.metric + "Ns")
+    print(f"\n{problems} problem(s) at a {args.threshold:.0f}% threshold")
+    return 1 if problems else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
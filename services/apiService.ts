@@ -2,7 +2,13 @@
 import {
   DeviceStatus,
   ColorSample,
+  SaveSampleResponse,
+  MatchEvent,
+  SamplePage,
+  SamplePageQuery,
   ScannedColorData,
+  TransferFormat,
+  TransferImportResult,
   CalibrationStatusResponse,
   MatrixCalibrationStatus,
   MatrixCalibrationStartResponse,
@@ -12,7 +18,7 @@ import {
   MatrixCalibrationResultsResponse,
   MatrixCalibrationApplyResponse
 } from '../types';
-import { DEVICE_BASE_URL } from '../constants';
+import { DEVICE_BASE_URL, SAMPLE_PAGE_SIZE } from '../constants';
 
 const API_BASE_URL = DEVICE_BASE_URL; // Use ESP32 device IP address
 
@@ -54,13 +60,20 @@ export async function startScan(): Promise<ScannedColorData> {
   return handleResponse<ScannedColorData>(response);
 }
 
-export async function saveSample(r: number, g: number, b: number): Promise<string> {
+export async function saveSample(r: number, g: number, b: number, scanId?: number): Promise<SaveSampleResponse> {
   const response = await fetch(`${API_BASE_URL}/save`, {
     method: 'POST',
     headers: { 'Content-Type': 'application/json' },
-    body: JSON.stringify({ r, g, b }),
+    body: JSON.stringify({ r, g, b, scanId }),
   });
-  return handleResponse<string>(response); // Expects "Sample saved" or error
+  return handleResponse<SaveSampleResponse>(response); // Paint match arrives later via subscribeMatchEvents
+}
+
+// Paint-match results pushed by the device; returns a function that closes the stream
+export function subscribeMatchEvents(onMatch: (event: MatchEvent) => void): () => void {
+  const source = new EventSource(`${API_BASE_URL}/events`);
+  source.addEventListener('match', (e) => onMatch(JSON.parse((e as MessageEvent).data) as MatchEvent));
+  return () => source.close();
 }
 
 export async function getSavedSamples(): Promise<{ samples: ColorSample[] }> {
@@ -68,11 +81,23 @@ export async function getSavedSamples(): Promise<{ samples: ColorSample[] }> {
   return handleResponse<{ samples: ColorSample[] }>(response);
 }
 
-export async function deleteSample(index: number): Promise<{ success: boolean; message: string }> {
+export async function getSamplesPage(query: SamplePageQuery = {}): Promise<SamplePage> {
+  const params = new URLSearchParams();
+  params.set('limit', String(query.limit ?? SAMPLE_PAGE_SIZE));
+  params.set('order', query.order ?? 'desc');
+  if (query.cursor) params.set('cursor', String(query.cursor));
+  if (query.offset) params.set('offset', String(query.offset));
+  if (query.since) params.set('since', String(query.since));
+  if (query.code) params.set('code', query.code);
+  const response = await fetch(`${API_BASE_URL}/samples?${params.toString()}`);
+  return handleResponse<SamplePage>(response);
+}
+
+export async function deleteSample(id: number): Promise<{ success: boolean; message: string }> {
   const response = await fetch(`${API_BASE_URL}/delete`, {
     method: 'POST',
     headers: { 'Content-Type': 'application/json' },
-    body: JSON.stringify({ index }),
+    body: JSON.stringify({ id }),
   });
   return handleResponse<{ success: boolean; message: string }>(response);
 }
@@ -85,6 +110,36 @@ export async function clearAllSamples(): Promise<{ success: boolean; message: st
   return handleResponse<{ success: boolean; message: string }>(response);
 }
 
+// Streamed by the device row by row; open directly or use as a download link
+export function getSampleExportUrl(format: TransferFormat = 'ndjson'): string {
+  return `${API_BASE_URL}/samples/export?format=${format}`;
+}
+
+export function getCalibrationExportUrl(format: TransferFormat = 'ndjson'): string {
+  return `${API_BASE_URL}/calibration/export?format=${format}`;
+}
+
+// The file is sent as the raw body (not multipart) so the device can parse it as it arrives
+export async function importSamples(file: Blob, format: TransferFormat, replace = false): Promise<TransferImportResult> {
+  const params = new URLSearchParams({ format });
+  if (replace) params.set('replace', '1');
+  const response = await fetch(`${API_BASE_URL}/samples/import?${params.toString()}`, {
+    method: 'POST',
+    headers: { 'Content-Type': format === 'csv' ? 'text/csv' : 'application/x-ndjson' },
+    body: file,
+  });
+  return handleResponse<TransferImportResult>(response);
+}
+
+export async function importCalibration(file: Blob, format: TransferFormat): Promise<TransferImportResult> {
+  const response = await fetch(`${API_BASE_URL}/calibration/import?format=${format}`, {
+    method: 'POST',
+    headers: { 'Content-Type': format === 'csv' ? 'text/csv' : 'application/x-ndjson' },
+    body: file,
+  });
+  return handleResponse<TransferImportResult>(response);
+}
+
 export async function updateSettings(settings: Partial<DeviceStatus>): Promise<string> {
   const response = await fetch(`${API_BASE_URL}/settings`, {
     method: 'POST',
@@ -1,4 +1,6 @@
 #include "TCS3430Calibration.h"
+#include "data_transfer.h"
+#include <LittleFS.h>
 #include <math.h>
 #include <esp_log.h>
 
@@ -135,37 +137,35 @@ bool TCS3430Calibration::configureSensor(const TCS3430SensorConfig& config) {
         return false;
     }
     
-    try {
-        // Set integration time (ATIME register)
-        sensor->setIntegrationTime(config.atime);
-        
-        // Set analog gain (AGAIN register)
-        sensor->setALSGain(config.again);
-        
-        // Set wait time (WTIME register)
-        sensor->setWaitTime(config.wtime);
-        
-        // Configure auto-zero mode
-        sensor->setAutoZeroMode(config.auto_zero_enabled ? 1 : 0);
-        sensor->setAutoZeroNTHIteration(config.auto_zero_frequency);
-        
-        // Enable ALS and power on - use public method
-        // Note: setPowerALSADC() is private, so we'll use the public begin() method approach
-        // or access through public interface
-        
-        // Store configuration
-        sensorConfig = config;
-        
-        LOG_CAL_INFO("Sensor configured: ATIME=%d, AGAIN=%d, WTIME=%d, AutoZero=%s", 
-                     config.atime, config.again, config.wtime, 
-                     config.auto_zero_enabled ? "enabled" : "disabled");
-        
-        return true;
-    } catch (...) {
+    sensor->clearError();
+
+    // Set integration time (ATIME register)
+    sensor->setIntegrationTime(config.atime);
+
+    // Set analog gain (AGAIN register)
+    sensor->setALSGain(config.again);
+
+    // Set wait time (WTIME register)
+    sensor->setWaitTime(config.wtime);
+
+    // Configure auto-zero mode
+    sensor->setAutoZeroMode(config.auto_zero_enabled ? 1 : 0);
+    sensor->setAutoZeroNTHIteration(config.auto_zero_frequency);
+
+    if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
         setError(CalibrationError::I2C_READ_FAILED);
-        LOG_CAL_ERROR("Failed to configure sensor - I2C error");
+        LOG_CAL_ERROR("Failed to configure sensor - I2C error %d", sensor->getLastError());
         return false;
     }
+
+    // Store configuration
+    sensorConfig = config;
+
+    LOG_CAL_INFO("Sensor configured: ATIME=%d, AGAIN=%d, WTIME=%d, AutoZero=%s",
+                 config.atime, config.again, config.wtime,
+                 config.auto_zero_enabled ? "enabled" : "disabled");
+
+    return true;
 }
 
 bool TCS3430Calibration::loadFactoryDefaults() {
@@ -218,31 +218,37 @@ RawChannelData TCS3430Calibration::readRawChannels() {
     
     // Retry mechanism for I2C reads
     for (int retry = 0; retry < CALIBRATION_RETRIES; retry++) {
-        try {
-            // Wait for sensor stabilization per datasheet timing requirements
-            delay(SENSOR_STABILIZE_DELAY_MS);
-            
-            // Read all channels per datasheet channel mapping
-            // TCS3430 channel mapping: CH0=Z, CH1=Y, CH2=IR1, CH3=X
-            data.r = sensor->getXData();    // CH3 (X channel)
-            data.g = sensor->getYData();    // CH1 (Y channel)
-            data.b = sensor->getZData();    // CH0 (Z channel)
-            data.ir = sensor->getIR1Data(); // CH2 (IR1 channel)
-            
-            // Check for saturation
-            data.saturated = checkSaturation(data);
-            data.valid = true;
-            
-            LOG_CAL_DEBUG("Raw channels read: R=%d, G=%d, B=%d, IR=%d, Saturated=%s", 
-                         data.r, data.g, data.b, data.ir, data.saturated ? "YES" : "NO");
-            
-            return data;
-            
-        } catch (...) {
-            LOG_CAL_WARN("I2C read failed, retry %d/%d", retry + 1, CALIBRATION_RETRIES);
+        // Wait for sensor stabilization per datasheet timing requirements
+        delay(SENSOR_STABILIZE_DELAY_MS);
+
+        // Read all channels per datasheet channel mapping
+        // TCS3430 channel mapping: CH0=Z, CH1=Y, CH2=IR1, CH3=X
+        sensor->clearError();
+        data.r = sensor->getXData();    // CH3 (X channel)
+        data.g = sensor->getYData();    // CH1 (Y channel)
+        data.b = sensor->getZData();    // CH0 (Z channel)
+        data.ir = sensor->getIR1Data(); // CH2 (IR1 channel)
+
+        // Failed reads return zeros rather than throwing; the driver counts
+        // them and recovers the bus after repeated failures
+        if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+            LOG_CAL_WARN("I2C read failed (error %d), retry %d/%d",
+                         sensor->getLastError(), retry + 1, CALIBRATION_RETRIES);
             delay(50); // Brief delay before retry
+            continue;
         }
+
+        // Check for saturation
+        data.saturated = checkSaturation(data);
+        data.valid = true;
+
+        LOG_CAL_DEBUG("Raw channels read: R=%d, G=%d, B=%d, IR=%d, Saturated=%s",
+                     data.r, data.g, data.b, data.ir, data.saturated ? "YES" : "NO");
+
+        return data;
     }
+
+    data.r = data.g = data.b = data.ir = 0;
     
     setError(CalibrationError::I2C_READ_FAILED);
     LOG_CAL_ERROR("Failed to read raw channels after %d retries", CALIBRATION_RETRIES);
@@ -257,33 +263,33 @@ bool TCS3430Calibration::performAutoZero() {
 
     LOG_CAL_INFO("Performing auto-zero calibration sequence");
 
-    try {
-        // Note: disableALSADC() and setPowerALSADC() are private methods
-        // We'll use alternative approach through public methods
-
-        // Use public methods to achieve auto-zero sequence
-        // The sensor should already be initialized from begin()
-
-        // Wait for auto-zero completion (per datasheet timing)
-        uint32_t startTime = millis();
-        while ((millis() - startTime) < AUTO_ZERO_TIMEOUT_MS) {
-            uint8_t status = sensor->getDeviceStatus();
-            // Check if auto-zero is complete (implementation depends on status register bits)
-            if ((status & 0x01) == 0) { // Assuming bit 0 indicates auto-zero in progress
-                break;
-            }
-            delay(10);
+    // Note: disableALSADC() and setPowerALSADC() are private methods
+    // We'll use alternative approach through public methods
+
+    // Use public methods to achieve auto-zero sequence
+    // The sensor should already be initialized from begin()
+
+    // Wait for auto-zero completion (per datasheet timing)
+    sensor->clearError();
+    uint32_t startTime = millis();
+    while ((millis() - startTime) < AUTO_ZERO_TIMEOUT_MS) {
+        uint8_t status = sensor->getDeviceStatus();
+        if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+            // A failed read returns 0, which would look like completion
+            setError(CalibrationError::AUTO_ZERO_FAILED);
+            LOG_CAL_ERROR("Auto-zero calibration failed - I2C error %d", sensor->getLastError());
+            return false;
         }
-
-        lastAutoZero = millis();
-        LOG_CAL_INFO("Auto-zero calibration completed");
-        return true;
-
-    } catch (...) {
-        setError(CalibrationError::AUTO_ZERO_FAILED);
-        LOG_CAL_ERROR("Auto-zero calibration failed - I2C error");
-        return false;
+        // Check if auto-zero is complete (implementation depends on status register bits)
+        if ((status & 0x01) == 0) { // Assuming bit 0 indicates auto-zero in progress
+            break;
+        }
+        delay(10);
     }
+
+    lastAutoZero = millis();
+    LOG_CAL_INFO("Auto-zero calibration completed");
+    return true;
 }
 
 bool TCS3430Calibration::checkSaturation(const RawChannelData& raw) {
@@ -973,62 +979,101 @@ bool TCS3430Calibration::loadCalibration() {
 }
 
 bool TCS3430Calibration::exportCalibrationData(const char* filename) {
-    // For now, just log the export request
-    // In a full implementation, this would write to LittleFS
     LOG_CAL_INFO("Export calibration data requested to file: %s", filename);
 
-    // Create JSON export data
-    JsonDocument doc;
-    doc["timestamp"] = millis();
-    doc["version"] = "1.0";
-    doc["device"] = "TCS3430";
+    File file = LittleFS.open(filename, "w");
+    if (!file) {
+        setError(CalibrationError::STORAGE_FAILED);
+        LOG_CAL_ERROR("Failed to open %s for calibration export", filename);
+        return false;
+    }
+    size_t rows = exportCalibrationData(file, TRANSFER_NDJSON);
+    file.close();
+    (void)rows;  // Only logged
 
-    // Export calibration matrices
-    if (calibration.lowIR.valid) {
-        JsonArray lowMatrix = doc["lowIR"]["matrix"].to<JsonArray>();
-        for (int i = 0; i < CALIBRATION_MATRIX_SIZE; i++) {
-            lowMatrix.add(calibration.lowIR.matrix[i]);
-        }
-        doc["lowIR"]["kX"] = calibration.lowIR.kX;
-        doc["lowIR"]["kY"] = calibration.lowIR.kY;
-        doc["lowIR"]["kZ"] = calibration.lowIR.kZ;
-        doc["lowIR"]["source"] = calibration.lowIR.source;
-        doc["lowIR"]["timestamp"] = calibration.lowIR.timestamp;
+    LOG_CAL_INFO("Calibration export wrote %u rows to %s", (unsigned)rows, filename);
+    return true;
+}
+
+static_assert(sizeof(CalibrationRecord::name) >= sizeof(TCS3430CalibrationMatrix::source),
+              "calibration export would truncate matrix source labels");
+
+static void matrixToRecord(const TCS3430CalibrationMatrix& matrix, const char* kind, CalibrationRecord& record) {
+    memset(&record, 0, sizeof(record));
+    strncpy(record.kind, kind, sizeof(record.kind) - 1);
+    snprintf(record.name, sizeof(record.name), "%s", matrix.source);
+    record.timestamp = matrix.timestamp;
+    for (int i = 0; i < CALIBRATION_MATRIX_SIZE; i++) {
+        record.values[record.count++] = matrix.matrix[i];
     }
+    record.values[record.count++] = matrix.kX;
+    record.values[record.count++] = matrix.kY;
+    record.values[record.count++] = matrix.kZ;
+}
+
+size_t TCS3430Calibration::exportCalibrationData(Print& out, TransferFormat format) {
+    CalibrationRecord record;
+    size_t rows = 0;
 
+    // Calibration matrices: 16 row-major coefficients, then kX, kY, kZ
+    if (calibration.lowIR.valid) {
+        matrixToRecord(calibration.lowIR, "lowIR", record);
+        writeCalibrationRow(out, format, record);
+        rows++;
+    }
     if (calibration.highIR.valid) {
-        JsonArray highMatrix = doc["highIR"]["matrix"].to<JsonArray>();
-        for (int i = 0; i < CALIBRATION_MATRIX_SIZE; i++) {
-            highMatrix.add(calibration.highIR.matrix[i]);
-        }
-        doc["highIR"]["kX"] = calibration.highIR.kX;
-        doc["highIR"]["kY"] = calibration.highIR.kY;
-        doc["highIR"]["kZ"] = calibration.highIR.kZ;
-        doc["highIR"]["source"] = calibration.highIR.source;
-        doc["highIR"]["timestamp"] = calibration.highIR.timestamp;
+        matrixToRecord(calibration.highIR, "highIR", record);
+        writeCalibrationRow(out, format, record);
+        rows++;
     }
 
-    // Export reference points
-    JsonArray refs = doc["referencePoints"].to<JsonArray>();
+    // Reference points: ref r, g, b, sensor r, g, b, ir, delta E
     for (uint8_t i = 0; i < numReferences; i++) {
-        JsonObject ref = refs.add<JsonObject>();
-        ref["name"] = references[i].name;
-        ref["ref_r"] = references[i].ref_r;
-        ref["ref_g"] = references[i].ref_g;
-        ref["ref_b"] = references[i].ref_b;
-        ref["sensor_r"] = references[i].sensor_r;
-        ref["sensor_g"] = references[i].sensor_g;
-        ref["sensor_b"] = references[i].sensor_b;
-        ref["sensor_ir"] = references[i].sensor_ir;
-        ref["delta_e"] = references[i].delta_e;
+        const CalibrationReference& ref = references[i];
+        memset(&record, 0, sizeof(record));
+        strcpy(record.kind, "reference");
+        strncpy(record.name, ref.name, sizeof(record.name) - 1);
+        float values[] = {(float)ref.ref_r, (float)ref.ref_g, (float)ref.ref_b, (float)ref.sensor_r,
+                          (float)ref.sensor_g, (float)ref.sensor_b, (float)ref.sensor_ir, ref.delta_e};
+        for (float v : values) {
+            record.values[record.count++] = v;
+        }
+        writeCalibrationRow(out, format, record);
+        rows++;
     }
+    return rows;
+}
 
-    // For now, just log the JSON (in full implementation, write to file)
-    String jsonStr;
-    serializeJsonPretty(doc, jsonStr);
-    LOG_CAL_INFO("Calibration export data:\n%s", jsonStr.c_str());
+bool TCS3430Calibration::importCalibrationRecord(const CalibrationRecord& record) {
+    MatrixType type;
+    if (strcmp(record.kind, "lowIR") == 0) {
+        type = MatrixType::LOW_IR;
+    } else if (strcmp(record.kind, "highIR") == 0) {
+        type = MatrixType::HIGH_IR;
+    } else {
+        return false;
+    }
+    if (record.count != CALIBRATION_MATRIX_SIZE + 3) {
+        setError(CalibrationError::INVALID_MATRIX);
+        LOG_CAL_ERROR("Imported %s matrix has %u values, expected %u",
+                      record.kind, record.count, CALIBRATION_MATRIX_SIZE + 3);
+        return false;
+    }
+    return importCalibrationMatrix(record.values, &record.values[CALIBRATION_MATRIX_SIZE], type);
+}
 
-    return true; // Would return actual file write success
+bool TCS3430Calibration::importCalibrationMatrix(const float matrix[CALIBRATION_MATRIX_SIZE],
+                                                const float scaling[3], MatrixType type) {
+    // Check both parts first so a rejected import leaves the old matrix whole
+    if (!validateMatrix(matrix) || scaling[0] <= 0.0f || scaling[1] <= 0.0f || scaling[2] <= 0.0f) {
+        setError(CalibrationError::INVALID_MATRIX);
+        LOG_CAL_ERROR("Rejected imported calibration matrix");
+        return false;
+    }
+    if (!setCalibrationMatrix(matrix, type)) {
+        return false;
+    }
+    return setScalingFactors(scaling[0], scaling[1], scaling[2], type);
 }
 
 void TCS3430Calibration::getSensorDiagnostics(JsonDocument& doc) {
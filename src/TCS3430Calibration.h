@@ -6,6 +6,10 @@
 #include <DFRobot_TCS3430.h>
 #include <ArduinoJson.h>
 
+// Row codec types from data_transfer.h
+enum TransferFormat : uint8_t;
+struct CalibrationRecord;
+
 // ============================================================================
 // CONSTANTS AND CONFIGURATION
 // ============================================================================
@@ -397,11 +401,26 @@ public:
 
     /**
      * @brief Export calibration data for offline analysis
-     * @param filename Output filename for calibration data
+     * @param filename Output file on LittleFS (NDJSON, one row per item)
      * @return true if export successful
      */
     bool exportCalibrationData(const char* filename);
 
+    /**
+     * @brief Stream matrices and reference points as calibration rows
+     * @param out Destination (written row by row, no header)
+     * @param format Row format
+     * @return Number of rows written
+     */
+    size_t exportCalibrationData(Print& out, TransferFormat format);
+
+    /**
+     * @brief Apply one imported "lowIR"/"highIR" matrix row
+     * @param record Row with 16 matrix values followed by kX, kY, kZ
+     * @return true if applied; other kinds are ignored and return false
+     */
+    bool importCalibrationRecord(const CalibrationRecord& record);
+
     /**
      * @brief Import calibration matrix from external source
      * @param matrix 4x4 calibration matrix
@@ -0,0 +1,106 @@
+#include "boot_profile.h"
+
+BootProfile::BootProfile() {
+  memset(phases, 0, sizeof(phases));
+  memset((void*)stages, 0, sizeof(stages));
+  phaseCount = 0;
+  originUs = 0;
+  lastMarkUs = 0;
+  bootMillis = 0;
+}
+
+void BootProfile::begin() {
+  phaseCount = 0;
+  originUs = micros();
+  lastMarkUs = originUs;
+  bootMillis = millis();
+}
+
+void BootProfile::add(const char* name, uint32_t startUs, uint32_t durationUs) {
+  if (phaseCount >= BOOT_PROFILE_MAX_PHASES) {
+    return;
+  }
+  phases[phaseCount].name = name;
+  phases[phaseCount].startUs = startUs - originUs;
+  phases[phaseCount].durationUs = durationUs;
+  phaseCount++;
+}
+
+void BootProfile::mark(const char* name) {
+  uint32_t now = micros();
+  add(name, lastMarkUs, now - lastMarkUs);
+  lastMarkUs = now;
+}
+
+void BootProfile::record(const char* name, uint32_t startUs) {
+  add(name, startUs, micros() - startUs);
+}
+
+uint32_t BootProfile::elapsedUs() const {
+  return lastMarkUs - originUs;
+}
+
+void BootProfile::startStage(BootStage stage) {
+  stages[stage].startUs = micros() - originUs;
+  stages[stage].durationUs = 0;
+  stages[stage].state = BOOT_RUNNING;
+}
+
+void BootProfile::finishStage(BootStage stage, bool ok) {
+  stages[stage].durationUs = (micros() - originUs) - stages[stage].startUs;
+  stages[stage].state = ok ? BOOT_READY : BOOT_FAILED;
+}
+
+uint32_t BootProfile::stageElapsedUs(BootStage stage) const {
+  if (stages[stage].state == BOOT_RUNNING) {
+    return (micros() - originUs) - stages[stage].startUs;
+  }
+  return stages[stage].durationUs;
+}
+
+const char* BootProfile::stageName(BootStage stage) {
+  switch (stage) {
+    case BOOT_STAGE_SETTINGS: return "settings";
+    case BOOT_STAGE_WIFI: return "wifi";
+    case BOOT_STAGE_SENSOR: return "sensor";
+    case BOOT_STAGE_FILESYSTEM: return "filesystem";
+    case BOOT_STAGE_STORAGE: return "storage";
+    case BOOT_STAGE_WEB_SERVER: return "webServer";
+    default: return "unknown";
+  }
+}
+
+const char* BootProfile::stageStateName(BootStageState state) {
+  switch (state) {
+    case BOOT_PENDING: return "pending";
+    case BOOT_RUNNING: return "running";
+    case BOOT_READY: return "ready";
+    case BOOT_FAILED: return "failed";
+    default: return "unknown";
+  }
+}
+
+void BootProfile::getStats(JsonObject stats) const {
+  stats["startMs"] = bootMillis;
+  stats["setupUs"] = elapsedUs();
+  JsonArray list = stats["phases"].to<JsonArray>();
+  for (uint8_t i = 0; i < phaseCount; i++) {
+    JsonObject phase = list.add<JsonObject>();
+    phase["name"] = phases[i].name;
+    phase["startUs"] = phases[i].startUs;
+    phase["us"] = phases[i].durationUs;
+  }
+
+  bool allReady = true;
+  JsonObject stageList = stats["stages"].to<JsonObject>();
+  for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+    BootStage stage = (BootStage)i;
+    BootStageState state = stages[i].state;
+    JsonObject entry = stageList[stageName(stage)].to<JsonObject>();
+    entry["state"] = stageStateName(state);
+    entry["startUs"] = stages[i].startUs;
+    entry["us"] = stageElapsedUs(stage);
+    allReady = allReady && state == BOOT_READY;
+  }
+  stats["ready"] = allReady;
+}
@@ -0,0 +1,118 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Independently started parts of the boot; each tracks its own readiness
+enum BootStage : uint8_t {
+  BOOT_STAGE_SETTINGS = 0,    // NVS settings blob (sensor config depends on it)
+  BOOT_STAGE_WIFI,            // Association and IP, driven by the Wi-Fi task
+  BOOT_STAGE_SENSOR,          // I2C, TCS3430 power-up and calibration objects
+  BOOT_STAGE_FILESYSTEM,      // LittleFS mount (format on failure)
+  BOOT_STAGE_STORAGE,         // Samples, calibration data and persistence
+  BOOT_STAGE_WEB_SERVER,      // Routes registered and listening
+  BOOT_STAGE_COUNT
+};
+
+enum BootStageState : uint8_t {
+  BOOT_PENDING = 0,
+  BOOT_RUNNING = 1,
+  BOOT_READY = 2,
+  BOOT_FAILED = 3
+};
+
+/**
+ * @brief Microsecond timeline of the boot sequence
+ *
+ * setup() calls mark() as each phase finishes; a phase runs from the
+ * previous mark (or begin()) to its own. Finer-grained timings inside a
+ * phase, such as the settings read, are added with record(). The result is
+ * kept for the lifetime of the boot and reported under /status.
+ *
+ * Stages run concurrently (the sensor on its own task, Wi-Fi in the
+ * background), so they carry their own state and duration instead of being
+ * phases on the setup() timeline. Each stage is only ever written by the
+ * task that runs it.
+ */
+class BootProfile {
+private:
+  struct Phase {
+    const char* name;
+    uint32_t startUs;       // Relative to begin()
+    uint32_t durationUs;
+  };
+
+  struct Stage {
+    volatile BootStageState state;
+    uint32_t startUs;       // Relative to begin()
+    uint32_t durationUs;
+  };
+
+  Phase phases[BOOT_PROFILE_MAX_PHASES];
+  Stage stages[BOOT_STAGE_COUNT];
+  uint8_t phaseCount;
+  uint32_t originUs;
+  uint32_t lastMarkUs;
+  uint32_t bootMillis;      // millis() at begin(), includes ROM/bootloader time
+
+  void add(const char* name, uint32_t startUs, uint32_t durationUs);
+
+public:
+  BootProfile();
+
+  /**
+   * @brief Start the timeline; call first thing in setup()
+   */
+  void begin();
+
+  /**
+   * @brief Close the phase that started at the previous mark
+   * @param name Static string naming the phase
+   */
+  void mark(const char* name);
+
+  /**
+   * @brief Record a timed step without moving the phase boundary
+   * @param name Static string naming the step
+   * @param startUs micros() when the step started
+   */
+  void record(const char* name, uint32_t startUs);
+
+  /**
+   * @brief Time since begin() (total once setup() has finished)
+   */
+  uint32_t elapsedUs() const;
+
+  /**
+   * @brief Mark a stage as running and start its clock
+   */
+  void startStage(BootStage stage);
+
+  /**
+   * @brief Stop a stage's clock and record the outcome
+   *
+   * A failed stage may finish again later (for example Wi-Fi connecting
+   * after its boot timeout); the duration then covers the whole wait.
+   */
+  void finishStage(BootStage stage, bool ok);
+
+  BootStageState getStageState(BootStage stage) const { return stages[stage].state; }
+  bool isReady(BootStage stage) const { return stages[stage].state == BOOT_READY; }
+
+  /**
+   * @brief Stage duration so far (live while running)
+   */
+  uint32_t stageElapsedUs(BootStage stage) const;
+
+  static const char* stageName(BootStage stage);
+  static const char* stageStateName(BootStageState state);
+
+  /**
+   * @brief Add the timeline to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // BOOT_PROFILE_H
@@ -0,0 +1,299 @@
+#include "calibration_capture.h"
+#include "logging.h"
+#include "perf_profiler.h"
+#include <math.h>
+
+namespace {
+
+// Running mean and variance (Welford), one per channel
+struct ChannelAccumulator {
+  uint16_t n;
+  double mean;
+  double m2;
+  uint16_t min;
+  uint16_t max;
+
+  void add(uint16_t value) {
+    if (n == 0 || value < min) {
+      min = value;
+    }
+    if (n == 0 || value > max) {
+      max = value;
+    }
+    n++;
+    double delta = value - mean;
+    mean += delta / n;
+    m2 += delta * (value - mean);
+  }
+
+  void toStats(CaptureChannelStats& stats) const {
+    stats.frames = n;
+    stats.mean = (float)mean;
+    stats.sigma = n > 1 ? (float)sqrt(m2 / (n - 1)) : 0.0f;
+    stats.stdError = n > 1 ? stats.sigma / sqrtf((float)n) : 0.0f;
+    stats.min = min;
+    stats.max = max;
+  }
+};
+
+const char* const CHANNEL_NAMES[CAPTURE_CHANNEL_COUNT] = {"x", "y", "z", "ir1", "ir2"};
+
+// Z, Y and IR1 are valid in every conversion whatever CH3 carries
+void addShared(ChannelAccumulator* acc, const uint16_t raw[4]) {
+  acc[CAPTURE_Z].add(raw[0]);
+  acc[CAPTURE_Y].add(raw[1]);
+  acc[CAPTURE_IR1].add(raw[2]);
+}
+
+} // namespace
+
+CalibrationCapture::CalibrationCapture(DFRobot_TCS3430* tcs) {
+  sensor = tcs;
+  memset(lastRaw, 0, sizeof(lastRaw));
+  haveLast = false;
+  lastFreshUs = 0;
+  cycleUs = 0;
+  captures = 0;
+  targetsMet = 0;
+  failures = 0;
+  lastMs = 0;
+  lastFrames = 0;
+}
+
+bool CalibrationCapture::nextConversion(uint16_t raw[4], CalibrationCaptureResult& result, uint32_t startMs) {
+  const uint32_t pollUs = max(cycleUs / 16, (uint32_t)2000);
+
+  // Nothing new can arrive until a cycle after the last fresh conversion
+  uint32_t sinceFresh = micros() - lastFreshUs;
+  if (haveLast && sinceFresh + pollUs < cycleUs) {
+    delay((cycleUs - pollUs - sinceFresh) / 1000);
+  }
+
+  while (millis() - startMs < CAL_CAPTURE_TIMEOUT_MS) {
+    result.polls++;
+    uint32_t readStartUs = PerfProfiler::now();
+    bool read = sensor->getChannelData(raw[0], raw[1], raw[2], raw[3]);
+    perfProfiler.record(PERF_I2C_READ, PerfProfiler::now() - readStartUs);
+    if (!read) {
+      result.stop = CAPTURE_STOP_READ_FAILED;
+      return false;
+    }
+
+    uint32_t now = micros();
+    bool changed = memcmp(raw, lastRaw, sizeof(lastRaw)) != 0;
+    bool first = !haveLast;
+    memcpy(lastRaw, raw, sizeof(lastRaw));
+    haveLast = true;
+
+    if (first) {
+      // Baseline: whatever the previous conversion left in the data registers
+      lastFreshUs = now;
+    } else if (changed || now - lastFreshUs >= 2 * cycleUs + pollUs) {
+      lastFreshUs = now;
+      result.conversions++;
+      return true;
+    } else {
+      result.stalePolls++;
+    }
+    delay(pollUs / 1000);
+  }
+
+  result.stop = CAPTURE_STOP_TIMEOUT;
+  return false;
+}
+
+bool CalibrationCapture::capture(CalibrationCaptureResult& result, bool withIR2, uint16_t maxFrames,
+                                 bool restart) {
+  uint32_t startMs = millis();
+  memset(&result, 0, sizeof(result));
+  result.withIR2 = withIR2;
+  result.stop = CAPTURE_STOP_MAX_FRAMES;
+  cycleUs = sensor->getCycleTimeUs();
+  result.cycleUs = cycleUs;
+  haveLast = false;
+  lastFreshUs = micros();
+
+  ChannelAccumulator acc[CAPTURE_CHANNEL_COUNT];
+  memset(acc, 0, sizeof(acc));
+  uint16_t raw[4];
+
+  // Settling: the conversion in progress started under the old lighting
+  bool ok = true;
+  if (restart) {
+    sensor->restartConversion();
+  } else {
+    ok = nextConversion(raw, result, startMs);
+    if (ok) {
+      result.discarded++;
+    }
+  }
+
+  if (ok && withIR2) {
+    sensor->selectIR2Channel(true);
+    ok = nextConversion(raw, result, startMs);
+    if (ok) {
+      addShared(acc, raw);  // CH3 mixes X and IR2
+    }
+    for (uint8_t i = 0; ok && i < CAL_CAPTURE_IR2_FRAMES; i++) {
+      ok = nextConversion(raw, result, startMs);
+      if (ok) {
+        addShared(acc, raw);
+        acc[CAPTURE_IR2].add(raw[3]);
+      }
+    }
+    sensor->selectIR2Channel(false);
+    if (ok) {
+      ok = nextConversion(raw, result, startMs);
+      if (ok) {
+        addShared(acc, raw);  // CH3 mixes IR2 and X
+      }
+    }
+  }
+
+  while (ok) {
+    ok = nextConversion(raw, result, startMs);
+    if (!ok) {
+      break;
+    }
+    addShared(acc, raw);
+    acc[CAPTURE_X].add(raw[3]);
+
+    if (acc[CAPTURE_X].n >= CAL_CAPTURE_MIN_FRAMES) {
+      bool met = true;
+      for (uint8_t c = CAPTURE_X; c <= CAPTURE_Z && met; c++) {
+        CaptureChannelStats stats;
+        acc[c].toStats(stats);
+        met = targetMet(stats);
+      }
+      if (met) {
+        result.stop = CAPTURE_STOP_TARGET;
+        break;
+      }
+    }
+    if (acc[CAPTURE_X].n >= maxFrames) {
+      result.stop = CAPTURE_STOP_MAX_FRAMES;
+      break;
+    }
+  }
+
+  for (uint8_t c = 0; c < CAPTURE_CHANNEL_COUNT; c++) {
+    acc[c].toStats(result.channels[c]);
+  }
+  result.status = sensor->getDeviceStatus();
+  result.ms = millis() - startMs;
+
+  captures++;
+  lastMs = result.ms;
+  lastFrames = acc[CAPTURE_X].n;
+  if (result.stop == CAPTURE_STOP_TARGET) {
+    targetsMet++;
+  }
+
+  const CaptureChannelStats& x = result.channels[CAPTURE_X];
+  if (x.frames == 0) {
+    failures++;
+    LOG_SENSOR_ERROR("Calibration capture got no X conversions (%s after %lu ms)",
+                     stopReasonName(result.stop), (unsigned long)result.ms);
+    return false;
+  }
+
+  LOG_SENSOR_INFO("Calibration capture: %u X frames, %u conversions, %u stale polls in %lu ms (%s)",
+                  x.frames, result.conversions, result.stalePolls, (unsigned long)result.ms,
+                  stopReasonName(result.stop));
+  LOG_SENSOR_DEBUG("Capture sigma - X:%.1f Y:%.1f Z:%.1f IR1:%.1f IR2:%.1f (cycle %lu us)",
+                   x.sigma, result.channels[CAPTURE_Y].sigma, result.channels[CAPTURE_Z].sigma,
+                   result.channels[CAPTURE_IR1].sigma, result.channels[CAPTURE_IR2].sigma,
+                   (unsigned long)cycleUs);
+  return true;
+}
+
+bool CalibrationCapture::captureIR2(CaptureChannelStats& stats, uint8_t frames) {
+  uint32_t startMs = millis();
+  CalibrationCaptureResult scratch;
+  memset(&scratch, 0, sizeof(scratch));
+  memset(&stats, 0, sizeof(stats));
+  cycleUs = sensor->getCycleTimeUs();
+  haveLast = false;
+  lastFreshUs = micros();
+
+  ChannelAccumulator acc;
+  memset(&acc, 0, sizeof(acc));
+  uint16_t raw[4];
+
+  sensor->selectIR2Channel(true);
+  bool ok = nextConversion(raw, scratch, startMs);  // CH3 mixes X and IR2
+  for (uint8_t i = 0; ok && i < frames; i++) {
+    ok = nextConversion(raw, scratch, startMs);
+    if (ok) {
+      acc.add(raw[3]);
+    }
+  }
+  sensor->selectIR2Channel(false);
+  if (ok) {
+    nextConversion(raw, scratch, startMs);          // CH3 mixes IR2 and X
+  }
+
+  acc.toStats(stats);
+  if (stats.frames == 0) {
+    LOG_SENSOR_ERROR("IR2 capture got no conversions (%s after %lu ms)",
+                     stopReasonName(scratch.stop), (unsigned long)(millis() - startMs));
+    return false;
+  }
+  LOG_SENSOR_DEBUG("IR2 capture: %u frames, mean %.1f, sigma %.1f in %lu ms", stats.frames, stats.mean,
+                   stats.sigma, (unsigned long)(millis() - startMs));
+  return true;
+}
+
+bool CalibrationCapture::targetMet(const CaptureChannelStats& stats) {
+  if (stats.frames < 2) {
+    return false;
+  }
+  float target = max(CAL_CAPTURE_TARGET_REL_SE * stats.mean, CAL_CAPTURE_TARGET_ABS_SE);
+  return stats.stdError <= target;
+}
+
+void CalibrationCapture::describe(const CalibrationCaptureResult& result, JsonObject out) {
+  out["frames"] = result.channels[CAPTURE_X].frames;
+  out["ir2Frames"] = result.channels[CAPTURE_IR2].frames;
+  out["conversions"] = result.conversions;
+  out["discarded"] = result.discarded;
+  out["polls"] = result.polls;
+  out["stalePolls"] = result.stalePolls;
+  out["cycleUs"] = result.cycleUs;
+  out["ms"] = result.ms;
+  out["stop"] = stopReasonName(result.stop);
+  out["status"] = result.status;
+
+  JsonObject channels = out["channels"].to<JsonObject>();
+  for (uint8_t c = 0; c < CAPTURE_CHANNEL_COUNT; c++) {
+    const CaptureChannelStats& stats = result.channels[c];
+    if (stats.frames == 0) {
+      continue;
+    }
+    JsonObject ch = channels[CHANNEL_NAMES[c]].to<JsonObject>();
+    ch["mean"] = stats.mean;
+    ch["sigma"] = stats.sigma;
+    ch["stdError"] = stats.stdError;
+    ch["frames"] = stats.frames;
+    ch["min"] = stats.min;
+    ch["max"] = stats.max;
+  }
+}
+
+const char* CalibrationCapture::stopReasonName(CaptureStopReason reason) {
+  switch (reason) {
+    case CAPTURE_STOP_TARGET: return "target";
+    case CAPTURE_STOP_MAX_FRAMES: return "maxFrames";
+    case CAPTURE_STOP_TIMEOUT: return "timeout";
+    case CAPTURE_STOP_READ_FAILED: return "readFailed";
+    default: return "unknown";
+  }
+}
+
+void CalibrationCapture::getStats(JsonObject stats) const {
+  stats["captures"] = captures;
+  stats["targetsMet"] = targetsMet;
+  stats["failures"] = failures;
+  stats["lastMs"] = lastMs;
+  stats["lastFrames"] = lastFrames;
+}
@@ -0,0 +1,132 @@
+#ifndef CALIBRATION_CAPTURE_H
+#define CALIBRATION_CAPTURE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <DFRobot_TCS3430.h>
+#include "config.h"
+
+// Averaged channels; CH3 carries X or IR2 depending on the channel mux
+enum CaptureChannel : uint8_t {
+  CAPTURE_X = 0,
+  CAPTURE_Y,
+  CAPTURE_Z,
+  CAPTURE_IR1,
+  CAPTURE_IR2,
+  CAPTURE_CHANNEL_COUNT
+};
+
+// Why a capture stopped averaging
+enum CaptureStopReason : uint8_t {
+  CAPTURE_STOP_TARGET = 0,     // X, Y and Z reached the target standard error
+  CAPTURE_STOP_MAX_FRAMES,     // The frame budget ran out without reaching it
+  CAPTURE_STOP_TIMEOUT,        // CAL_CAPTURE_TIMEOUT_MS elapsed
+  CAPTURE_STOP_READ_FAILED     // An I2C burst read failed
+};
+
+struct CaptureChannelStats {
+  uint16_t frames;             // Conversions averaged into this channel
+  float mean;
+  float sigma;                 // Sample standard deviation between conversions
+  float stdError;              // sigma / sqrt(frames)
+  uint16_t min;
+  uint16_t max;
+};
+
+struct CalibrationCaptureResult {
+  CaptureChannelStats channels[CAPTURE_CHANNEL_COUNT];
+  bool withIR2;
+  uint16_t conversions;        // Fresh conversions read, discarded ones included
+  uint16_t discarded;          // Conversions dropped while the light settled (none after a restart)
+  uint16_t polls;              // Burst reads issued
+  uint16_t stalePolls;         // Burst reads that returned the previous conversion
+  uint8_t status;              // STATUS register after the last conversion
+  uint32_t cycleUs;            // ALS cycle time the reads were paced at
+  uint32_t ms;
+  CaptureStopReason stop;
+};
+
+/**
+ * @brief Averages fresh TCS3430 conversions for the white and black references
+ *
+ * The sensor has no data-valid flag, so a conversion counts as fresh when a
+ * burst read of CH0-CH3 differs from the previous one, or when two full ALS
+ * cycles have passed without a change (a perfectly steady signal). Reads are
+ * paced at the cycle time and only poll near the expected end of a conversion.
+ *
+ * - The first fresh conversion is discarded: it straddles the light change
+ *   made just before the capture. With restart the ALS cycle is restarted
+ *   instead, so the first conversion already sees only the new light.
+ * - With IR2, CH3 is switched to IR2 for CAL_CAPTURE_IR2_FRAMES conversions
+ *   and back. Z, Y and IR1 keep averaging throughout; only CH3 of the two
+ *   conversions spanning each switch is dropped.
+ * - Averaging stops once at least CAL_CAPTURE_MIN_FRAMES X conversions are in
+ *   and the X, Y and Z standard errors are within
+ *   max(CAL_CAPTURE_TARGET_REL_SE * mean, CAL_CAPTURE_TARGET_ABS_SE), or at
+ *   the frame budget (CAL_CAPTURE_MAX_FRAMES by default) / CAL_CAPTURE_TIMEOUT_MS.
+ *   The IR channels are small correction terms; their sigma is reported but
+ *   does not extend the capture.
+ *
+ * Called from the loop task only; blocks for the capture.
+ */
+class CalibrationCapture {
+private:
+  DFRobot_TCS3430* sensor;
+  uint16_t lastRaw[4];
+  bool haveLast;
+  uint32_t lastFreshUs;
+  uint32_t cycleUs;
+
+  uint32_t captures;
+  uint32_t targetsMet;
+  uint32_t failures;
+  uint32_t lastMs;
+  uint16_t lastFrames;
+
+  bool nextConversion(uint16_t raw[4], CalibrationCaptureResult& result, uint32_t startMs);
+
+public:
+  explicit CalibrationCapture(DFRobot_TCS3430* sensor);
+
+  /**
+   * @brief Average fresh conversions under the current lighting
+   * @param withIR2 Also sample IR2 (costs about CAL_CAPTURE_IR2_FRAMES + 1 extra cycles)
+   * @param maxFrames X conversions before giving up on the target
+   * @param restart Restart the ALS cycle instead of discarding the settling
+   *                conversion; saves most of a cycle when the light just changed
+   * @return false if no X conversion could be averaged
+   */
+  bool capture(CalibrationCaptureResult& result, bool withIR2, uint16_t maxFrames = CAL_CAPTURE_MAX_FRAMES,
+               bool restart = false);
+
+  /**
+   * @brief Average IR2 alone, for scans that read X, Y and Z themselves
+   *
+   * Switches CH3 to IR2, drops the conversion spanning the switch, averages
+   * frames conversions and switches back. One more conversion is waited out
+   * so the next X read does not see IR2. Costs about frames + 2 ALS cycles,
+   * where getIR2Data() costs a full restarted cycle per call.
+   *
+   * @return false if no IR2 conversion could be read
+   */
+  bool captureIR2(CaptureChannelStats& stats, uint8_t frames = CAL_CAPTURE_IR2_FRAMES);
+
+  /**
+   * @brief Whether a channel's standard error is within the capture target
+   */
+  static bool targetMet(const CaptureChannelStats& stats);
+
+  /**
+   * @brief Add a capture's per-channel mean, sigma and standard error to a JSON object
+   */
+  static void describe(const CalibrationCaptureResult& result, JsonObject out);
+
+  static const char* stopReasonName(CaptureStopReason reason);
+
+  /**
+   * @brief Add capture counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // CALIBRATION_CAPTURE_H
@@ -11,6 +11,13 @@
 #include "cie1931.h"
 #include <math.h>
 
+// Per-conversion trace; each line costs milliseconds on the serial port
+#if DEBUG_SENSOR_READINGS
+#define CIE_TRACE(...) Serial.printf(__VA_ARGS__)
+#else
+#define CIE_TRACE(...) do {} while (0)
+#endif
+
 // CIE 1931 XYZ to sRGB transformation matrix (D65 illuminant)
 // Based on IEC 61966-2-1:1999 sRGB standard
 static const float XYZ_TO_SRGB_MATRIX[3][3] = {
@@ -38,7 +45,7 @@ CIE_XYZ convertTCS3430ToXYZ(uint16_t rawX, uint16_t rawY, uint16_t rawZ,
     float z = (float)rawZ;
     float ir = (float)rawIR;
     
-    Serial.printf("[CIE1931] Raw TCS3430 values - X:%.0f Y:%.0f Z:%.0f IR:%.0f\n", x, y, z, ir);
+    CIE_TRACE("[CIE1931] Raw TCS3430 values - X:%.0f Y:%.0f Z:%.0f IR:%.0f\n", x, y, z, ir);
     
     // Apply spectral response correction
     x *= TCS3430_SPECTRAL_CORRECTION[0];
@@ -51,7 +58,7 @@ CIE_XYZ convertTCS3430ToXYZ(uint16_t rawX, uint16_t rawY, uint16_t rawZ,
     y = fmaxf(0.0f, y - irCompensation);
     z = fmaxf(0.0f, z - irCompensation);
     
-    Serial.printf("[CIE1931] After IR compensation - X:%.2f Y:%.2f Z:%.2f\n", x, y, z);
+    CIE_TRACE("[CIE1931] After IR compensation - X:%.2f Y:%.2f Z:%.2f\n", x, y, z);
 
     // Apply white reference calibration if available
     if (whiteRef.valid) {
@@ -70,7 +77,7 @@ CIE_XYZ convertTCS3430ToXYZ(uint16_t rawX, uint16_t rawY, uint16_t rawZ,
             y *= normY * whiteRef.scalingFactor;
             z *= normZ * whiteRef.scalingFactor;
 
-            Serial.printf("[CIE1931] After white reference calibration - X:%.2f Y:%.2f Z:%.2f\n", x, y, z);
+            CIE_TRACE("[CIE1931] After white reference calibration - X:%.2f Y:%.2f Z:%.2f\n", x, y, z);
         }
     } else {
         // No calibration available, use default scaling
@@ -78,7 +85,7 @@ CIE_XYZ convertTCS3430ToXYZ(uint16_t rawX, uint16_t rawY, uint16_t rawZ,
         y *= TCS3430_XYZ_NORMALIZATION_FACTOR / 65535.0f;
         z *= TCS3430_XYZ_NORMALIZATION_FACTOR / 65535.0f;
 
-        Serial.printf("[CIE1931] Using default scaling - X:%.2f Y:%.2f Z:%.2f\n", x, y, z);
+        CIE_TRACE("[CIE1931] Using default scaling - X:%.2f Y:%.2f Z:%.2f\n", x, y, z);
     }
     
     xyz.X = x;
@@ -96,28 +103,28 @@ sRGB convertXYZToSRGB(const CIE_XYZ& xyz) {
     float Y = xyz.Y / 100.0f;
     float Z = xyz.Z / 100.0f;
     
-    Serial.printf("[CIE1931] Normalized XYZ for sRGB conversion - X:%.4f Y:%.4f Z:%.4f\n", X, Y, Z);
+    CIE_TRACE("[CIE1931] Normalized XYZ for sRGB conversion - X:%.4f Y:%.4f Z:%.4f\n", X, Y, Z);
 
     // Apply XYZ to sRGB transformation matrix
     float r = XYZ_TO_SRGB_MATRIX[0][0] * X + XYZ_TO_SRGB_MATRIX[0][1] * Y + XYZ_TO_SRGB_MATRIX[0][2] * Z;
     float g = XYZ_TO_SRGB_MATRIX[1][0] * X + XYZ_TO_SRGB_MATRIX[1][1] * Y + XYZ_TO_SRGB_MATRIX[1][2] * Z;
     float b = XYZ_TO_SRGB_MATRIX[2][0] * X + XYZ_TO_SRGB_MATRIX[2][1] * Y + XYZ_TO_SRGB_MATRIX[2][2] * Z;
 
-    Serial.printf("[CIE1931] Linear RGB values - R:%.4f G:%.4f B:%.4f\n", r, g, b);
+    CIE_TRACE("[CIE1931] Linear RGB values - R:%.4f G:%.4f B:%.4f\n", r, g, b);
 
     // Apply gamma correction
     r = applySRGBGamma(r);
     g = applySRGBGamma(g);
     b = applySRGBGamma(b);
 
-    Serial.printf("[CIE1931] Gamma-corrected RGB - R:%.4f G:%.4f B:%.4f\n", r, g, b);
+    CIE_TRACE("[CIE1931] Gamma-corrected RGB - R:%.4f G:%.4f B:%.4f\n", r, g, b);
 
     // Clamp to valid range and convert to 8-bit
     rgb.r = (uint8_t)constrain(r * 255.0f, 0.0f, 255.0f);
     rgb.g = (uint8_t)constrain(g * 255.0f, 0.0f, 255.0f);
     rgb.b = (uint8_t)constrain(b * 255.0f, 0.0f, 255.0f);
 
-    Serial.printf("[CIE1931] Final sRGB values - R:%u G:%u B:%u\n", rgb.r, rgb.g, rgb.b);
+    CIE_TRACE("[CIE1931] Final sRGB values - R:%u G:%u B:%u\n", rgb.r, rgb.g, rgb.b);
     
     return rgb;
 }
@@ -146,7 +153,7 @@ CIE_xyY convertXYZToxyY(const CIE_XYZ& xyz) {
         xyY.Y = 0.0f;
     }
     
-    Serial.printf("[CIE1931] Chromaticity coordinates - x:%.4f y:%.4f Y:%.2f\n", xyY.x, xyY.y, xyY.Y);
+    CIE_TRACE("[CIE1931] Chromaticity coordinates - x:%.4f y:%.4f Y:%.2f\n", xyY.x, xyY.y, xyY.Y);
     
     return xyY;
 }
@@ -169,7 +176,7 @@ CIE_WhiteReference calibrateWhiteReference(uint16_t rawX, uint16_t rawY,
                                           uint16_t rawZ, uint16_t rawIR) {
     CIE_WhiteReference whiteRef;
     
-    Serial.printf("[CIE1931] Calibrating white reference with raw values - X:%u Y:%u Z:%u IR:%u\n",
+    CIE_TRACE("[CIE1931] Calibrating white reference with raw values - X:%u Y:%u Z:%u IR:%u\n",
                     rawX, rawY, rawZ, rawIR);
     
     // Convert raw values to floating point
@@ -201,7 +208,7 @@ CIE_WhiteReference calibrateWhiteReference(uint16_t rawX, uint16_t rawY,
     whiteRef.timestamp = millis();
     whiteRef.valid = (x > 0 && y > 0 && z > 0);
     
-    Serial.printf("[CIE1931] White reference calibrated - XYZ:(%.2f,%.2f,%.2f) Scale:%.4f Valid:%s\n",
+    CIE_TRACE("[CIE1931] White reference calibrated - XYZ:(%.2f,%.2f,%.2f) Scale:%.4f Valid:%s\n",
                     whiteRef.whitePoint.X, whiteRef.whitePoint.Y, whiteRef.whitePoint.Z,
                     whiteRef.scalingFactor, whiteRef.valid ? "true" : "false");
     
@@ -254,7 +261,7 @@ CIE_XYZ applyIRCompensation(const CIE_XYZ& xyz, uint16_t irValue) {
     compensated.Y = fmaxf(0.0f, xyz.Y - irCompensation);
     compensated.Z = fmaxf(0.0f, xyz.Z - irCompensation);
 
-    Serial.printf("[CIE1931] IR compensation applied - Original:(%.2f,%.2f,%.2f) IR:%.0f Compensated:(%.2f,%.2f,%.2f)\n",
+    CIE_TRACE("[CIE1931] IR compensation applied - Original:(%.2f,%.2f,%.2f) IR:%.0f Compensated:(%.2f,%.2f,%.2f)\n",
                      xyz.X, xyz.Y, xyz.Z, irCompensation,
                      compensated.X, compensated.Y, compensated.Z);
 
@@ -276,7 +283,7 @@ CIE_XYZ normalizeToWhitePoint(const CIE_XYZ& xyz, const CIE_WhiteReference& whit
             normalized.Y = (xyz.Y / whiteY) * CIE_D65_WHITE_Y;
             normalized.Z = (xyz.Z / whiteZ) * CIE_D65_WHITE_Z;
 
-            Serial.printf("[CIE1931] White point normalization - Original:(%.2f,%.2f,%.2f) Normalized:(%.2f,%.2f,%.2f)\n",
+            CIE_TRACE("[CIE1931] White point normalization - Original:(%.2f,%.2f,%.2f) Normalized:(%.2f,%.2f,%.2f)\n",
                              xyz.X, xyz.Y, xyz.Z, normalized.X, normalized.Y, normalized.Z);
         }
     }
@@ -284,6 +291,99 @@ CIE_XYZ normalizeToWhitePoint(const CIE_XYZ& xyz, const CIE_WhiteReference& whit
     return normalized;
 }
 
+// CIE L*a*b* conversion and CIEDE2000
+
+static float linearizeSRGB(float v) {
+    return (v <= 0.04045f) ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static float labCompand(float t) {
+    // CIE epsilon (216/24389) and kappa (24389/27)
+    return (t > 0.008856452f) ? cbrtf(t) : (903.2963f * t + 16.0f) / 116.0f;
+}
+
+CIE_Lab convertSRGBToLab(uint8_t r, uint8_t g, uint8_t b) {
+    float lr = linearizeSRGB(r / 255.0f);
+    float lg = linearizeSRGB(g / 255.0f);
+    float lb = linearizeSRGB(b / 255.0f);
+
+    // Linear sRGB to XYZ (IEC 61966-2-1), scaled to Y=100 like the D65 constants
+    float X = (0.4124564f * lr + 0.3575761f * lg + 0.1804375f * lb) * CIE_XYZ_SCALE_FACTOR;
+    float Y = (0.2126729f * lr + 0.7151522f * lg + 0.0721750f * lb) * CIE_XYZ_SCALE_FACTOR;
+    float Z = (0.0193339f * lr + 0.1191920f * lg + 0.9503041f * lb) * CIE_XYZ_SCALE_FACTOR;
+
+    float fx = labCompand(X / CIE_D65_WHITE_X);
+    float fy = labCompand(Y / CIE_D65_WHITE_Y);
+    float fz = labCompand(Z / CIE_D65_WHITE_Z);
+
+    CIE_Lab lab;
+    lab.L = 116.0f * fy - 16.0f;
+    lab.a = 500.0f * (fx - fy);
+    lab.b = 200.0f * (fy - fz);
+    return lab;
+}
+
+float calculateDeltaE2000(const CIE_Lab& lab1, const CIE_Lab& lab2) {
+    const float DEG = (float)M_PI / 180.0f;
+    const float POW25_7 = 6103515625.0f;  // 25^7
+
+    float C1 = sqrtf(lab1.a * lab1.a + lab1.b * lab1.b);
+    float C2 = sqrtf(lab2.a * lab2.a + lab2.b * lab2.b);
+    float Cbar7 = powf((C1 + C2) * 0.5f, 7.0f);
+    float G = 0.5f * (1.0f - sqrtf(Cbar7 / (Cbar7 + POW25_7)));
+
+    float a1p = (1.0f + G) * lab1.a;
+    float a2p = (1.0f + G) * lab2.a;
+    float C1p = sqrtf(a1p * a1p + lab1.b * lab1.b);
+    float C2p = sqrtf(a2p * a2p + lab2.b * lab2.b);
+
+    float h1p = (a1p == 0.0f && lab1.b == 0.0f) ? 0.0f : atan2f(lab1.b, a1p) / DEG;
+    float h2p = (a2p == 0.0f && lab2.b == 0.0f) ? 0.0f : atan2f(lab2.b, a2p) / DEG;
+    if (h1p < 0.0f) h1p += 360.0f;
+    if (h2p < 0.0f) h2p += 360.0f;
+
+    float dLp = lab2.L - lab1.L;
+    float dCp = C2p - C1p;
+
+    float dhp = 0.0f;
+    if (C1p * C2p != 0.0f) {
+        dhp = h2p - h1p;
+        if (dhp > 180.0f) dhp -= 360.0f;
+        else if (dhp < -180.0f) dhp += 360.0f;
+    }
+    float dHp = 2.0f * sqrtf(C1p * C2p) * sinf(dhp * 0.5f * DEG);
+
+    float Lbarp = (lab1.L + lab2.L) * 0.5f;
+    float Cbarp = (C1p + C2p) * 0.5f;
+
+    float hbarp = h1p + h2p;
+    if (C1p * C2p != 0.0f) {
+        if (fabsf(h1p - h2p) > 180.0f) {
+            hbarp += (hbarp < 360.0f) ? 360.0f : -360.0f;
+        }
+        hbarp *= 0.5f;
+    }
+
+    float T = 1.0f - 0.17f * cosf((hbarp - 30.0f) * DEG)
+                   + 0.24f * cosf(2.0f * hbarp * DEG)
+                   + 0.32f * cosf((3.0f * hbarp + 6.0f) * DEG)
+                   - 0.20f * cosf((4.0f * hbarp - 63.0f) * DEG);
+
+    float dTheta = 30.0f * expf(-((hbarp - 275.0f) / 25.0f) * ((hbarp - 275.0f) / 25.0f));
+    float Cbarp7 = powf(Cbarp, 7.0f);
+    float RC = 2.0f * sqrtf(Cbarp7 / (Cbarp7 + POW25_7));
+    float Lm50 = (Lbarp - 50.0f) * (Lbarp - 50.0f);
+    float SL = 1.0f + (0.015f * Lm50) / sqrtf(20.0f + Lm50);
+    float SC = 1.0f + 0.045f * Cbarp;
+    float SH = 1.0f + 0.015f * Cbarp * T;
+    float RT = -sinf(2.0f * dTheta * DEG) * RC;
+
+    float tL = dLp / SL;
+    float tC = dCp / SC;
+    float tH = dHp / SH;
+    return sqrtf(tL * tL + tC * tC + tH * tH + RT * tC * tH);
+}
+
 // Debug functions
 void printXYZ(const CIE_XYZ& xyz, const char* label) {
     Serial.printf("[%s] X:%.2f Y:%.2f Z:%.2f\n", label, xyz.X, xyz.Y, xyz.Z);
@@ -67,6 +67,15 @@ struct RGB_Float {
     float b;  // Blue component (0.0-1.0)
 };
 
+/**
+ * @brief CIE 1976 L*a*b* color coordinates structure (D65 reference white)
+ */
+struct CIE_Lab {
+    float L;  // Lightness (0-100)
+    float a;  // Green-red axis
+    float b;  // Blue-yellow axis
+};
+
 /**
  * @brief White reference calibration data in CIE XYZ space
  */
@@ -175,6 +184,23 @@ CIE_XYZ getD65WhitePoint();
  */
 CIE_XYZ normalizeToWhitePoint(const CIE_XYZ& xyz, const CIE_WhiteReference& whiteRef);
 
+/**
+ * @brief Convert 8-bit sRGB to CIE L*a*b* (D65)
+ * @param r Red component (0-255)
+ * @param g Green component (0-255)
+ * @param b Blue component (0-255)
+ * @return CIE_Lab Lab coordinates
+ */
+CIE_Lab convertSRGBToLab(uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Calculate the CIEDE2000 color difference between two Lab colors
+ * @param lab1 First color
+ * @param lab2 Second color
+ * @return float Delta E 2000 (kL = kC = kH = 1)
+ */
+float calculateDeltaE2000(const CIE_Lab& lab1, const CIE_Lab& lab2);
+
 // Debug and utility functions
 
 /**
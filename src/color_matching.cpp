@@ -0,0 +1,210 @@
+#include "color_matching.h"
+#include <LittleFS.h>
+
+#define CATALOG_LINE_MAX 128
+
+struct BuiltInPaint {
+  const char* name;
+  const char* code;
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  float lrv;
+};
+
+// Same subset as color_matcher_server.py
+static const BuiltInPaint builtInPaints[] = {
+  {"Vivid White", "W01A1", 255, 255, 255, 90.0f},
+  {"First Love Quarter", "P08H1Q", 255, 248, 240, 87.2f},
+  {"Pink Tutu Quarter", "P04H1Q", 255, 233, 247, 84.4f},
+  {"Cruel Sea", "P29A9", 33, 26, 27, 5.5f},
+  {"Decorum", "P02D3", 179, 154, 161, 40.0f},
+  {"Deep Leather", "P05B9", 39, 17, 0, 5.9f},
+};
+
+static void copyField(char* dest, size_t size, const char* value) {
+  strncpy(dest, value, size - 1);
+  dest[size - 1] = '\0';
+}
+
+static char* trimField(char* field) {
+  while (*field == ' ' || *field == '\t') {
+    field++;
+  }
+  char* end = field + strlen(field);
+  while (end > field && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+    *--end = '\0';
+  }
+  return field;
+}
+
+CatalogMatchBackend::CatalogMatchBackend() {
+  fromFile = false;
+  skippedLines = 0;
+  lookups = 0;
+  lastLookupUs = 0;
+}
+
+// ============================================================================
+// LOADING
+// ============================================================================
+
+bool CatalogMatchBackend::parseLine(char* line, CatalogPaint& paint) {
+  char* fields[6];
+  size_t count = 0;
+  char* cursor = line;
+  while (count < 6) {
+    fields[count++] = cursor;
+    char* comma = strchr(cursor, ',');
+    if (!comma) {
+      break;
+    }
+    *comma = '\0';
+    cursor = comma + 1;
+  }
+  if (count < 5) {
+    return false;
+  }
+
+  int rgb[3];
+  for (int i = 0; i < 3; i++) {
+    char* end;
+    long value = strtol(trimField(fields[2 + i]), &end, 10);
+    if (*end != '\0' || value < 0 || value > 255) {
+      return false;
+    }
+    rgb[i] = value;
+  }
+
+  const char* name = trimField(fields[0]);
+  if (!name[0]) {
+    return false;
+  }
+  copyField(paint.name, sizeof(paint.name), name);
+  copyField(paint.code, sizeof(paint.code), trimField(fields[1]));
+  paint.lrv = count == 6 ? atof(trimField(fields[5])) : 0.0f;
+  paint.lab = convertSRGBToLab(rgb[0], rgb[1], rgb[2]);
+  return true;
+}
+
+void CatalogMatchBackend::loadBuiltIn() {
+  paints.clear();
+  for (const BuiltInPaint& entry : builtInPaints) {
+    CatalogPaint paint;
+    copyField(paint.name, sizeof(paint.name), entry.name);
+    copyField(paint.code, sizeof(paint.code), entry.code);
+    paint.lrv = entry.lrv;
+    paint.lab = convertSRGBToLab(entry.r, entry.g, entry.b);
+    paints.push_back(paint);
+  }
+  fromFile = false;
+}
+
+size_t CatalogMatchBackend::load() {
+  LOG_PERF_START();
+  paints.clear();
+  skippedLines = 0;
+
+  File file = LittleFS.open(MATCH_CATALOG_PATH, "r");
+  if (file) {
+    char line[CATALOG_LINE_MAX];
+    size_t length = 0;
+    bool tooLong = false;
+    bool more = true;
+    while (more && paints.size() < MATCH_CATALOG_MAX) {
+      int c = file.read();
+      more = c >= 0;
+      if (more && c != '\n') {
+        if (length < sizeof(line) - 1) {
+          line[length++] = (char)c;
+        } else {
+          tooLong = true;
+        }
+        continue;
+      }
+
+      line[length] = '\0';
+      char* text = trimField(line);
+      if (text[0] && text[0] != '#') {
+        CatalogPaint paint;
+        if (!tooLong && parseLine(text, paint)) {
+          paints.push_back(paint);
+        } else {
+          skippedLines++;
+        }
+      }
+      length = 0;
+      tooLong = false;
+    }
+    file.close();
+  }
+
+  if (paints.empty()) {
+    loadBuiltIn();
+    LOG_STORAGE_INFO("Paint catalog: %s not usable - using %u built-in paints", MATCH_CATALOG_PATH,
+                     (unsigned)paints.size());
+  } else {
+    fromFile = true;
+    paints.shrink_to_fit();
+    LOG_STORAGE_INFO("Paint catalog loaded - Paints:%u Skipped:%u", (unsigned)paints.size(), skippedLines);
+  }
+  LOG_PERF_END("Paint catalog load");
+  return paints.size();
+}
+
+// ============================================================================
+// LOOKUP
+// ============================================================================
+
+MatchBackendStatus CatalogMatchBackend::lookup(uint8_t r, uint8_t g, uint8_t b, MatchResponse& out) {
+  uint32_t startUs = micros();
+  memset(&out, 0, sizeof(out));
+  lookups++;
+  if (paints.empty()) {
+    copyField(out.error, sizeof(out.error), "Catalog is empty");
+    return MATCH_BACKEND_NO_MATCH;
+  }
+
+  // Best match plus MATCH_ALTERNATES_MAX runners-up, kept sorted by insertion
+  const size_t keep = MATCH_ALTERNATES_MAX + 1;
+  const CatalogPaint* hits[keep];
+  float distances[keep];
+  size_t found = 0;
+
+  CIE_Lab target = convertSRGBToLab(r, g, b);
+  for (const CatalogPaint& paint : paints) {
+    float dE = calculateDeltaE2000(target, paint.lab);
+    if (found == keep && dE >= distances[found - 1]) {
+      continue;
+    }
+    size_t pos = (found < keep) ? found++ : found - 1;
+    while (pos > 0 && distances[pos - 1] > dE) {
+      hits[pos] = hits[pos - 1];
+      distances[pos] = distances[pos - 1];
+      pos--;
+    }
+    hits[pos] = &paint;
+    distances[pos] = dE;
+  }
+
+  for (size_t i = 0; i < found; i++) {
+    PaintMatch& match = i == 0 ? out.best : out.alternates[out.alternateCount++];
+    copyField(match.name, sizeof(match.name), hits[i]->name);
+    copyField(match.code, sizeof(match.code), hits[i]->code);
+    match.lrv = hits[i]->lrv;
+    match.distance = distances[i];
+  }
+  out.parsed = true;
+  out.success = true;
+  out.hasMatch = true;
+  lastLookupUs = micros() - startUs;
+  return MATCH_BACKEND_MATCHED;
+}
+
+void CatalogMatchBackend::getStats(JsonObject stats) const {
+  stats["paints"] = paints.size();
+  stats["source"] = fromFile ? MATCH_CATALOG_PATH : "builtIn";
+  stats["skippedLines"] = skippedLines;
+  stats["lookups"] = lookups;
+  stats["lastLookupUs"] = lastLookupUs;
+}
@@ -0,0 +1,62 @@
+#ifndef COLOR_MATCHING_H
+#define COLOR_MATCHING_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "config.h"
+#include "logging.h"
+#include "cie1931.h"
+#include "match_backend.h"
+#include "sample_store.h"
+
+/**
+ * @brief On-device paint catalog matched by CIEDE2000
+ *
+ * Loads MATCH_CATALOG_PATH from LittleFS, one paint per line:
+ *
+ *   name,code,r,g,b,lrv
+ *
+ * Blank lines and lines starting with '#' are skipped; at most
+ * MATCH_CATALOG_MAX entries are kept. Without the file the catalog holds the
+ * same Dulux subset as color_matcher_server.py. Each entry's Lab is computed
+ * once at load, so a lookup is one deltaE2000 per entry and never touches the
+ * network.
+ */
+
+struct CatalogPaint {
+  char name[SAMPLE_NAME_LENGTH];
+  char code[SAMPLE_CODE_LENGTH];
+  float lrv;
+  CIE_Lab lab;
+};
+
+class CatalogMatchBackend : public MatchBackend {
+private:
+  std::vector<CatalogPaint, PsramAllocator<CatalogPaint>> paints;
+  bool fromFile;
+  uint32_t skippedLines;
+  uint32_t lookups;
+  uint32_t lastLookupUs;
+
+  bool parseLine(char* line, CatalogPaint& paint);
+  void loadBuiltIn();
+
+public:
+  CatalogMatchBackend();
+
+  /**
+   * @brief Load the catalog file, or the built-in subset if it is missing or empty
+   * @return Entries loaded
+   */
+  size_t load();
+
+  size_t size() const { return paints.size(); }
+
+  const char* getName() const override { return "catalog"; }
+  bool isRemote() const override { return false; }
+  MatchBackendStatus lookup(uint8_t r, uint8_t g, uint8_t b, MatchResponse& out) override;
+  void getStats(JsonObject stats) const override;
+};
+
+#endif // COLOR_MATCHING_H
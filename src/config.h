@@ -24,6 +24,11 @@
 #define WIFI_SSID "Wifi 6"
 #define WIFI_PASSWORD "Scrofani1985"
 #define WIFI_TIMEOUT_MS 50000
+#define WIFI_ATTEMPT_TIMEOUT_MS 20000  // Give up on a full (scanning, DHCP) attempt after this
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 4000  // Give up on a directed attempt to the cached BSSID/channel
+#define WIFI_FAST_CONNECT_REUSE_IP true    // Reuse the cached lease on fast connects until its renewal time (skips DHCP)
+#define WIFI_BACKOFF_MIN_MS 1000       // First wait after a failed full attempt
+#define WIFI_BACKOFF_MAX_MS 60000      // Backoff doubles up to this
 
 // Static IP Configuration
 #define USE_STATIC_IP false
@@ -95,6 +100,7 @@
 #define RAPID_SCAN_INTERVAL_MS 50      // Interval between rapid samples
 #define ADAPTIVE_SAMPLE_COUNT_MIN 5    // Minimum adaptive sample count
 #define ADAPTIVE_SAMPLE_COUNT_MAX 20   // Maximum adaptive sample count
+#define SCAN_MAX_FAILED_READ_PERCENT 25 // Readings dropped for I2C errors beyond this share fail the scan
 
 // TCS3430 Advanced Calibration Settings - Optimized for consecutive readings
 #define DEFAULT_AUTO_ZERO_MODE 1        // 1 = use previous offset (recommended for stability)
@@ -146,10 +152,103 @@
 #define CALIBRATION_BALANCE_RATIO 2.5   // Maximum XYZ balance ratio for white
 
 // Sample Storage Configuration
-#define MAX_SAMPLES 30
+#define MAX_SAMPLES 30                          // Legacy Preferences ring buffer size (migration only)
 #define SAMPLE_NAME_LENGTH 32
 #define SAMPLE_CODE_LENGTH 16
 
+// Log-Structured Sample Store (LittleFS)
+#define SAMPLE_STORE_PATH "/samples.log"        // Append-only sample record log
+#define SAMPLE_STORE_COMPACT_PATH "/samples.tmp" // Scratch file written during compaction
+#define SAMPLE_STORE_COMPACT_MIN_DEAD 64        // Dead records required before compacting
+#define SAMPLE_STORE_COMPACT_RATIO 0.5f         // Compact once dead records reach this share of the log
+#define SAMPLE_STORE_COMPACT_BATCH 16           // Records copied per loop() compaction step
+#define SAMPLE_STORE_SCAN_BATCH 32              // Records read per chunk when rebuilding the index
+#define SAMPLE_STORE_RESERVE_BYTES 32768        // Free flash kept back for web assets and tombstones
+#define SAMPLE_STORE_PENDING_MAX 32             // Queued records before a mutation flushes inline
+#define SAMPLE_STORE_FLUSH_BATCH 16             // Records staged per write when flushing
+#define SAMPLE_STORE_ID_RESERVE 64              // Sample ids reserved per NVS high-water write
+#define SAMPLE_STORE_VISIT_BATCH 8              // Records read per lock hold when visiting; visitors run unlocked
+#define SAMPLE_RECOMPUTE_BATCH 16               // Stale samples recomputed per loop() step after recalibration
+#define SAMPLE_SIGMA_SCALE 10                   // Stored sigma = std dev x this (0.1 count resolution)
+#define SAMPLE_STORE_BENCH_PATH "/samples_bench.log"
+#define SAMPLE_STORE_BENCH_COUNT 10000          // Default sample count for /samples/benchmark
+#define SETTINGS_PAGE_SAMPLE_LIMIT 30           // Most recent samples listed on /settings-page
+#define SAMPLE_PAGE_DEFAULT_LIMIT 50            // Default page size for GET /samples?limit=
+#define SAMPLE_PAGE_MAX_LIMIT 200               // Largest page GET /samples will return
+#define SAMPLE_NEAR_DEFAULT_DELTA_E 5.0f        // Default CIEDE2000 radius for /samples/near
+#define SAMPLE_NEAR_MAX_DELTA_E 100.0f          // Largest radius /samples/near accepts
+#define SAMPLE_NEAR_DEFAULT_LIMIT 10            // Default result count for /samples/near
+#define SAMPLE_NEAR_MAX_LIMIT 50                // Largest result count for /samples/near
+
+// Bulk Export/Import (NDJSON/CSV)
+#define TRANSFER_CHUNK_SIZE 1024                // Bytes buffered per chunk when streaming an export
+#define TRANSFER_LINE_MAX 512                   // Longest import row accepted (longer rows are skipped)
+#define CALIBRATION_RECORD_MAX_VALUES 20        // Values per calibration row (4x4 matrix + kX, kY, kZ)
+
+// Boot Profiling
+#define BOOT_PROFILE_MAX_PHASES 24              // Timed boot phases kept for /status
+#define BOOT_SENSOR_TASK_STACK 8192             // Sensor bring-up task stack (bytes)
+#define BOOT_SENSOR_TASK_PRIORITY 1             // Same as the loop task; it mostly waits on I2C/delays
+#define BOOT_SENSOR_TASK_CORE 0                 // Overlap with the filesystem mount on core 1
+
+// Deferred Persistence
+#define PERSIST_COALESCE_MS 250                 // Delay after the first dirty mark before flushing
+#define PERSIST_MAX_SINKS 4                     // Registered flush targets (samples, settings, ...)
+#define PERSIST_TASK_STACK 6144                 // Flush task stack (bytes)
+#define PERSIST_TASK_PRIORITY 1                 // Below the Arduino loop task
+#define PERSIST_TASK_CORE 0                     // Keep flash writes off the loop()/web core
+#define SAVE_FLASH_DURATION_MS 200              // Green confirmation flash after /save
+
+// Paint Match Queue
+#define MATCH_QUEUE_PATH "/matchq.bin"          // Pending lookups, rewritten by the persistence task
+#define MATCH_QUEUE_CAPACITY 64                 // Pending lookups kept (oldest dropped beyond this)
+#define MATCH_QUEUE_BATCH MATCH_BATCH_MAX       // Lookups coalesced into one pass (and one backend request)
+#define MATCH_QUEUE_LINGER_MS 300               // Wait this long for a partial batch to fill
+#define MATCH_MAX_ATTEMPTS 8                    // Online failures before a lookup is abandoned
+#define MATCH_BACKOFF_MIN_MS 5000               // First wait after a failed lookup
+#define MATCH_BACKOFF_MAX_MS 300000             // Backoff doubles up to this
+#define MATCH_QUEUE_POLL_MS 1000                // Connectivity re-check while offline
+#define MATCH_QUEUE_IDLE_MS 60000               // Worker sleep with nothing queued (enqueue wakes it)
+#define MATCH_TASK_STACK 12288                  // Worker stack; lookups run on the lanes, /match/benchmark's TLS handshakes here
+#define MATCH_TASK_PRIORITY 1
+#define MATCH_TASK_CORE 0                       // Keep network waits off the loop()/web core
+
+// Paint Match Backend Client
+#define MATCH_CLIENT_CONNECTIONS 2              // Kept-alive hosts (Apps Script and its echo redirect host)
+#define MATCH_HOST_MAX 64                       // Longest backend host name
+#define MATCH_KEEPALIVE_IDLE_MS 60000           // Reconnect instead of reusing a connection idle this long
+#define MATCH_MAX_REDIRECTS 3                   // Hops followed per lookup
+#define MATCH_REDIRECT_CACHE_SIZE 2             // Moved-endpoint targets remembered
+#define MATCH_REDIRECT_TTL_MS 3600000           // Cached redirect target lifetime (1 hour)
+#define MATCH_RESPONSE_MAX_BYTES 16384          // Body bytes read before a response is abandoned (batches included)
+#define MATCH_ALTERNATES_MAX 3                  // Runner-up paints requested and kept per lookup
+#define MATCH_PARSE_ARENA_BYTES 4096            // Fixed JSON arena for one filtered match response
+#define MATCH_HEADER_LINE_MAX 1024              // Longest status/header line accepted
+#define MATCH_BENCHMARK_RUNS 5                  // Default calls per mode for /match/benchmark
+#define MATCH_BENCHMARK_MAX_RUNS 20
+
+// Paint Match Backends
+#define MATCH_HTTP_BACKEND_URL ""               // JSON match service tried before Apps Script ("" disables it)
+#define MATCH_BATCH_MAX 8                       // Colors per batch request
+#define MATCH_ROUTER_MAX_REMOTES 2              // Remote backends with their own lane task
+#define MATCH_HEDGE_DELAY_MS 1500               // Start the next backend if the current one is still silent
+#define MATCH_ROUTE_TIMEOUT_MS 25000            // Longest a lookup waits on the remote backends
+#define MATCH_BREAKER_FAILURES 3                // Consecutive failures that open a backend's breaker
+#define MATCH_BREAKER_COOLDOWN_MS 30000         // First open period; a failed trial call doubles it
+#define MATCH_BREAKER_COOLDOWN_MAX_MS 600000
+#define MATCH_CATALOG_PATH "/catalog.csv"       // name,code,r,g,b,lrv per line; built-in subset if missing
+#define MATCH_CATALOG_MAX 512                   // Catalog entries kept in memory
+#define MATCH_CATALOG_FALLBACK true             // Provisional catalog answer when every remote fails; the job stays queued
+#define MATCH_LANE_TASK_STACK 12288             // Per remote backend; TLS handshakes run on it
+#define MATCH_LANE_TASK_PRIORITY 1
+#define MATCH_LANE_TASK_CORE 0
+
+// Server-Sent Events (/events)
+#define EVENT_STREAM_MAX_CLIENTS 4              // Concurrent subscribers
+#define EVENT_STREAM_QUEUE_LEN 8                // Events buffered between publisher tasks and loop()
+#define EVENT_STREAM_DATA_MAX 256               // Payload bytes per event (a match with its alternates fits)
+#define EVENT_STREAM_KEEPALIVE_MS 15000         // Comment line sent to idle subscribers
+
 // LED Brightness Control
 #define MIN_LED_BRIGHTNESS 64
 #define MAX_LED_BRIGHTNESS 255
@@ -199,6 +298,28 @@
 #define QUALITY_SCORE_GOOD 70
 #define QUALITY_SCORE_FAIR 50
 
+// Calibration Capture Settings
+// White/black references average fresh conversions until the X, Y and Z
+// standard errors are within max(REL * mean, ABS) counts
+#define CAL_CAPTURE_TARGET_REL_SE 0.001f   // 0.1% of the channel mean
+#define CAL_CAPTURE_TARGET_ABS_SE 1.0f     // Floor for dark channels, in counts
+#define CAL_CAPTURE_MIN_FRAMES 4           // X conversions before the target is checked
+#define CAL_CAPTURE_MAX_FRAMES 32          // X conversions before giving up on the target
+#define CAL_CAPTURE_IR2_FRAMES 2           // IR2 conversions (channel 3 switched to IR2)
+#define CAL_CAPTURE_TIMEOUT_MS 8000        // Whole capture, settling included
+#define SCAN_IR2_FRAMES 3                  // IR2 conversions averaged once per scan, after X/Y/Z
+
+// Drift Check Settings
+// A quick white tile reading against the stored white reference, corrected
+// with per-channel gains instead of a full recalibration
+#define DRIFT_CHECK_FRAMES 2               // X conversions per check (the ALS cycle is restarted, nothing discarded)
+#define DRIFT_LED_SETTLE_MS 5              // Illumination LED settle before the restart
+#define DRIFT_MAX_CORRECTION 0.10f         // Larger drift on any channel needs a recalibration (or the tile is missing)
+#define DRIFT_MIN_SIGNAL 500               // Tile readings below this on any channel are rejected
+#define DRIFT_SATURATION 60000             // ...and above this
+#define DRIFT_HISTORY_SIZE 16              // Checks kept for /drift
+#define DRIFT_DEFAULT_INTERVAL_MIN 0       // Periodic check interval, 0 = on request only
+
 // Sensor Reading Stability Settings
 #define SENSOR_STABILIZE_MS 300            // Delay after LED activation before reading
 #define SENSOR_READING_DELAY_MS 150        // Delay between consecutive readings
@@ -225,6 +346,10 @@
 #define PREF_SAMPLE_PREFIX "sample"
 #define PREF_ENHANCED_LED_MODE "enhancedLED"
 #define PREF_MANUAL_LED_INTENSITY "manualLEDInt"
+#define PREF_SETTINGS_BLOB "settings"          // Versioned settings blob (replaces the per-setting keys)
+#define PREF_WIFI_CACHE "wifiCache"            // Last good BSSID/channel/IP for fast connect
+#define PREF_SAMPLE_ID_HIGH "sampleIdHigh"     // Sample ids below this may have been issued
+#define SETTINGS_BLOB_MAX 128                   // Largest settings blob read, including newer layouts
 
 // TCS3430 Advanced Calibration EEPROM Keys
 #define PREF_AUTO_ZERO_MODE "autoZeroMode"
@@ -245,12 +370,28 @@
 #define PREF_BLACK_CAL_TIMESTAMP "blackCalTime"
 #define PREF_HAS_WHITE_CAL "hasWhiteCal"
 #define PREF_HAS_BLACK_CAL "hasBlackCal"
+#define PREF_CAL_VERSION "calVersion"      // Bumped on every calibration commit; tags sample colors
+#define PREF_DRIFT_GAIN "driftGain"        // Drift correction gains and black pivot (6 floats) on top of the white reference
+#define PREF_DRIFT_INTERVAL "driftInterval" // Periodic drift check interval in minutes
 
 // Matrix Calibration Configuration
 #define MATRIX_SIZE 4                    // 3x4 matrix size for least squares
 #define MAX_CALIBRATION_POINTS 12        // Maximum color patches for calibration
 #define STANDARD_CALIBRATION_POINTS 7    // Standard 7-color patch set
 
+// Patch Sweep Settings (matrix calibration from a continuous pass over a chart)
+#define SWEEP_MAX_PLATEAUS 32            // Plateaus kept per sweep (patches plus stray stops)
+#define SWEEP_MAX_TARGETS 24             // Reference patches (full ColorChecker)
+#define SWEEP_STABLE_TOLERANCE 0.03f     // A frame joins a plateau within 3% of its mean on X, Y and Z...
+#define SWEEP_STABLE_FLOOR 40            // ...or within this many counts (dark patches)
+#define SWEEP_MIN_PLATEAU_FRAMES 3       // Conversions a run needs to count as a patch
+#define SWEEP_MERGE_TOLERANCE 0.02f      // Back-to-back plateaus this close are one patch
+#define SWEEP_MIN_SIGNAL 100             // Y below this is a gap or the sensor off the chart
+#define SWEEP_SATURATION 60000           // Any channel above this rejects the plateau
+#define SWEEP_REJECT_DELTA_E 30.0f       // Cost of leaving a plateau unassigned
+#define SWEEP_REFINE_PASSES 3            // Assign/refit rounds against the fitted matrix
+#define SWEEP_TIMEOUT_MS 120000          // Sampling stops on its own after this
+
 // Matrix Calibration NVS Keys
 #define PREF_MATRIX_VALID "matrixValid"
 #define PREF_MATRIX_DATA "matrixData"
@@ -264,6 +405,9 @@
 #define DELTA_E_ACCEPTABLE 5.0f          // ΔE < 5 = acceptable calibration
 #define MATRIX_MIN_POINTS 4              // Minimum points for matrix computation
 #define MATRIX_CONDITION_THRESHOLD 100.0f // Maximum condition number for stability
+#define MATRIX_CV_FOLDS 5                // k for the k-fold estimate computed with every fit
+#define MATRIX_CV_SUSPECT_RATIO 3.0f     // LOO ΔE this many times the median flags a point...
+#define MATRIX_CV_LEVERAGE_RATIO 2.0f    // Leverage above this times p/n flags a point as high leverage
 
 // Standard Color References (sRGB values)
 #define REF_RED_R 255
@@ -290,8 +434,10 @@
 
 // Removed simple and vivid white calibration constants - using advanced calibration only
 
-// Logging Configuration
+// Logging Configuration (the benchmark builds pass -DENABLE_LOGGING=false)
+#ifndef ENABLE_LOGGING
 #define ENABLE_LOGGING true
+#endif
 #define LOG_LEVEL_ERROR 1
 #define LOG_LEVEL_WARN 2
 #define LOG_LEVEL_INFO 3
@@ -314,6 +460,33 @@
 #define LOG_RESPONSE_TIMES true
 #define LOG_SCAN_PERFORMANCE true
 
+// Scoped profiler (/perf): microsecond timings per named region
+#define PERF_PROFILING_ENABLED true        // false compiles PERF_SCOPE out
+#define PERF_HISTOGRAM_BUCKETS 24          // Power-of-two buckets: <1us, <2us, <4us ... <8.4s (last also takes longer)
+
+// Heap accounting (/metrics): per-subsystem and per-endpoint allocation counts.
+// Counting needs the app env's -Wl,--wrap=malloc,... and -DMEM_ACCOUNTING_WRAP
+// (platformio.ini); builds without them report heap and fragmentation only.
+#ifdef MEM_ACCOUNTING_WRAP
+#define MEM_ACCOUNTING_TRACKING true
+#else
+#define MEM_ACCOUNTING_TRACKING false
+#endif
+#define MEM_TASK_SLOTS 16                  // Tasks whose subsystem is tracked; later tasks count as system
+#define MEM_ENDPOINT_SLOTS 24              // Request paths kept; the least requested is replaced when full
+#define MEM_ENDPOINT_PATH_LENGTH 40        // Longer paths are truncated
+
+// Task telemetry (/tasks): per-task CPU share and stack headroom, loop() timing
+#define TASK_MONITOR_INTERVAL_MS 5000      // Snapshot period; CPU shares are averaged over it
+#define TASK_MONITOR_HISTORY 8             // Snapshots kept
+#define TASK_MONITOR_MAX_TASKS 24          // Tasks kept per snapshot, busiest first
+#define TASK_MONITOR_STATUS_SLOTS 32       // Tasks read per collection; collection is skipped above this
+#define TASK_MONITOR_NAME_LENGTH 16        // configMAX_TASK_NAME_LEN on ESP-IDF
+// Estimate per-core load from idle hooks when run time stats are off. The hooks
+// keep both idle tasks spinning instead of waiting for an interrupt, which
+// costs power and warms the board (and the color sensor), so it is opt-in.
+#define TASK_MONITOR_IDLE_HOOKS false
+
 // Debug Configuration (legacy)
 #define DEBUG_SERIAL true
 #define DEBUG_SENSOR_READINGS false
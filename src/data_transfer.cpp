@@ -0,0 +1,475 @@
+#include "data_transfer.h"
+
+#define SAMPLE_CSV_COLUMNS 22
+#define SAMPLE_CSV_MIN_COLUMNS 8    // id .. lrv; rows without a raw measurement
+
+bool parseTransferFormat(const String& name, TransferFormat& format) {
+  if (name.length() == 0 || name.equalsIgnoreCase("ndjson") || name.equalsIgnoreCase("jsonl")) {
+    format = TRANSFER_NDJSON;
+    return true;
+  }
+  if (name.equalsIgnoreCase("csv")) {
+    format = TRANSFER_CSV;
+    return true;
+  }
+  return false;
+}
+
+const char* transferContentType(TransferFormat format) {
+  return format == TRANSFER_CSV ? "text/csv" : "application/x-ndjson";
+}
+
+// ============================================================================
+// CHUNKED OUTPUT
+// ============================================================================
+
+TransferChunkPrint::TransferChunkPrint(TransferChunkFn fn, void* ctx) {
+  used = 0;
+  total = 0;
+  sink = fn;
+  sinkCtx = ctx;
+}
+
+TransferChunkPrint::~TransferChunkPrint() {
+  flush();
+}
+
+size_t TransferChunkPrint::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t TransferChunkPrint::write(const uint8_t* data, size_t len) {
+  size_t remaining = len;
+  while (remaining > 0) {
+    size_t n = min(remaining, sizeof(buffer) - used);
+    memcpy(buffer + used, data, n);
+    used += n;
+    data += n;
+    remaining -= n;
+    if (used == sizeof(buffer)) {
+      flush();
+    }
+  }
+  total += len;
+  return len;
+}
+
+void TransferChunkPrint::flush() {
+  if (used > 0 && sink) {
+    sink(buffer, used, sinkCtx);
+  }
+  used = 0;
+}
+
+// ============================================================================
+// LINE READER
+// ============================================================================
+
+TransferLineReader::TransferLineReader() {
+  begin(nullptr, nullptr);
+}
+
+void TransferLineReader::begin(TransferLineFn fn, void* ctx) {
+  length = 0;
+  overflow = false;
+  handler = fn;
+  handlerCtx = ctx;
+  lines = 0;
+  overlong = 0;
+}
+
+void TransferLineReader::emit() {
+  if (overflow) {
+    overlong++;
+  } else {
+    while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' ')) {
+      length--;
+    }
+    if (length > 0) {
+      line[length] = '\0';
+      lines++;
+      if (handler) {
+        handler(line, length, handlerCtx);
+      }
+    }
+  }
+  length = 0;
+  overflow = false;
+}
+
+void TransferLineReader::feed(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = (char)data[i];
+    if (c == '\n') {
+      emit();
+    } else if (length < sizeof(line) - 1) {
+      line[length++] = c;
+    } else {
+      overflow = true;
+    }
+  }
+}
+
+void TransferLineReader::finish() {
+  if (length > 0 || overflow) {
+    emit();
+  }
+}
+
+// ============================================================================
+// FIELD HELPERS
+// ============================================================================
+
+// Splits a CSV row in place; quoted fields may contain commas and "" escapes
+static size_t splitCsv(char* line, char** fields, size_t maxFields) {
+  size_t count = 0;
+  char* p = line;
+  while (count < maxFields) {
+    char* out = p;
+    fields[count++] = out;
+    if (*p == '"') {
+      p++;
+      while (*p) {
+        if (*p == '"') {
+          if (p[1] != '"') {
+            p++;
+            break;
+          }
+          p++;
+        }
+        *out++ = *p++;
+      }
+      while (*p && *p != ',') {
+        p++;
+      }
+    } else {
+      while (*p && *p != ',') {
+        *out++ = *p++;
+      }
+    }
+    bool more = *p == ',';
+    *out = '\0';
+    if (!more) {
+      break;
+    }
+    p++;
+  }
+  return count;
+}
+
+static bool parseUnsigned(const char* text, uint32_t maxValue, uint32_t& value) {
+  char* end = nullptr;
+  if (!text || !*text) {
+    return false;
+  }
+  unsigned long parsed = strtoul(text, &end, 10);
+  if (*end != '\0' || parsed > maxValue) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+static bool parseFloat(const char* text, float& value) {
+  char* end = nullptr;
+  if (!text || !*text) {
+    return false;
+  }
+  value = strtof(text, &end);
+  return *end == '\0';
+}
+
+// Writes a quoted CSV string; line breaks become spaces so a row stays one line
+static void writeCsvString(Print& out, const char* text, size_t maxLen) {
+  out.write('"');
+  for (size_t i = 0; i < maxLen && text[i]; i++) {
+    char c = text[i];
+    if (c == '"') {
+      out.write('"');
+    } else if (c == '\r' || c == '\n') {
+      c = ' ';
+    }
+    out.write(c);
+  }
+  out.write('"');
+}
+
+static void copyField(char* dest, size_t size, const char* src) {
+  strncpy(dest, src ? src : "", size - 1);
+  dest[size - 1] = '\0';
+}
+
+// ============================================================================
+// SAMPLES
+// ============================================================================
+
+void sampleRawToJson(JsonDocument& doc, const ColorSample& sample) {
+  SampleMeasurement raw = sample.raw;
+  if (raw.readings == 0) {
+    return;
+  }
+  JsonObject obj = doc["raw"].to<JsonObject>();
+  obj["x"] = raw.x;
+  obj["y"] = raw.y;
+  obj["z"] = raw.z;
+  obj["ir1"] = raw.ir1;
+  obj["ir2"] = raw.ir2;
+  JsonArray sigma = obj["sigma"].to<JsonArray>();
+  for (size_t i = 0; i < 5; i++) {
+    sigma.add(static_cast<float>(raw.sigma[i]) / SAMPLE_SIGMA_SCALE);
+  }
+  obj["readings"] = raw.readings;
+  obj["atime"] = raw.atime;
+  obj["again"] = raw.again;
+  obj["calVersion"] = raw.calVersion;
+}
+
+void writeSampleHeader(Print& out, TransferFormat format) {
+  if (format == TRANSFER_CSV) {
+    out.print("id,r,g,b,timestamp,paintName,paintCode,lrv,x,y,z,ir1,ir2,"
+              "sigmaX,sigmaY,sigmaZ,sigmaIR1,sigmaIR2,readings,atime,again,calVersion\n");
+  }
+}
+
+void writeSampleRow(Print& out, TransferFormat format, uint32_t id, const ColorSample& sample) {
+  if (format == TRANSFER_NDJSON) {
+    JsonDocument doc;
+    doc["id"] = id;
+    doc["r"] = sample.r;
+    doc["g"] = sample.g;
+    doc["b"] = sample.b;
+    doc["timestamp"] = sample.timestamp;
+    doc["paintName"] = sample.paintName;
+    doc["paintCode"] = sample.paintCode;
+    doc["lrv"] = sample.lrv;
+    sampleRawToJson(doc, sample);
+    serializeJson(doc, out);
+    out.write('\n');
+    return;
+  }
+
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%u,%u,%u,%u,%u,", (unsigned)id, sample.r, sample.g, sample.b,
+           (unsigned)sample.timestamp);
+  out.print(buf);
+  writeCsvString(out, sample.paintName, SAMPLE_NAME_LENGTH);
+  out.write(',');
+  writeCsvString(out, sample.paintCode, SAMPLE_CODE_LENGTH);
+  snprintf(buf, sizeof(buf), ",%.7g", sample.lrv);
+  out.print(buf);
+
+  SampleMeasurement raw = sample.raw;
+  if (raw.readings == 0) {
+    out.print(",,,,,,,,,,,,,,\n");
+    return;
+  }
+  snprintf(buf, sizeof(buf), ",%u,%u,%u,%u,%u", raw.x, raw.y, raw.z, raw.ir1, raw.ir2);
+  out.print(buf);
+  for (size_t i = 0; i < 5; i++) {
+    snprintf(buf, sizeof(buf), ",%.1f", static_cast<float>(raw.sigma[i]) / SAMPLE_SIGMA_SCALE);
+    out.print(buf);
+  }
+  snprintf(buf, sizeof(buf), ",%u,%u,%u,%u\n", raw.readings, raw.atime, raw.again, (unsigned)raw.calVersion);
+  out.print(buf);
+}
+
+static uint16_t packSigmaValue(float sigma) {
+  return (uint16_t)constrain(sigma * SAMPLE_SIGMA_SCALE + 0.5f, 0.0f, 65535.0f);
+}
+
+static TransferRowResult parseSampleJson(char* line, ColorSample& sample, uint32_t& id) {
+  JsonDocument doc;
+  if (deserializeJson(doc, line) || !doc["r"].is<int>() || !doc["g"].is<int>() ||
+      !doc["b"].is<int>()) {
+    return TRANSFER_ROW_INVALID;
+  }
+  int r = doc["r"], g = doc["g"], b = doc["b"];
+  if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) {
+    return TRANSFER_ROW_INVALID;
+  }
+  id = doc["id"] | 0u;
+  sample.r = r;
+  sample.g = g;
+  sample.b = b;
+  sample.timestamp = doc["timestamp"] | 0u;
+  copyField(sample.paintName, sizeof(sample.paintName), doc["paintName"] | "Unknown");
+  copyField(sample.paintCode, sizeof(sample.paintCode), doc["paintCode"] | "N/A");
+  sample.lrv = doc["lrv"] | 0.0f;
+
+  JsonObject rawObj = doc["raw"];
+  if (rawObj && (rawObj["readings"] | 0u) > 0) {
+    SampleMeasurement raw;
+    memset(&raw, 0, sizeof(raw));
+    raw.x = rawObj["x"] | 0u;
+    raw.y = rawObj["y"] | 0u;
+    raw.z = rawObj["z"] | 0u;
+    raw.ir1 = rawObj["ir1"] | 0u;
+    raw.ir2 = rawObj["ir2"] | 0u;
+    JsonArray sigma = rawObj["sigma"];
+    for (size_t i = 0; i < 5 && i < sigma.size(); i++) {
+      raw.sigma[i] = packSigmaValue(sigma[i] | 0.0f);
+    }
+    raw.readings = rawObj["readings"] | 0u;
+    raw.atime = rawObj["atime"] | 0u;
+    raw.again = rawObj["again"] | 0u;
+    raw.calVersion = rawObj["calVersion"] | 0u;
+    sample.raw = raw;
+  }
+  return TRANSFER_ROW_OK;
+}
+
+static TransferRowResult parseSampleCsv(char* line, ColorSample& sample, uint32_t& id) {
+  char* f[SAMPLE_CSV_COLUMNS];
+  size_t n = splitCsv(line, f, SAMPLE_CSV_COLUMNS);
+  if (strcmp(f[0], "id") == 0) {
+    return TRANSFER_ROW_SKIP;
+  }
+  uint32_t r, g, b, timestamp;
+  if (n < SAMPLE_CSV_MIN_COLUMNS || !parseUnsigned(f[1], 255, r) || !parseUnsigned(f[2], 255, g) ||
+      !parseUnsigned(f[3], 255, b) || !parseUnsigned(f[4], UINT32_MAX, timestamp)) {
+    return TRANSFER_ROW_INVALID;
+  }
+  if (!parseUnsigned(f[0], UINT32_MAX, id)) {
+    id = 0;
+  }
+  sample.r = r;
+  sample.g = g;
+  sample.b = b;
+  sample.timestamp = timestamp;
+  copyField(sample.paintName, sizeof(sample.paintName), f[5]);
+  copyField(sample.paintCode, sizeof(sample.paintCode), f[6]);
+  if (!parseFloat(f[7], sample.lrv)) {
+    sample.lrv = 0.0f;
+  }
+
+  // Raw columns are all-or-nothing; a partial set is ignored
+  uint32_t readings;
+  if (n < SAMPLE_CSV_COLUMNS || !parseUnsigned(f[18], 65535, readings) || readings == 0) {
+    return TRANSFER_ROW_OK;
+  }
+  SampleMeasurement raw;
+  memset(&raw, 0, sizeof(raw));
+  uint32_t counts[5], atime, again, calVersion;
+  float sigma[5];
+  for (size_t i = 0; i < 5; i++) {
+    if (!parseUnsigned(f[8 + i], 65535, counts[i]) || !parseFloat(f[13 + i], sigma[i])) {
+      return TRANSFER_ROW_OK;
+    }
+  }
+  if (!parseUnsigned(f[19], 255, atime) || !parseUnsigned(f[20], 255, again) ||
+      !parseUnsigned(f[21], UINT32_MAX, calVersion)) {
+    return TRANSFER_ROW_OK;
+  }
+  raw.x = counts[0];
+  raw.y = counts[1];
+  raw.z = counts[2];
+  raw.ir1 = counts[3];
+  raw.ir2 = counts[4];
+  for (size_t i = 0; i < 5; i++) {
+    raw.sigma[i] = packSigmaValue(sigma[i]);
+  }
+  raw.readings = readings;
+  raw.atime = atime;
+  raw.again = again;
+  raw.calVersion = calVersion;
+  sample.raw = raw;
+  return TRANSFER_ROW_OK;
+}
+
+TransferRowResult parseSampleRow(TransferFormat format, char* line, ColorSample& sample, uint32_t& id) {
+  memset(&sample, 0, sizeof(sample));
+  id = 0;
+  if (line[0] == '#') {
+    return TRANSFER_ROW_SKIP;
+  }
+  return format == TRANSFER_CSV ? parseSampleCsv(line, sample, id) : parseSampleJson(line, sample, id);
+}
+
+// ============================================================================
+// CALIBRATION
+// ============================================================================
+
+void writeCalibrationHeader(Print& out, TransferFormat format) {
+  if (format == TRANSFER_CSV) {
+    out.print("kind,name,timestamp,values\n");
+  }
+}
+
+void writeCalibrationRow(Print& out, TransferFormat format, const CalibrationRecord& record) {
+  uint8_t count = min(record.count, (uint8_t)CALIBRATION_RECORD_MAX_VALUES);
+  if (format == TRANSFER_NDJSON) {
+    JsonDocument doc;
+    doc["kind"] = record.kind;
+    doc["name"] = record.name;
+    doc["timestamp"] = record.timestamp;
+    JsonArray values = doc["values"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+      values.add(record.values[i]);
+    }
+    serializeJson(doc, out);
+    out.write('\n');
+    return;
+  }
+
+  // Values share one field, separated by ';', so every row has four columns
+  char buf[24];
+  writeCsvString(out, record.kind, sizeof(record.kind));
+  out.write(',');
+  writeCsvString(out, record.name, sizeof(record.name));
+  snprintf(buf, sizeof(buf), ",%u,", (unsigned)record.timestamp);
+  out.print(buf);
+  for (uint8_t i = 0; i < count; i++) {
+    snprintf(buf, sizeof(buf), i ? ";%.7g" : "%.7g", record.values[i]);
+    out.print(buf);
+  }
+  out.write('\n');
+}
+
+TransferRowResult parseCalibrationRow(TransferFormat format, char* line, CalibrationRecord& record) {
+  memset(&record, 0, sizeof(record));
+  if (line[0] == '#') {
+    return TRANSFER_ROW_SKIP;
+  }
+
+  if (format == TRANSFER_NDJSON) {
+    JsonDocument doc;
+    if (deserializeJson(doc, line) || !doc["kind"].is<const char*>()) {
+      return TRANSFER_ROW_INVALID;
+    }
+    copyField(record.kind, sizeof(record.kind), doc["kind"]);
+    copyField(record.name, sizeof(record.name), doc["name"] | "");
+    record.timestamp = doc["timestamp"] | 0u;
+    JsonArray values = doc["values"];
+    if (values.size() > CALIBRATION_RECORD_MAX_VALUES) {
+      return TRANSFER_ROW_INVALID;
+    }
+    for (JsonVariant v : values) {
+      record.values[record.count++] = v | 0.0f;
+    }
+    return TRANSFER_ROW_OK;
+  }
+
+  char* f[4];
+  size_t n = splitCsv(line, f, 4);
+  if (strcmp(f[0], "kind") == 0) {
+    return TRANSFER_ROW_SKIP;
+  }
+  if (n < 4 || !f[0][0] || !parseUnsigned(f[2], UINT32_MAX, record.timestamp)) {
+    return TRANSFER_ROW_INVALID;
+  }
+  copyField(record.kind, sizeof(record.kind), f[0]);
+  copyField(record.name, sizeof(record.name), f[1]);
+  char* value = f[3];
+  while (*value) {
+    if (record.count == CALIBRATION_RECORD_MAX_VALUES) {
+      return TRANSFER_ROW_INVALID;
+    }
+    char* end = nullptr;
+    record.values[record.count++] = strtof(value, &end);
+    if (end == value || (*end != ';' && *end != '\0')) {
+      return TRANSFER_ROW_INVALID;
+    }
+    value = *end ? end + 1 : end;
+  }
+  return TRANSFER_ROW_OK;
+}
@@ -0,0 +1,175 @@
+#ifndef DATA_TRANSFER_H
+#define DATA_TRANSFER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+#include "sample_store.h"
+
+/**
+ * @brief Row-by-row NDJSON/CSV codecs for moving samples and calibrations
+ *
+ * Exports write one self-contained row per record through a fixed-size
+ * chunk buffer, and imports reassemble rows from arbitrarily split input in
+ * a fixed-size line buffer, so neither side holds more than one record no
+ * matter how large the dataset is.
+ */
+
+enum TransferFormat : uint8_t {
+  TRANSFER_NDJSON = 0,   // One JSON object per line
+  TRANSFER_CSV = 1       // Header line, then one comma-separated row per record
+};
+
+/**
+ * @brief Parse a format name ("ndjson", "jsonl", "csv"); empty selects NDJSON
+ * @return false for an unknown name
+ */
+bool parseTransferFormat(const String& name, TransferFormat& format);
+
+/**
+ * @brief MIME type for a transfer format
+ */
+const char* transferContentType(TransferFormat format);
+
+// Outcome of parsing one import row
+enum TransferRowResult : uint8_t {
+  TRANSFER_ROW_OK = 0,
+  TRANSFER_ROW_SKIP = 1,      // Header or comment row
+  TRANSFER_ROW_INVALID = 2    // Malformed or out-of-range row
+};
+
+// ============================================================================
+// OUTPUT
+// ============================================================================
+
+// Receives each filled chunk (for example WebServer::sendContent)
+typedef void (*TransferChunkFn)(const char* data, size_t len, void* ctx);
+
+/**
+ * @brief Print adapter that batches small writes into TRANSFER_CHUNK_SIZE chunks
+ */
+class TransferChunkPrint : public Print {
+private:
+  char buffer[TRANSFER_CHUNK_SIZE];
+  size_t used;
+  size_t total;
+  TransferChunkFn sink;
+  void* sinkCtx;
+
+public:
+  TransferChunkPrint(TransferChunkFn fn, void* ctx);
+  ~TransferChunkPrint();
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t len) override;
+
+  /**
+   * @brief Hand any buffered bytes to the sink
+   */
+  void flush();
+
+  size_t bytesWritten() const { return total; }
+};
+
+// ============================================================================
+// INPUT
+// ============================================================================
+
+// Called once per complete, non-blank line (terminator and '\r' stripped)
+typedef void (*TransferLineFn)(char* line, size_t len, void* ctx);
+
+/**
+ * @brief Reassembles lines from input delivered in arbitrary pieces
+ *
+ * Lines longer than TRANSFER_LINE_MAX are dropped whole and counted, so one
+ * bad row cannot desynchronise the rest of the stream.
+ */
+class TransferLineReader {
+private:
+  char line[TRANSFER_LINE_MAX];
+  size_t length;
+  bool overflow;
+  TransferLineFn handler;
+  void* handlerCtx;
+  uint32_t lines;
+  uint32_t overlong;
+
+  void emit();
+
+public:
+  TransferLineReader();
+
+  /**
+   * @brief Reset state and set the line handler
+   */
+  void begin(TransferLineFn fn, void* ctx);
+
+  /**
+   * @brief Feed the next piece of input
+   */
+  void feed(const uint8_t* data, size_t len);
+
+  /**
+   * @brief Deliver a final line that had no terminator
+   */
+  void finish();
+
+  uint32_t getLines() const { return lines; }
+  uint32_t getOverlong() const { return overlong; }
+};
+
+// ============================================================================
+// SAMPLES
+// ============================================================================
+
+/**
+ * @brief Add a sample's raw measurement as a JSON object (no-op without one)
+ */
+void sampleRawToJson(JsonDocument& doc, const ColorSample& sample);
+
+/**
+ * @brief Write the CSV header row (nothing for NDJSON)
+ */
+void writeSampleHeader(Print& out, TransferFormat format);
+
+/**
+ * @brief Write one sample as a single row
+ */
+void writeSampleRow(Print& out, TransferFormat format, uint32_t id, const ColorSample& sample);
+
+/**
+ * @brief Parse one sample row in place
+ * @param line Row text; modified while parsing
+ * @param sample Receives the sample (zeroed first)
+ * @param id Receives the exported id, 0 if absent
+ */
+TransferRowResult parseSampleRow(TransferFormat format, char* line, ColorSample& sample, uint32_t& id);
+
+// ============================================================================
+// CALIBRATION
+// ============================================================================
+
+/**
+ * @brief One calibration item (reference reading, matrix, ...) as a flat row
+ *
+ * The meaning of values[] depends on kind; see the exporters in main.cpp and
+ * TCS3430Calibration::exportCalibrationData.
+ */
+struct CalibrationRecord {
+  char kind[16];                                // "white", "black", "lowIR", "highIR", "reference"
+  char name[32];                                // Free-form label, sized for matrix sources and reference names
+  uint32_t timestamp;
+  float values[CALIBRATION_RECORD_MAX_VALUES];
+  uint8_t count;                                // Valid entries in values[]
+};
+
+void writeCalibrationHeader(Print& out, TransferFormat format);
+void writeCalibrationRow(Print& out, TransferFormat format, const CalibrationRecord& record);
+
+/**
+ * @brief Parse one calibration row in place
+ */
+TransferRowResult parseCalibrationRow(TransferFormat format, char* line, CalibrationRecord& record);
+
+#endif // DATA_TRANSFER_H
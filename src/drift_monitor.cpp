@@ -0,0 +1,176 @@
+#include "drift_monitor.h"
+#include "cie1931.h"
+#include "logging.h"
+#include <math.h>
+
+namespace {
+
+// CIE L*a*b* companding
+float labF(float t) {
+  return t > 0.008856f ? cbrtf(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+// The tile as L*a*b* relative to the white reference (which is L 100, a 0, b 0)
+CIE_Lab tileLab(const float ratio[3]) {
+  float fx = labF(max(ratio[0], 0.0f));
+  float fy = labF(max(ratio[1], 0.0f));
+  float fz = labF(max(ratio[2], 0.0f));
+  CIE_Lab lab;
+  lab.L = 116.0f * fy - 16.0f;
+  lab.a = 500.0f * (fx - fy);
+  lab.b = 200.0f * (fy - fz);
+  return lab;
+}
+
+} // namespace
+
+DriftMonitor::DriftMonitor() {
+  for (uint8_t c = 0; c < 3; c++) {
+    gain[c] = 1.0f;
+    black[c] = 0.0f;
+  }
+  memset(history, 0, sizeof(history));
+  historyHead = 0;
+  historyCount = 0;
+  intervalMs = DRIFT_DEFAULT_INTERVAL_MIN * 60000UL;
+  lastCheckMs = 0;
+  checks = 0;
+  corrections = 0;
+  rejections = 0;
+}
+
+void DriftMonitor::reset() {
+  for (uint8_t c = 0; c < 3; c++) {
+    gain[c] = 1.0f;
+    black[c] = 0.0f;
+  }
+}
+
+void DriftMonitor::setGains(const float gains[3], const float blackLevel[3]) {
+  for (uint8_t c = 0; c < 3; c++) {
+    gain[c] = gains[c] > 0.0f ? gains[c] : 1.0f;
+    black[c] = blackLevel[c];
+  }
+}
+
+const DriftCheck& DriftMonitor::evaluate(const float reference[3], const float blackLevel[3], const float* measured,
+                                         bool apply, bool periodic, uint16_t ms) {
+  DriftCheck& check = history[historyHead];
+  historyHead = (historyHead + 1) % DRIFT_HISTORY_SIZE;
+  if (historyCount < DRIFT_HISTORY_SIZE) {
+    historyCount++;
+  }
+  memset(&check, 0, sizeof(check));
+  check.at = millis();
+  check.ms = ms;
+  check.periodic = periodic;
+  checks++;
+  lastCheckMs = check.at;
+
+  bool readable = measured != nullptr;
+  for (uint8_t c = 0; c < 3 && readable; c++) {
+    readable = measured[c] >= DRIFT_MIN_SIGNAL && measured[c] <= DRIFT_SATURATION &&
+               reference[c] - blackLevel[c] > 0.0f && measured[c] - blackLevel[c] > 0.0f;
+  }
+  if (!readable) {
+    if (measured) {
+      memcpy(check.measured, measured, sizeof(check.measured));
+    }
+    memcpy(check.gain, gain, sizeof(check.gain));
+    check.verdict = DRIFT_BAD_READING;
+    rejections++;
+    LOG_SENSOR_WARN("Drift check rejected: no usable white tile reading");
+    return check;
+  }
+
+  float newGain[3];
+  float ratio[3];
+  float worst = 0.0f;
+  for (uint8_t c = 0; c < 3; c++) {
+    float span = reference[c] - blackLevel[c];
+    float reading = measured[c] - blackLevel[c];
+    check.measured[c] = measured[c];
+    check.drift[c] = reading / span - 1.0f;
+    newGain[c] = span / reading;
+    ratio[c] = reading * gain[c] / span;  // What the color model sees with the old gains
+    worst = max(worst, fabsf(check.drift[c]));
+  }
+  const float unity[3] = {1.0f, 1.0f, 1.0f};
+  check.deltaE = calculateDeltaE2000(tileLab(ratio), tileLab(unity));
+
+  if (worst > DRIFT_MAX_CORRECTION) {
+    check.verdict = DRIFT_OUT_OF_RANGE;
+    rejections++;
+    LOG_SENSOR_WARN("Drift check: %.1f%% drift exceeds the %.0f%% correction limit - recalibrate",
+                    worst * 100.0f, DRIFT_MAX_CORRECTION * 100.0f);
+  } else if (apply) {
+    setGains(newGain, blackLevel);
+    check.verdict = DRIFT_APPLIED;
+    corrections++;
+  } else {
+    check.verdict = DRIFT_MEASURED;
+  }
+  memcpy(check.gain, gain, sizeof(check.gain));
+
+  LOG_SENSOR_INFO("Drift check: X %+.2f%% Y %+.2f%% Z %+.2f%%, white ΔE %.2f, %s in %u ms",
+                  check.drift[0] * 100.0f, check.drift[1] * 100.0f, check.drift[2] * 100.0f, check.deltaE,
+                  verdictName(check.verdict), ms);
+  return check;
+}
+
+void DriftMonitor::correct(uint16_t& x, uint16_t& y, uint16_t& z) const {
+  uint16_t* channel[3] = {&x, &y, &z};
+  for (uint8_t c = 0; c < 3; c++) {
+    if (*channel[c] > black[c]) {
+      *channel[c] = constrain(black[c] + (*channel[c] - black[c]) * gain[c] + 0.5f, 0.0f, 65535.0f);
+    }
+  }
+}
+
+void DriftMonitor::setIntervalMinutes(uint16_t minutes) {
+  intervalMs = minutes * 60000UL;
+  lastCheckMs = millis();
+}
+
+void DriftMonitor::describe(JsonArray out) const {
+  for (uint8_t i = 0; i < historyCount; i++) {
+    const DriftCheck& check = history[(historyHead + DRIFT_HISTORY_SIZE - 1 - i) % DRIFT_HISTORY_SIZE];
+    JsonObject item = out.add<JsonObject>();
+    item["ageMs"] = millis() - check.at;
+    item["verdict"] = verdictName(check.verdict);
+    item["periodic"] = check.periodic;
+    item["ms"] = check.ms;
+    JsonArray measured = item["measured"].to<JsonArray>();
+    JsonArray drift = item["driftPercent"].to<JsonArray>();
+    JsonArray gains = item["gain"].to<JsonArray>();
+    for (uint8_t c = 0; c < 3; c++) {
+      measured.add(check.measured[c]);
+      drift.add(check.drift[c] * 100.0f);
+      gains.add(check.gain[c]);
+    }
+    item["deltaE"] = check.deltaE;
+  }
+}
+
+const char* DriftMonitor::verdictName(DriftVerdict verdict) {
+  switch (verdict) {
+    case DRIFT_APPLIED: return "applied";
+    case DRIFT_MEASURED: return "measured";
+    case DRIFT_OUT_OF_RANGE: return "outOfRange";
+    case DRIFT_BAD_READING: return "badReading";
+    default: return "unknown";
+  }
+}
+
+void DriftMonitor::getStats(JsonObject stats) const {
+  JsonArray gains = stats["gain"].to<JsonArray>();
+  for (uint8_t c = 0; c < 3; c++) {
+    gains.add(gain[c]);
+  }
+  stats["correcting"] = isCorrecting();
+  stats["intervalMin"] = getIntervalMinutes();
+  stats["checks"] = checks;
+  stats["corrections"] = corrections;
+  stats["rejections"] = rejections;
+  stats["lastCheckAgeMs"] = checks ? millis() - lastCheckMs : 0;
+}
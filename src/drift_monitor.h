@@ -0,0 +1,110 @@
+#ifndef DRIFT_MONITOR_H
+#define DRIFT_MONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Outcome of one drift check
+enum DriftVerdict : uint8_t {
+  DRIFT_APPLIED = 0,           // New gains in effect
+  DRIFT_MEASURED,              // Dry run, gains unchanged
+  DRIFT_OUT_OF_RANGE,          // Beyond DRIFT_MAX_CORRECTION: recalibrate, or the tile is not there
+  DRIFT_BAD_READING            // Capture failed, too dark or saturated
+};
+
+struct DriftCheck {
+  uint32_t at;                 // millis() when the check finished
+  float measured[3];           // X, Y, Z tile means
+  float drift[3];              // Black-corrected reading relative to the white reference, minus 1
+  float gain[3];               // Gains in effect after the check
+  float deltaE;                // CIEDE2000 of the tile under the gains in effect before the check
+  uint16_t ms;                 // Capture time
+  DriftVerdict verdict;
+  bool periodic;
+};
+
+/**
+ * @brief Tracks drift of the white reference and corrects it with per-channel gains
+ *
+ * A check reads the white tile under the white calibration's brightness and
+ * compares it with the stored reference. Above the black level each channel
+ * is linear in the light reaching it, so LED ageing and temperature drift
+ * show up as per-channel gains:
+ *
+ *   gain = (reference - black) / (measured - black)
+ *
+ * correct() applies them to raw X/Y/Z before the white/black reference
+ * correction, leaving the stored calibration untouched. Gains are always
+ * relative to the stored reference, so they replace each other rather than
+ * compound; a new white calibration resets them to 1.
+ *
+ * Used from the loop task only; not thread-safe.
+ */
+class DriftMonitor {
+private:
+  float gain[3];
+  float black[3];              // Black level the gains pivot around
+
+  DriftCheck history[DRIFT_HISTORY_SIZE];
+  uint8_t historyHead;         // Next slot to write
+  uint8_t historyCount;
+
+  uint32_t intervalMs;
+  uint32_t lastCheckMs;
+  uint32_t checks;
+  uint32_t corrections;
+  uint32_t rejections;
+
+public:
+  DriftMonitor();
+
+  /**
+   * @brief Drop the correction (new white reference); history is kept
+   */
+  void reset();
+
+  /**
+   * @brief Restore gains saved by an earlier check
+   */
+  void setGains(const float gains[3], const float blackLevel[3]);
+  const float* getGains() const { return gain; }
+  const float* getBlackLevel() const { return black; }
+  bool isCorrecting() const { return gain[0] != 1.0f || gain[1] != 1.0f || gain[2] != 1.0f; }
+
+  /**
+   * @brief Compare a tile reading with the white reference and record the check
+   * @param reference White reference X, Y, Z
+   * @param blackLevel Black reference X, Y, Z (zeros without one)
+   * @param measured Tile reading, nullptr if the capture failed
+   * @param apply Put the new gains in effect when the drift is within range
+   */
+  const DriftCheck& evaluate(const float reference[3], const float blackLevel[3], const float* measured, bool apply,
+                             bool periodic, uint16_t ms);
+
+  /**
+   * @brief Apply the drift gains to a raw reading
+   */
+  void correct(uint16_t& x, uint16_t& y, uint16_t& z) const;
+
+  /**
+   * @brief Periodic check interval; 0 disables periodic checks (which only measure)
+   */
+  void setIntervalMinutes(uint16_t minutes);
+  uint16_t getIntervalMinutes() const { return intervalMs / 60000UL; }
+  bool isDue() const { return intervalMs && millis() - lastCheckMs >= intervalMs; }
+
+  /**
+   * @brief Add the check history to a JSON array, newest first
+   */
+  void describe(JsonArray out) const;
+
+  static const char* verdictName(DriftVerdict verdict);
+
+  /**
+   * @brief Add gains and check counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // DRIFT_MONITOR_H
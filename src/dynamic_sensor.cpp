@@ -86,8 +86,10 @@ void DynamicSensorManager::initializeOptimalConfigs() {
 
 LightingCondition DynamicSensorManager::detectLightingCondition() {
   // Take a quick reading to assess lighting
-  uint16_t yReading = sensor->getYData(); // Y channel for brightness assessment
-  
+  return classifyLighting(sensor->getYData()); // Y channel for brightness assessment
+}
+
+LightingCondition DynamicSensorManager::classifyLighting(uint16_t yReading) const {
   LOG_SENSOR_DEBUG("Lighting detection: Y channel = %u", yReading);
   
   if (yReading < LIGHT_CONDITION_DARK) {
@@ -216,7 +218,28 @@ bool DynamicSensorManager::optimizeSensorSettings() {
 }
 
 bool DynamicSensorManager::checkSaturation() {
+  // A failed read is no evidence either way, so it never triggers an adjustment
+  sensor->clearError();
   uint8_t status = sensor->getDeviceStatus();
+  if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+    LOG_SENSOR_WARN("Saturation check skipped: I2C error %d", (int)sensor->getLastError());
+    return false;
+  }
+  if (status & 0x10) {
+    // ASAT alone decides; skip the channel reads
+    return isSaturated(status, 0, 0, 0);
+  }
+  uint16_t x = sensor->getXData();
+  uint16_t y = sensor->getYData();
+  uint16_t z = sensor->getZData();
+  if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+    LOG_SENSOR_WARN("Saturation check skipped: I2C error %d", (int)sensor->getLastError());
+    return false;
+  }
+  return isSaturated(status, x, y, z);
+}
+
+bool DynamicSensorManager::isSaturated(uint8_t status, uint16_t x, uint16_t y, uint16_t z) const {
   bool hardwareSaturation = (status & 0x10) != 0; // ASAT bit
   
   if (hardwareSaturation) {
@@ -225,10 +248,6 @@ bool DynamicSensorManager::checkSaturation() {
   }
   
   // Check individual channels for near-saturation
-  uint16_t x = sensor->getXData();
-  uint16_t y = sensor->getYData();
-  uint16_t z = sensor->getZData();
-  
   bool softSaturation = (x > ADC_TARGET_MAX || y > ADC_TARGET_MAX || z > ADC_TARGET_MAX);
   
   if (softSaturation) {
@@ -240,10 +259,18 @@ bool DynamicSensorManager::checkSaturation() {
 }
 
 bool DynamicSensorManager::checkSignalAdequacy() {
+  sensor->clearError();
   uint16_t x = sensor->getXData();
   uint16_t y = sensor->getYData();
   uint16_t z = sensor->getZData();
-  
+  if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+    LOG_SENSOR_WARN("Signal check skipped: I2C error %d", (int)sensor->getLastError());
+    return true;
+  }
+  return isSignalAdequate(x, y, z);
+}
+
+bool DynamicSensorManager::isSignalAdequate(uint16_t x, uint16_t y, uint16_t z) const {
   bool adequate = (x > ADC_TARGET_MIN && y > ADC_TARGET_MIN && z > ADC_TARGET_MIN);
   
   if (!adequate) {
@@ -317,27 +344,41 @@ bool DynamicSensorManager::performQualityReading(uint16_t& x, uint16_t& y, uint1
   uint16_t ir1Readings[RAPID_SCAN_SAMPLES];
   uint16_t ir2Readings[RAPID_SCAN_SAMPLES];
 
-  // Collect multiple rapid samples
+  // Collect multiple rapid samples; a sample with an I2C error is dropped
+  uint8_t count = 0;
+  uint8_t failed = 0;
   for (int i = 0; i < RAPID_SCAN_SAMPLES; i++) {
     if (i > 0) {
       delay(RAPID_SCAN_INTERVAL_MS);
     }
 
-    xReadings[i] = sensor->getXData();
-    yReadings[i] = sensor->getYData();
-    zReadings[i] = sensor->getZData();
-    ir1Readings[i] = sensor->getIR1Data();
-    ir2Readings[i] = sensor->getIR2Data();
+    sensor->clearError();
+    xReadings[count] = sensor->getXData();
+    yReadings[count] = sensor->getYData();
+    zReadings[count] = sensor->getZData();
+    ir1Readings[count] = sensor->getIR1Data();
+    ir2Readings[count] = sensor->getIR2Data();
+    if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+      LOG_SENSOR_WARN("Sample %d dropped: I2C error %d", i+1, (int)sensor->getLastError());
+      failed++;
+      continue;
+    }
 
     LOG_SENSOR_DEBUG("Sample %d: X=%u Y=%u Z=%u IR1=%u IR2=%u",
-                     i+1, xReadings[i], yReadings[i], zReadings[i],
-                     ir1Readings[i], ir2Readings[i]);
+                     i+1, xReadings[count], yReadings[count], zReadings[count],
+                     ir1Readings[count], ir2Readings[count]);
+    count++;
+  }
+
+  if (count == 0 || failed * 100 > RAPID_SCAN_SAMPLES * SCAN_MAX_FAILED_READ_PERCENT) {
+    LOG_SENSOR_ERROR("Quality reading failed: %u of %d samples had I2C errors", failed, RAPID_SCAN_SAMPLES);
+    return false;
   }
 
   // Calculate statistics for each channel
-  SampleStatistics xStats = calculateStatistics(xReadings, RAPID_SCAN_SAMPLES);
-  SampleStatistics yStats = calculateStatistics(yReadings, RAPID_SCAN_SAMPLES);
-  SampleStatistics zStats = calculateStatistics(zReadings, RAPID_SCAN_SAMPLES);
+  SampleStatistics xStats = calculateStatistics(xReadings, count);
+  SampleStatistics yStats = calculateStatistics(yReadings, count);
+  SampleStatistics zStats = calculateStatistics(zReadings, count);
 
   // Calculate averages (using mean from statistics)
   x = (uint16_t)xStats.mean;
@@ -346,12 +387,12 @@ bool DynamicSensorManager::performQualityReading(uint16_t& x, uint16_t& y, uint1
 
   // Calculate IR averages
   uint32_t ir1Sum = 0, ir2Sum = 0;
-  for (int i = 0; i < RAPID_SCAN_SAMPLES; i++) {
+  for (uint8_t i = 0; i < count; i++) {
     ir1Sum += ir1Readings[i];
     ir2Sum += ir2Readings[i];
   }
-  ir1 = ir1Sum / RAPID_SCAN_SAMPLES;
-  ir2 = ir2Sum / RAPID_SCAN_SAMPLES;
+  ir1 = ir1Sum / count;
+  ir2 = ir2Sum / count;
 
   // Analyze quality metrics
   quality.coefficientOfVariation = max({xStats.coefficientOfVariation,
@@ -365,7 +406,7 @@ bool DynamicSensorManager::performQualityReading(uint16_t& x, uint16_t& y, uint1
   quality.hasLowSignal = (quality.minReading < ADC_TARGET_MIN);
 
   // Calculate overall quality score
-  quality.qualityScore = calculateQualityScore(yReadings, RAPID_SCAN_SAMPLES);
+  quality.qualityScore = calculateQualityScore(yReadings, count);
 
   LOG_SENSOR_INFO("Quality reading complete: X=%u Y=%u Z=%u IR1=%u IR2=%u CV=%.3f Score=%u",
                   x, y, z, ir1, ir2, quality.coefficientOfVariation, quality.qualityScore);
@@ -488,6 +529,11 @@ uint8_t DynamicSensorManager::calculateQualityScore(uint16_t* readings, uint8_t
 }
 
 String DynamicSensorManager::getDiagnostics() {
+  bool saturation = checkSaturation();
+  return getDiagnostics(saturation, checkSignalAdequacy());
+}
+
+String DynamicSensorManager::getDiagnostics(bool saturation, bool signalAdequate) {
   String diagnostics = "{";
   diagnostics += "\"initialized\":" + String(initialized ? "true" : "false") + ",";
   diagnostics += "\"currentConfig\":{";
@@ -499,8 +545,8 @@ String DynamicSensorManager::getDiagnostics() {
   diagnostics += "},";
   diagnostics += "\"lastAdjustment\":" + String(millis() - lastAdjustmentTime) + ",";
   diagnostics += "\"adjustmentAttempts\":" + String(adjustmentAttempts) + ",";
-  diagnostics += "\"saturation\":" + String(checkSaturation() ? "true" : "false") + ",";
-  diagnostics += "\"signalAdequate\":" + String(checkSignalAdequacy() ? "true" : "false");
+  diagnostics += "\"saturation\":" + String(saturation ? "true" : "false") + ",";
+  diagnostics += "\"signalAdequate\":" + String(signalAdequate ? "true" : "false");
   diagnostics += "}";
 
   return diagnostics;
@@ -86,6 +86,13 @@ public:
    * @return Detected lighting condition
    */
   LightingCondition detectLightingCondition();
+
+  /**
+   * @brief Classify lighting from a Y reading taken elsewhere
+   * @param y Y channel reading
+   * @return Lighting condition for that reading
+   */
+  LightingCondition classifyLighting(uint16_t y) const;
   
   /**
    * @brief Get optimal sensor configuration for current lighting
@@ -109,15 +116,28 @@ public:
   
   /**
    * @brief Check if current readings are saturated
-   * @return true if any channel is saturated
+   * @return true if any channel is saturated; false when the read fails
    */
   bool checkSaturation();
   
   /**
    * @brief Check if current readings have sufficient signal
-   * @return true if signal is adequate
+   * @return true if signal is adequate or the read fails
    */
   bool checkSignalAdequacy();
+
+  /**
+   * @brief Saturation check on readings taken elsewhere
+   * @param status STATUS register value
+   * @return true if ASAT is set or any channel is near saturation
+   */
+  bool isSaturated(uint8_t status, uint16_t x, uint16_t y, uint16_t z) const;
+
+  /**
+   * @brief Signal check on readings taken elsewhere
+   * @return true if every channel is above the minimum
+   */
+  bool isSignalAdequate(uint16_t x, uint16_t y, uint16_t z) const;
   
   /**
    * @brief Perform rapid multi-sample reading with quality analysis
@@ -127,7 +147,8 @@ public:
    * @param ir1 Output IR1 channel average
    * @param ir2 Output IR2 channel average
    * @param quality Output quality metrics
-   * @return true if reading successful
+   * @return true if reading successful; false when more than
+   *         SCAN_MAX_FAILED_READ_PERCENT of the samples had I2C errors
    */
   bool performQualityReading(uint16_t& x, uint16_t& y, uint16_t& z, 
                            uint16_t& ir1, uint16_t& ir2, ReadingQuality& quality);
@@ -194,6 +215,14 @@ public:
    */
   String getDiagnostics();
 
+  /**
+   * @brief Get diagnostic information with the quality checks already done
+   * @param saturation Result of a saturation check
+   * @param signalAdequate Result of a signal check
+   * @return JSON string with diagnostic data
+   */
+  String getDiagnostics(bool saturation, bool signalAdequate);
+
 private:
   /**
    * @brief Initialize optimal configurations for different lighting conditions
@@ -0,0 +1,106 @@
+#include "event_stream.h"
+
+EventStream::EventStream() {
+  memset(active, 0, sizeof(active));
+  queue = xQueueCreate(EVENT_STREAM_QUEUE_LEN, sizeof(StreamEvent));
+  lastKeepaliveMs = 0;
+  published = 0;
+  delivered = 0;
+  droppedEvents = 0;
+  rejectedClients = 0;
+}
+
+bool EventStream::accept(WiFiClient client) {
+  for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+    if (active[i] && !clients[i].connected()) {
+      active[i] = false;
+      clients[i].stop();
+    }
+    if (!active[i]) {
+      clients[i] = client;
+      clients[i].setNoDelay(true);
+      clients[i].print("HTTP/1.1 200 OK\r\n"
+                       "Content-Type: text/event-stream\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Access-Control-Allow-Origin: *\r\n"
+                       "\r\n"
+                       "retry: 3000\n\n");
+      active[i] = true;
+      LOG_WEB_INFO("Event stream subscriber %u connected (%u active)", i, subscriberCount());
+      return true;
+    }
+  }
+  rejectedClients++;
+  return false;
+}
+
+bool EventStream::publish(const char* name, const char* data) {
+  StreamEvent event;
+  strncpy(event.name, name, sizeof(event.name) - 1);
+  event.name[sizeof(event.name) - 1] = '\0';
+  strncpy(event.data, data, sizeof(event.data) - 1);
+  event.data[sizeof(event.data) - 1] = '\0';
+
+  if (xQueueSend(queue, &event, 0) != pdPASS) {
+    droppedEvents++;
+    return false;
+  }
+  published++;
+  return true;
+}
+
+void EventStream::send(const char* text) {
+  for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+    if (!active[i]) {
+      continue;
+    }
+    if (!clients[i].connected() || clients[i].print(text) == 0) {
+      active[i] = false;
+      clients[i].stop();
+      LOG_WEB_DEBUG("Event stream subscriber %u disconnected", i);
+    }
+  }
+}
+
+void EventStream::service() {
+  StreamEvent event;
+  bool any = subscriberCount() > 0;
+  while (xQueueReceive(queue, &event, 0) == pdPASS) {
+    if (!any) {
+      continue;  // Nobody listening; /samples still has the result
+    }
+    String frame = "event: ";
+    frame += event.name;
+    frame += "\ndata: ";
+    frame += event.data;
+    frame += "\n\n";
+    send(frame.c_str());
+    delivered++;
+    lastKeepaliveMs = millis();
+  }
+
+  if (any && millis() - lastKeepaliveMs > EVENT_STREAM_KEEPALIVE_MS) {
+    send(": keepalive\n\n");
+    lastKeepaliveMs = millis();
+  }
+}
+
+uint8_t EventStream::subscriberCount() const {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+    if (active[i]) {
+      n++;
+    }
+  }
+  return n;
+}
+
+void EventStream::getStats(JsonObject stats) const {
+  stats["subscribers"] = subscriberCount();
+  stats["maxSubscribers"] = EVENT_STREAM_MAX_CLIENTS;
+  stats["published"] = published;
+  stats["delivered"] = delivered;
+  stats["dropped"] = droppedEvents;
+  stats["rejectedClients"] = rejectedClients;
+}
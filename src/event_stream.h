@@ -0,0 +1,69 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+
+/**
+ * @brief Server-sent events over connections handed off by the web server
+ *
+ * A GET handler passes its client to accept(), which answers with an
+ * event-stream header and keeps the socket open. Any task can publish();
+ * events are copied into a fixed-size FreeRTOS queue and written to every
+ * subscriber from loop() by service(), so background tasks never touch the
+ * sockets. A comment line is sent every EVENT_STREAM_KEEPALIVE_MS so idle
+ * proxies keep the connection, and closed clients are pruned.
+ */
+
+struct StreamEvent {
+  char name[16];
+  char data[EVENT_STREAM_DATA_MAX];
+};
+
+class EventStream {
+private:
+  WiFiClient clients[EVENT_STREAM_MAX_CLIENTS];
+  bool active[EVENT_STREAM_MAX_CLIENTS];
+  QueueHandle_t queue;
+  uint32_t lastKeepaliveMs;
+  uint32_t published;
+  uint32_t delivered;
+  uint32_t droppedEvents;    // Queue full when published
+  uint32_t rejectedClients;  // No free subscriber slot
+
+  void send(const char* text);
+
+public:
+  EventStream();
+
+  /**
+   * @brief Take over a client as a subscriber
+   * @return false if every slot is in use (caller should answer 503)
+   */
+  bool accept(WiFiClient client);
+
+  /**
+   * @brief Queue an event for all subscribers; safe from any task
+   * @param name Event name (the "event:" field)
+   * @param data Single-line payload, usually JSON; truncated to EVENT_STREAM_DATA_MAX
+   * @return false if the queue was full and the event was dropped
+   */
+  bool publish(const char* name, const char* data);
+
+  /**
+   * @brief Deliver queued events and keepalives; call from loop()
+   */
+  void service();
+
+  uint8_t subscriberCount() const;
+
+  /**
+   * @brief Add subscriber and delivery counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // EVENT_STREAM_H
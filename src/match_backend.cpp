@@ -0,0 +1,234 @@
+#include "match_backend.h"
+
+const char* MatchBackend::statusName(MatchBackendStatus status) {
+  switch (status) {
+    case MATCH_BACKEND_MATCHED: return "matched";
+    case MATCH_BACKEND_NO_MATCH: return "noMatch";
+    case MATCH_BACKEND_FAILED: return "failed";
+  }
+  return "unknown";
+}
+
+MatchBackendStatus MatchBackend::lookupBatch(const MatchColor* colors, uint8_t count, MatchResponse* out,
+                                             MatchBackendStatus* statuses) {
+  MatchBackendStatus overall = MATCH_BACKEND_NO_MATCH;
+  for (uint8_t i = 0; i < count; i++) {
+    if (overall == MATCH_BACKEND_FAILED) {
+      memset(&out[i], 0, sizeof(out[i]));
+      statuses[i] = MATCH_BACKEND_FAILED;
+      continue;
+    }
+    statuses[i] = lookup(colors[i].r, colors[i].g, colors[i].b, out[i]);
+    if (statuses[i] != MATCH_BACKEND_NO_MATCH) {
+      overall = statuses[i];
+    }
+  }
+  return overall;
+}
+
+// ============================================================================
+// CIRCUIT BREAKER
+// ============================================================================
+
+CircuitBreaker::CircuitBreaker() {
+  state = BREAKER_CLOSED;
+  consecutiveFailures = 0;
+  openedAt = 0;
+  cooldownMs = MATCH_BREAKER_COOLDOWN_MS;
+  trips = 0;
+  skipped = 0;
+}
+
+bool CircuitBreaker::allow(uint32_t now) {
+  if (state == BREAKER_CLOSED) {
+    return true;
+  }
+  if (state == BREAKER_OPEN && now - openedAt >= cooldownMs) {
+    state = BREAKER_HALF_OPEN;
+    return true;
+  }
+  skipped++;
+  return false;
+}
+
+void CircuitBreaker::recordSuccess() {
+  state = BREAKER_CLOSED;
+  consecutiveFailures = 0;
+  cooldownMs = MATCH_BREAKER_COOLDOWN_MS;
+}
+
+void CircuitBreaker::recordFailure(uint32_t now) {
+  if (state == BREAKER_HALF_OPEN) {
+    cooldownMs = min((uint32_t)MATCH_BREAKER_COOLDOWN_MAX_MS, cooldownMs * 2);
+    open(now);
+    return;
+  }
+  if (consecutiveFailures < 255) {
+    consecutiveFailures++;
+  }
+  if (state == BREAKER_CLOSED && consecutiveFailures >= MATCH_BREAKER_FAILURES) {
+    open(now);
+  }
+}
+
+void CircuitBreaker::open(uint32_t now) {
+  state = BREAKER_OPEN;
+  openedAt = now;
+  trips++;
+}
+
+void CircuitBreaker::getStats(JsonObject stats) const {
+  uint32_t now = millis();
+  stats["state"] = stateName(state);
+  stats["consecutiveFailures"] = consecutiveFailures;
+  stats["cooldownMs"] = cooldownMs;
+  stats["reopensInMs"] = state == BREAKER_OPEN && now - openedAt < cooldownMs ? cooldownMs - (now - openedAt) : 0;
+  stats["trips"] = trips;
+  stats["skipped"] = skipped;
+}
+
+const char* CircuitBreaker::stateName(BreakerState state) {
+  switch (state) {
+    case BREAKER_CLOSED: return "closed";
+    case BREAKER_OPEN: return "open";
+    case BREAKER_HALF_OPEN: return "halfOpen";
+  }
+  return "unknown";
+}
+
+// ============================================================================
+// HTTP BACKENDS
+// ============================================================================
+
+HttpMatchBackend::HttpMatchBackend(const char* name, const char* url) : name(name), baseUrl(url) {
+  memset(&parse, 0, sizeof(parse));
+  lastStatus = 0;
+  batchPost = true;
+  batchRequests = 0;
+  batchColors = 0;
+}
+
+String HttpMatchBackend::lookupUrl(uint8_t r, uint8_t g, uint8_t b) const {
+  return String(baseUrl) + (strchr(baseUrl, '?') ? "&" : "?") + "r=" + String(r) + "&g=" + String(g) +
+         "&b=" + String(b) + "&k=" + String(MATCH_ALTERNATES_MAX);
+}
+
+MatchBackendStatus HttpMatchBackend::lookup(uint8_t r, uint8_t g, uint8_t b, MatchResponse& out) {
+  if (!isConfigured()) {
+    memset(&out, 0, sizeof(out));
+    return MATCH_BACKEND_FAILED;
+  }
+
+  String url = lookupUrl(r, g, b);
+  LOG_API_DEBUG("[%s] GET %s", name, url.c_str());
+
+  // The body is parsed from the socket as it arrives
+  lastStatus = client.get(url, readMatchResponse, &parse);
+  const MatchCallInfo& call = client.lastCall();
+  const MatchResponse& result = parse.response;
+
+  LOG_API_INFO("[%s] Response - Code:%d Duration:%lu ms Hops:%u Connects:%u Resumed:%u Reused:%u", name,
+               lastStatus, (unsigned long)call.ms, call.hops, call.connects, call.resumedHandshakes,
+               call.reusedRequests);
+  if (lastStatus == 200) {
+    LOG_API_DEBUG("[%s] Parsed - Arena:%u/%u bytes Alternates:%u", name, result.arenaPeak,
+                  (unsigned)MATCH_PARSE_ARENA_BYTES, result.alternateCount);
+  } else if (lastStatus < 0) {
+    LOG_API_ERROR("[%s] Request failed - %s", name, MatchClient::errorName(lastStatus));
+  }
+  if (result.error[0]) {
+    LOG_API_ERROR("[%s] Error response: %s", name, result.error);
+  }
+
+  Logger::logAPICall(name, lastStatus, call.ms);
+  memcpy(&out, &result, sizeof(out));
+  return classify(lastStatus, result);
+}
+
+MatchBackendStatus HttpMatchBackend::lookupBatch(const MatchColor* colors, uint8_t count, MatchResponse* out,
+                                                 MatchBackendStatus* statuses) {
+  if (count <= 1 || !batchPost || !isConfigured()) {
+    return MatchBackend::lookupBatch(colors, count, out, statuses);
+  }
+
+  JsonDocument request;
+  request["k"] = MATCH_ALTERNATES_MAX;
+  JsonArray list = request["colors"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; i++) {
+    JsonObject color = list.add<JsonObject>();
+    color["r"] = colors[i].r;
+    color["g"] = colors[i].g;
+    color["b"] = colors[i].b;
+  }
+  String body;
+  serializeJson(request, body);
+
+  MatchBatchParse batch = {&parse, out, count, 0, false};
+  lastStatus = client.post(baseUrl, body, readMatchBatchResponse, &batch);
+  const MatchCallInfo& call = client.lastCall();
+  LOG_API_INFO("[%s] Batch response - Code:%d Colors:%u Results:%u Duration:%lu ms Connects:%u Reused:%u", name,
+               lastStatus, count, batch.received, (unsigned long)call.ms, call.connects, call.reusedRequests);
+  Logger::logAPICall(name, lastStatus, call.ms);
+
+  if (lastStatus == 404 || lastStatus == 405 || lastStatus == 501) {
+    LOG_API_INFO("[%s] Server does not take batches - looking colors up one at a time", name);
+    batchPost = false;
+    return MatchBackend::lookupBatch(colors, count, out, statuses);
+  }
+  batchRequests++;
+  batchColors += count;
+
+  // Results that arrived stand even if the rest of the body did not
+  const MatchResponse& failure = parse.response;
+  MatchBackendStatus batchVerdict = lastStatus == 200 ? MATCH_BACKEND_FAILED : classify(lastStatus, failure);
+  if (failure.error[0] && batch.received < count) {
+    LOG_API_ERROR("[%s] Batch error: %s", name, failure.error);
+  }
+  MatchBackendStatus overall = MATCH_BACKEND_NO_MATCH;
+  for (uint8_t i = 0; i < count; i++) {
+    if (i < batch.received) {
+      statuses[i] = classify(200, out[i]);
+    } else {
+      memcpy(&out[i], &failure, sizeof(out[i]));
+      statuses[i] = batchVerdict;
+    }
+    if (overall != MATCH_BACKEND_FAILED && statuses[i] != MATCH_BACKEND_NO_MATCH) {
+      overall = statuses[i];
+    }
+  }
+  return overall;
+}
+
+MatchBackendStatus HttpMatchBackend::classify(int status, const MatchResponse& response) const {
+  // Connection errors, throttling and server errors may clear up
+  if (status < 0 || status == 429 || status >= 500) {
+    return MATCH_BACKEND_FAILED;
+  }
+  if (status != 200) {
+    return MATCH_BACKEND_NO_MATCH;
+  }
+  if (!response.parsed) {
+    // A payload too big for the arena will not shrink on retry
+    return response.overflow ? MATCH_BACKEND_NO_MATCH : MATCH_BACKEND_FAILED;
+  }
+  return response.success && response.hasMatch ? MATCH_BACKEND_MATCHED : MATCH_BACKEND_NO_MATCH;
+}
+
+void HttpMatchBackend::getStats(JsonObject stats) const {
+  stats["configured"] = isConfigured();
+  stats["lastStatus"] = lastStatus;
+  stats["batchPost"] = batchPost;
+  stats["batchRequests"] = batchRequests;
+  stats["batchColors"] = batchColors;
+  client.getStats(stats["client"].to<JsonObject>());
+}
+
+MatchBackendStatus AppsScriptMatchBackend::classify(int status, const MatchResponse& response) const {
+  MatchBackendStatus verdict = HttpMatchBackend::classify(status, response);
+  if (verdict == MATCH_BACKEND_NO_MATCH && !response.success &&
+      (strstr(response.error, "quota") || strstr(response.error, "too many times") ||
+       strstr(response.error, "Service invoked"))) {
+    return MATCH_BACKEND_FAILED;
+  }
+  return verdict;
+}
@@ -0,0 +1,178 @@
+#ifndef MATCH_BACKEND_H
+#define MATCH_BACKEND_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+#include "match_client.h"
+#include "match_response.h"
+
+/**
+ * @brief Paint-match backends behind one lookup interface
+ *
+ * A backend turns an RGB color into a MatchResponse and says whether the
+ * answer is final: MATCHED and NO_MATCH are answers (the backend worked, it
+ * just may not know the color), FAILED means it could not be asked and
+ * another backend or a later retry may do better. MatchRouter chooses which
+ * backends to ask and guards each remote one with a CircuitBreaker.
+ *
+ * A backend's lookup() is called from one task at a time.
+ */
+
+struct MatchColor {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+enum MatchBackendStatus : uint8_t {
+  MATCH_BACKEND_MATCHED = 0,    // response.best holds the paint
+  MATCH_BACKEND_NO_MATCH = 1,   // Backend answered without a usable paint
+  MATCH_BACKEND_FAILED = 2      // Unreachable, timed out, throttled or server error
+};
+
+class MatchBackend {
+public:
+  virtual ~MatchBackend() {}
+
+  virtual const char* getName() const = 0;
+
+  /**
+   * @brief Whether lookups leave the device (and so need the network and a lane task)
+   */
+  virtual bool isRemote() const = 0;
+
+  /**
+   * @brief Look up one color; out is overwritten even on failure
+   */
+  virtual MatchBackendStatus lookup(uint8_t r, uint8_t g, uint8_t b, MatchResponse& out) = 0;
+
+  /**
+   * @brief Look up several colors; statuses[i] and out[i] belong to colors[i]
+   * @return MATCH_BACKEND_FAILED if any color could not be looked up
+   *
+   * The default calls lookup() per color and, after a failure, marks the
+   * rest failed without trying them.
+   */
+  virtual MatchBackendStatus lookupBatch(const MatchColor* colors, uint8_t count, MatchResponse* out,
+                                         MatchBackendStatus* statuses);
+
+  /**
+   * @brief Add backend-specific counters to a JSON object
+   */
+  virtual void getStats(JsonObject stats) const = 0;
+
+  static const char* statusName(MatchBackendStatus status);
+};
+
+// ============================================================================
+// CIRCUIT BREAKER
+// ============================================================================
+
+enum BreakerState : uint8_t {
+  BREAKER_CLOSED = 0,       // Calls go through
+  BREAKER_OPEN = 1,         // Calls skipped until the cool-down ends
+  BREAKER_HALF_OPEN = 2     // One trial call in flight
+};
+
+/**
+ * @brief Stops calling a backend after repeated failures
+ *
+ * MATCH_BREAKER_FAILURES consecutive failures open the breaker for
+ * MATCH_BREAKER_COOLDOWN_MS. The first call allowed after that is a trial:
+ * success closes the breaker, failure reopens it with the cool-down doubled
+ * (up to MATCH_BREAKER_COOLDOWN_MAX_MS). Answers without a match count as
+ * success. Owned by the router task; not thread-safe.
+ */
+class CircuitBreaker {
+private:
+  BreakerState state;
+  uint8_t consecutiveFailures;
+  uint32_t openedAt;
+  uint32_t cooldownMs;
+  uint32_t trips;
+  uint32_t skipped;
+
+  void open(uint32_t now);
+
+public:
+  CircuitBreaker();
+
+  /**
+   * @brief Whether a call may start now; moves OPEN to HALF_OPEN once the cool-down ends
+   */
+  bool allow(uint32_t now);
+
+  void recordSuccess();
+  void recordFailure(uint32_t now);
+
+  BreakerState getState() const { return state; }
+  void getStats(JsonObject stats) const;
+
+  static const char* stateName(BreakerState state);
+};
+
+// ============================================================================
+// HTTP BACKENDS
+// ============================================================================
+
+/**
+ * @brief JSON match service reached with GET url?r=&g=&b=&k=
+ *
+ * Speaks the protocol of color_matcher_server.py: a JSON object with success,
+ * match {name, code, lrv}, distance and alternates. Several colors go out as
+ * one POST of {"k": 3, "colors": [{"r", "g", "b"}, ...]} answered by
+ * {"results": [...]} in the same order; a server that answers the POST with
+ * 404, 405 or 501 is asked one color at a time from then on. Each instance
+ * keeps its own MatchClient connections and parse arena.
+ */
+class HttpMatchBackend : public MatchBackend {
+protected:
+  const char* name;
+  const char* baseUrl;
+  MatchClient client;
+  MatchParseState parse;
+  int lastStatus;
+  bool batchPost;          // Server takes batch POSTs (cleared when it refuses one)
+  uint32_t batchRequests;
+  uint32_t batchColors;
+
+  /**
+   * @brief Decide what an HTTP status and parsed body mean for the router
+   */
+  virtual MatchBackendStatus classify(int status, const MatchResponse& response) const;
+
+public:
+  HttpMatchBackend(const char* name, const char* url);
+
+  const char* getName() const override { return name; }
+  bool isRemote() const override { return true; }
+  bool isConfigured() const { return baseUrl && baseUrl[0]; }
+
+  /**
+   * @brief The GET URL lookup() requests for a color
+   */
+  String lookupUrl(uint8_t r, uint8_t g, uint8_t b) const;
+  MatchBackendStatus lookup(uint8_t r, uint8_t g, uint8_t b, MatchResponse& out) override;
+  MatchBackendStatus lookupBatch(const MatchColor* colors, uint8_t count, MatchResponse* out,
+                                 MatchBackendStatus* statuses) override;
+  void getStats(JsonObject stats) const override;
+};
+
+/**
+ * @brief The Google Apps Script deployment
+ *
+ * Apps Script reports quota exhaustion and overload in the JSON error field
+ * (or as an HTML page with status 200), so those are failures, not answers.
+ * The deployed script only implements doGet, so colors go one per request.
+ */
+class AppsScriptMatchBackend : public HttpMatchBackend {
+protected:
+  MatchBackendStatus classify(int status, const MatchResponse& response) const override;
+
+public:
+  explicit AppsScriptMatchBackend(const char* url) : HttpMatchBackend("appsScript", url) { batchPost = false; }
+};
+
+#endif // MATCH_BACKEND_H
@@ -0,0 +1,951 @@
+#include "match_client.h"
+#include "perf_profiler.h"
+#include <mbedtls/net_sockets.h>
+
+// A resumed handshake is a few hundred bytes from the server; a full one
+// carries the certificate chain, which is several kilobytes
+#define TLS_RESUMED_MAX_RX_BYTES 1024
+
+// ============================================================================
+// TLS SESSION CLIENT
+// ============================================================================
+
+TlsSessionClient::TlsSessionClient() {
+  caCert = nullptr;
+  configured = false;
+  active = false;
+  haveSession = false;
+  sessionHost[0] = '\0';
+  timeoutMs = COLOR_MATCH_TIMEOUT_MS;
+  handshakeRxBytes = 0;
+  fullHandshakes = 0;
+  resumedHandshakes = 0;
+  lastHandshakeUs = 0;
+  lastResumed = false;
+  handshakeFailed = false;
+  mbedtls_ssl_init(&ssl);
+  mbedtls_ssl_session_init(&session);
+}
+
+TlsSessionClient::~TlsSessionClient() {
+  stop();
+  mbedtls_ssl_session_free(&session);
+  if (configured) {
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+    mbedtls_x509_crt_free(&caChain);
+  }
+}
+
+bool TlsSessionClient::configure() {
+  if (configured) {
+    return true;
+  }
+
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&drbg);
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_x509_crt_init(&caChain);
+  configured = true;
+
+  const char* pers = "match_client";
+  if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                            (const unsigned char*)pers, strlen(pers)) != 0 ||
+      mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+    LOG_API_ERROR("TLS client setup failed");
+    return false;
+  }
+
+  if (caCert && mbedtls_x509_crt_parse(&caChain, (const unsigned char*)caCert, strlen(caCert) + 1) == 0) {
+    mbedtls_ssl_conf_ca_chain(&conf, &caChain, nullptr);
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+  } else {
+    if (caCert) {
+      LOG_API_ERROR("Match backend CA certificate did not parse - server will not be verified");
+    }
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+  }
+  mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+  mbedtls_ssl_conf_read_timeout(&conf, timeoutMs);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+  return true;
+}
+
+int TlsSessionClient::bioSend(void* ctx, const unsigned char* buf, size_t len) {
+  TlsSessionClient* self = static_cast<TlsSessionClient*>(ctx);
+  size_t sent = self->WiFiClient::write(buf, len);
+  return sent > 0 ? (int)sent : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsSessionClient::bioRecv(void* ctx, unsigned char* buf, size_t len, uint32_t timeout) {
+  TlsSessionClient* self = static_cast<TlsSessionClient*>(ctx);
+  unsigned long start = millis();
+  while (self->WiFiClient::available() <= 0) {
+    if (!self->WiFiClient::connected()) {
+      return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    if (timeout && millis() - start >= timeout) {
+      return MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    delay(1);
+  }
+  int n = self->WiFiClient::read(buf, len);
+  if (n <= 0) {
+    return MBEDTLS_ERR_NET_RECV_FAILED;
+  }
+  self->handshakeRxBytes += n;
+  return n;
+}
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip.toString().c_str(), port, timeoutMs);
+}
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+  return connect(ip.toString().c_str(), port, timeout);
+}
+
+int TlsSessionClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, timeoutMs);
+}
+
+int TlsSessionClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  stop();
+  handshakeFailed = true;
+  if (!configure()) {
+    return 0;
+  }
+  if (!WiFiClient::connect(host, port, timeout)) {
+    handshakeFailed = false;
+    return 0;
+  }
+
+  if (mbedtls_ssl_setup(&ssl, &conf) != 0 || mbedtls_ssl_set_hostname(&ssl, host) != 0) {
+    LOG_API_ERROR("TLS context setup failed for %s", host);
+    teardown();
+    return 0;
+  }
+  mbedtls_ssl_set_bio(&ssl, this, bioSend, nullptr, bioRecv);
+
+  // Sessions are only valid for the server that issued them
+  bool offered = false;
+  if (haveSession && strcmp(sessionHost, host) == 0) {
+    offered = mbedtls_ssl_set_session(&ssl, &session) == 0;
+  }
+
+  unsigned long start = micros();
+  unsigned long deadline = millis() + timeoutMs;
+  handshakeRxBytes = 0;
+  int ret;
+  while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+        (long)(millis() - deadline) >= 0) {
+      LOG_API_ERROR("TLS handshake with %s failed (-0x%04x)", host, (unsigned)-ret);
+      teardown();
+      // A rejected or stale session must not poison the next attempt
+      forgetSession();
+      return 0;
+    }
+    delay(1);
+  }
+  lastHandshakeUs = micros() - start;
+  lastResumed = offered && handshakeRxBytes < TLS_RESUMED_MAX_RX_BYTES;
+  if (lastResumed) {
+    resumedHandshakes++;
+  } else {
+    fullHandshakes++;
+  }
+
+  mbedtls_ssl_session_free(&session);
+  mbedtls_ssl_session_init(&session);
+  haveSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+  strncpy(sessionHost, host, sizeof(sessionHost) - 1);
+  sessionHost[sizeof(sessionHost) - 1] = '\0';
+
+  active = true;
+  handshakeFailed = false;
+  LOG_API_DEBUG("TLS %s handshake with %s in %luus", lastResumed ? "resumed" : "full", host,
+                (unsigned long)lastHandshakeUs);
+  return 1;
+}
+
+void TlsSessionClient::teardown() {
+  mbedtls_ssl_free(&ssl);
+  mbedtls_ssl_init(&ssl);
+  active = false;
+  WiFiClient::stop();
+}
+
+void TlsSessionClient::stop() {
+  if (active) {
+    mbedtls_ssl_close_notify(&ssl);
+  }
+  teardown();
+}
+
+void TlsSessionClient::forgetSession() {
+  mbedtls_ssl_session_free(&session);
+  mbedtls_ssl_session_init(&session);
+  haveSession = false;
+  sessionHost[0] = '\0';
+}
+
+size_t TlsSessionClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t TlsSessionClient::write(const uint8_t* buf, size_t size) {
+  if (!active) {
+    return 0;
+  }
+  size_t written = 0;
+  while (written < size) {
+    int ret = mbedtls_ssl_write(&ssl, buf + written, size - written);
+    if (ret > 0) {
+      written += ret;
+    } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      stop();
+      break;
+    }
+  }
+  return written;
+}
+
+int TlsSessionClient::available() {
+  if (!active) {
+    return 0;
+  }
+  int pending = mbedtls_ssl_get_bytes_avail(&ssl);
+  if (pending == 0 && WiFiClient::available() > 0) {
+    // Decrypt the next record so its plaintext length is known
+    int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      stop();
+      return 0;
+    }
+    pending = mbedtls_ssl_get_bytes_avail(&ssl);
+  }
+  return pending;
+}
+
+int TlsSessionClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int TlsSessionClient::read(uint8_t* buf, size_t size) {
+  if (available() <= 0) {
+    return -1;
+  }
+  int ret = mbedtls_ssl_read(&ssl, buf, size);
+  if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return -1;
+  }
+  if (ret <= 0) {
+    stop();  // Peer close_notify or a fatal alert
+    return -1;
+  }
+  return ret;
+}
+
+int TlsSessionClient::peek() {
+  // HTTP parsing here never peeks; kept for the Client interface
+  return -1;
+}
+
+uint8_t TlsSessionClient::connected() {
+  if (!active) {
+    return 0;
+  }
+  return mbedtls_ssl_get_bytes_avail(&ssl) > 0 || WiFiClient::connected();
+}
+
+// ============================================================================
+// URL HELPERS
+// ============================================================================
+
+struct ParsedUrl {
+  bool secure;
+  char host[MATCH_HOST_MAX];
+  uint16_t port;
+  String path;      // Path and query, starting with '/'
+};
+
+static bool parseUrl(const String& url, ParsedUrl& out) {
+  int hostStart;
+  if (url.startsWith("https://")) {
+    out.secure = true;
+    out.port = 443;
+    hostStart = 8;
+  } else if (url.startsWith("http://")) {
+    out.secure = false;
+    out.port = 80;
+    hostStart = 7;
+  } else {
+    return false;
+  }
+
+  int pathStart = url.indexOf('/', hostStart);
+  String authority = pathStart < 0 ? url.substring(hostStart) : url.substring(hostStart, pathStart);
+  out.path = pathStart < 0 ? String("/") : url.substring(pathStart);
+
+  int colon = authority.indexOf(':');
+  if (colon >= 0) {
+    long port = authority.substring(colon + 1).toInt();
+    if (port <= 0 || port > 65535) {
+      return false;
+    }
+    out.port = port;
+    authority = authority.substring(0, colon);
+  }
+  if (authority.length() == 0 || authority.length() >= sizeof(out.host)) {
+    return false;
+  }
+  strcpy(out.host, authority.c_str());
+  return true;
+}
+
+static String withoutQuery(const String& url) {
+  int q = url.indexOf('?');
+  return q < 0 ? url : url.substring(0, q);
+}
+
+static String queryOf(const String& url) {
+  int q = url.indexOf('?');
+  return q < 0 ? String() : url.substring(q);
+}
+
+// Location may be absolute or host-relative
+static String resolveLocation(const String& current, const String& location) {
+  if (location.startsWith("http://") || location.startsWith("https://")) {
+    return location;
+  }
+  ParsedUrl base;
+  if (!location.startsWith("/") || !parseUrl(current, base)) {
+    return String();
+  }
+  String url = base.secure ? "https://" : "http://";
+  url += base.host;
+  if (base.port != (base.secure ? 443 : 80)) {
+    url += ":";
+    url += String(base.port);
+  }
+  url += location;
+  return url;
+}
+
+// ============================================================================
+// HTTP
+// ============================================================================
+
+static bool waitAvailable(WiFiClient& client, unsigned long deadline) {
+  while (client.available() <= 0) {
+    if (!client.connected() || (long)(millis() - deadline) >= 0) {
+      return false;
+    }
+    delay(1);
+  }
+  return true;
+}
+
+static bool readLine(WiFiClient& client, String& line, unsigned long deadline) {
+  line = "";
+  for (;;) {
+    if (!waitAvailable(client, deadline)) {
+      return false;
+    }
+    int c = client.read();
+    if (c < 0) {
+      return false;
+    }
+    if (c == '\n') {
+      line.trim();
+      return true;
+    }
+    if (line.length() >= MATCH_HEADER_LINE_MAX) {
+      return false;
+    }
+    line += (char)c;
+  }
+}
+
+/**
+ * @brief Response body as a Stream, undoing chunked or length framing
+ *
+ * read() waits for data up to the response deadline and returns -1 at the end
+ * of the body or on an error (see error()). Nothing is buffered beyond what
+ * the socket already holds.
+ */
+class MatchBodyStream : public Stream {
+private:
+  WiFiClient& client;
+  unsigned long deadline;
+  bool chunked;
+  bool untilClose;
+  bool firstChunk;
+  bool done;
+  int err;
+  long remaining;          // Bytes left in this chunk, or in the body
+  size_t consumed;
+  int peeked;              // Byte returned by peek() and not yet read, or -1
+
+  bool nextChunk() {
+    String line;
+    if ((!firstChunk && !readLine(client, line, deadline)) || !readLine(client, line, deadline)) {
+      err = MATCH_CLIENT_ERR_RESPONSE;
+      return false;
+    }
+    firstChunk = false;
+    remaining = strtol(line.c_str(), nullptr, 16);
+    if (remaining <= 0) {
+      // Last chunk: skip trailers up to the blank line
+      do {
+        if (!readLine(client, line, deadline)) {
+          err = MATCH_CLIENT_ERR_RESPONSE;
+          return false;
+        }
+      } while (line.length() > 0);
+      done = true;
+    }
+    return true;
+  }
+
+public:
+  MatchBodyStream(WiFiClient& client, unsigned long deadline, bool chunked, long contentLength)
+      : client(client), deadline(deadline), chunked(chunked), untilClose(!chunked && contentLength < 0),
+        firstChunk(true), done(!chunked && contentLength == 0), err(0), remaining(chunked ? 0 : contentLength),
+        consumed(0), peeked(-1) {
+    setTimeout(0);  // read() already waits; Stream::readBytes must not wait again at the end
+  }
+
+  int read() override {
+    if (peeked >= 0) {
+      int c = peeked;
+      peeked = -1;
+      return c;
+    }
+    if (done || err) {
+      return -1;
+    }
+    if (chunked && remaining == 0 && (!nextChunk() || done)) {
+      return -1;
+    }
+    if (!waitAvailable(client, deadline)) {
+      if (untilClose && !client.connected()) {
+        done = true;
+      } else {
+        err = MATCH_CLIENT_ERR_TIMEOUT;
+      }
+      return -1;
+    }
+    int c = client.read();
+    if (c < 0) {
+      err = MATCH_CLIENT_ERR_TIMEOUT;
+      return -1;
+    }
+    if (++consumed > MATCH_RESPONSE_MAX_BYTES) {
+      err = MATCH_CLIENT_ERR_TOO_LARGE;
+      return -1;
+    }
+    if (!untilClose && --remaining == 0 && !chunked) {
+      done = true;
+    }
+    return c;
+  }
+
+  int available() override {
+    if (done || err) {
+      return peeked >= 0 ? 1 : 0;
+    }
+    int ready = client.available();
+    return (peeked >= 0 ? 1 : 0) + (untilClose || remaining > ready ? ready : remaining);
+  }
+
+  int peek() override {
+    if (peeked < 0) {
+      peeked = read();
+    }
+    return peeked;
+  }
+  size_t write(uint8_t) override { return 0; }
+
+  /**
+   * @brief Read whatever the handler left so the connection can carry the next request
+   */
+  void drain() {
+    while (read() >= 0) {
+    }
+  }
+
+  bool complete() const { return done && !err; }
+  int error() const { return err; }
+  bool closeDelimited() const { return untilClose; }
+};
+
+int MatchClient::readResponse(WiFiClient& client, MatchBodyHandler handler, void* ctx, String& location,
+                              bool& keepAlive) {
+  unsigned long deadline = millis() + timeoutMs;
+  String line;
+
+  if (!waitAvailable(client, deadline)) {
+    return client.connected() ? MATCH_CLIENT_ERR_TIMEOUT : MATCH_CLIENT_ERR_CLOSED;
+  }
+  if (!readLine(client, line, deadline) || !line.startsWith("HTTP/1.")) {
+    return MATCH_CLIENT_ERR_RESPONSE;
+  }
+  int space = line.indexOf(' ');
+  int status = space > 0 ? line.substring(space + 1).toInt() : 0;
+  if (status < 100) {
+    return MATCH_CLIENT_ERR_RESPONSE;
+  }
+  keepAlive = line.startsWith("HTTP/1.1");
+
+  long contentLength = -1;
+  bool chunked = false;
+  for (;;) {
+    if (!readLine(client, line, deadline)) {
+      return MATCH_CLIENT_ERR_RESPONSE;
+    }
+    if (line.length() == 0) {
+      break;
+    }
+    int colon = line.indexOf(':');
+    if (colon <= 0) {
+      continue;
+    }
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase("Content-Length")) {
+      contentLength = value.toInt();
+    } else if (name.equalsIgnoreCase("Transfer-Encoding")) {
+      value.toLowerCase();
+      chunked = value.indexOf("chunked") >= 0;
+    } else if (name.equalsIgnoreCase("Connection")) {
+      value.toLowerCase();
+      if (value.indexOf("close") >= 0) {
+        keepAlive = false;
+      } else if (value.indexOf("keep-alive") >= 0) {
+        keepAlive = true;
+      }
+    } else if (name.equalsIgnoreCase("Location")) {
+      location = value;
+    }
+  }
+
+  if (status == 204 || status == 304) {
+    contentLength = 0;
+    chunked = false;
+  }
+  MatchBodyStream body(client, deadline, chunked, contentLength);
+  bool redirect = status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+  if (!redirect && handler) {
+    handler(body, status, ctx);
+  }
+  body.drain();
+
+  if (body.closeDelimited()) {
+    keepAlive = false;
+  }
+  return body.complete() ? status : body.error();
+}
+
+// ============================================================================
+// MATCH CLIENT
+// ============================================================================
+
+MatchClient::MatchClient() {
+  for (uint8_t i = 0; i < MATCH_CLIENT_CONNECTIONS; i++) {
+    connections[i].host[0] = '\0';
+    connections[i].port = 0;
+    connections[i].secure = false;
+    connections[i].lastUsedMs = 0;
+    connections[i].open = false;
+  }
+  for (uint8_t i = 0; i < MATCH_REDIRECT_CACHE_SIZE; i++) {
+    redirects[i].expiresAt = 0;
+  }
+  timeoutMs = COLOR_MATCH_TIMEOUT_MS;
+  memset(&last, 0, sizeof(last));
+  calls = 0;
+  failures = 0;
+  connects = 0;
+  reusedRequests = 0;
+  redirectsFollowed = 0;
+  redirectCacheHits = 0;
+  totalMs = 0;
+}
+
+MatchConnection& MatchClient::connectionFor(bool secure, const char* host, uint16_t port) {
+  uint8_t pick = 0;
+  for (uint8_t i = 0; i < MATCH_CLIENT_CONNECTIONS; i++) {
+    MatchConnection& conn = connections[i];
+    if (conn.secure == secure && conn.port == port && strcmp(conn.host, host) == 0) {
+      return conn;
+    }
+    // Otherwise reuse the least recently used slot
+    if (conn.host[0] == '\0' ||
+        (connections[pick].host[0] != '\0' && conn.lastUsedMs < connections[pick].lastUsedMs)) {
+      pick = i;
+    }
+  }
+
+  MatchConnection& conn = connections[pick];
+  conn.client().stop();
+  conn.open = false;
+  if (conn.secure) {
+    conn.tls.forgetSession();
+  }
+  strcpy(conn.host, host);
+  conn.port = port;
+  conn.secure = secure;
+  return conn;
+}
+
+int MatchClient::open(MatchConnection& conn) {
+  conn.client().stop();
+  conn.open = false;
+  connects++;
+  last.connects++;
+  if (!conn.secure) {
+    conn.open = conn.plain.connect(conn.host, conn.port, timeoutMs);
+    return conn.open ? 0 : MATCH_CLIENT_ERR_CONNECT;
+  }
+
+  conn.tls.setHandshakeTimeout(timeoutMs);
+  if (!conn.tls.connect(conn.host, conn.port, timeoutMs)) {
+    return conn.tls.didHandshakeFail() ? MATCH_CLIENT_ERR_TLS : MATCH_CLIENT_ERR_CONNECT;
+  }
+  conn.open = true;
+  if (conn.tls.wasLastResumed()) {
+    last.resumedHandshakes++;
+  } else {
+    last.fullHandshakes++;
+  }
+  return 0;
+}
+
+int MatchClient::request(const String& url, const String* body, MatchBodyHandler handler, void* ctx,
+                         String& location) {
+  ParsedUrl target;
+  if (!parseUrl(url, target)) {
+    return MATCH_CLIENT_ERR_URL;
+  }
+  PERF_SCOPE(PERF_NETWORK);
+  MatchConnection& conn = connectionFor(target.secure, target.host, target.port);
+  WiFiClient& client = conn.client();
+
+  // Servers drop idle keep-alive connections; reconnecting beats a failed write
+  if (client.connected() && millis() - conn.lastUsedMs > MATCH_KEEPALIVE_IDLE_MS) {
+    client.stop();
+    conn.open = false;
+  }
+
+  String head = String(body ? "POST " : "GET ") + target.path + " HTTP/1.1\r\nHost: " + target.host;
+  if (target.port != (target.secure ? 443 : 80)) {
+    head += ":";
+    head += String(target.port);
+  }
+  head += "\r\nUser-Agent: ESP32-ColorMatcher\r\nAccept: application/json\r\nConnection: keep-alive\r\n";
+  if (body) {
+    head += "Content-Type: application/json\r\nContent-Length: " + String(body->length()) + "\r\n";
+  }
+  head += "\r\n";
+
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    bool reused = client.connected();
+    if (!reused) {
+      int err = open(conn);
+      if (err) {
+        return err;
+      }
+    }
+
+    location = "";
+    bool keepAlive = false;
+    bool sent = client.write((const uint8_t*)head.c_str(), head.length()) == head.length() &&
+                (!body || client.write((const uint8_t*)body->c_str(), body->length()) == body->length());
+    int status = sent ? readResponse(client, handler, ctx, location, keepAlive) : MATCH_CLIENT_ERR_SEND;
+    conn.lastUsedMs = millis();
+
+    if (status < 0 || !keepAlive) {
+      client.stop();
+    }
+    conn.open = client.connected();
+    // A kept-alive connection the server already gave up on: retry once on a new one
+    if (reused && (status == MATCH_CLIENT_ERR_SEND || status == MATCH_CLIENT_ERR_CLOSED)) {
+      LOG_API_DEBUG("Kept-alive connection to %s was closed - reconnecting", target.host);
+      continue;
+    }
+    if (reused) {
+      reusedRequests++;
+      last.reusedRequests++;
+    }
+    return status;
+  }
+  return MATCH_CLIENT_ERR_CLOSED;
+}
+
+int MatchClient::findRedirect(const String& base) const {
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < MATCH_REDIRECT_CACHE_SIZE; i++) {
+    if (redirects[i].expiresAt && (long)(redirects[i].expiresAt - now) > 0 && redirects[i].from == base) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void MatchClient::rememberRedirect(const String& url, const String& target) {
+  // Only a redirect that carries our query over is the same endpoint moved;
+  // one-off targets (Apps Script's echo URLs) are not reusable
+  if (queryOf(url) != queryOf(target) || queryOf(target).length() == 0) {
+    return;
+  }
+  String from = withoutQuery(url);
+  int index = findRedirect(from);
+  if (index < 0) {
+    index = 0;
+    for (uint8_t i = 1; i < MATCH_REDIRECT_CACHE_SIZE; i++) {
+      if (redirects[i].expiresAt < redirects[index].expiresAt) {
+        index = i;
+      }
+    }
+  }
+  redirects[index].from = from;
+  redirects[index].to = withoutQuery(target);
+  redirects[index].expiresAt = millis() + MATCH_REDIRECT_TTL_MS;
+  if (redirects[index].expiresAt == 0) {
+    redirects[index].expiresAt = 1;
+  }
+  LOG_API_DEBUG("Caching redirect %s -> %s", redirects[index].from.c_str(), redirects[index].to.c_str());
+}
+
+void MatchClient::forgetRedirect(int index) {
+  redirects[index].expiresAt = 0;
+  redirects[index].from = "";
+  redirects[index].to = "";
+}
+
+int MatchClient::follow(const String& url, const String& origin, const String* body, MatchBodyHandler handler,
+                        void* ctx, bool learn) {
+  String target = url;
+  int status = MATCH_CLIENT_ERR_REDIRECTS;
+  for (uint8_t hop = 0; hop <= MATCH_MAX_REDIRECTS; hop++) {
+    String location;
+    status = request(target, body, handler, ctx, location);
+    bool redirect = status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+    if (!redirect) {
+      break;
+    }
+    // Like browsers, only 307/308 repeat a POST; the others continue as GET
+    if (status != 307 && status != 308) {
+      body = nullptr;
+    }
+
+    String next = resolveLocation(target, location);
+    if (next.length() == 0) {
+      status = MATCH_CLIENT_ERR_RESPONSE;
+      break;
+    }
+    if (hop == 0 && learn) {
+      rememberRedirect(origin, next);
+    }
+    target = next;
+    last.hops++;
+    redirectsFollowed++;
+    status = MATCH_CLIENT_ERR_REDIRECTS;
+  }
+  return status;
+}
+
+int MatchClient::send(const String& url, const String* body, MatchBodyHandler handler, void* ctx) {
+  unsigned long start = millis();
+  memset(&last, 0, sizeof(last));
+  calls++;
+
+  int status;
+  int cached = findRedirect(withoutQuery(url));
+  if (cached < 0) {
+    status = follow(url, url, body, handler, ctx, true);
+  } else {
+    last.redirectCached = true;
+    redirectCacheHits++;
+    status = follow(redirects[cached].to + queryOf(url), url, body, handler, ctx, false);
+
+    // The cached target moved or went away; start again from the original URL
+    if (status < 0 || status == 404 || status == 410) {
+      LOG_API_DEBUG("Cached redirect target failed (%d) - retrying %s", status, url.c_str());
+      forgetRedirect(cached);
+      status = follow(url, url, body, handler, ctx, true);
+    }
+  }
+
+  last.ms = millis() - start;
+  totalMs += last.ms;
+  if (status != 200) {
+    failures++;
+  }
+  return status;
+}
+
+int MatchClient::get(const String& url, MatchBodyHandler handler, void* ctx) {
+  return send(url, nullptr, handler, ctx);
+}
+
+int MatchClient::post(const String& url, const String& json, MatchBodyHandler handler, void* ctx) {
+  return send(url, &json, handler, ctx);
+}
+
+static void copyBody(Stream& body, int, void* ctx) {
+  String* out = static_cast<String*>(ctx);
+  int c;
+  while ((c = body.read()) >= 0) {
+    *out += (char)c;
+  }
+}
+
+int MatchClient::get(const String& url, String& body) {
+  body = "";
+  return get(url, copyBody, &body);
+}
+
+void MatchClient::disconnect() {
+  for (uint8_t i = 0; i < MATCH_CLIENT_CONNECTIONS; i++) {
+    connections[i].client().stop();
+    connections[i].open = false;
+  }
+}
+
+void MatchClient::reset() {
+  for (uint8_t i = 0; i < MATCH_CLIENT_CONNECTIONS; i++) {
+    connections[i].client().stop();
+    connections[i].open = false;
+    connections[i].tls.forgetSession();
+    connections[i].host[0] = '\0';
+  }
+  for (uint8_t i = 0; i < MATCH_REDIRECT_CACHE_SIZE; i++) {
+    forgetRedirect(i);
+  }
+}
+
+void MatchClient::getStats(JsonObject stats) const {
+  uint32_t fullHandshakes = 0;
+  uint32_t resumedHandshakes = 0;
+  uint8_t open = 0;
+  JsonArray hosts = stats["connections"].to<JsonArray>();
+  for (uint8_t i = 0; i < MATCH_CLIENT_CONNECTIONS; i++) {
+    const MatchConnection& conn = connections[i];
+    fullHandshakes += conn.tls.getFullHandshakes();
+    resumedHandshakes += conn.tls.getResumedHandshakes();
+    if (conn.host[0] == '\0') {
+      continue;
+    }
+    // Polling the socket here would race the task using it
+    bool isOpen = conn.open;
+    open += isOpen;
+    JsonObject entry = hosts.add<JsonObject>();
+    entry["host"] = conn.host;
+    entry["port"] = conn.port;
+    entry["tls"] = conn.secure;
+    entry["open"] = isOpen;
+    entry["idleMs"] = millis() - conn.lastUsedMs;
+    if (conn.secure) {
+      entry["lastHandshakeUs"] = conn.tls.getLastHandshakeUs();
+    }
+  }
+
+  uint8_t cachedRedirects = 0;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < MATCH_REDIRECT_CACHE_SIZE; i++) {
+    if (redirects[i].expiresAt && (long)(redirects[i].expiresAt - now) > 0) {
+      cachedRedirects++;
+    }
+  }
+
+  stats["calls"] = calls;
+  stats["failures"] = failures;
+  stats["avgMs"] = calls ? totalMs / calls : 0;
+  stats["lastMs"] = last.ms;
+  stats["openConnections"] = open;
+  stats["connects"] = connects;
+  stats["reusedRequests"] = reusedRequests;
+  stats["fullHandshakes"] = fullHandshakes;
+  stats["resumedHandshakes"] = resumedHandshakes;
+  stats["redirectsFollowed"] = redirectsFollowed;
+  stats["redirectCacheHits"] = redirectCacheHits;
+  stats["cachedRedirects"] = cachedRedirects;
+}
+
+const char* MatchClient::errorName(int code) {
+  switch (code) {
+    case MATCH_CLIENT_ERR_URL: return "bad URL";
+    case MATCH_CLIENT_ERR_CONNECT: return "connect failed";
+    case MATCH_CLIENT_ERR_TLS: return "TLS handshake failed";
+    case MATCH_CLIENT_ERR_SEND: return "send failed";
+    case MATCH_CLIENT_ERR_TIMEOUT: return "timed out";
+    case MATCH_CLIENT_ERR_RESPONSE: return "malformed response";
+    case MATCH_CLIENT_ERR_TOO_LARGE: return "response too large";
+    case MATCH_CLIENT_ERR_REDIRECTS: return "too many redirects";
+    case MATCH_CLIENT_ERR_CLOSED: return "connection closed";
+    default: return code >= 0 ? "HTTP" : "unknown";
+  }
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+static void recordRun(MatchBenchmarkMode& mode, const MatchCallInfo& info, int status) {
+  mode.runs++;
+  mode.lastStatus = status;
+  if (status == 200) {
+    mode.ok++;
+  }
+  mode.totalMs += info.ms;
+  mode.minMs = mode.runs == 1 ? info.ms : min(mode.minMs, info.ms);
+  mode.maxMs = max(mode.maxMs, info.ms);
+  mode.connects += info.connects;
+  mode.fullHandshakes += info.fullHandshakes;
+  mode.resumedHandshakes += info.resumedHandshakes;
+  mode.reusedRequests += info.reusedRequests;
+  mode.hops += info.hops;
+}
+
+MatchBenchmarkResult MatchClient::runBenchmark(const String& url, uint16_t runs) {
+  MatchBenchmarkResult result;
+  memset(&result, 0, sizeof(result));
+
+  // Private client so the match worker's connections are left alone
+  MatchClient* client = new MatchClient();
+
+  for (uint16_t i = 0; i < runs; i++) {
+    client->reset();
+    int status = client->get(url, nullptr, nullptr);
+    recordRun(result.cold, client->lastCall(), status);
+    if (status < 0) {
+      break;  // Backend unreachable; the other modes would only time out too
+    }
+  }
+
+  if (result.cold.ok > 0) {
+    for (uint16_t i = 0; i < runs; i++) {
+      client->disconnect();
+      int status = client->get(url, nullptr, nullptr);
+      recordRun(result.resumed, client->lastCall(), status);
+    }
+
+    client->get(url, nullptr, nullptr);  // Make sure every hop has an open connection
+    for (uint16_t i = 0; i < runs; i++) {
+      int status = client->get(url, nullptr, nullptr);
+      recordRun(result.warm, client->lastCall(), status);
+    }
+  }
+
+  delete client;
+  return result;
+}
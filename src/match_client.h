@@ -0,0 +1,258 @@
+#ifndef MATCH_CLIENT_H
+#define MATCH_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ArduinoJson.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+#include "config.h"
+#include "logging.h"
+
+/**
+ * @brief Persistent HTTP(S) client for the paint-match backend
+ *
+ * A lookup used to build a new HTTPClient, run a full TLS handshake to
+ * script.google.com, follow the redirect with a second full handshake to
+ * script.googleusercontent.com and then close both. This client keeps one
+ * connection per host open between lookups (HTTP/1.1 keep-alive) and, when a
+ * connection has to be reopened, offers the TLS session from the previous
+ * handshake so the server can resume it without sending its certificate
+ * chain again.
+ *
+ * Redirects are followed here rather than by HTTPClient. When a redirect
+ * keeps the request's query string (a moved endpoint) its target is cached
+ * for MATCH_REDIRECT_TTL_MS and later lookups go straight there. Apps Script
+ * answers each call with a one-off echo URL, which cannot be cached; that hop
+ * still rides its own kept-alive connection.
+ *
+ * Bodies are handed to the caller as a stream, so a lookup never holds the
+ * whole response in memory; MATCH_RESPONSE_MAX_BYTES only bounds how much is
+ * read before the connection is given up.
+ *
+ * Not thread-safe: each instance belongs to one task (the match worker, or a
+ * benchmark run).
+ */
+
+// Negative results from MatchClient::get(); non-negative values are HTTP statuses
+#define MATCH_CLIENT_ERR_URL -1          // URL not http(s) or host too long
+#define MATCH_CLIENT_ERR_CONNECT -2      // TCP connect failed
+#define MATCH_CLIENT_ERR_TLS -3          // TLS handshake failed
+#define MATCH_CLIENT_ERR_SEND -4         // Request could not be written
+#define MATCH_CLIENT_ERR_TIMEOUT -5      // No complete response in time
+#define MATCH_CLIENT_ERR_RESPONSE -6     // Malformed status line, headers or chunking
+#define MATCH_CLIENT_ERR_TOO_LARGE -7    // Body over MATCH_RESPONSE_MAX_BYTES
+#define MATCH_CLIENT_ERR_REDIRECTS -8    // More than MATCH_MAX_REDIRECTS hops
+#define MATCH_CLIENT_ERR_CLOSED -9       // Connection closed before a status line
+
+// Consumes the final response body (any status) on the calling task. The
+// stream ends with the body; whatever the handler leaves unread is discarded.
+typedef void (*MatchBodyHandler)(Stream& body, int status, void* ctx);
+
+/**
+ * @brief TLS over a WiFiClient socket that keeps its session between connections
+ *
+ * Works like WiFiClientSecure but saves the negotiated session (ID and, when
+ * the server issues one, session ticket) after every handshake and offers it
+ * on the next connect to the same host. Without a CA certificate the peer is
+ * not verified, which is what HTTPClient::begin(url) did for https URLs.
+ */
+class TlsSessionClient : public WiFiClient {
+private:
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context drbg;
+  mbedtls_ssl_config conf;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_session session;
+  mbedtls_x509_crt caChain;
+
+  const char* caCert;
+  bool configured;          // conf/drbg/caChain set up
+  bool active;              // ssl set up and handshake complete
+  bool haveSession;
+  char sessionHost[MATCH_HOST_MAX];
+  uint32_t timeoutMs;
+  uint32_t handshakeRxBytes;
+
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint32_t lastHandshakeUs;
+  bool lastResumed;
+  bool handshakeFailed;     // Last connect got a socket but no TLS session
+
+  bool configure();
+  void teardown();
+  static int bioSend(void* ctx, const unsigned char* buf, size_t len);
+  static int bioRecv(void* ctx, unsigned char* buf, size_t len, uint32_t timeout);
+
+public:
+  TlsSessionClient();
+  ~TlsSessionClient();
+  TlsSessionClient(const TlsSessionClient&) = delete;
+  TlsSessionClient& operator=(const TlsSessionClient&) = delete;
+
+  /**
+   * @brief Verify the server against a PEM CA certificate; call before the first connect
+   */
+  void setCACert(const char* pem) { caCert = pem; }
+  void setHandshakeTimeout(uint32_t ms) { timeoutMs = ms; }
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+  int connect(const char* host, uint16_t port) override;
+  int connect(const char* host, uint16_t port, int32_t timeout) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+  /**
+   * @brief Drop the saved session so the next connect does a full handshake
+   */
+  void forgetSession();
+
+  uint32_t getFullHandshakes() const { return fullHandshakes; }
+  uint32_t getResumedHandshakes() const { return resumedHandshakes; }
+  uint32_t getLastHandshakeUs() const { return lastHandshakeUs; }
+  bool wasLastResumed() const { return lastResumed; }
+  bool didHandshakeFail() const { return handshakeFailed; }
+};
+
+/**
+ * @brief What one MatchClient::get() call cost
+ */
+struct MatchCallInfo {
+  uint32_t ms;
+  uint8_t hops;               // Redirects followed
+  uint8_t connects;           // New TCP connections
+  uint8_t fullHandshakes;
+  uint8_t resumedHandshakes;
+  uint8_t reusedRequests;     // Requests sent on a kept-alive connection
+  bool redirectCached;        // Started at a cached redirect target
+};
+
+struct MatchBenchmarkMode {
+  uint16_t runs;
+  uint16_t ok;                // Calls that returned HTTP 200
+  uint32_t totalMs;
+  uint32_t minMs;
+  uint32_t maxMs;
+  uint16_t connects;
+  uint16_t fullHandshakes;
+  uint16_t resumedHandshakes;
+  uint16_t reusedRequests;
+  uint16_t hops;
+  int lastStatus;
+};
+
+struct MatchBenchmarkResult {
+  MatchBenchmarkMode cold;    // New connection, no session, no redirect cache
+  MatchBenchmarkMode resumed; // New connection, TLS session and redirect cache kept
+  MatchBenchmarkMode warm;    // Kept-alive connections
+};
+
+struct MatchRedirect {
+  String from;                // Request URL without its query
+  String to;                  // Redirect target without its query
+  uint32_t expiresAt;
+};
+
+struct MatchConnection {
+  char host[MATCH_HOST_MAX];
+  uint16_t port;
+  bool secure;
+  uint32_t lastUsedMs;
+  bool open;                // Socket state as last seen by the task making requests; getStats() reads only this
+  WiFiClient plain;
+  TlsSessionClient tls;
+
+  WiFiClient& client() { return secure ? static_cast<WiFiClient&>(tls) : plain; }
+};
+
+class MatchClient {
+private:
+  MatchConnection connections[MATCH_CLIENT_CONNECTIONS];
+  MatchRedirect redirects[MATCH_REDIRECT_CACHE_SIZE];
+  uint32_t timeoutMs;
+  MatchCallInfo last;
+
+  uint32_t calls;
+  uint32_t failures;
+  uint32_t connects;
+  uint32_t reusedRequests;
+  uint32_t redirectsFollowed;
+  uint32_t redirectCacheHits;
+  uint32_t totalMs;
+
+  MatchConnection& connectionFor(bool secure, const char* host, uint16_t port);
+  int open(MatchConnection& conn);
+  int request(const String& url, const String* body, MatchBodyHandler handler, void* ctx, String& location);
+  int readResponse(WiFiClient& client, MatchBodyHandler handler, void* ctx, String& location, bool& keepAlive);
+  int follow(const String& url, const String& origin, const String* body, MatchBodyHandler handler, void* ctx,
+             bool learn);
+  int send(const String& url, const String* body, MatchBodyHandler handler, void* ctx);
+  int findRedirect(const String& base) const;
+  void rememberRedirect(const String& url, const String& target);
+  void forgetRedirect(int index);
+
+public:
+  MatchClient();
+
+  void setTimeout(uint32_t ms) { timeoutMs = ms; }
+
+  /**
+   * @brief GET a URL, following redirects over kept-alive connections
+   * @param url Absolute http:// or https:// URL
+   * @param handler Reads the final response body straight from the socket (may be nullptr)
+   * @param ctx Passed to the handler
+   * @return HTTP status of the final response, or MATCH_CLIENT_ERR_*
+   */
+  int get(const String& url, MatchBodyHandler handler, void* ctx);
+
+  /**
+   * @brief POST a JSON body; 307/308 redirects repeat the POST, others continue as GET
+   * @return HTTP status of the final response, or MATCH_CLIENT_ERR_*
+   */
+  int post(const String& url, const String& json, MatchBodyHandler handler, void* ctx);
+
+  /**
+   * @brief GET a URL and copy the body (at most MATCH_RESPONSE_MAX_BYTES) into a String
+   */
+  int get(const String& url, String& body);
+
+  /**
+   * @brief Close every connection; TLS sessions and redirect targets are kept
+   */
+  void disconnect();
+
+  /**
+   * @brief Close every connection and forget sessions and redirect targets
+   */
+  void reset();
+
+  const MatchCallInfo& lastCall() const { return last; }
+
+  /**
+   * @brief Add connection, handshake and redirect counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+
+  /**
+   * @brief Time cold, resumed and warm lookups against a URL on a private client
+   * @param url Absolute URL to GET
+   * @param runs Calls per mode
+   */
+  static MatchBenchmarkResult runBenchmark(const String& url, uint16_t runs);
+
+  static const char* errorName(int code);
+};
+
+#endif // MATCH_CLIENT_H
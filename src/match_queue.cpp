@@ -0,0 +1,415 @@
+#include "match_queue.h"
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+
+#define MATCH_QUEUE_TMP_PATH MATCH_QUEUE_PATH ".tmp"
+
+// Holds the queue lock for the current scope
+class QueueLock {
+public:
+  explicit QueueLock(SemaphoreHandle_t handle) : handle(handle) { xSemaphoreTake(handle, portMAX_DELAY); }
+  ~QueueLock() { xSemaphoreGive(handle); }
+
+private:
+  SemaphoreHandle_t handle;
+};
+
+MatchQueue::MatchQueue() {
+  memset(jobs, 0, sizeof(jobs));
+  count = 0;
+  lock = xSemaphoreCreateMutex();
+  task = nullptr;
+  lookup = nullptr;
+  ready = nullptr;
+  done = nullptr;
+  callbackCtx = nullptr;
+  persistence = nullptr;
+  persistSink = -1;
+  work = nullptr;
+  workCtx = nullptr;
+  backoffMs = 0;
+  nextAttemptMs = 0;
+  loadedAtBoot = 0;
+  enqueued = 0;
+  matched = 0;
+  rejected = 0;
+  retries = 0;
+  dropped = 0;
+  passes = 0;
+  lastPassJobs = 0;
+  lastPassMs = 0;
+}
+
+MatchQueue::~MatchQueue() {
+  vSemaphoreDelete(lock);
+}
+
+// ============================================================================
+// STORAGE
+// ============================================================================
+
+bool MatchQueue::load() {
+  File file = LittleFS.open(MATCH_QUEUE_PATH, "r");
+  if (!file) {
+    return true;  // Nothing pending
+  }
+
+  MatchQueueHeader header;
+  bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == MATCH_QUEUE_MAGIC && header.version == MATCH_QUEUE_VERSION &&
+            header.jobSize == sizeof(MatchJob) && header.count <= MATCH_QUEUE_CAPACITY;
+
+  QueueLock guard(lock);
+  if (ok) {
+    size_t bytes = header.count * sizeof(MatchJob);
+    ok = file.read((uint8_t*)jobs, bytes) == bytes &&
+         esp_rom_crc32_le(0, (const uint8_t*)jobs, bytes) == header.crc;
+  }
+  file.close();
+
+  if (!ok) {
+    count = 0;
+    LOG_STORAGE_ERROR("Match queue file is corrupt - pending lookups discarded");
+    LittleFS.remove(MATCH_QUEUE_PATH);
+    return false;
+  }
+
+  // millis() restarted with this boot; age carried-over jobs from boot start
+  count = header.count;
+  for (uint16_t i = 0; i < count; i++) {
+    jobs[i].enqueuedAt = 0;
+  }
+  loadedAtBoot = count;
+  LOG_STORAGE_INFO("Match queue loaded - %u pending lookup(s)", (unsigned)count);
+  return true;
+}
+
+bool MatchQueue::flush() {
+  MatchJob snapshot[MATCH_QUEUE_CAPACITY];
+  uint16_t snapshotCount;
+  {
+    QueueLock guard(lock);
+    snapshotCount = count;
+    memcpy(snapshot, jobs, snapshotCount * sizeof(MatchJob));
+  }
+
+  if (snapshotCount == 0) {
+    return !LittleFS.exists(MATCH_QUEUE_PATH) || LittleFS.remove(MATCH_QUEUE_PATH);
+  }
+
+  size_t bytes = snapshotCount * sizeof(MatchJob);
+  MatchQueueHeader header;
+  header.magic = MATCH_QUEUE_MAGIC;
+  header.version = MATCH_QUEUE_VERSION;
+  header.jobSize = sizeof(MatchJob);
+  header.count = snapshotCount;
+  header.reserved = 0;
+  header.crc = esp_rom_crc32_le(0, (const uint8_t*)snapshot, bytes);
+
+  // Write aside and rename so a reset mid-write keeps the previous queue
+  File file = LittleFS.open(MATCH_QUEUE_TMP_PATH, "w");
+  if (!file) {
+    LOG_STORAGE_ERROR("Cannot open %s for writing", MATCH_QUEUE_TMP_PATH);
+    return false;
+  }
+  bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            file.write((const uint8_t*)snapshot, bytes) == bytes;
+  file.close();
+
+  if (!ok || !LittleFS.rename(MATCH_QUEUE_TMP_PATH, MATCH_QUEUE_PATH)) {
+    LittleFS.remove(MATCH_QUEUE_TMP_PATH);
+    LOG_STORAGE_ERROR("Failed to write match queue (%u jobs)", (unsigned)snapshotCount);
+    return false;
+  }
+  return true;
+}
+
+void MatchQueue::markDirty() {
+  if (persistence) {
+    persistence->markDirty(persistSink);
+  }
+}
+
+// ============================================================================
+// QUEUE
+// ============================================================================
+
+bool MatchQueue::begin(MatchLookupFn lookupFn, MatchReadyFn readyFn, MatchDoneFn doneFn, void* ctx,
+                       PersistenceManager& manager, int sink) {
+  lookup = lookupFn;
+  ready = readyFn;
+  done = doneFn;
+  callbackCtx = ctx;
+  persistence = &manager;
+  persistSink = sink;
+
+  if (task == nullptr &&
+      xTaskCreatePinnedToCore(taskMain, "match", MATCH_TASK_STACK, this, MATCH_TASK_PRIORITY,
+                              &task, MATCH_TASK_CORE) != pdPASS) {
+    task = nullptr;
+    LOG_API_ERROR("Failed to start match worker - samples will stay unmatched");
+    return false;
+  }
+
+  LOG_API_INFO("Match worker started - Pending:%u Capacity:%u Batch:%u",
+               (unsigned)count, (unsigned)MATCH_QUEUE_CAPACITY, (unsigned)MATCH_QUEUE_BATCH);
+  return true;
+}
+
+bool MatchQueue::enqueue(uint32_t sampleId, uint8_t r, uint8_t g, uint8_t b) {
+  bool room = true;
+  {
+    QueueLock guard(lock);
+    if (count >= MATCH_QUEUE_CAPACITY) {
+      LOG_API_ERROR("Match queue full - dropping oldest lookup (sample %u)", jobs[0].sampleId);
+      memmove(&jobs[0], &jobs[1], (count - 1) * sizeof(MatchJob));
+      count--;
+      dropped++;
+      room = false;
+    }
+    MatchJob& job = jobs[count++];
+    job.sampleId = sampleId;
+    job.r = r;
+    job.g = g;
+    job.b = b;
+    job.attempts = 0;
+    job.enqueuedAt = millis();
+    enqueued++;
+  }
+
+  markDirty();
+  kick();
+  return room;
+}
+
+bool MatchQueue::removeLocked(uint32_t sampleId) {
+  for (uint16_t i = 0; i < count; i++) {
+    if (jobs[i].sampleId == sampleId) {
+      memmove(&jobs[i], &jobs[i + 1], (count - i - 1) * sizeof(MatchJob));
+      count--;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MatchQueue::contains(uint32_t sampleId) const {
+  QueueLock guard(lock);
+  for (uint16_t i = 0; i < count; i++) {
+    if (jobs[i].sampleId == sampleId) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MatchQueue::remove(uint32_t sampleId) {
+  bool removed;
+  {
+    QueueLock guard(lock);
+    removed = removeLocked(sampleId);
+  }
+  if (removed) {
+    markDirty();
+  }
+  return removed;
+}
+
+void MatchQueue::clear() {
+  {
+    QueueLock guard(lock);
+    count = 0;
+    backoffMs = 0;
+  }
+  markDirty();
+}
+
+void MatchQueue::kick() {
+  if (task) {
+    xTaskNotifyGive(task);
+  }
+}
+
+bool MatchQueue::runOnWorker(MatchWorkFn fn, void* ctx) {
+  if (!task) {
+    return false;
+  }
+  {
+    QueueLock guard(lock);
+    if (work) {
+      return false;
+    }
+    work = fn;
+    workCtx = ctx;
+  }
+  kick();
+  return true;
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+void MatchQueue::runWork() {
+  MatchWorkFn fn;
+  void* ctx;
+  {
+    QueueLock guard(lock);
+    fn = work;
+    ctx = workCtx;
+    work = nullptr;
+  }
+  if (fn) {
+    fn(ctx);
+  }
+}
+
+uint32_t MatchQueue::runPass() {
+  if (count == 0) {
+    return MATCH_QUEUE_IDLE_MS;
+  }
+  if (ready && !ready(callbackCtx)) {
+    return MATCH_QUEUE_POLL_MS;
+  }
+  uint32_t now = millis();
+  if (backoffMs && (long)(nextAttemptMs - now) > 0) {
+    return nextAttemptMs - now;
+  }
+
+  // Work on a copy so the lock is never held across a network call
+  MatchJob batch[MATCH_QUEUE_BATCH];
+  MatchOutcome outcomes[MATCH_QUEUE_BATCH];
+  uint16_t batchCount;
+  {
+    QueueLock guard(lock);
+    // Give a partial batch a moment to fill; enqueue() wakes the task
+    uint32_t age = now - jobs[0].enqueuedAt;
+    if (count < MATCH_QUEUE_BATCH && !backoffMs && age < MATCH_QUEUE_LINGER_MS) {
+      return MATCH_QUEUE_LINGER_MS - age;
+    }
+    batchCount = min(count, (uint16_t)MATCH_QUEUE_BATCH);
+    memcpy(batch, jobs, batchCount * sizeof(MatchJob));
+  }
+
+  unsigned long passStart = millis();
+  lookup(batch, batchCount, outcomes, callbackCtx);
+
+  bool retry = false;
+  for (uint16_t i = 0; i < batchCount; i++) {
+    MatchOutcome outcome = outcomes[i];
+    bool finished = true;
+    {
+      QueueLock guard(lock);
+      if (outcome == MATCH_OUTCOME_RETRY) {
+        retries++;
+        retry = true;
+        if (batch[i].attempts + 1 >= MATCH_MAX_ATTEMPTS) {
+          LOG_API_ERROR("Giving up on match for sample %u after %u attempts",
+                        batch[i].sampleId, (unsigned)MATCH_MAX_ATTEMPTS);
+          outcome = MATCH_OUTCOME_REJECTED;
+        } else {
+          for (uint16_t j = 0; j < count; j++) {
+            if (jobs[j].sampleId == batch[i].sampleId) {
+              jobs[j].attempts++;
+            }
+          }
+          finished = false;
+        }
+      } else if (outcome == MATCH_OUTCOME_MATCHED) {
+        matched++;
+      }
+
+      if (finished) {
+        if (outcome == MATCH_OUTCOME_REJECTED) {
+          rejected++;
+        }
+        // Deleted while the lookup ran: nobody to tell
+        finished = removeLocked(batch[i].sampleId);
+      }
+    }
+    if (finished && done) {
+      done(batch[i], outcome, callbackCtx);
+    }
+  }
+
+  {
+    QueueLock guard(lock);
+    if (retry) {
+      backoffMs = backoffMs ? min(backoffMs * 2, (uint32_t)MATCH_BACKOFF_MAX_MS) : MATCH_BACKOFF_MIN_MS;
+      nextAttemptMs = millis() + backoffMs;
+    } else {
+      backoffMs = 0;
+    }
+    passes++;
+    lastPassJobs = batchCount;
+    lastPassMs = millis() - passStart;
+  }
+  markDirty();
+
+  if (retry) {
+    LOG_API_ERROR("Match lookup failed - %u pending, retrying in %lums",
+                  (unsigned)count, (unsigned long)backoffMs);
+    return backoffMs;
+  }
+  LOG_API_DEBUG("Match pass done - Jobs:%u Time:%lums Pending:%u",
+                (unsigned)batchCount, (unsigned long)lastPassMs, (unsigned)count);
+  return 0;
+}
+
+void MatchQueue::taskMain(void* arg) {
+  MatchQueue* self = static_cast<MatchQueue*>(arg);
+  for (;;) {
+    self->runWork();
+    uint32_t waitMs = self->runPass();
+    if (waitMs > 0) {
+      // enqueue()/kick() end the wait early
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+    }
+  }
+}
+
+uint16_t MatchQueue::depth() const {
+  QueueLock guard(lock);
+  return count;
+}
+
+void MatchQueue::getStats(JsonObject stats) const {
+  // Snapshot under the lock; the worker task updates these between lookups
+  uint16_t depthNow, passJobs;
+  uint32_t oldestAt, backoff, nextAttempt, passMs;
+  uint32_t enqueuedNow, matchedNow, rejectedNow, retriesNow, droppedNow, passesNow;
+  {
+    QueueLock guard(lock);
+    depthNow = count;
+    oldestAt = count ? jobs[0].enqueuedAt : 0;
+    backoff = backoffMs;
+    nextAttempt = nextAttemptMs;
+    enqueuedNow = enqueued;
+    matchedNow = matched;
+    rejectedNow = rejected;
+    retriesNow = retries;
+    droppedNow = dropped;
+    passesNow = passes;
+    passJobs = lastPassJobs;
+    passMs = lastPassMs;
+  }
+
+  uint32_t now = millis();
+  stats["depth"] = depthNow;
+  stats["capacity"] = MATCH_QUEUE_CAPACITY;
+  stats["batch"] = MATCH_QUEUE_BATCH;
+  stats["lingerMs"] = MATCH_QUEUE_LINGER_MS;
+  stats["taskRunning"] = task != nullptr;
+  stats["backoffMs"] = backoff;
+  stats["nextAttemptInMs"] = backoff && (long)(nextAttempt - now) > 0 ? nextAttempt - now : 0;
+  stats["oldestAgeMs"] = depthNow ? now - oldestAt : 0;
+  stats["loadedAtBoot"] = loadedAtBoot;
+  stats["enqueued"] = enqueuedNow;
+  stats["matched"] = matchedNow;
+  stats["rejected"] = rejectedNow;
+  stats["retries"] = retriesNow;
+  stats["dropped"] = droppedNow;
+  stats["passes"] = passesNow;
+  stats["lastPassJobs"] = passJobs;
+  stats["lastPassMs"] = passMs;
+}
@@ -0,0 +1,176 @@
+#ifndef MATCH_QUEUE_H
+#define MATCH_QUEUE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+#include "persistence_manager.h"
+
+/**
+ * @brief Durable queue of paint-match lookups drained by a background task
+ *
+ * Saving a sample only enqueues its color here; the worker task performs the
+ * remote lookups whenever the network is up, so no request handler waits on
+ * the backend and samples saved offline are matched once connectivity
+ * returns. Pending jobs are written to LittleFS through the persistence
+ * manager and reloaded at boot.
+ *
+ * Each pass hands up to MATCH_QUEUE_BATCH jobs from the head to the lookup
+ * callback at once, so they can share one backend request. A partial batch
+ * is held until its oldest job has waited MATCH_QUEUE_LINGER_MS, which lets a
+ * burst of saves (a fan-deck scan) coalesce while a lone save is delayed by
+ * at most that long; a full batch goes at once. A job that keeps failing
+ * while online is dropped after MATCH_MAX_ATTEMPTS; time spent offline does
+ * not count against it.
+ *
+ * Any transient failure in a pass backs off exponentially
+ * (MATCH_BACKOFF_MIN_MS doubling to MATCH_BACKOFF_MAX_MS); a successful
+ * lookup resets it. When the queue is full the oldest job is dropped.
+ *
+ * runOnWorker() hands other network work (a backend benchmark) to the same
+ * task; it runs before the next pass, so lookups wait for it to finish.
+ */
+
+#define MATCH_QUEUE_MAGIC 0x4D51      // "MQ"
+#define MATCH_QUEUE_VERSION 1
+
+struct __attribute__((packed)) MatchJob {
+  uint32_t sampleId;
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t attempts;        // Failed online attempts so far
+  uint32_t enqueuedAt;     // millis() when queued (this boot or an earlier one)
+};
+
+struct __attribute__((packed)) MatchQueueHeader {
+  uint16_t magic;          // MATCH_QUEUE_MAGIC
+  uint8_t version;
+  uint8_t jobSize;         // sizeof(MatchJob) when written
+  uint16_t count;
+  uint16_t reserved;
+  uint32_t crc;            // CRC32 over the job records
+};
+
+enum MatchOutcome : uint8_t {
+  MATCH_OUTCOME_MATCHED = 0,    // Result applied; job done
+  MATCH_OUTCOME_REJECTED = 1,   // Permanent failure (bad response, sample gone); job dropped
+  MATCH_OUTCOME_RETRY = 2       // Network or server error; job kept, pass ends and backs off
+};
+
+// Performs a batch of lookups on the worker task, applies the results and
+// sets outcomes[i] for jobs[i]
+typedef void (*MatchLookupFn)(const MatchJob* jobs, uint16_t count, MatchOutcome* outcomes, void* ctx);
+
+// Whether lookups can be attempted right now (for example Wi-Fi connected)
+typedef bool (*MatchReadyFn)(void* ctx);
+
+// Called on the worker task once a job has left the queue (matched or given up)
+typedef void (*MatchDoneFn)(const MatchJob& job, MatchOutcome outcome, void* ctx);
+
+// Work run on the worker task between passes
+typedef void (*MatchWorkFn)(void* ctx);
+
+class MatchQueue {
+private:
+  MatchJob jobs[MATCH_QUEUE_CAPACITY];    // FIFO, head at index 0
+  uint16_t count;
+  SemaphoreHandle_t lock;
+  TaskHandle_t task;
+
+  MatchLookupFn lookup;
+  MatchReadyFn ready;
+  MatchDoneFn done;
+  void* callbackCtx;
+  PersistenceManager* persistence;
+  int persistSink;
+  MatchWorkFn work;             // Waiting for the worker; cleared when it starts
+  void* workCtx;
+
+  uint32_t backoffMs;
+  uint32_t nextAttemptMs;
+
+  uint16_t loadedAtBoot;
+  uint32_t enqueued;
+  uint32_t matched;
+  uint32_t rejected;
+  uint32_t retries;
+  uint32_t dropped;
+  uint32_t passes;
+  uint16_t lastPassJobs;
+  uint32_t lastPassMs;
+
+  static void taskMain(void* arg);
+  uint32_t runPass();
+  void runWork();
+  bool removeLocked(uint32_t sampleId);
+  void markDirty();
+
+public:
+  MatchQueue();
+  ~MatchQueue();
+
+  /**
+   * @brief Read pending jobs saved by an earlier boot; call once LittleFS is mounted
+   */
+  bool load();
+
+  /**
+   * @brief Write the pending jobs (removes the file when empty); persistence sink
+   */
+  bool flush();
+
+  /**
+   * @brief Start the worker task
+   * @param lookupFn Performs and applies a batch of lookups (runs on the worker task)
+   * @param readyFn Connectivity check
+   * @param doneFn Completion notice (may be nullptr)
+   * @param ctx Passed to the callbacks
+   * @param manager Persistence manager that owns the flush
+   * @param sink Sink registered for flush()
+   */
+  bool begin(MatchLookupFn lookupFn, MatchReadyFn readyFn, MatchDoneFn doneFn, void* ctx,
+             PersistenceManager& manager, int sink);
+
+  /**
+   * @brief Queue a lookup for a sample; never touches the network or flash
+   * @return false if an older job had to be dropped to make room
+   */
+  bool enqueue(uint32_t sampleId, uint8_t r, uint8_t g, uint8_t b);
+
+  /**
+   * @brief Drop the job for a sample (deleted before it was matched)
+   */
+  bool remove(uint32_t sampleId);
+
+  /**
+   * @brief Drop every job
+   */
+  void clear();
+
+  /**
+   * @brief Wake the worker early, e.g. when connectivity returns
+   */
+  void kick();
+
+  /**
+   * @brief Run fn on the worker task before its next pass
+   * @return false if the worker is not running or earlier work has not started yet
+   */
+  bool runOnWorker(MatchWorkFn fn, void* ctx);
+
+  /**
+   * @brief Whether a sample still has a lookup pending
+   */
+  bool contains(uint32_t sampleId) const;
+
+  uint16_t depth() const;
+
+  /**
+   * @brief Add depth, backoff and counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // MATCH_QUEUE_H
@@ -0,0 +1,235 @@
+#include "match_response.h"
+
+#define MATCH_PARSE_NESTING 4   // {alternates:[{...}]} is three levels deep
+#define ARENA_ALIGN 8
+
+/**
+ * @brief Bump allocator over a fixed buffer for one JsonDocument
+ *
+ * Each block carries its size in front of it. Freeing or resizing the most
+ * recent block gives the space back, which covers how the deserializer grows
+ * strings; other frees are reclaimed when the arena is reset.
+ */
+class ArenaAllocator : public ArduinoJson::Allocator {
+public:
+  ArenaAllocator(uint8_t* buffer, size_t capacity) : buffer(buffer), capacity(capacity), used(0), peak(0) {}
+
+  void* allocate(size_t size) override {
+    size_t bytes = align(size);
+    if (used + ARENA_ALIGN + bytes > capacity) {
+      return nullptr;
+    }
+    uint8_t* block = buffer + used + ARENA_ALIGN;
+    sizeOf(block) = bytes;
+    used += ARENA_ALIGN + bytes;
+    peak = max(peak, used);
+    return block;
+  }
+
+  void deallocate(void* ptr) override {
+    if (ptr && isLast(ptr)) {
+      used = (uint8_t*)ptr - buffer - ARENA_ALIGN;
+    }
+  }
+
+  void* reallocate(void* ptr, size_t size) override {
+    if (!ptr) {
+      return allocate(size);
+    }
+    size_t bytes = align(size);
+    size_t current = sizeOf(ptr);
+    if (isLast(ptr)) {
+      if ((uint8_t*)ptr + bytes > buffer + capacity) {
+        return nullptr;
+      }
+      used = (uint8_t*)ptr - buffer + bytes;
+      peak = max(peak, used);
+      sizeOf(ptr) = bytes;
+      return ptr;
+    }
+    if (bytes <= current) {
+      sizeOf(ptr) = bytes;
+      return ptr;
+    }
+    void* moved = allocate(size);
+    if (moved) {
+      memcpy(moved, ptr, current);
+    }
+    return moved;
+  }
+
+  size_t peakBytes() const { return peak; }
+
+private:
+  uint8_t* buffer;
+  size_t capacity;
+  size_t used;
+  size_t peak;
+
+  static size_t align(size_t size) { return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1); }
+  static size_t& sizeOf(void* block) { return *(size_t*)((uint8_t*)block - ARENA_ALIGN); }
+  bool isLast(void* block) { return (uint8_t*)block + sizeOf(block) == buffer + used; }
+};
+
+static void copyField(char* dest, size_t size, const char* value) {
+  strncpy(dest, value, size - 1);
+  dest[size - 1] = '\0';
+}
+
+static void readPaint(JsonObjectConst source, PaintMatch& paint, float fallbackDistance) {
+  copyField(paint.name, sizeof(paint.name), source["name"] | "Unknown");
+  copyField(paint.code, sizeof(paint.code), source["code"] | "N/A");
+  paint.lrv = source["lrv"] | 0.0f;
+  paint.distance = source["distance"] | fallbackDistance;
+}
+
+static void keepPaintFields(JsonObject paint) {
+  paint["name"] = true;
+  paint["code"] = true;
+  paint["lrv"] = true;
+  paint["distance"] = true;
+}
+
+// A filter on the first array element applies to all of them
+static JsonDocument buildFilter() {
+  JsonDocument filter;
+  filter["success"] = true;
+  filter["error"] = true;
+  filter["distance"] = true;
+  keepPaintFields(filter["match"].to<JsonObject>());
+  keepPaintFields(filter["alternates"][0].to<JsonObject>());
+  return filter;
+}
+
+// Built before setup() so parsing tasks only ever read it
+static const JsonDocument matchFilter = buildFilter();
+
+bool parseMatchResponse(Stream& body, MatchParseState& state) {
+  MatchResponse& out = state.response;
+  memset(&out, 0, sizeof(out));
+
+  ArenaAllocator arena(state.arena, sizeof(state.arena));
+  {
+    JsonDocument doc(&arena);
+    DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(matchFilter),
+                                                 DeserializationOption::NestingLimit(MATCH_PARSE_NESTING));
+    if (error) {
+      out.overflow = error == DeserializationError::NoMemory;
+      copyField(out.error, sizeof(out.error), error.c_str());
+    } else {
+      out.parsed = true;
+      out.success = doc["success"] | false;
+      copyField(out.error, sizeof(out.error), doc["error"] | "");
+
+      float distance = doc["distance"] | 0.0f;
+      JsonObjectConst match = doc["match"];
+      if (!match.isNull()) {
+        out.hasMatch = true;
+        readPaint(match, out.best, distance);
+      }
+
+      // Extra alternates were parsed into the arena but are not kept
+      for (JsonObjectConst alternate : doc["alternates"].as<JsonArrayConst>()) {
+        if (out.alternateCount >= MATCH_ALTERNATES_MAX) {
+          break;
+        }
+        readPaint(alternate, out.alternates[out.alternateCount++], 0.0f);
+      }
+    }
+  }
+  out.arenaPeak = arena.peakBytes();
+  return out.parsed;
+}
+
+void readMatchResponse(Stream& body, int status, void* ctx) {
+  MatchParseState& state = *static_cast<MatchParseState*>(ctx);
+  if (status == 200) {
+    parseMatchResponse(body, state);
+    return;
+  }
+
+  MatchResponse& out = state.response;
+  memset(&out, 0, sizeof(out));
+  size_t length = 0;
+  int c;
+  while (length < sizeof(out.error) - 1 && (c = body.read()) >= 0) {
+    out.error[length++] = (char)c;
+  }
+  out.error[length] = '\0';
+}
+
+// ============================================================================
+// BATCH ANSWERS
+// ============================================================================
+
+static int nextToken(Stream& body) {
+  int c;
+  do {
+    c = body.read();
+  } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+  return c;
+}
+
+// Reads up to and including the first occurrence of a key, e.g. "results"
+static bool skipToKey(Stream& body, const char* key) {
+  size_t matched = 0;
+  size_t length = strlen(key);
+  int c;
+  while ((c = body.read()) >= 0) {
+    if (c == key[matched]) {
+      if (++matched == length) {
+        return true;
+      }
+    } else {
+      matched = c == key[0] ? 1 : 0;
+    }
+  }
+  return false;
+}
+
+void readMatchBatchResponse(Stream& body, int status, void* ctx) {
+  MatchBatchParse& batch = *static_cast<MatchBatchParse*>(ctx);
+  batch.received = 0;
+  batch.complete = false;
+  if (status != 200) {
+    readMatchResponse(body, status, batch.state);
+    return;
+  }
+
+  MatchResponse& error = batch.state->response;
+  memset(&error, 0, sizeof(error));
+  if (!skipToKey(body, "\"results\"") || nextToken(body) != ':' || nextToken(body) != '[') {
+    copyField(error.error, sizeof(error.error), "No results array");
+    return;
+  }
+
+  // Skip whitespace so an empty array shows as ']'
+  while (body.peek() == ' ' || body.peek() == '\r' || body.peek() == '\n' || body.peek() == '\t') {
+    body.read();
+  }
+  if (body.peek() == ']') {
+    body.read();
+    batch.complete = true;
+    return;
+  }
+
+  while (batch.received < batch.capacity) {
+    if (!parseMatchResponse(body, *batch.state)) {
+      // Keep the parse error where a failed batch reports it
+      return;
+    }
+    memcpy(&batch.results[batch.received++], &batch.state->response, sizeof(MatchResponse));
+
+    int separator = nextToken(body);
+    if (separator == ']') {
+      batch.complete = true;
+      return;
+    }
+    if (separator != ',') {
+      memset(&error, 0, sizeof(error));
+      copyField(error.error, sizeof(error.error), "Malformed results array");
+      return;
+    }
+  }
+  // More results than colors asked for: the extra ones are left to the drain
+}
@@ -0,0 +1,77 @@
+#ifndef MATCH_RESPONSE_H
+#define MATCH_RESPONSE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+/**
+ * @brief Filtered, incremental parse of a paint-match response
+ *
+ * The body is deserialized straight from the connection through an
+ * ArduinoJson filter that keeps only success/error, the best match and its
+ * alternates; every other field is skipped as it streams past. The document
+ * lives in a fixed arena rather than the heap, so a verbose payload costs
+ * parse time but not memory. If the kept fields alone overflow the arena, the
+ * parse stops with NoMemory. Each task that parses owns its MatchParseState.
+ */
+
+struct PaintMatch {
+  char name[SAMPLE_NAME_LENGTH];
+  char code[SAMPLE_CODE_LENGTH];
+  float lrv;
+  float distance;
+};
+
+struct MatchResponse {
+  bool parsed;                 // Body was complete, valid JSON
+  bool overflow;               // Kept fields did not fit MATCH_PARSE_ARENA_BYTES
+  bool success;
+  bool hasMatch;
+  PaintMatch best;
+  PaintMatch alternates[MATCH_ALTERNATES_MAX];
+  uint8_t alternateCount;
+  char error[96];              // Backend "error", parse error, or the start of a non-200 body
+  uint16_t arenaPeak;          // Arena bytes used by the document
+};
+
+struct MatchParseState {
+  MatchResponse response;
+  alignas(8) uint8_t arena[MATCH_PARSE_ARENA_BYTES];
+};
+
+/**
+ * @brief Parse a 200 response body into state.response
+ * @return state.response.parsed
+ */
+bool parseMatchResponse(Stream& body, MatchParseState& state);
+
+/**
+ * @brief MatchBodyHandler for lookups; ctx is a MatchParseState
+ *
+ * A 200 body is parsed; for any other status the first bytes are kept in
+ * error for the log.
+ */
+void readMatchResponse(Stream& body, int status, void* ctx);
+
+/**
+ * @brief Where a batch answer, {"results": [answer, ...]}, is parsed to
+ *
+ * The results array is walked element by element and each element goes
+ * through the single-answer filter and arena, so the arena only ever holds
+ * one result however long the batch is.
+ */
+struct MatchBatchParse {
+  MatchParseState* state;      // Arena; its response holds the error for a failed batch
+  MatchResponse* results;      // One per requested color, in request order
+  uint8_t capacity;
+  uint8_t received;            // Results parsed so far
+  bool complete;               // The whole array was read
+};
+
+/**
+ * @brief MatchBodyHandler for batch lookups; ctx is a MatchBatchParse
+ */
+void readMatchBatchResponse(Stream& body, int status, void* ctx);
+
+#endif // MATCH_RESPONSE_H
@@ -0,0 +1,315 @@
+#include "match_router.h"
+
+MatchRouter::MatchRouter() {
+  for (uint8_t i = 0; i < MATCH_ROUTER_MAX_REMOTES; i++) {
+    MatchLane& lane = lanes[i];
+    lane.router = this;
+    lane.index = i;
+    lane.backend = nullptr;
+    lane.requests = nullptr;
+    lane.task = nullptr;
+    lane.busy = false;
+    lane.count = 0;
+    memset(lane.items, 0, sizeof(lane.items));
+    memset(lane.colors, 0, sizeof(lane.colors));
+    memset(lane.responses, 0, sizeof(lane.responses));
+    memset(lane.statuses, 0, sizeof(lane.statuses));
+    lane.calls = 0;
+    lane.failed = 0;
+    lane.colorsAsked = 0;
+    lane.wins = 0;
+    lane.totalMs = 0;
+    lane.lastMs = 0;
+  }
+  laneCount = 0;
+  local = nullptr;
+  done = nullptr;
+  seq = 0;
+  nextLane = 0;
+  lookups = 0;
+  routedColors = 0;
+  answered = 0;
+  failedColors = 0;
+  hedges = 0;
+  hedgeWins = 0;
+  failovers = 0;
+  localAnswers = 0;
+  totalMs = 0;
+  lastMs = 0;
+  lastCount = 0;
+}
+
+bool MatchRouter::addRemote(MatchBackend* backend) {
+  if (laneCount >= MATCH_ROUTER_MAX_REMOTES || done != nullptr) {
+    LOG_API_ERROR("Cannot add match backend %s", backend->getName());
+    return false;
+  }
+  lanes[laneCount++].backend = backend;
+  return true;
+}
+
+bool MatchRouter::begin() {
+  if (done != nullptr) {
+    return true;
+  }
+  // Every lane has at most one request outstanding, so its completion always fits
+  done = xQueueCreate(MATCH_ROUTER_MAX_REMOTES, sizeof(MatchLaneDone));
+  if (done == nullptr) {
+    LOG_API_ERROR("Failed to create match router queue");
+    return false;
+  }
+
+  bool ok = true;
+  for (uint8_t i = 0; i < laneCount; i++) {
+    MatchLane& lane = lanes[i];
+    lane.requests = xQueueCreate(1, sizeof(MatchLaneRequest));
+    if (lane.requests == nullptr ||
+        xTaskCreatePinnedToCore(laneMain, "matchLane", MATCH_LANE_TASK_STACK, &lane, MATCH_LANE_TASK_PRIORITY,
+                                &lane.task, MATCH_LANE_TASK_CORE) != pdPASS) {
+      lane.task = nullptr;
+      LOG_API_ERROR("Failed to start match lane for %s", lane.backend->getName());
+      ok = false;
+    }
+  }
+
+  LOG_API_INFO("Match router started - Remotes:%u Local:%s HedgeDelay:%u ms", laneCount,
+               local ? local->getName() : "none", (unsigned)MATCH_HEDGE_DELAY_MS);
+  return ok;
+}
+
+void MatchRouter::laneMain(void* arg) {
+  MatchLane* lane = static_cast<MatchLane*>(arg);
+  for (;;) {
+    MatchLaneRequest request;
+    if (xQueueReceive(lane->requests, &request, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    uint32_t startMs = millis();
+    MatchLaneDone result;
+    result.lane = lane->index;
+    result.seq = request.seq;
+    result.status = lane->backend->lookupBatch(lane->colors, lane->count, lane->responses, lane->statuses);
+    result.ms = millis() - startMs;
+    xQueueSend(lane->router->done, &result, portMAX_DELAY);
+  }
+}
+
+// ============================================================================
+// ROUTING
+// ============================================================================
+
+bool MatchRouter::startNext(const MatchColor* colors, uint8_t count, const bool* resolved) {
+  while (nextLane < laneCount) {
+    MatchLane& lane = lanes[nextLane++];
+    if (lane.task == nullptr || lane.busy) {
+      continue;
+    }
+    if (!lane.breaker.allow(millis())) {
+      LOG_API_DEBUG("Skipping %s - breaker %s", lane.backend->getName(),
+                    CircuitBreaker::stateName(lane.breaker.getState()));
+      continue;
+    }
+
+    lane.count = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (!resolved[i]) {
+        lane.items[lane.count] = i;
+        lane.colors[lane.count++] = colors[i];
+      }
+    }
+    MatchLaneRequest request = {seq};
+    if (xQueueSend(lane.requests, &request, 0) != pdTRUE) {
+      lane.breaker.recordFailure(millis());
+      continue;
+    }
+    lane.busy = true;
+    lane.calls++;
+    lane.colorsAsked += lane.count;
+    LOG_API_DEBUG("Started %s for lookup %u (%u colors)", lane.backend->getName(), seq, lane.count);
+    return true;
+  }
+  return false;
+}
+
+bool MatchRouter::complete(const MatchLaneDone& result) {
+  MatchLane& lane = lanes[result.lane];
+  lane.busy = false;
+  lane.lastMs = result.ms;
+  lane.totalMs += result.ms;
+
+  BreakerState before = lane.breaker.getState();
+  if (result.status == MATCH_BACKEND_FAILED) {
+    lane.failed++;
+    lane.breaker.recordFailure(millis());
+  } else {
+    lane.breaker.recordSuccess();
+  }
+  BreakerState after = lane.breaker.getState();
+  if (after != before) {
+    if (after == BREAKER_OPEN) {
+      LOG_API_ERROR("Match backend %s breaker open - skipping it for a while", lane.backend->getName());
+    } else {
+      LOG_API_INFO("Match backend %s breaker %s", lane.backend->getName(), CircuitBreaker::stateName(after));
+    }
+  }
+  return result.seq == seq;
+}
+
+MatchRouteResult MatchRouter::lookupBatch(const MatchColor* colors, uint8_t count, MatchResponse* out,
+                                          MatchBackendStatus* statuses, const char** sources) {
+  uint32_t startMs = millis();
+  MatchRouteResult route = {0, 0, 0, 0, false};
+  count = min(count, (uint8_t)MATCH_BATCH_MAX);
+  lookups++;
+  routedColors += count;
+  seq++;
+  nextLane = 0;
+
+  bool resolved[MATCH_BATCH_MAX];
+  for (uint8_t i = 0; i < count; i++) {
+    resolved[i] = false;
+    statuses[i] = MATCH_BACKEND_FAILED;
+    sources[i] = "none";
+  }
+  uint8_t unresolved = count;
+
+  // Settle backends still finishing an earlier lookup
+  MatchLaneDone result;
+  while (done && xQueueReceive(done, &result, 0) == pdTRUE) {
+    complete(result);
+  }
+
+  int first = -1;
+  bool hedgeAnswered = false;
+  uint8_t inFlight = 0;
+  uint32_t lastStartMs = millis();
+  if (startNext(colors, count, resolved)) {
+    inFlight++;
+    first = nextLane - 1;
+  }
+
+  while (inFlight > 0 && unresolved > 0) {
+    uint32_t elapsed = millis() - startMs;
+    if (elapsed >= MATCH_ROUTE_TIMEOUT_MS) {
+      LOG_API_ERROR("Match lookup timed out with %u backend(s) still busy", inFlight);
+      break;
+    }
+    uint32_t waitMs = MATCH_ROUTE_TIMEOUT_MS - elapsed;
+    bool canHedge = nextLane < laneCount;
+    if (canHedge) {
+      uint32_t sinceStart = millis() - lastStartMs;
+      uint32_t hedgeInMs = sinceStart < MATCH_HEDGE_DELAY_MS ? MATCH_HEDGE_DELAY_MS - sinceStart : 0;
+      waitMs = min(waitMs, hedgeInMs);
+    }
+
+    if (xQueueReceive(done, &result, pdMS_TO_TICKS(waitMs)) == pdTRUE) {
+      if (!complete(result)) {
+        continue;
+      }
+      inFlight--;
+
+      // First answer for each color wins
+      MatchLane& lane = lanes[result.lane];
+      for (uint8_t j = 0; j < lane.count; j++) {
+        uint8_t item = lane.items[j];
+        if (resolved[item] || lane.statuses[j] == MATCH_BACKEND_FAILED) {
+          continue;
+        }
+        memcpy(&out[item], &lane.responses[j], sizeof(MatchResponse));
+        statuses[item] = lane.statuses[j];
+        sources[item] = lane.backend->getName();
+        resolved[item] = true;
+        unresolved--;
+        lane.wins++;
+        if (result.lane != first) {
+          hedgeAnswered = true;
+        }
+      }
+
+      if (unresolved > 0 && result.status == MATCH_BACKEND_FAILED && startNext(colors, count, resolved)) {
+        inFlight++;
+        failovers++;
+        lastStartMs = millis();
+      }
+    } else if (canHedge && millis() - lastStartMs >= MATCH_HEDGE_DELAY_MS) {
+      if (startNext(colors, count, resolved)) {
+        inFlight++;
+        hedges++;
+        route.hedged = true;
+        lastStartMs = millis();
+        LOG_API_INFO("Hedging match lookup %u after %u ms", seq, (unsigned)(lastStartMs - startMs));
+      }
+    }
+  }
+  if (route.hedged && hedgeAnswered) {
+    hedgeWins++;
+  }
+
+  bool useLocal = local && (laneCount == 0 || MATCH_CATALOG_FALLBACK);
+  for (uint8_t i = 0; i < count; i++) {
+    if (!resolved[i] && useLocal) {
+      statuses[i] = local->lookup(colors[i].r, colors[i].g, colors[i].b, out[i]);
+      sources[i] = local->getName();
+      resolved[i] = statuses[i] != MATCH_BACKEND_FAILED;
+      if (resolved[i]) {
+        route.local++;
+        localAnswers++;
+      }
+    }
+    if (resolved[i]) {
+      route.answered++;
+    } else {
+      route.failed++;
+      if (!useLocal) {
+        memset(&out[i], 0, sizeof(MatchResponse));
+        strncpy(out[i].error, "No match backend answered", sizeof(out[i].error) - 1);
+      }
+    }
+  }
+
+  route.ms = millis() - startMs;
+  answered += route.answered;
+  failedColors += route.failed;
+  totalMs += route.ms;
+  lastMs = route.ms;
+  lastCount = count;
+  return route;
+}
+
+void MatchRouter::getStats(JsonObject stats) const {
+  stats["lookups"] = lookups;
+  stats["colors"] = routedColors;
+  stats["answered"] = answered;
+  stats["failed"] = failedColors;
+  stats["hedges"] = hedges;
+  stats["hedgeWins"] = hedgeWins;
+  stats["failovers"] = failovers;
+  stats["localAnswers"] = localAnswers;
+  stats["hedgeDelayMs"] = MATCH_HEDGE_DELAY_MS;
+  stats["avgMs"] = lookups ? (float)totalMs / lookups : 0;
+  stats["lastMs"] = lastMs;
+  stats["lastColors"] = lastCount;
+
+  JsonArray remotes = stats["remotes"].to<JsonArray>();
+  for (uint8_t i = 0; i < laneCount; i++) {
+    const MatchLane& lane = lanes[i];
+    JsonObject entry = remotes.add<JsonObject>();
+    entry["name"] = lane.backend->getName();
+    entry["running"] = lane.task != nullptr;
+    entry["busy"] = lane.busy;
+    entry["calls"] = lane.calls;
+    entry["failed"] = lane.failed;
+    entry["colors"] = lane.colorsAsked;
+    entry["wins"] = lane.wins;
+    entry["avgMs"] = lane.calls ? (float)lane.totalMs / lane.calls : 0;
+    entry["lastMs"] = lane.lastMs;
+    lane.breaker.getStats(entry["breaker"].to<JsonObject>());
+    lane.backend->getStats(entry["backend"].to<JsonObject>());
+  }
+
+  if (local) {
+    JsonObject entry = stats["local"].to<JsonObject>();
+    entry["name"] = local->getName();
+    local->getStats(entry["backend"].to<JsonObject>());
+  }
+}
@@ -0,0 +1,140 @@
+#ifndef MATCH_ROUTER_H
+#define MATCH_ROUTER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+#include "match_backend.h"
+
+/**
+ * @brief Routes paint-match lookups across backends with hedging and breakers
+ *
+ * A lookup carries up to MATCH_BATCH_MAX colors. Remote backends are tried in
+ * the order they were added, and each runs on its own lane task so the router
+ * can wait on several at once:
+ *
+ * - The first backend whose breaker allows it is started with every color.
+ * - If it has not answered within MATCH_HEDGE_DELAY_MS the next one is
+ *   started as well (a hedge) and the first answer for each color wins.
+ * - A failure starts the next backend straight away with the colors still
+ *   unanswered.
+ * - A backend still busy with an earlier lookup is skipped.
+ *
+ * A color's result is final once a backend answers it (matched or not).
+ * Backends that lose the race keep running and their results still feed
+ * their breakers. Colors no remote backend answers go to the local backend
+ * (the on-device catalog) when MATCH_CATALOG_FALLBACK is set, or always when
+ * no remote backend is configured. The caller treats a fallback answer as
+ * provisional and retries the remotes later.
+ *
+ * lookupBatch() is called from the match worker task only.
+ */
+
+struct MatchRouteResult {
+  uint8_t answered;        // Colors a backend answered (matched or not)
+  uint8_t failed;          // Colors no backend could answer
+  uint8_t local;           // Answered colors that came from the local backend
+  uint32_t ms;
+  bool hedged;             // A second remote was started before the first answered
+};
+
+struct MatchLaneRequest {
+  uint32_t seq;
+};
+
+struct MatchLaneDone {
+  uint8_t lane;
+  uint32_t seq;
+  MatchBackendStatus status;
+  uint32_t ms;
+};
+
+class MatchRouter;
+
+// Colors, responses and statuses belong to the lane task while busy
+struct MatchLane {
+  MatchRouter* router;
+  uint8_t index;
+  MatchBackend* backend;
+  CircuitBreaker breaker;
+  QueueHandle_t requests;
+  TaskHandle_t task;
+  bool busy;                   // Request sent, completion not yet seen by the router
+  uint8_t count;
+  uint8_t items[MATCH_BATCH_MAX];      // Position of each color in the router's lookup
+  MatchColor colors[MATCH_BATCH_MAX];
+  MatchResponse responses[MATCH_BATCH_MAX];
+  MatchBackendStatus statuses[MATCH_BATCH_MAX];
+
+  uint32_t calls;
+  uint32_t failed;             // Calls that failed for at least one color
+  uint32_t colorsAsked;
+  uint32_t wins;               // Colors whose answer was used
+  uint32_t totalMs;
+  uint32_t lastMs;
+};
+
+class MatchRouter {
+private:
+  MatchLane lanes[MATCH_ROUTER_MAX_REMOTES];
+  uint8_t laneCount;
+  MatchBackend* local;
+  QueueHandle_t done;
+  uint32_t seq;
+  uint8_t nextLane;            // Next lane to try in the current lookup
+
+  uint32_t lookups;
+  uint32_t routedColors;
+  uint32_t answered;
+  uint32_t failedColors;
+  uint32_t hedges;
+  uint32_t hedgeWins;          // Lookups where a hedged backend answered a color first
+  uint32_t failovers;
+  uint32_t localAnswers;
+  uint32_t totalMs;
+  uint32_t lastMs;
+  uint8_t lastCount;
+
+  bool startNext(const MatchColor* colors, uint8_t count, const bool* resolved);
+  bool complete(const MatchLaneDone& result);
+  static void laneMain(void* arg);
+
+public:
+  MatchRouter();
+
+  /**
+   * @brief Add a remote backend; call before begin()
+   * @return false when MATCH_ROUTER_MAX_REMOTES are already added
+   */
+  bool addRemote(MatchBackend* backend);
+
+  /**
+   * @brief Set the on-device backend used when the remotes fail
+   */
+  void setLocal(MatchBackend* backend) { local = backend; }
+
+  /**
+   * @brief Start the lane tasks
+   */
+  bool begin();
+
+  bool hasRemote() const { return laneCount > 0; }
+
+  /**
+   * @brief Look up several colors; blocks until each is answered or every backend has failed
+   * @param colors At most MATCH_BATCH_MAX colors
+   * @param out Receives each color's response
+   * @param statuses Receives each color's status
+   * @param sources Receives the name of the backend that answered each color ("none" if none)
+   */
+  MatchRouteResult lookupBatch(const MatchColor* colors, uint8_t count, MatchResponse* out,
+                               MatchBackendStatus* statuses, const char** sources);
+
+  /**
+   * @brief Add routing counters and per-backend breaker and client stats to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // MATCH_ROUTER_H
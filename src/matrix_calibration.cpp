@@ -2,6 +2,7 @@
 #include <Preferences.h>
 #include <ArduinoJson.h>
 #include <math.h>
+#include "perf_profiler.h"
 
 // External preferences object from main.cpp
 extern Preferences preferences;
@@ -24,6 +25,7 @@ MatrixCalibration::MatrixCalibration(DFRobot_TCS3430* tcs3430) {
   currentMatrix.max_delta_e = 0.0f;
   currentMatrix.timestamp = 0;
   strcpy(currentMatrix.illuminant, "D65");
+  memset(&lastCrossValidation, 0, sizeof(lastCrossValidation));
 }
 
 bool MatrixCalibration::initialize() {
@@ -46,8 +48,8 @@ bool MatrixCalibration::initialize() {
 }
 
 bool MatrixCalibration::addCalibrationPoint(uint8_t ref_r, uint8_t ref_g, uint8_t ref_b, const char* name) {
-  if (numPoints >= MAX_CALIBRATION_POINTS) {
-    LOG_SENSOR_ERROR("Matrix calibration: maximum points reached (%d)", MAX_CALIBRATION_POINTS);
+  if (numPoints >= MATRIX_MAX_POINTS) {
+    LOG_SENSOR_ERROR("Matrix calibration: maximum points reached (%d)", MATRIX_MAX_POINTS);
     return false;
   }
   
@@ -63,15 +65,24 @@ bool MatrixCalibration::addCalibrationPoint(uint8_t ref_r, uint8_t ref_g, uint8_
   LOG_SENSOR_INFO("Matrix calibration: measuring %s (target RGB: %d,%d,%d)", 
                   name, ref_r, ref_g, ref_b);
   
+  int validReadings = 0;
+  int failedReadings = 0;
   for (int i = 0; i < numReadings; i++) {
     delay(200); // Stabilization delay
     
+    sensor->clearError();
     uint16_t r = sensor->getXData();    // Red channel
     uint16_t g = sensor->getYData();    // Green channel  
     uint16_t b = sensor->getZData();    // Blue channel
     uint16_t c = (r + g + b) / 3;       // Clear channel approximation
     uint16_t ir1 = sensor->getIR1Data();
     uint16_t ir2 = sensor->getIR2Data();
+    if (sensor->getLastError() != DFRobot_TCS3430::eI2COK) {
+      LOG_SENSOR_WARN("Reading %d dropped: I2C error %d", i+1, (int)sensor->getLastError());
+      failedReadings++;
+      continue;
+    }
+    validReadings++;
     
     sumR += r;
     sumG += g;
@@ -84,20 +95,28 @@ bool MatrixCalibration::addCalibrationPoint(uint8_t ref_r, uint8_t ref_g, uint8_
                      i+1, r, g, b, c, ir1, ir2);
   }
   
+  if (validReadings == 0 || failedReadings * 100 > numReadings * SCAN_MAX_FAILED_READ_PERCENT) {
+    LOG_SENSOR_ERROR("Matrix calibration: %d of %d readings of %s had I2C errors", failedReadings, numReadings, name);
+    return false;
+  }
+
   // Average the readings
   ColorReference& point = calibrationPoints[numPoints];
   point.ref_r = ref_r;
   point.ref_g = ref_g;
   point.ref_b = ref_b;
-  point.sensor_r = sumR / numReadings;
-  point.sensor_g = sumG / numReadings;
-  point.sensor_b = sumB / numReadings;
-  point.sensor_c = sumC / numReadings;
-  point.sensor_ir1 = sumIR1 / numReadings;
-  point.sensor_ir2 = sumIR2 / numReadings;
+  point.sensor_r = sumR / validReadings;
+  point.sensor_g = sumG / validReadings;
+  point.sensor_b = sumB / validReadings;
+  point.sensor_c = sumC / validReadings;
+  point.sensor_ir1 = sumIR1 / validReadings;
+  point.sensor_ir2 = sumIR2 / validReadings;
   point.valid = true;
   point.timestamp = millis();
   point.delta_e = 0.0f; // Will be calculated after matrix computation
+  point.leverage = 0.0f;
+  point.loo_delta_e = -1.0f;
+  point.suspect = false;
   strncpy(point.name, name, sizeof(point.name) - 1);
   point.name[sizeof(point.name) - 1] = '\0';
   
@@ -110,7 +129,7 @@ bool MatrixCalibration::addCalibrationPoint(uint8_t ref_r, uint8_t ref_g, uint8_
   
   numPoints++;
   LOG_SENSOR_INFO("Matrix calibration: added point %d/%d - %s (sensor: %d,%d,%d,%d)", 
-                  numPoints, MAX_CALIBRATION_POINTS, name, 
+                  numPoints, MATRIX_MAX_POINTS, name, 
                   point.sensor_r, point.sensor_g, point.sensor_b, point.sensor_c);
   
   return true;
@@ -120,8 +139,8 @@ bool MatrixCalibration::addManualCalibrationPoint(uint8_t ref_r, uint8_t ref_g,
                                                  uint16_t sensor_r, uint16_t sensor_g, 
                                                  uint16_t sensor_b, uint16_t sensor_c,
                                                  const char* name) {
-  if (numPoints >= MAX_CALIBRATION_POINTS) {
-    LOG_SENSOR_ERROR("Matrix calibration: maximum points reached (%d)", MAX_CALIBRATION_POINTS);
+  if (numPoints >= MATRIX_MAX_POINTS) {
+    LOG_SENSOR_ERROR("Matrix calibration: maximum points reached (%d)", MATRIX_MAX_POINTS);
     return false;
   }
   
@@ -138,6 +157,9 @@ bool MatrixCalibration::addManualCalibrationPoint(uint8_t ref_r, uint8_t ref_g,
   point.valid = true;
   point.timestamp = millis();
   point.delta_e = 0.0f;
+  point.leverage = 0.0f;
+  point.loo_delta_e = -1.0f;
+  point.suspect = false;
   strncpy(point.name, name, sizeof(point.name) - 1);
   point.name[sizeof(point.name) - 1] = '\0';
   
@@ -181,8 +203,8 @@ bool MatrixCalibration::computeCalibrationMatrix() {
   // b is (validPoints x 3) matrix of target sRGB values
   // x is (4 x 3) matrix we want to solve for (transposed calibration matrix)
   
-  float A[MAX_CALIBRATION_POINTS][MATRIX_COLS];
-  float b[MAX_CALIBRATION_POINTS][3];
+  float A[MATRIX_MAX_POINTS][MATRIX_COLS];
+  float b[MATRIX_MAX_POINTS][3];
   
   int row = 0;
   for (int i = 0; i < numPoints; i++) {
@@ -242,19 +264,20 @@ bool MatrixCalibration::computeCalibrationMatrix() {
   currentMatrix.valid = true;
   currentMatrix.num_points = validPoints;
   currentMatrix.timestamp = millis();
+  matrixValid = true;
   
-  // Evaluate calibration quality
+  // Evaluate calibration quality (needs the matrix marked valid to apply it)
   lastStats = evaluateCalibration();
   currentMatrix.avg_delta_e = lastStats.mean_delta_e;
   currentMatrix.max_delta_e = lastStats.max_delta_e;
   
-  matrixValid = true;
-  
   LOG_SENSOR_INFO("Matrix calibration: computation complete");
   LOG_SENSOR_INFO("  Points used: %d", validPoints);
   LOG_SENSOR_INFO("  Average ΔE: %.2f", currentMatrix.avg_delta_e);
   LOG_SENSOR_INFO("  Maximum ΔE: %.2f", currentMatrix.max_delta_e);
   LOG_SENSOR_INFO("  Quality score: %.1f", lastStats.quality_score);
+
+  crossValidate(MATRIX_CV_FOLDS);
   
   return true;
 }
@@ -266,6 +289,7 @@ bool MatrixCalibration::applyCalibratedConversion(uint16_t sensor_r, uint16_t se
     LOG_SENSOR_DEBUG("Matrix calibration: no valid matrix, using fallback");
     return false;
   }
+  PERF_SCOPE(PERF_MATRIX_APPLY);
 
   // Normalize sensor readings to 0-1 range
   float norm_r = sensor_r / 65535.0f;
@@ -375,11 +399,264 @@ CalibrationStats MatrixCalibration::evaluateCalibration() {
   return stats;
 }
 
+// Target-space value (0-1) to the 8-bit sRGB applyCalibratedConversion() produces
+static uint8_t toChannelByte(float value) {
+  return (uint8_t)(constrain(value * 255.0f, 0.0f, 255.0f));
+}
+
+// Solve M X = B in place for m unknowns and 3 right-hand sides (partial pivoting)
+static bool solveFold(float M[][MATRIX_MAX_POINTS / 2], float B[][3], int m) {
+  for (int i = 0; i < m; i++) {
+    int pivot = i;
+    for (int k = i + 1; k < m; k++) {
+      if (fabsf(M[k][i]) > fabsf(M[pivot][i])) {
+        pivot = k;
+      }
+    }
+    if (fabsf(M[pivot][i]) < 1e-6f) {
+      return false;
+    }
+    if (pivot != i) {
+      for (int j = 0; j < m; j++) {
+        float temp = M[i][j];
+        M[i][j] = M[pivot][j];
+        M[pivot][j] = temp;
+      }
+      for (int c = 0; c < 3; c++) {
+        float temp = B[i][c];
+        B[i][c] = B[pivot][c];
+        B[pivot][c] = temp;
+      }
+    }
+    for (int k = i + 1; k < m; k++) {
+      float factor = M[k][i] / M[i][i];
+      for (int j = i; j < m; j++) {
+        M[k][j] -= factor * M[i][j];
+      }
+      for (int c = 0; c < 3; c++) {
+        B[k][c] -= factor * B[i][c];
+      }
+    }
+  }
+  for (int i = m - 1; i >= 0; i--) {
+    for (int c = 0; c < 3; c++) {
+      for (int j = i + 1; j < m; j++) {
+        B[i][c] -= M[i][j] * B[j][c];
+      }
+      B[i][c] /= M[i][i];
+    }
+  }
+  return true;
+}
+
+CalibrationCrossValidation MatrixCalibration::crossValidate(uint8_t folds) {
+  CalibrationCrossValidation cv;
+  memset(&cv, 0, sizeof(cv));
+  if (!matrixValid || !currentMatrix.valid) {
+    lastCrossValidation = cv;
+    return cv;
+  }
+
+  // Same design matrix and targets as computeCalibrationMatrix()
+  float A[MATRIX_MAX_POINTS][MATRIX_COLS];
+  float target[MATRIX_MAX_POINTS][3];
+  float residual[MATRIX_MAX_POINTS][3];
+  uint8_t pointIndex[MATRIX_MAX_POINTS];
+  int n = 0;
+  for (int i = 0; i < numPoints; i++) {
+    if (!calibrationPoints[i].valid) continue;
+    A[n][0] = calibrationPoints[i].sensor_r / 65535.0f;
+    A[n][1] = calibrationPoints[i].sensor_g / 65535.0f;
+    A[n][2] = calibrationPoints[i].sensor_b / 65535.0f;
+    A[n][3] = 1.0f;
+    target[n][0] = calibrationPoints[i].ref_r / 255.0f;
+    target[n][1] = calibrationPoints[i].ref_g / 255.0f;
+    target[n][2] = calibrationPoints[i].ref_b / 255.0f;
+    for (int c = 0; c < 3; c++) {
+      float fitted = 0.0f;
+      for (int k = 0; k < MATRIX_COLS; k++) {
+        fitted += currentMatrix.matrix[c][k] * A[n][k];
+      }
+      residual[n][c] = target[n][c] - fitted;
+    }
+    pointIndex[n] = i;
+    n++;
+  }
+  cv.total_points = n;
+  if (n < MATRIX_COLS) {
+    lastCrossValidation = cv;
+    return cv;
+  }
+
+  // G = (AᵀA)⁻¹, one column per unit vector; the hat matrix is h_rs = a_rᵀ G a_s
+  float AtA[MATRIX_COLS][MATRIX_COLS];
+  for (int i = 0; i < MATRIX_COLS; i++) {
+    for (int j = 0; j < MATRIX_COLS; j++) {
+      AtA[i][j] = 0.0f;
+      for (int k = 0; k < n; k++) {
+        AtA[i][j] += A[k][i] * A[k][j];
+      }
+    }
+  }
+  float G[MATRIX_COLS][MATRIX_COLS];
+  for (int col = 0; col < MATRIX_COLS; col++) {
+    float work[MATRIX_COLS][MATRIX_COLS];
+    float unit[MATRIX_COLS];
+    float x[MATRIX_COLS];
+    memcpy(work, AtA, sizeof(work));
+    for (int k = 0; k < MATRIX_COLS; k++) {
+      unit[k] = (k == col) ? 1.0f : 0.0f;
+    }
+    if (!solveLeastSquares(work, unit, x, MATRIX_COLS)) {
+      lastCrossValidation = cv;
+      return cv;
+    }
+    for (int k = 0; k < MATRIX_COLS; k++) {
+      G[k][col] = x[k];
+    }
+  }
+  auto hat = [&](int r, int s) -> float {
+    float h = 0.0f;
+    for (int k = 0; k < MATRIX_COLS; k++) {
+      float Ga = 0.0f;
+      for (int l = 0; l < MATRIX_COLS; l++) {
+        Ga += G[k][l] * A[s][l];
+      }
+      h += A[r][k] * Ga;
+    }
+    return h;
+  };
+  auto deltaEFor = [&](int r, const float predicted[3]) -> float {
+    const ColorReference& point = calibrationPoints[pointIndex[r]];
+    return calculateDeltaE(toChannelByte(predicted[0]), toChannelByte(predicted[1]), toChannelByte(predicted[2]),
+                           point.ref_r, point.ref_g, point.ref_b);
+  };
+
+  // Leave-one-out
+  const float leverageLimit = MATRIX_CV_LEVERAGE_RATIO * MATRIX_COLS / n;
+  float looSorted[MATRIX_MAX_POINTS];
+  float looSum = 0.0f;
+  for (int r = 0; r < n; r++) {
+    ColorReference& point = calibrationPoints[pointIndex[r]];
+    float h = hat(r, r);
+    point.leverage = h;
+    point.suspect = false;
+    if (h > leverageLimit) {
+      cv.high_leverage_points++;
+    }
+    // With n == MATRIX_COLS every h is 1 and float rounding only hides it
+    if (n == MATRIX_COLS || 1.0f - h < 1e-3f) {
+      point.loo_delta_e = -1.0f;  // The fit passes through this point whatever it measured
+      continue;
+    }
+    float predicted[3];
+    for (int c = 0; c < 3; c++) {
+      predicted[c] = target[r][c] - residual[r][c] / (1.0f - h);
+    }
+    point.loo_delta_e = deltaEFor(r, predicted);
+    looSorted[cv.loo_points++] = point.loo_delta_e;
+    looSum += point.loo_delta_e;
+    if (point.loo_delta_e > cv.loo_max_delta_e) {
+      cv.loo_max_delta_e = point.loo_delta_e;
+    }
+  }
+
+  if (cv.loo_points > 0) {
+    cv.loo_mean_delta_e = looSum / cv.loo_points;
+    // Insertion sort; at most MATRIX_MAX_POINTS values
+    for (int i = 1; i < cv.loo_points; i++) {
+      float value = looSorted[i];
+      int j = i - 1;
+      while (j >= 0 && looSorted[j] > value) {
+        looSorted[j + 1] = looSorted[j];
+        j--;
+      }
+      looSorted[j + 1] = value;
+    }
+    cv.loo_median_delta_e = (cv.loo_points % 2) ? looSorted[cv.loo_points / 2]
+        : (looSorted[cv.loo_points / 2 - 1] + looSorted[cv.loo_points / 2]) / 2.0f;
+
+    float suspectLimit = max(DELTA_E_ACCEPTABLE, MATRIX_CV_SUSPECT_RATIO * cv.loo_median_delta_e);
+    for (int r = 0; r < n; r++) {
+      ColorReference& point = calibrationPoints[pointIndex[r]];
+      if (point.loo_delta_e > suspectLimit) {
+        point.suspect = true;
+        cv.suspect_points++;
+        LOG_SENSOR_WARN("Matrix calibration: %s looks bad - LOO ΔE %.2f (median %.2f), leverage %.2f",
+                        point.name, point.loo_delta_e, cv.loo_median_delta_e, point.leverage);
+      }
+    }
+  }
+
+  // k-fold, folds interleaved so each holds patches from across the chart
+  uint8_t k = min((int)max(folds, (uint8_t)2), n);
+  int largestFold = (n + k - 1) / k;
+  if (largestFold <= MATRIX_MAX_POINTS / 2 && n - largestFold >= MATRIX_COLS) {
+    float foldSum = 0.0f;
+    int foldPoints = 0;
+    for (int f = 0; f < k; f++) {
+      int members[MATRIX_MAX_POINTS / 2];
+      int m = 0;
+      for (int r = f; r < n; r += k) {
+        members[m++] = r;
+      }
+      float M[MATRIX_MAX_POINTS / 2][MATRIX_MAX_POINTS / 2];
+      float B[MATRIX_MAX_POINTS / 2][3];
+      for (int i = 0; i < m; i++) {
+        for (int j = 0; j < m; j++) {
+          M[i][j] = (i == j ? 1.0f : 0.0f) - hat(members[i], members[j]);
+        }
+        for (int c = 0; c < 3; c++) {
+          B[i][c] = residual[members[i]][c];
+        }
+      }
+      if (!solveFold(M, B, m)) {
+        continue;  // The other folds cannot determine this one
+      }
+      for (int i = 0; i < m; i++) {
+        float predicted[3];
+        for (int c = 0; c < 3; c++) {
+          predicted[c] = target[members[i]][c] - B[i][c];
+        }
+        foldSum += deltaEFor(members[i], predicted);
+        foldPoints++;
+      }
+    }
+    if (foldPoints > 0) {
+      cv.folds = k;
+      cv.kfold_mean_delta_e = foldSum / foldPoints;
+    }
+  }
+
+  cv.valid = cv.loo_points > 0;
+  lastCrossValidation = cv;
+  LOG_SENSOR_INFO("Matrix calibration: LOO ΔE mean %.2f max %.2f, %u-fold ΔE %.2f, %u suspect, %u high leverage",
+                  cv.loo_mean_delta_e, cv.loo_max_delta_e, cv.folds, cv.kfold_mean_delta_e, cv.suspect_points,
+                  cv.high_leverage_points);
+  return cv;
+}
+
 uint8_t MatrixCalibration::loadColorCheckerReferences() {
   clearCalibrationPoints();
 
-  // Standard ColorChecker patches (simplified set)
-  struct { uint8_t r, g, b; const char* name; } colorChecker[] = {
+  uint8_t count;
+  const SweepTarget* colorChecker = getColorCheckerTargets(count);
+
+  int loaded = 0;
+  for (int i = 0; i < count && loaded < MATRIX_MAX_POINTS; i++) {
+    if (addManualCalibrationPoint(colorChecker[i].r, colorChecker[i].g, colorChecker[i].b,
+                                 0, 0, 0, 0, colorChecker[i].name)) {
+      loaded++;
+    }
+  }
+
+  LOG_SENSOR_INFO("Matrix calibration: loaded %d ColorChecker references", loaded);
+  return loaded;
+}
+
+const SweepTarget* MatrixCalibration::getColorCheckerTargets(uint8_t& count) {
+  // ColorChecker Classic sRGB values, chart order (row by row from dark skin)
+  static const SweepTarget colorChecker[] = {
     {115, 82, 68, "Dark Skin"},
     {194, 150, 130, "Light Skin"},
     {98, 122, 157, "Blue Sky"},
@@ -391,19 +668,22 @@ uint8_t MatrixCalibration::loadColorCheckerReferences() {
     {193, 90, 99, "Moderate Red"},
     {94, 60, 108, "Purple"},
     {157, 188, 64, "Yellow Green"},
-    {224, 163, 46, "Orange Yellow"}
+    {224, 163, 46, "Orange Yellow"},
+    {56, 61, 150, "Blue"},
+    {70, 148, 73, "Green"},
+    {175, 54, 60, "Red"},
+    {231, 199, 31, "Yellow"},
+    {187, 86, 149, "Magenta"},
+    {8, 133, 161, "Cyan"},
+    {243, 243, 242, "White 9.5"},
+    {200, 200, 200, "Neutral 8"},
+    {160, 160, 160, "Neutral 6.5"},
+    {122, 122, 121, "Neutral 5"},
+    {85, 85, 85, "Neutral 3.5"},
+    {52, 52, 52, "Black 2"}
   };
-
-  int loaded = 0;
-  for (int i = 0; i < 12 && loaded < MAX_CALIBRATION_POINTS; i++) {
-    if (addManualCalibrationPoint(colorChecker[i].r, colorChecker[i].g, colorChecker[i].b,
-                                 0, 0, 0, 0, colorChecker[i].name)) {
-      loaded++;
-    }
-  }
-
-  LOG_SENSOR_INFO("Matrix calibration: loaded %d ColorChecker references", loaded);
-  return loaded;
+  count = sizeof(colorChecker) / sizeof(colorChecker[0]);
+  return colorChecker;
 }
 
 uint8_t MatrixCalibration::loadDuluxColorReferences() {
@@ -421,7 +701,7 @@ uint8_t MatrixCalibration::loadDuluxColorReferences() {
   };
 
   int loaded = 0;
-  for (int i = 0; i < STANDARD_CALIBRATION_POINTS && loaded < MAX_CALIBRATION_POINTS; i++) {
+  for (int i = 0; i < STANDARD_CALIBRATION_POINTS && loaded < MATRIX_MAX_POINTS; i++) {
     if (addManualCalibrationPoint(duluxColors[i].r, duluxColors[i].g, duluxColors[i].b,
                                  0, 0, 0, 0, duluxColors[i].name)) {
       loaded++;
@@ -433,14 +713,18 @@ uint8_t MatrixCalibration::loadDuluxColorReferences() {
 }
 
 void MatrixCalibration::clearCalibrationPoints() {
-  for (int i = 0; i < MAX_CALIBRATION_POINTS; i++) {
+  for (int i = 0; i < MATRIX_MAX_POINTS; i++) {
     calibrationPoints[i].valid = false;
     calibrationPoints[i].delta_e = 0.0f;
+    calibrationPoints[i].leverage = 0.0f;
+    calibrationPoints[i].loo_delta_e = -1.0f;
+    calibrationPoints[i].suspect = false;
     memset(calibrationPoints[i].name, 0, sizeof(calibrationPoints[i].name));
   }
   numPoints = 0;
   matrixValid = false;
   currentMatrix.valid = false;
+  memset(&lastCrossValidation, 0, sizeof(lastCrossValidation));
 
   LOG_SENSOR_INFO("Matrix calibration: cleared all calibration points");
 }
@@ -544,6 +828,17 @@ String MatrixCalibration::getDiagnostics() {
     doc["qualityScore"] = lastStats.quality_score;
     doc["pointsUnder2"] = lastStats.points_under_2;
     doc["pointsUnder5"] = lastStats.points_under_5;
+
+    JsonObject cv = doc["crossValidation"].to<JsonObject>();
+    cv["valid"] = lastCrossValidation.valid;
+    cv["looMeanDeltaE"] = lastCrossValidation.loo_mean_delta_e;
+    cv["looMedianDeltaE"] = lastCrossValidation.loo_median_delta_e;
+    cv["looMaxDeltaE"] = lastCrossValidation.loo_max_delta_e;
+    cv["looPoints"] = lastCrossValidation.loo_points;
+    cv["folds"] = lastCrossValidation.folds;
+    cv["kfoldMeanDeltaE"] = lastCrossValidation.kfold_mean_delta_e;
+    cv["suspectPoints"] = lastCrossValidation.suspect_points;
+    cv["highLeveragePoints"] = lastCrossValidation.high_leverage_points;
   }
 
   JsonArray points = doc["calibrationPoints"].to<JsonArray>();
@@ -558,6 +853,13 @@ String MatrixCalibration::getDiagnostics() {
       point["sensorG"] = calibrationPoints[i].sensor_g;
       point["sensorB"] = calibrationPoints[i].sensor_b;
       point["deltaE"] = calibrationPoints[i].delta_e;
+      point["leverage"] = calibrationPoints[i].leverage;
+      if (calibrationPoints[i].loo_delta_e >= 0.0f) {
+        point["looDeltaE"] = calibrationPoints[i].loo_delta_e;
+      } else {
+        point["looDeltaE"] = nullptr;
+      }
+      point["suspect"] = calibrationPoints[i].suspect;
     }
   }
 
@@ -5,6 +5,7 @@
 #include <DFRobot_TCS3430.h>
 #include "config.h"
 #include "logging.h"
+#include "patch_sweep.h"
 
 /**
  * @brief Matrix-based Color Calibration System for TCS3430
@@ -13,8 +14,8 @@
  * to map raw sensor readings to accurate sRGB values.
  */
 
-// Maximum number of calibration points (color patches)
-#define MAX_CALIBRATION_POINTS 12
+// Maximum number of calibration points (color patches, a full ColorChecker)
+#define MATRIX_MAX_POINTS 24
 #define MATRIX_COLS 4  // 3x4 matrix (RGB output, RGBC input + bias)
 
 // Color reference structure for calibration points
@@ -31,6 +32,9 @@ struct ColorReference {
   bool valid;              // Whether this calibration point is valid
   uint32_t timestamp;      // When this measurement was taken
   float delta_e;           // Color difference after calibration (quality metric)
+  float leverage;          // Hat matrix diagonal h_ii: how much this point pulls its own fit
+  float loo_delta_e;       // ΔE predicted for this point by the fit without it (-1 if undetermined)
+  bool suspect;            // LOO ΔE far above the rest: likely a bad patch or measurement
 };
 
 // Calibration matrix structure
@@ -58,12 +62,27 @@ struct CalibrationStats {
   float quality_score;     // Overall quality score (0-100)
 };
 
+// Cross-validation of the fit, computed from the hat matrix without refitting
+struct CalibrationCrossValidation {
+  float loo_mean_delta_e;  // Mean leave-one-out ΔE
+  float loo_max_delta_e;
+  float loo_median_delta_e;
+  float kfold_mean_delta_e; // Mean ΔE predicting each fold from the others
+  uint8_t folds;           // k used for kfold_mean_delta_e (0 if too few points)
+  uint8_t loo_points;      // Points with a determined LOO prediction (leverage < 1)
+  uint8_t suspect_points;
+  uint8_t high_leverage_points;
+  uint8_t total_points;
+  bool valid;
+};
+
 class MatrixCalibration {
 private:
   DFRobot_TCS3430* sensor;
-  ColorReference calibrationPoints[MAX_CALIBRATION_POINTS];
+  ColorReference calibrationPoints[MATRIX_MAX_POINTS];
   CalibrationMatrix currentMatrix;
   CalibrationStats lastStats;
+  CalibrationCrossValidation lastCrossValidation;
   
   uint8_t numPoints;
   bool matrixValid;
@@ -145,12 +164,33 @@ public:
    * @return Calibration statistics
    */
   CalibrationStats evaluateCalibration();
+
+  /**
+   * @brief Leave-one-out and k-fold validation of the current fit
+   *
+   * The fit is linear least squares, so with H = A (AᵀA)⁻¹ Aᵀ the residual
+   * of point i predicted without it is e_i / (1 - h_ii), and the residuals
+   * of a held-out fold S are (I - H_SS)⁻¹ e_S. Neither needs a refit. Sets
+   * each point's leverage, loo_delta_e and suspect flag. Run by
+   * computeCalibrationMatrix() with MATRIX_CV_FOLDS.
+   * @param folds k for the k-fold estimate (2 or more; clamped to the point count)
+   */
+  CalibrationCrossValidation crossValidate(uint8_t folds);
+
+  CalibrationCrossValidation getCrossValidation() const { return lastCrossValidation; }
   
   /**
    * @brief Load pre-defined ColorChecker calibration points
    * @return Number of points loaded
    */
   uint8_t loadColorCheckerReferences();
+
+  /**
+   * @brief ColorChecker Classic reference colors in chart order
+   * @param count Receives the number of patches
+   * @return The reference table (static storage)
+   */
+  static const SweepTarget* getColorCheckerTargets(uint8_t& count);
   
   /**
    * @brief Load Dulux paint color references
@@ -0,0 +1,345 @@
+#include "memory_accounting.h"
+#include <esp_heap_caps.h>
+#include <soc/soc_memory_layout.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+MemoryAccounting memoryAccounting;
+
+// Statically initialized rather than a member: other modules' constructors
+// allocate before memoryAccounting's own constructor has run
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Nothing below may allocate: it runs inside malloc and free
+
+// Caller holds the lock. Registers the task on first sight while slots remain.
+MemoryAccounting::TaskSlot* MemoryAccounting::findTask(void* handle) {
+  if (!handle) {
+    return nullptr;
+  }
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (tasks[i].handle == handle) {
+      return &tasks[i];
+    }
+  }
+  if (taskCount >= MEM_TASK_SLOTS) {
+    return nullptr;
+  }
+  TaskSlot& slot = tasks[taskCount++];
+  slot.handle = handle;
+  slot.current = subsystemForTask(pcTaskGetTaskName((TaskHandle_t)handle));
+  return &slot;
+}
+
+MemSubsystem MemoryAccounting::subsystemForTask(const char* name) {
+  if (!name) {
+    return MEM_SYSTEM;
+  }
+  // Task names from xTaskCreate calls in this firmware and the IDF network stack
+  if (strcmp(name, "match") == 0 || strcmp(name, "matchLane") == 0 || strcmp(name, "tiT") == 0 ||
+      strcmp(name, "wifi") == 0 || strcmp(name, "arduino_events") == 0) {
+    return MEM_NETWORK;
+  }
+  if (strcmp(name, "persist") == 0) {
+    return MEM_STORAGE;
+  }
+  if (strcmp(name, "sensorBoot") == 0) {
+    return MEM_SENSOR;
+  }
+  return MEM_SYSTEM;
+}
+
+MemSubsystem MemoryAccounting::subsystemForPath(const char* path) {
+  static const struct {
+    const char* prefix;
+    MemSubsystem subsystem;
+  } routes[] = {
+    {"/scan", MEM_SENSOR},
+    {"/enhanced-scan", MEM_SENSOR},
+    {"/raw", MEM_SENSOR},
+    {"/sensor-diagnostics", MEM_SENSOR},
+    {"/live-metrics", MEM_SENSOR},
+    {"/brightness", MEM_SENSOR},
+    {"/calibrat", MEM_CALIBRATION},
+    {"/matrix-calibration", MEM_CALIBRATION},
+    {"/tcs3430-calibration", MEM_CALIBRATION},
+    {"/drift", MEM_CALIBRATION},
+    {"/samples", MEM_STORAGE},
+    {"/save", MEM_STORAGE},
+    {"/delete", MEM_STORAGE},
+    {"/settings", MEM_STORAGE},
+    {"/match", MEM_NETWORK},
+  };
+  for (const auto& route : routes) {
+    if (strncmp(path, route.prefix, strlen(route.prefix)) == 0) {
+      return route.subsystem;
+    }
+  }
+  return MEM_WEB;
+}
+
+void MemoryAccounting::recordAlloc(size_t size, bool psram) {
+  void* task = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&mux);
+  TaskSlot* slot = findTask(task);
+  Subsystem& s = subsystems[slot ? slot->current : MEM_SYSTEM];
+  if (size == 0) {
+    s.failures++;
+    portEXIT_CRITICAL(&mux);
+    return;
+  }
+  s.allocs++;
+  s.allocBytes += size;
+  if (size > s.largestAlloc) {
+    s.largestAlloc = size;
+  }
+  if (psram) {
+    s.psramAllocs++;
+  }
+  if (requestActive && task == requestTask) {
+    requestAllocs++;
+    requestAllocBytes += size;
+    requestNet += size;
+    if (requestNet > requestPeak) {
+      requestPeak = requestNet;
+    }
+  }
+  portEXIT_CRITICAL(&mux);
+}
+
+void MemoryAccounting::recordFree(size_t size) {
+  void* task = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&mux);
+  if (requestActive && task == requestTask) {
+    requestNet -= size;
+  }
+  portEXIT_CRITICAL(&mux);
+}
+
+MemSubsystem MemoryAccounting::enter(MemSubsystem subsystem) {
+  portENTER_CRITICAL(&mux);
+  TaskSlot* slot = findTask(xTaskGetCurrentTaskHandle());
+  MemSubsystem previous = MEM_SYSTEM;
+  if (slot) {
+    previous = slot->current;
+    slot->current = subsystem;
+  }
+  portEXIT_CRITICAL(&mux);
+  return previous;
+}
+
+void MemoryAccounting::beginRequest(const char* path) {
+  if (requestActive) {
+    return;
+  }
+  // Read before the lock: the heap walk takes the heap's own lock
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  MemSubsystem subsystem = subsystemForPath(path);
+
+  portENTER_CRITICAL(&mux);
+  strncpy(requestPath, path, sizeof(requestPath) - 1);
+  requestPath[sizeof(requestPath) - 1] = '\0';
+  requestTask = xTaskGetCurrentTaskHandle();
+  requestAllocs = 0;
+  requestAllocBytes = 0;
+  requestNet = 0;
+  requestPeak = 0;
+  requestLargestBefore = largest;
+  TaskSlot* slot = findTask(requestTask);
+  requestPrevious = MEM_SYSTEM;
+  if (slot) {
+    requestPrevious = slot->current;
+    slot->current = subsystem;
+  }
+  requestActive = true;
+  portEXIT_CRITICAL(&mux);
+}
+
+MemoryAccounting::Endpoint& MemoryAccounting::endpointFor(const char* path) {
+  for (uint8_t i = 0; i < endpointCount; i++) {
+    if (strcmp(endpoints[i].path, path) == 0) {
+      return endpoints[i];
+    }
+  }
+  uint8_t index = endpointCount;
+  if (endpointCount < MEM_ENDPOINT_SLOTS) {
+    endpointCount++;
+  } else {
+    index = 0;
+    for (uint8_t i = 1; i < endpointCount; i++) {
+      if (endpoints[i].requests < endpoints[index].requests) {
+        index = i;
+      }
+    }
+  }
+  Endpoint& e = endpoints[index];
+  memset(&e, 0, sizeof(e));
+  strncpy(e.path, path, sizeof(e.path) - 1);
+  return e;
+}
+
+void MemoryAccounting::endRequest() {
+  if (!requestActive) {
+    return;
+  }
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+  portENTER_CRITICAL(&mux);
+  requestActive = false;
+  Endpoint& e = endpointFor(requestPath);
+  e.requests++;
+  e.allocs += requestAllocs;
+  e.allocBytes += requestAllocBytes;
+  e.retainedBytes += requestNet;
+  if (requestPeak > e.peakBytes) {
+    e.peakBytes = requestPeak;
+  }
+  uint32_t drop = requestLargestBefore > largest ? requestLargestBefore - largest : 0;
+  if (drop > e.worstBlockDrop) {
+    e.worstBlockDrop = drop;
+  }
+  TaskSlot* slot = findTask(requestTask);
+  if (slot) {
+    slot->current = requestPrevious;
+  }
+  portEXIT_CRITICAL(&mux);
+}
+
+const char* MemoryAccounting::subsystemName(MemSubsystem subsystem) {
+  switch (subsystem) {
+    case MEM_SYSTEM: return "system";
+    case MEM_WEB: return "web";
+    case MEM_SENSOR: return "sensor";
+    case MEM_CALIBRATION: return "calibration";
+    case MEM_STORAGE: return "storage";
+    case MEM_NETWORK: return "network";
+    default: return "unknown";
+  }
+}
+
+// Free, largest block and fragmentation for one kind of heap memory
+static void addHeapStats(JsonObject out, uint32_t caps) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, caps);
+  out["total"] = (uint32_t)(info.total_free_bytes + info.total_allocated_bytes);
+  out["free"] = (uint32_t)info.total_free_bytes;
+  out["minFree"] = (uint32_t)info.minimum_free_bytes;
+  out["largestFreeBlock"] = (uint32_t)info.largest_free_block;
+  out["allocatedBlocks"] = (uint32_t)info.allocated_blocks;
+  // Share of free memory that cannot be handed out in one block
+  float fragmentation = info.total_free_bytes ?
+    100.0f * (1.0f - (float)info.largest_free_block / info.total_free_bytes) : 0.0f;
+  out["fragmentationPercent"] = roundf(fragmentation * 10.0f) / 10.0f;
+}
+
+void MemoryAccounting::getStats(JsonObject stats) const {
+  // Copy under the lock, format outside it (formatting allocates)
+  Subsystem subsystemSnapshot[MEM_SUBSYSTEM_COUNT];
+  Endpoint endpointSnapshot[MEM_ENDPOINT_SLOTS];
+  portENTER_CRITICAL(&mux);
+  memcpy(subsystemSnapshot, subsystems, sizeof(subsystemSnapshot));
+  uint8_t count = endpointCount;
+  memcpy(endpointSnapshot, endpoints, sizeof(Endpoint) * count);
+  portEXIT_CRITICAL(&mux);
+
+  stats["tracking"] = isTracking();
+  addHeapStats(stats["internal"].to<JsonObject>(), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (psramFound()) {
+    addHeapStats(stats["psram"].to<JsonObject>(), MALLOC_CAP_SPIRAM);
+  }
+  if (!isTracking()) {
+    return;
+  }
+
+  JsonObject out = stats["subsystems"].to<JsonObject>();
+  for (uint8_t i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+    const Subsystem& s = subsystemSnapshot[i];
+    JsonObject subsystem = out[subsystemName((MemSubsystem)i)].to<JsonObject>();
+    subsystem["allocs"] = s.allocs;
+    subsystem["failures"] = s.failures;
+    subsystem["allocBytes"] = s.allocBytes;
+    subsystem["largestAlloc"] = s.largestAlloc;
+    subsystem["psramAllocs"] = s.psramAllocs;
+  }
+
+  // Most retained bytes first: those are the endpoints that leave the heap smaller
+  uint8_t order[MEM_ENDPOINT_SLOTS];
+  for (uint8_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  std::sort(order, order + count, [&](uint8_t a, uint8_t b) {
+    return endpointSnapshot[a].retainedBytes > endpointSnapshot[b].retainedBytes;
+  });
+  JsonArray list = stats["endpoints"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; i++) {
+    const Endpoint& e = endpointSnapshot[order[i]];
+    JsonObject endpoint = list.add<JsonObject>();
+    endpoint["path"] = e.path;
+    endpoint["requests"] = e.requests;
+    endpoint["allocs"] = e.allocs;
+    endpoint["allocBytes"] = e.allocBytes;
+    endpoint["meanAllocBytes"] = e.requests ? (uint32_t)(e.allocBytes / e.requests) : 0;
+    endpoint["retainedBytes"] = e.retainedBytes;
+    endpoint["peakBytes"] = e.peakBytes;
+    endpoint["worstBlockDrop"] = e.worstBlockDrop;
+  }
+}
+
+// ============================================================================
+// Allocator wrappers, linked in place of the libc functions by -Wl,--wrap
+// ============================================================================
+
+#ifdef MEM_ACCOUNTING_WRAP
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static inline void recordBlock(void* ptr) {
+  if (ptr) {
+    memoryAccounting.recordAlloc(heap_caps_get_allocated_size(ptr), esp_ptr_external_ram(ptr));
+  } else {
+    memoryAccounting.recordAlloc(0, false);
+  }
+}
+
+void* __wrap_malloc(size_t size) {
+  void* ptr = __real_malloc(size);
+  recordBlock(ptr);
+  return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  void* ptr = __real_calloc(count, size);
+  recordBlock(ptr);
+  return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  size_t oldSize = ptr ? heap_caps_get_allocated_size(ptr) : 0;
+  void* result = __real_realloc(ptr, size);
+  if (!result && size > 0) {
+    // Failed: the old block is untouched
+    memoryAccounting.recordAlloc(0, false);
+    return result;
+  }
+  if (ptr) {
+    memoryAccounting.recordFree(oldSize);
+  }
+  if (result) {
+    recordBlock(result);
+  }
+  return result;
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr) {
+    memoryAccounting.recordFree(heap_caps_get_allocated_size(ptr));
+  }
+  __real_free(ptr);
+}
+}
+
+#endif // MEM_ACCOUNTING_WRAP
@@ -0,0 +1,152 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Subsystems heap use is charged to
+enum MemSubsystem : uint8_t {
+  MEM_SYSTEM = 0,              // Untagged: framework, Wi-Fi driver, boot
+  MEM_WEB,                     // HTTP parsing, responses, static files, events
+  MEM_SENSOR,                  // Scans and sensor services
+  MEM_CALIBRATION,             // White/black, matrix, sweep and drift calibration
+  MEM_STORAGE,                 // Sample log, settings, persistence task
+  MEM_NETWORK,                 // Wi-Fi link and paint backend requests
+  MEM_SUBSYSTEM_COUNT
+};
+
+/**
+ * @brief Heap allocation accounting per subsystem and per HTTP endpoint
+ *
+ * The firmware links malloc, calloc, realloc and free through wrappers
+ * (-Wl,--wrap in platformio.ini, which also defines MEM_ACCOUNTING_WRAP).
+ * That covers String, new/delete and ArduinoJson as well as direct calls.
+ * Every call is charged to the calling task's current subsystem. Each task
+ * starts with a fixed subsystem chosen by its name, and MEM_SCOPE() overrides
+ * that for a block. Block sizes come from heap_caps_get_allocated_size(), so
+ * the counts include allocator rounding.
+ *
+ * Blocks do not record who allocated them, and memory is often freed on a
+ * different task (a response built in a handler and released by lwIP, a
+ * record handed to the persist task). Per subsystem there are therefore only
+ * allocation counts and bytes, not live bytes. How much is held overall comes
+ * from the allocator's own heap figures.
+ *
+ * HTTP requests are tracked from handleCORSHeaders(), which every route calls,
+ * until server.handleClient() returns. Each path records the bytes it
+ * allocated, the bytes still held afterwards, and how far it shrank the
+ * largest free internal block. The last of these is the fragmentation that
+ * eventually makes a large allocation fail.
+ *
+ * Without the wrappers only the heap and fragmentation figures are reported.
+ */
+class MemoryAccounting {
+private:
+  struct Subsystem {
+    uint32_t allocs;
+    uint32_t failures;         // Allocations that returned null
+    uint64_t allocBytes;
+    uint32_t largestAlloc;
+    uint32_t psramAllocs;      // Allocations that landed in PSRAM
+  };
+
+  struct TaskSlot {
+    void* handle;
+    MemSubsystem current;
+  };
+
+  struct Endpoint {
+    char path[MEM_ENDPOINT_PATH_LENGTH];
+    uint32_t requests;
+    uint32_t allocs;
+    uint64_t allocBytes;
+    int32_t retainedBytes;     // Net bytes still held after the requests, summed
+    int32_t peakBytes;         // Largest net use within one request
+    uint32_t worstBlockDrop;   // Largest shrink of the largest free block in one request
+  };
+
+  Subsystem subsystems[MEM_SUBSYSTEM_COUNT];
+  TaskSlot tasks[MEM_TASK_SLOTS];
+  uint8_t taskCount;
+  Endpoint endpoints[MEM_ENDPOINT_SLOTS];
+  uint8_t endpointCount;
+
+  // Request in progress on the web server's task
+  bool requestActive;
+  void* requestTask;
+  char requestPath[MEM_ENDPOINT_PATH_LENGTH];
+  uint32_t requestAllocs;
+  uint32_t requestAllocBytes;
+  int32_t requestNet;
+  int32_t requestPeak;
+  uint32_t requestLargestBefore;
+  MemSubsystem requestPrevious;
+
+  TaskSlot* findTask(void* handle);
+  static MemSubsystem subsystemForTask(const char* name);
+  static MemSubsystem subsystemForPath(const char* path);
+  Endpoint& endpointFor(const char* path);
+
+public:
+  // No constructor: the malloc wrappers run before static constructors do, so
+  // the instance relies on static zero-initialisation and is never reset
+
+  /**
+   * @brief Charge an allocation; called by the malloc wrappers
+   * @param size Allocated block size, 0 if the allocation failed
+   */
+  void recordAlloc(size_t size, bool psram);
+
+  /**
+   * @brief Charge a free; called by the free and realloc wrappers
+   */
+  void recordFree(size_t size);
+
+  /**
+   * @brief Set the calling task's subsystem
+   * @return The subsystem it replaced
+   */
+  MemSubsystem enter(MemSubsystem subsystem);
+  void leave(MemSubsystem previous) { enter(previous); }
+
+  /**
+   * @brief Start charging an HTTP request to its path; later calls in the same request are ignored
+   */
+  void beginRequest(const char* path);
+
+  /**
+   * @brief Close the request started by beginRequest(), if any
+   */
+  void endRequest();
+
+  static bool isTracking() { return MEM_ACCOUNTING_TRACKING; }
+  static const char* subsystemName(MemSubsystem subsystem);
+
+  /**
+   * @brief Add heap, fragmentation, per-subsystem and per-endpoint figures to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+extern MemoryAccounting memoryAccounting;
+
+/**
+ * @brief Charges the calling task's allocations to a subsystem for its lifetime
+ */
+class MemScope {
+private:
+  MemSubsystem previous;
+
+public:
+  explicit MemScope(MemSubsystem subsystem) : previous(memoryAccounting.enter(subsystem)) {}
+  ~MemScope() { memoryAccounting.leave(previous); }
+};
+
+#define MEM_CONCAT_INNER(a, b) a##b
+#define MEM_CONCAT(a, b) MEM_CONCAT_INNER(a, b)
+
+// Charge the rest of the enclosing block to a subsystem
+#define MEM_SCOPE(subsystem) MemScope MEM_CONCAT(_mem_scope_, __LINE__)(subsystem)
+
+#endif // MEMORY_ACCOUNTING_H
@@ -0,0 +1,306 @@
+#include "patch_sweep.h"
+#include "cie1931.h"
+#include "logging.h"
+#include <float.h>
+#include <math.h>
+
+// Hungarian matrix side: every plateau and every target, padded to square
+#define SWEEP_ASSIGN_SIZE (SWEEP_MAX_PLATEAUS + SWEEP_MAX_TARGETS)
+
+PatchSweep::PatchSweep() {
+  active = false;
+  startMs = 0;
+  lastFrameMs = 0;
+  memset(runSum, 0, sizeof(runSum));
+  runFrames = 0;
+  runStartMs = 0;
+  memset(plateaus, 0, sizeof(plateaus));
+  plateauCount = 0;
+  memset(cost, 0, sizeof(cost));
+  frames = 0;
+  transitions = 0;
+  gaps = 0;
+  merged = 0;
+  overflow = 0;
+  assignPasses = 0;
+  lastAssignUs = 0;
+}
+
+void PatchSweep::start() {
+  active = true;
+  startMs = millis();
+  lastFrameMs = startMs;
+  memset(runSum, 0, sizeof(runSum));
+  runFrames = 0;
+  runStartMs = 0;
+  plateauCount = 0;
+  frames = 0;
+  transitions = 0;
+  gaps = 0;
+  merged = 0;
+  overflow = 0;
+  assignPasses = 0;
+  lastAssignUs = 0;
+  LOG_SENSOR_INFO("Patch sweep started");
+}
+
+bool PatchSweep::addFrame(uint16_t x, uint16_t y, uint16_t z, uint16_t ir1) {
+  if (!active) {
+    return false;
+  }
+  frames++;
+  lastFrameMs = millis();
+  const uint16_t value[4] = {x, y, z, ir1};
+
+  bool committed = false;
+  if (runFrames > 0) {
+    for (uint8_t c = 0; c < 3; c++) {
+      float mean = runSum[c] / runFrames;
+      if (fabsf(value[c] - mean) > max(mean * SWEEP_STABLE_TOLERANCE, (float)SWEEP_STABLE_FLOOR)) {
+        committed = closeRun();
+        break;
+      }
+    }
+  }
+
+  if (runFrames == 0) {
+    runStartMs = lastFrameMs - startMs;
+  }
+  for (uint8_t c = 0; c < 4; c++) {
+    runSum[c] += value[c];
+  }
+  runFrames++;
+  return committed;
+}
+
+void PatchSweep::stop() {
+  if (!active) {
+    return;
+  }
+  closeRun();
+  active = false;
+  LOG_SENSOR_INFO("Patch sweep stopped after %lu ms: %u frames, %u plateaus (%lu transitions, %lu gaps, %lu merged)",
+                  (unsigned long)elapsedMs(), (unsigned)frames, plateauCount, (unsigned long)transitions,
+                  (unsigned long)gaps, (unsigned long)merged);
+}
+
+bool PatchSweep::closeRun() {
+  if (runFrames == 0) {
+    return false;
+  }
+
+  float mean[4];
+  for (uint8_t c = 0; c < 4; c++) {
+    mean[c] = runSum[c] / runFrames;
+  }
+  uint16_t runLength = runFrames;
+  uint32_t runEndMs = lastFrameMs - startMs;
+  memset(runSum, 0, sizeof(runSum));
+  runFrames = 0;
+
+  if (runLength < SWEEP_MIN_PLATEAU_FRAMES) {
+    transitions++;
+    return false;
+  }
+  if (mean[1] < SWEEP_MIN_SIGNAL || mean[0] > SWEEP_SATURATION || mean[1] > SWEEP_SATURATION ||
+      mean[2] > SWEEP_SATURATION) {
+    gaps++;
+    return false;
+  }
+
+  if (plateauCount > 0) {
+    SweepPlateau& last = plateaus[plateauCount - 1];
+    const float previous[3] = {last.x, last.y, last.z};
+    bool same = true;
+    for (uint8_t c = 0; c < 3 && same; c++) {
+      same = fabsf(previous[c] - mean[c]) <= SWEEP_MERGE_TOLERANCE * max(previous[c], mean[c]);
+    }
+    if (same) {
+      float total = last.frames + runLength;
+      last.x = (last.x * last.frames + mean[0] * runLength) / total;
+      last.y = (last.y * last.frames + mean[1] * runLength) / total;
+      last.z = (last.z * last.frames + mean[2] * runLength) / total;
+      last.ir1 = (last.ir1 * last.frames + mean[3] * runLength) / total;
+      last.frames += runLength;
+      last.durationMs = runEndMs - last.startMs;
+      merged++;
+      return true;
+    }
+  }
+
+  if (plateauCount >= SWEEP_MAX_PLATEAUS) {
+    overflow++;
+    return false;
+  }
+
+  SweepPlateau& plateau = plateaus[plateauCount++];
+  plateau.x = mean[0];
+  plateau.y = mean[1];
+  plateau.z = mean[2];
+  plateau.ir1 = mean[3];
+  plateau.frames = runLength;
+  plateau.startMs = runStartMs;
+  plateau.durationMs = runEndMs - runStartMs;
+  plateau.target = -1;
+  plateau.deltaE = 0.0f;
+  memset(plateau.predicted, 0, sizeof(plateau.predicted));
+  LOG_SENSOR_DEBUG("Sweep plateau %u: X:%.0f Y:%.0f Z:%.0f over %u frames", plateauCount, mean[0], mean[1],
+                   mean[2], runLength);
+  return true;
+}
+
+uint8_t PatchSweep::assign(const SweepTarget* targets, uint8_t count, SweepPredictor predict, void* ctx,
+                           bool* changed) {
+  uint32_t startUs = micros();
+  const uint8_t P = plateauCount;
+  const uint8_t R = min(count, (uint8_t)SWEEP_MAX_TARGETS);
+  const uint8_t N = P + R;
+  if (changed) {
+    *changed = false;
+  }
+  if (P == 0 || R == 0) {
+    return 0;
+  }
+
+  CIE_Lab targetLab[SWEEP_MAX_TARGETS];
+  for (uint8_t j = 0; j < R; j++) {
+    targetLab[j] = convertSRGBToLab(targets[j].r, targets[j].g, targets[j].b);
+  }
+  for (uint8_t i = 0; i < P; i++) {
+    predict(plateaus[i], plateaus[i].predicted, ctx);
+    CIE_Lab lab = convertSRGBToLab(plateaus[i].predicted[0], plateaus[i].predicted[1], plateaus[i].predicted[2]);
+    for (uint8_t j = 0; j < R; j++) {
+      cost[i][j] = calculateDeltaE2000(lab, targetLab[j]);
+    }
+  }
+
+  // Hungarian method (shortest augmenting paths with potentials), 1-based.
+  // Rows 1..P are plateaus and columns 1..R targets; a plateau in a padding
+  // column R+1..N stays unassigned at SWEEP_REJECT_DELTA_E, and padding rows
+  // take the targets no plateau claims at no cost.
+  float u[SWEEP_ASSIGN_SIZE + 1];
+  float v[SWEEP_ASSIGN_SIZE + 1];
+  float minv[SWEEP_ASSIGN_SIZE + 1];
+  uint8_t p[SWEEP_ASSIGN_SIZE + 1];
+  uint8_t way[SWEEP_ASSIGN_SIZE + 1];
+  bool used[SWEEP_ASSIGN_SIZE + 1];
+  memset(u, 0, sizeof(u));
+  memset(v, 0, sizeof(v));
+  memset(p, 0, sizeof(p));
+  memset(way, 0, sizeof(way));
+
+  for (uint8_t i = 1; i <= N; i++) {
+    p[0] = i;
+    uint8_t j0 = 0;
+    for (uint8_t j = 0; j <= N; j++) {
+      minv[j] = FLT_MAX;
+      used[j] = false;
+    }
+    do {
+      used[j0] = true;
+      uint8_t i0 = p[j0];
+      uint8_t j1 = 0;
+      float delta = FLT_MAX;
+      for (uint8_t j = 1; j <= N; j++) {
+        if (used[j]) {
+          continue;
+        }
+        float c;
+        if (i0 > P) {
+          c = 0.0f;
+        } else if (j > R) {
+          c = SWEEP_REJECT_DELTA_E;
+        } else {
+          c = cost[i0 - 1][j - 1];
+        }
+        float reduced = c - u[i0] - v[j];
+        if (reduced < minv[j]) {
+          minv[j] = reduced;
+          way[j] = j0;
+        }
+        if (minv[j] < delta) {
+          delta = minv[j];
+          j1 = j;
+        }
+      }
+      for (uint8_t j = 0; j <= N; j++) {
+        if (used[j]) {
+          u[p[j]] += delta;
+          v[j] -= delta;
+        } else {
+          minv[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (p[j0] != 0);
+    do {
+      uint8_t j1 = way[j0];
+      p[j0] = p[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  int8_t assigned[SWEEP_MAX_PLATEAUS];
+  memset(assigned, -1, sizeof(assigned));
+  for (uint8_t j = 1; j <= R; j++) {
+    if (p[j] >= 1 && p[j] <= P) {
+      assigned[p[j] - 1] = j - 1;
+    }
+  }
+
+  uint8_t assignedCount = 0;
+  for (uint8_t i = 0; i < P; i++) {
+    if (changed && plateaus[i].target != assigned[i]) {
+      *changed = true;
+    }
+    plateaus[i].target = assigned[i];
+    plateaus[i].deltaE = assigned[i] >= 0 ? cost[i][assigned[i]] : 0.0f;
+    if (assigned[i] >= 0) {
+      assignedCount++;
+    }
+  }
+
+  assignPasses++;
+  lastAssignUs = micros() - startUs;
+  LOG_SENSOR_INFO("Sweep assignment pass %u: %u of %u plateaus to %u references in %lu us", assignPasses,
+                  assignedCount, P, R, (unsigned long)lastAssignUs);
+  return assignedCount;
+}
+
+void PatchSweep::describe(const SweepTarget* targets, JsonArray out) const {
+  for (uint8_t i = 0; i < plateauCount; i++) {
+    const SweepPlateau& plateau = plateaus[i];
+    JsonObject item = out.add<JsonObject>();
+    item["x"] = plateau.x;
+    item["y"] = plateau.y;
+    item["z"] = plateau.z;
+    item["ir1"] = plateau.ir1;
+    item["frames"] = plateau.frames;
+    item["startMs"] = plateau.startMs;
+    item["durationMs"] = plateau.durationMs;
+    JsonArray predicted = item["predicted"].to<JsonArray>();
+    for (uint8_t c = 0; c < 3; c++) {
+      predicted.add(plateau.predicted[c]);
+    }
+    if (plateau.target >= 0 && targets) {
+      item["target"] = targets[plateau.target].name;
+      item["targetIndex"] = plateau.target;
+      item["deltaE"] = plateau.deltaE;
+    } else {
+      item["target"] = nullptr;
+    }
+  }
+}
+
+void PatchSweep::getStats(JsonObject stats) const {
+  stats["active"] = active;
+  stats["elapsedMs"] = elapsedMs();
+  stats["frames"] = frames;
+  stats["plateaus"] = plateauCount;
+  stats["transitions"] = transitions;
+  stats["gaps"] = gaps;
+  stats["merged"] = merged;
+  stats["overflow"] = overflow;
+  stats["assignPasses"] = assignPasses;
+  stats["lastAssignUs"] = lastAssignUs;
+}
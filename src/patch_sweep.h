@@ -0,0 +1,122 @@
+#ifndef PATCH_SWEEP_H
+#define PATCH_SWEEP_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Reference patch a plateau can be assigned to
+struct SweepTarget {
+  uint8_t r, g, b;
+  const char* name;
+};
+
+/**
+ * @brief A stretch of the sweep where the sensor sat on one patch
+ */
+struct SweepPlateau {
+  float x, y, z, ir1;          // Mean raw counts over the plateau
+  uint16_t frames;             // Conversions averaged
+  uint32_t startMs;            // Offset from the start of the sweep
+  uint32_t durationMs;
+  int8_t target;               // Assigned reference, -1 if none
+  float deltaE;                // CIEDE2000 between the predicted color and the assigned reference
+  uint8_t predicted[3];        // sRGB predicted by the last assignment pass
+};
+
+/**
+ * @brief Predicts a plateau's sRGB with the current color model
+ */
+typedef void (*SweepPredictor)(const SweepPlateau& plateau, uint8_t rgb[3], void* ctx);
+
+/**
+ * @brief Finds the patches of a chart in a continuous stream of sensor frames
+ *
+ * The operator moves the sensor across a chart, pausing briefly on each patch.
+ * Frames are grouped into runs while X, Y and Z stay within
+ * SWEEP_STABLE_TOLERANCE of the run mean; a run of at least
+ * SWEEP_MIN_PLATEAU_FRAMES conversions becomes a plateau. Shorter runs are
+ * the transitions between patches, and runs below SWEEP_MIN_SIGNAL are gaps.
+ * A plateau matching the one before it (the operator paused twice on a patch)
+ * is merged into it.
+ *
+ * assign() then maps plateaus to reference patches in one global step: the
+ * CIEDE2000 between each plateau's predicted color and each reference forms a
+ * cost matrix, padded so a plateau may stay unassigned at
+ * SWEEP_REJECT_DELTA_E, and the Hungarian method picks the assignment with
+ * the lowest total cost. Each reference is used at most once, so a patch the
+ * model predicts poorly still lands on the reference its neighbours leave over.
+ *
+ * Fed and read from the loop task only; not thread-safe.
+ */
+class PatchSweep {
+private:
+  bool active;
+  uint32_t startMs;
+  uint32_t lastFrameMs;
+
+  // Run being grown
+  float runSum[4];
+  uint16_t runFrames;
+  uint32_t runStartMs;
+
+  SweepPlateau plateaus[SWEEP_MAX_PLATEAUS];
+  uint8_t plateauCount;
+  float cost[SWEEP_MAX_PLATEAUS][SWEEP_MAX_TARGETS];
+
+  uint32_t frames;
+  uint32_t transitions;        // Runs too short to be a patch
+  uint32_t gaps;               // Runs too dark or saturated
+  uint32_t merged;
+  uint32_t overflow;           // Plateaus dropped with SWEEP_MAX_PLATEAUS full
+  uint8_t assignPasses;
+  uint32_t lastAssignUs;
+
+  bool closeRun();
+
+public:
+  PatchSweep();
+
+  /**
+   * @brief Forget any previous sweep and start collecting frames
+   */
+  void start();
+
+  /**
+   * @brief Add one fresh conversion
+   * @return true when the frame closed a run that became (or merged into) a plateau
+   */
+  bool addFrame(uint16_t x, uint16_t y, uint16_t z, uint16_t ir1);
+
+  /**
+   * @brief Stop collecting; the open run is closed as if the sensor moved off
+   */
+  void stop();
+
+  bool isActive() const { return active; }
+  uint32_t elapsedMs() const { return startMs ? (active ? millis() : lastFrameMs) - startMs : 0; }
+  uint8_t getPlateauCount() const { return plateauCount; }
+  const SweepPlateau& getPlateau(uint8_t index) const { return plateaus[index]; }
+
+  /**
+   * @brief Assign plateaus to references with the Hungarian method
+   * @param targets At most SWEEP_MAX_TARGETS references
+   * @param predict Color model used for the plateaus
+   * @param changed Set when any plateau's assignment differs from the previous pass
+   * @return Plateaus assigned to a reference
+   */
+  uint8_t assign(const SweepTarget* targets, uint8_t count, SweepPredictor predict, void* ctx,
+                 bool* changed = nullptr);
+
+  /**
+   * @brief Add the plateaus and their assignments to a JSON array
+   */
+  void describe(const SweepTarget* targets, JsonArray out) const;
+
+  /**
+   * @brief Add segmentation and assignment counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // PATCH_SWEEP_H
@@ -0,0 +1,97 @@
+#include "perf_profiler.h"
+
+PerfProfiler perfProfiler;
+
+PerfProfiler::PerfProfiler() {
+  portMUX_INITIALIZE(&mux);
+  memset(regions, 0, sizeof(regions));
+  resetAtMs = 0;
+}
+
+void PerfProfiler::record(PerfRegion region, uint32_t us) {
+  if (region >= PERF_REGION_COUNT) {
+    return;
+  }
+  uint8_t bucket = bucketFor(us);
+  portENTER_CRITICAL(&mux);
+  Region& r = regions[region];
+  if (r.count == 0 || us < r.minUs) {
+    r.minUs = us;
+  }
+  if (us > r.maxUs) {
+    r.maxUs = us;
+  }
+  r.count++;
+  r.totalUs += us;
+  r.histogram[bucket]++;
+  portEXIT_CRITICAL(&mux);
+}
+
+void PerfProfiler::reset() {
+  portENTER_CRITICAL(&mux);
+  memset(regions, 0, sizeof(regions));
+  resetAtMs = millis();
+  portEXIT_CRITICAL(&mux);
+}
+
+uint8_t PerfProfiler::bucketFor(uint32_t us) {
+  uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+  return bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1;
+}
+
+const char* PerfProfiler::regionName(PerfRegion region) {
+  switch (region) {
+    case PERF_SCAN: return "scan";
+    case PERF_I2C_READ: return "i2cRead";
+    case PERF_CONVERSION: return "conversion";
+    case PERF_MATRIX_APPLY: return "matrixApply";
+    case PERF_JSON_SERIALIZE: return "jsonSerialize";
+    case PERF_FLASH_WRITE: return "flashWrite";
+    case PERF_NETWORK: return "network";
+    default: return "unknown";
+  }
+}
+
+void PerfProfiler::getStats(JsonObject stats) const {
+  // Copy under the lock, format outside it
+  Region snapshot[PERF_REGION_COUNT];
+  portENTER_CRITICAL(&mux);
+  memcpy(snapshot, regions, sizeof(snapshot));
+  portEXIT_CRITICAL(&mux);
+
+  stats["sinceResetMs"] = millis() - resetAtMs;
+  stats["enabled"] = (bool)PERF_PROFILING_ENABLED;
+  JsonObject out = stats["regions"].to<JsonObject>();
+  for (uint8_t i = 0; i < PERF_REGION_COUNT; i++) {
+    const Region& r = snapshot[i];
+    JsonObject region = out[regionName((PerfRegion)i)].to<JsonObject>();
+    region["count"] = r.count;
+    if (r.count == 0) {
+      continue;
+    }
+    region["totalUs"] = r.totalUs;
+    region["meanUs"] = (uint32_t)(r.totalUs / r.count);
+    region["minUs"] = r.minUs;
+    region["maxUs"] = r.maxUs;
+
+    // Upper bound of the bucket holding each percentile, capped at the max seen
+    const uint8_t percentiles[3] = {50, 90, 99};
+    const char* const names[3] = {"p50Us", "p90Us", "p99Us"};
+    uint8_t p = 0;
+    uint32_t cumulative = 0;
+    uint8_t last = 0;
+    for (uint8_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+      cumulative += r.histogram[b];
+      while (p < 3 && (uint64_t)cumulative * 100 >= (uint64_t)r.count * percentiles[p]) {
+        region[names[p++]] = min(1UL << b, (unsigned long)r.maxUs);
+      }
+      if (r.histogram[b]) {
+        last = b;
+      }
+    }
+    JsonArray histogram = region["histogram"].to<JsonArray>();
+    for (uint8_t b = 0; b <= last; b++) {
+      histogram.add(r.histogram[b]);
+    }
+  }
+}
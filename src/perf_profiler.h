@@ -0,0 +1,101 @@
+#ifndef PERF_PROFILER_H
+#define PERF_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "config.h"
+
+// Profiled regions; one fixed table slot each
+enum PerfRegion : uint8_t {
+  PERF_SCAN = 0,               // Whole /scan request
+  PERF_I2C_READ,               // TCS3430 channel reads, including any wait inside the read
+  PERF_CONVERSION,             // Raw channels to display RGB
+  PERF_MATRIX_APPLY,           // Matrix calibration conversion
+  PERF_JSON_SERIALIZE,         // Response documents to text
+  PERF_FLASH_WRITE,            // Sample log and NVS writes
+  PERF_NETWORK,                // Paint backend requests
+  PERF_REGION_COUNT
+};
+
+/**
+ * @brief Microsecond timings per region: count, total, min/max and a log2 histogram
+ *
+ * Times come from esp_timer_get_time(), which is monotonic and shared by both
+ * cores (the CPU cycle counter is per core and a task can migrate mid-region).
+ * Bucket 0 holds 0 us and bucket b holds [2^(b-1), 2^b) us, so percentiles
+ * read from the histogram are accurate to a factor of two; the last bucket
+ * also takes everything longer.
+ *
+ * Regions are recorded from any task (the match worker does the network
+ * requests); a spinlock guards the update, which is a few dozen instructions
+ * and never allocates.
+ */
+class PerfProfiler {
+private:
+  struct Region {
+    uint32_t count;
+    uint64_t totalUs;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t histogram[PERF_HISTOGRAM_BUCKETS];
+  };
+
+  Region regions[PERF_REGION_COUNT];
+  uint32_t resetAtMs;
+  mutable portMUX_TYPE mux;
+
+public:
+  PerfProfiler();
+
+  static uint32_t now() { return (uint32_t)esp_timer_get_time(); }
+
+  /**
+   * @brief Add one timing to a region
+   */
+  void record(PerfRegion region, uint32_t us);
+
+  /**
+   * @brief Clear every region
+   */
+  void reset();
+
+  static const char* regionName(PerfRegion region);
+
+  /**
+   * @brief Bucket a duration falls in
+   */
+  static uint8_t bucketFor(uint32_t us);
+
+  /**
+   * @brief Add every region's counters, percentiles and histogram to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+extern PerfProfiler perfProfiler;
+
+/**
+ * @brief Times its own lifetime into a region
+ */
+class PerfScope {
+private:
+  PerfRegion region;
+  uint32_t startUs;
+
+public:
+  explicit PerfScope(PerfRegion region) : region(region), startUs(PerfProfiler::now()) {}
+  ~PerfScope() { perfProfiler.record(region, PerfProfiler::now() - startUs); }
+};
+
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+
+// Profile the rest of the enclosing block
+#if PERF_PROFILING_ENABLED
+#define PERF_SCOPE(region) PerfScope PERF_CONCAT(_perf_scope_, __LINE__)(region)
+#else
+#define PERF_SCOPE(region) do {} while (0)
+#endif
+
+#endif // PERF_PROFILER_H
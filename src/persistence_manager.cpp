@@ -0,0 +1,136 @@
+#include "persistence_manager.h"
+#include "perf_profiler.h"
+#include <esp_system.h>
+
+// The shutdown hook is a plain function pointer, so it needs the instance
+static PersistenceManager* shutdownInstance = nullptr;
+
+PersistenceManager::PersistenceManager() {
+  memset(sinks, 0, sizeof(sinks));
+  sinkCount = 0;
+  task = nullptr;
+  flushLock = xSemaphoreCreateMutex();
+  lastResetBrownout = false;
+}
+
+bool PersistenceManager::begin() {
+  lastResetBrownout = esp_reset_reason() == ESP_RST_BROWNOUT;
+  if (lastResetBrownout) {
+    LOG_STORAGE_ERROR("Last reset was a brownout - changes from the final %ums before it may be lost",
+                      (unsigned)PERSIST_COALESCE_MS);
+  }
+
+  shutdownInstance = this;
+  if (esp_register_shutdown_handler(shutdownHandler) != ESP_OK) {
+    LOG_STORAGE_ERROR("Could not register persistence shutdown handler");
+  }
+
+  if (task == nullptr &&
+      xTaskCreatePinnedToCore(taskMain, "persist", PERSIST_TASK_STACK, this, PERSIST_TASK_PRIORITY,
+                              &task, PERSIST_TASK_CORE) != pdPASS) {
+    task = nullptr;
+    LOG_STORAGE_ERROR("Failed to start persistence task - writes will flush on sync() only");
+    return false;
+  }
+
+  LOG_STORAGE_INFO("Persistence manager started - Sinks:%u Coalesce:%ums",
+                   (unsigned)sinkCount, (unsigned)PERSIST_COALESCE_MS);
+  return true;
+}
+
+int PersistenceManager::registerSink(const char* name, PersistFlushFn flush, void* ctx) {
+  if (sinkCount >= PERSIST_MAX_SINKS) {
+    LOG_STORAGE_ERROR("Persistence sink table full - cannot register %s", name);
+    return -1;
+  }
+  Sink& sink = sinks[sinkCount];
+  sink.name = name;
+  sink.flush = flush;
+  sink.ctx = ctx;
+  sink.dirty = false;
+  return sinkCount++;
+}
+
+void PersistenceManager::markDirty(int sink) {
+  if (sink < 0 || sink >= sinkCount) {
+    return;
+  }
+  sinks[sink].dirty = true;
+  sinks[sink].marks++;
+  if (task) {
+    xTaskNotifyGive(task);
+  }
+}
+
+bool PersistenceManager::flushSink(Sink& sink) {
+  // Clear first so a mark made during the flush triggers another pass
+  sink.dirty = false;
+  unsigned long start = micros();
+  if (!sink.flush(sink.ctx)) {
+    sink.dirty = true;
+    sink.failures++;
+    LOG_STORAGE_ERROR("Persistence flush failed for %s - will retry", sink.name);
+    return false;
+  }
+  sink.lastFlushUs = micros() - start;
+  sink.flushes++;
+  perfProfiler.record(PERF_FLASH_WRITE, sink.lastFlushUs);
+  return true;
+}
+
+bool PersistenceManager::sync() {
+  xSemaphoreTake(flushLock, portMAX_DELAY);
+  bool ok = true;
+  for (uint8_t i = 0; i < sinkCount; i++) {
+    if (sinks[i].dirty && !flushSink(sinks[i])) {
+      ok = false;
+    }
+  }
+  xSemaphoreGive(flushLock);
+  return ok;
+}
+
+bool PersistenceManager::isDirty() const {
+  for (uint8_t i = 0; i < sinkCount; i++) {
+    if (sinks[i].dirty) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PersistenceManager::taskMain(void* arg) {
+  PersistenceManager* self = static_cast<PersistenceManager*>(arg);
+  for (;;) {
+    // Sleep until something is marked dirty, then give the burst time to coalesce
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    vTaskDelay(pdMS_TO_TICKS(PERSIST_COALESCE_MS));
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    if (!self->sync()) {
+      // Retry failed sinks on the next coalescing window
+      xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+    }
+  }
+}
+
+void PersistenceManager::shutdownHandler() {
+  if (shutdownInstance && shutdownInstance->isDirty()) {
+    shutdownInstance->sync();
+  }
+}
+
+void PersistenceManager::getStats(JsonObject stats) const {
+  stats["coalesceMs"] = PERSIST_COALESCE_MS;
+  stats["taskRunning"] = task != nullptr;
+  stats["lastResetBrownout"] = lastResetBrownout;
+  JsonObject sinkStats = stats["sinks"].to<JsonObject>();
+  for (uint8_t i = 0; i < sinkCount; i++) {
+    JsonObject s = sinkStats[sinks[i].name].to<JsonObject>();
+    s["dirty"] = sinks[i].dirty;
+    s["marks"] = sinks[i].marks;
+    s["flushes"] = sinks[i].flushes;
+    s["failures"] = sinks[i].failures;
+    s["lastFlushUs"] = sinks[i].lastFlushUs;
+  }
+}
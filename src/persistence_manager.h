@@ -0,0 +1,86 @@
+#ifndef PERSISTENCE_MANAGER_H
+#define PERSISTENCE_MANAGER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+
+/**
+ * @brief Deferred, coalescing persistence for flash-backed state
+ *
+ * Subsystems register a flush callback and mark themselves dirty after
+ * changing in-RAM state. A background task waits PERSIST_COALESCE_MS after
+ * the first mark, so bursts of changes reach flash in a single flush, and
+ * HTTP handlers never wait on flash. Everything dirty is also flushed from
+ * the ESP-IDF shutdown hook (ESP.restart()/esp_restart()), and sync() gives
+ * callers such as calibration commits an explicit durability barrier.
+ *
+ * A brownout reset cannot run any code, so at most PERSIST_COALESCE_MS of
+ * changes can be lost there; begin() reports when that has happened.
+ */
+
+// Flush callback; return false to stay dirty and retry on the next pass
+typedef bool (*PersistFlushFn)(void* ctx);
+
+class PersistenceManager {
+private:
+  struct Sink {
+    const char* name;
+    PersistFlushFn flush;
+    void* ctx;
+    volatile bool dirty;
+    uint32_t marks;         // markDirty() calls
+    uint32_t flushes;       // Successful flushes (marks - flushes = writes coalesced away)
+    uint32_t failures;
+    uint32_t lastFlushUs;
+  };
+
+  Sink sinks[PERSIST_MAX_SINKS];
+  uint8_t sinkCount;
+  TaskHandle_t task;
+  SemaphoreHandle_t flushLock;
+  bool lastResetBrownout;
+
+  static void taskMain(void* arg);
+  static void shutdownHandler();
+  bool flushSink(Sink& sink);
+
+public:
+  PersistenceManager();
+
+  /**
+   * @brief Start the flush task and hook the shutdown path
+   * @return true if the task is running
+   */
+  bool begin();
+
+  /**
+   * @brief Register a flush target
+   * @param name Short name used in logs and /status
+   * @param flush Callback that writes the subsystem's dirty state
+   * @param ctx Passed to the callback
+   * @return Sink handle, or -1 if the table is full
+   */
+  int registerSink(const char* name, PersistFlushFn flush, void* ctx);
+
+  /**
+   * @brief Mark a sink dirty; safe from any task, never touches flash
+   */
+  void markDirty(int sink);
+
+  /**
+   * @brief Flush every dirty sink on the calling task before returning
+   * @return true if nothing is left dirty
+   */
+  bool sync();
+
+  bool isDirty() const;
+
+  /**
+   * @brief Add per-sink counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // PERSISTENCE_MANAGER_H
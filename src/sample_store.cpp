@@ -0,0 +1,1488 @@
+#include "sample_store.h"
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <esp_task_wdt.h>
+#include <algorithm>
+
+static const size_t RECORD_SIZE = sizeof(SampleRecord);
+static const uint32_t SLOT_DELETED = 0xFFFFFFFF;
+static const uint32_t SLOT_PENDING = 0xFFFFFFFE;   // Live copy is still in the pending buffer
+
+// Version 1 layout, read only to upgrade old logs and legacy Preferences samples
+struct LegacyColorSample {
+  uint8_t r, g, b;
+  uint32_t timestamp;
+  char paintName[SAMPLE_NAME_LENGTH];
+  char paintCode[SAMPLE_CODE_LENGTH];
+  float lrv;
+};
+
+struct __attribute__((packed)) LegacySampleRecord {
+  uint16_t magic;
+  uint8_t type;
+  uint8_t version;
+  uint32_t id;
+  LegacyColorSample sample;
+  uint32_t crc;
+};
+
+static void fromLegacy(const LegacyColorSample& legacy, ColorSample& sample) {
+  memset(&sample, 0, sizeof(sample));
+  sample.r = legacy.r;
+  sample.g = legacy.g;
+  sample.b = legacy.b;
+  sample.timestamp = legacy.timestamp;
+  memcpy(sample.paintName, legacy.paintName, SAMPLE_NAME_LENGTH);
+  memcpy(sample.paintCode, legacy.paintCode, SAMPLE_CODE_LENGTH);
+  sample.lrv = legacy.lrv;
+}
+
+// Calibration version of a sample's cached color (0 = nothing to recompute from)
+static uint32_t cachedVersion(const ColorSample& sample) {
+  return sample.raw.readings ? sample.raw.calVersion : 0;
+}
+
+// Largest CIEDE2000 lightness weight SL (reached at L* = 0 or 100)
+static const float DE2000_SL_MAX = 1.75f;
+
+static SampleLabKey makeLabKey(uint32_t id, const ColorSample& sample) {
+  CIE_Lab lab = convertSRGBToLab(sample.r, sample.g, sample.b);
+  SampleLabKey key = {id, (int16_t)lroundf(lab.L * 100.0f), (int16_t)lroundf(lab.a * 100.0f),
+                      (int16_t)lroundf(lab.b * 100.0f)};
+  return key;
+}
+
+static bool labKeyLess(const SampleLabKey& lhs, const SampleLabKey& rhs) {
+  return lhs.L < rhs.L || (lhs.L == rhs.L && lhs.id < rhs.id);
+}
+
+// Holds the (recursive) store lock for the current scope
+class StoreLock {
+public:
+  explicit StoreLock(SemaphoreHandle_t handle) : handle(handle) { xSemaphoreTakeRecursive(handle, portMAX_DELAY); }
+  ~StoreLock() { xSemaphoreGiveRecursive(handle); }
+
+private:
+  SemaphoreHandle_t handle;
+};
+
+SampleStore::SampleStore(const char* path, const char* tmpPath) {
+  logPath = path;
+  compactPath = tmpPath;
+  nextId = 1;
+  idPrefs = nullptr;
+  idReserved = 0;
+  slotCount = 0;
+  deadSlots = 0;
+  corruptSlots = 0;
+  freeBytes = 0;
+  initialized = false;
+  compacting = false;
+  compactCursor = 0;
+  compactions = 0;
+  logTorn = false;
+  flushes = 0;
+  flushedRecords = 0;
+  coalescedWrites = 0;
+  lastFlushUs = 0;
+  colorModel = nullptr;
+  colorModelCtx = nullptr;
+  colorVersion = 0;
+  recomputeCursor = 0;
+  recomputed = 0;
+  lock = xSemaphoreCreateRecursiveMutex();
+}
+
+SampleStore::~SampleStore() {
+  end();
+  vSemaphoreDelete(lock);
+}
+
+// ============================================================================
+// RECORD HELPERS
+// ============================================================================
+
+void SampleStore::sealRecord(SampleRecord& record) {
+  record.crc = esp_rom_crc32_le(0, (const uint8_t*)&record, RECORD_SIZE - sizeof(record.crc));
+}
+
+bool SampleStore::validRecord(const SampleRecord& record) {
+  if (record.magic != SAMPLE_RECORD_MAGIC || record.version != SAMPLE_RECORD_VERSION) {
+    return false;
+  }
+  if (record.type != SAMPLE_RECORD_DATA && record.type != SAMPLE_RECORD_TOMBSTONE) {
+    return false;
+  }
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&record, RECORD_SIZE - sizeof(record.crc));
+  return crc == record.crc;
+}
+
+bool SampleStore::readSlot(File& file, uint32_t slot, SampleRecord& record) {
+  if (!file.seek((size_t)slot * RECORD_SIZE, SeekSet)) {
+    return false;
+  }
+  if (file.read((uint8_t*)&record, RECORD_SIZE) != RECORD_SIZE) {
+    return false;
+  }
+  return validRecord(record);
+}
+
+bool SampleStore::readEntry(File& file, const SampleIndexEntry& entry, SampleRecord& record) {
+  if (entry.slot != SLOT_PENDING) {
+    return readSlot(file, entry.slot, record);
+  }
+  int32_t p = findPending(entry.id);
+  if (p < 0) {
+    return false;
+  }
+  record = pending[p].record;
+  return true;
+}
+
+void SampleStore::refreshColor(ColorSample& sample) const {
+  if (!colorModel || !sample.raw.readings || sample.raw.calVersion == colorVersion) {
+    return;
+  }
+  uint8_t rgb[1][3];
+  colorModel(&sample.raw, 1, rgb, colorModelCtx);
+  sample.r = rgb[0][0];
+  sample.g = rgb[0][1];
+  sample.b = rgb[0][2];
+  sample.raw.calVersion = colorVersion;
+}
+
+bool SampleStore::isStale(const SampleIndexEntry& entry) const {
+  return colorModel && entry.calVersion != 0 && entry.calVersion != colorVersion;
+}
+
+int32_t SampleStore::findPending(uint32_t id) const {
+  // The buffer is small and newest entries are most likely to be hit again
+  for (int32_t i = (int32_t)pending.size() - 1; i >= 0; i--) {
+    if (pending[i].record.id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int32_t SampleStore::findPosition(uint32_t id) const {
+  // Index is ordered by id because ids are handed out monotonically
+  size_t lo = 0;
+  size_t hi = index.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index[mid].id < id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < index.size() && index[lo].id == id) {
+    return (int32_t)lo;
+  }
+  return -1;
+}
+
+size_t SampleStore::count() const {
+  StoreLock guard(lock);
+  return index.size();
+}
+
+size_t SampleStore::pendingCount() const {
+  StoreLock guard(lock);
+  return pending.size();
+}
+
+int32_t SampleStore::positionOf(uint32_t id) const {
+  StoreLock guard(lock);
+  return findPosition(id);
+}
+
+// First position with an id above the given one; caller holds the lock
+size_t SampleStore::positionAfter(uint32_t id) const {
+  size_t lo = 0;
+  size_t hi = index.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index[mid].id <= id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+uint32_t SampleStore::idAt(size_t position) const {
+  StoreLock guard(lock);
+  return position < index.size() ? index[position].id : 0;
+}
+
+void SampleStore::refreshFreeBytes() {
+  size_t total = LittleFS.totalBytes();
+  size_t used = LittleFS.usedBytes();
+  freeBytes = total > used ? total - used : 0;
+  // Queued records already hold their share of the free space
+  size_t reserved = pending.size() * RECORD_SIZE;
+  freeBytes = freeBytes > reserved ? freeBytes - reserved : 0;
+}
+
+// ============================================================================
+// LIFECYCLE
+// ============================================================================
+
+bool SampleStore::begin(Preferences* prefs) {
+  LOG_PERF_START();
+  StoreLock guard(lock);
+  end();
+  idPrefs = prefs;
+  idReserved = 0;
+
+  index.clear();
+  labIndex.clear();
+  nextId = 1;
+  slotCount = 0;
+  deadSlots = 0;
+  corruptSlots = 0;
+  logTorn = false;
+
+  // A scratch file next to an intact log means compaction was interrupted before
+  // the rename; the log is still authoritative. Without a log the rename itself
+  // was interrupted and the scratch file is the complete copy.
+  if (LittleFS.exists(compactPath)) {
+    if (LittleFS.exists(logPath)) {
+      LOG_STORAGE_INFO("Discarding interrupted sample log compaction");
+      LittleFS.remove(compactPath);
+    } else {
+      LOG_STORAGE_INFO("Completing interrupted sample log compaction");
+      LittleFS.rename(compactPath, logPath);
+    }
+  }
+
+  if (!upgradeLog()) {
+    return false;
+  }
+
+  bool tornTail = false;
+  if (!rebuildIndex(tornTail)) {
+    return false;
+  }
+
+  refreshFreeBytes();
+  if (!openAppend()) {
+    return false;
+  }
+  initialized = true;
+
+  // Appending after a torn record would misalign every later slot, so rewrite first
+  if (tornTail) {
+    LOG_STORAGE_ERROR("Sample log has a torn tail record - compacting before use");
+    compactNow();
+  }
+
+  LOG_STORAGE_INFO("Sample store ready - Samples:%u Records:%u Dead:%u Corrupt:%u Free:%u bytes",
+                   (unsigned)index.size(), slotCount, deadSlots, corruptSlots, (unsigned)freeBytes);
+  LOG_PERF_END("Sample store index rebuild");
+  return true;
+}
+
+void SampleStore::end() {
+  StoreLock guard(lock);
+  if (initialized) {
+    flushLocked();
+  }
+  pending.clear();
+  if (compacting) {
+    abortCompaction("store closed");
+  }
+  if (appendFile) {
+    appendFile.close();
+  }
+  initialized = false;
+}
+
+bool SampleStore::openAppend() {
+  appendFile = LittleFS.open(logPath, "a");
+  if (!appendFile) {
+    LOG_STORAGE_ERROR("Failed to open sample log %s for append", logPath);
+    return false;
+  }
+  return true;
+}
+
+bool SampleStore::upgradeLog() {
+  File file = LittleFS.open(logPath, "r");
+  if (!file) {
+    return true;
+  }
+  SampleRecord head;
+  bool legacy = file.read((uint8_t*)&head, 4) == 4 && head.magic == SAMPLE_RECORD_MAGIC && head.version == 1;
+  if (!legacy) {
+    file.close();
+    return true;
+  }
+
+  // Rewrite into the scratch file and rename, so an interrupted upgrade leaves
+  // the v1 log in place (begin() discards the scratch file and retries)
+  LOG_PERF_START();
+  LOG_STORAGE_INFO("Upgrading sample log %s from record v1 to v%u", logPath, SAMPLE_RECORD_VERSION);
+  File out = LittleFS.open(compactPath, "w");
+  if (!out) {
+    file.close();
+    LOG_STORAGE_ERROR("Failed to open %s for sample log upgrade", compactPath);
+    return false;
+  }
+
+  file.seek(0, SeekSet);
+  LegacySampleRecord old;
+  SampleRecord record;
+  uint32_t converted = 0;
+  uint32_t skipped = 0;
+  bool ok = true;
+  while (file.read((uint8_t*)&old, sizeof(old)) == sizeof(old)) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&old, sizeof(old) - sizeof(old.crc));
+    if (old.magic != SAMPLE_RECORD_MAGIC || old.version != 1 || crc != old.crc) {
+      skipped++;
+      continue;
+    }
+    memset(&record, 0, sizeof(record));
+    record.magic = SAMPLE_RECORD_MAGIC;
+    record.type = old.type;
+    record.version = SAMPLE_RECORD_VERSION;
+    record.id = old.id;
+    if (old.type == SAMPLE_RECORD_DATA) {
+      ColorSample sample;
+      fromLegacy(old.sample, sample);
+      record.sample = sample;
+    }
+    sealRecord(record);
+    if (out.write((const uint8_t*)&record, RECORD_SIZE) != RECORD_SIZE) {
+      ok = false;
+      break;
+    }
+    if ((++converted & 0x3F) == 0) {
+      esp_task_wdt_reset();
+    }
+  }
+  file.close();
+  out.close();
+
+  // Keep the v1 log untouched if the copy is incomplete; its records would
+  // otherwise read as corrupt and be dropped
+  if (!ok || !LittleFS.rename(compactPath, logPath)) {
+    LittleFS.remove(compactPath);
+    LOG_STORAGE_ERROR("Sample log upgrade failed after %u records - store disabled", converted);
+    return false;
+  }
+  LOG_STORAGE_INFO("Sample log upgraded - Records:%u Skipped:%u", converted, skipped);
+  LOG_PERF_END("Sample log upgrade");
+  return true;
+}
+
+bool SampleStore::rebuildIndex(bool& tornTail) {
+  tornTail = false;
+  if (!LittleFS.exists(logPath)) {
+    LOG_STORAGE_INFO("No sample log at %s - starting empty", logPath);
+    return true;
+  }
+
+  File file = LittleFS.open(logPath, "r");
+  if (!file) {
+    LOG_STORAGE_ERROR("Failed to open sample log %s", logPath);
+    return false;
+  }
+
+  size_t fileSize = file.size();
+  slotCount = fileSize / RECORD_SIZE;
+  tornTail = (fileSize % RECORD_SIZE) != 0;
+  index.reserve(slotCount);
+  labIndex.reserve(slotCount);
+
+  SampleRecord* batch = new SampleRecord[SAMPLE_STORE_SCAN_BATCH];
+  uint32_t maxId = 0;
+  size_t deleted = 0;
+  uint32_t slot = 0;
+
+  while (slot < slotCount) {
+    uint32_t wanted = min((uint32_t)SAMPLE_STORE_SCAN_BATCH, slotCount - slot);
+    size_t got = file.read((uint8_t*)batch, wanted * RECORD_SIZE) / RECORD_SIZE;
+    if (got < wanted) {
+      slotCount = slot + got;
+      tornTail = true;
+    }
+
+    for (size_t i = 0; i < got; i++, slot++) {
+      const SampleRecord& record = batch[i];
+      if (!validRecord(record)) {
+        corruptSlots++;
+        deadSlots++;
+        continue;
+      }
+      if (record.id > maxId) {
+        maxId = record.id;
+      }
+
+      if (record.type == SAMPLE_RECORD_DATA) {
+        // labIndex stays parallel to index until it is sorted below
+        SampleIndexEntry entry = {record.id, slot, record.sample.timestamp, hashCode(record.sample.paintCode),
+                                  cachedVersion(record.sample)};
+        if (index.empty() || record.id > index.back().id) {
+          index.push_back(entry);
+          labIndex.push_back(makeLabKey(record.id, record.sample));
+          continue;
+        }
+        int32_t pos = findPosition(record.id);
+        if (pos >= 0 && index[pos].slot != SLOT_DELETED) {
+          index[pos] = entry;  // Newer copy supersedes the old one
+          labIndex[pos] = makeLabKey(record.id, record.sample);
+        }
+        deadSlots++;
+      } else {
+        int32_t pos = findPosition(record.id);
+        if (pos >= 0 && index[pos].slot != SLOT_DELETED) {
+          index[pos].slot = SLOT_DELETED;
+          deleted++;
+          deadSlots += 2;  // Tombstone plus the record it kills
+        } else {
+          deadSlots++;
+        }
+      }
+    }
+
+    esp_task_wdt_reset();
+    if (got < wanted) {
+      break;
+    }
+  }
+
+  delete[] batch;
+  file.close();
+
+  // Drop tombstoned entries in one pass instead of erasing per tombstone
+  if (deleted > 0) {
+    size_t out = 0;
+    for (size_t i = 0; i < index.size(); i++) {
+      if (index[i].slot != SLOT_DELETED) {
+        labIndex[out] = labIndex[i];
+        index[out++] = index[i];
+      }
+    }
+    index.resize(out);
+    labIndex.resize(out);
+  }
+  labSort();
+  nextId = maxId + 1;
+
+  // Compaction drops deleted ids from the log, so the log alone can lead to reuse
+  if (idPrefs) {
+    idReserved = idPrefs->getULong(PREF_SAMPLE_ID_HIGH, 0);
+    if (idReserved > nextId) {
+      nextId = idReserved;
+    }
+  }
+  return true;
+}
+
+// Extend the NVS reservation before issuing an id at or above it (lock held)
+bool SampleStore::reserveId() {
+  if (!idPrefs || nextId < idReserved) {
+    return true;
+  }
+  uint32_t high = nextId + SAMPLE_STORE_ID_RESERVE;
+  if (idPrefs->putULong(PREF_SAMPLE_ID_HIGH, high) != sizeof(uint32_t)) {
+    LOG_STORAGE_ERROR("Failed to reserve sample ids up to %u", high);
+    return false;
+  }
+  idReserved = high;
+  return true;
+}
+
+// ============================================================================
+// MUTATIONS
+// ============================================================================
+
+bool SampleStore::ensureCapacity() {
+  if (freeBytes >= SAMPLE_STORE_RESERVE_BYTES + RECORD_SIZE) {
+    return true;
+  }
+  if (deadSlots > 0) {
+    LOG_STORAGE_INFO("Sample store low on flash (%u bytes) - compacting", (unsigned)freeBytes);
+    compactNow();
+    if (freeBytes >= SAMPLE_STORE_RESERVE_BYTES + RECORD_SIZE) {
+      return true;
+    }
+  }
+  LOG_STORAGE_ERROR("Sample store full - Free:%u Reserve:%u Samples:%u",
+                    (unsigned)freeBytes, (unsigned)SAMPLE_STORE_RESERVE_BYTES, (unsigned)index.size());
+  return false;
+}
+
+bool SampleStore::queueRecord(uint8_t type, uint32_t id, const ColorSample* sample, bool supersedes) {
+  // Bound RAM and the loss window if the flush task falls behind
+  if (pending.size() >= SAMPLE_STORE_PENDING_MAX && !flushLocked()) {
+    return false;
+  }
+
+  SamplePendingRecord entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.record.magic = SAMPLE_RECORD_MAGIC;
+  entry.record.type = type;
+  entry.record.version = SAMPLE_RECORD_VERSION;
+  entry.record.id = id;
+  if (sample) {
+    entry.record.sample = *sample;
+  }
+  entry.supersedes = supersedes;
+  pending.push_back(entry);
+  freeBytes = freeBytes > RECORD_SIZE ? freeBytes - RECORD_SIZE : 0;
+  return true;
+}
+
+bool SampleStore::flushLocked() {
+  if (pending.empty()) {
+    return true;
+  }
+  // Appending after a torn record would misalign every later slot
+  if (logTorn) {
+    return false;
+  }
+  if (!appendFile && !openAppend()) {
+    return false;
+  }
+
+  unsigned long start = micros();
+  for (size_t i = 0; i < pending.size(); i++) {
+    sealRecord(pending[i].record);
+  }
+
+  // Pending entries carry a flag beside each record, so records are staged
+  // into contiguous batches and each batch goes out in a single write
+  SampleRecord batch[SAMPLE_STORE_FLUSH_BATCH];
+  size_t done = 0;
+  size_t torn = 0;
+  while (done < pending.size()) {
+    size_t n = min((size_t)SAMPLE_STORE_FLUSH_BATCH, pending.size() - done);
+    for (size_t i = 0; i < n; i++) {
+      batch[i] = pending[done + i].record;
+    }
+    size_t written = appendFile.write((const uint8_t*)batch, n * RECORD_SIZE);
+    size_t whole = written / RECORD_SIZE;
+    torn = written % RECORD_SIZE;
+
+    for (size_t i = 0; i < whole; i++) {
+      const SamplePendingRecord& entry = pending[done + i];
+      if (entry.record.type == SAMPLE_RECORD_DATA) {
+        int32_t pos = findPosition(entry.record.id);
+        if (pos >= 0) {
+          index[pos].slot = slotCount;
+        }
+        if (entry.supersedes) {
+          deadSlots++;
+        }
+      } else {
+        deadSlots += 2;  // Tombstone plus the record it kills
+      }
+      slotCount++;
+    }
+    done += whole;
+    if (whole < n) {
+      break;
+    }
+  }
+  appendFile.flush();
+  pending.erase(pending.begin(), pending.begin() + done);
+
+  flushes++;
+  flushedRecords += done;
+  lastFlushUs = micros() - start;
+
+  if (!pending.empty()) {
+    LOG_STORAGE_ERROR("Sample log flush stopped after %u records - %u still queued",
+                      (unsigned)done, (unsigned)pending.size());
+    if (torn > 0) {
+      // Partial record: rewrite the log from the index so slots stay aligned
+      slotCount++;
+      deadSlots++;
+      logTorn = true;
+      compactNow();
+    }
+    return false;
+  }
+  LOG_STORAGE_DEBUG("Sample log flushed %u records in %luus", (unsigned)done, (unsigned long)lastFlushUs);
+  return true;
+}
+
+bool SampleStore::flush() {
+  StoreLock guard(lock);
+  return initialized && flushLocked();
+}
+
+bool SampleStore::append(const ColorSample& sample, uint32_t& outId) {
+  StoreLock guard(lock);
+  if (!initialized || !ensureCapacity() || !reserveId()) {
+    return false;
+  }
+
+  uint32_t id = nextId;
+  if (!queueRecord(SAMPLE_RECORD_DATA, id, &sample, false)) {
+    return false;
+  }
+
+  nextId++;
+  index.push_back({id, SLOT_PENDING, sample.timestamp, hashCode(sample.paintCode), cachedVersion(sample)});
+  labInsert(id, sample);
+  outId = id;
+  LOG_STORAGE_DEBUG("Sample %u queued for append", id);
+  return true;
+}
+
+bool SampleStore::update(uint32_t id, const ColorSample& sample) {
+  StoreLock guard(lock);
+  if (!initialized) {
+    return false;
+  }
+  if (findPosition(id) < 0) {
+    LOG_STORAGE_ERROR("Cannot update unknown sample %u", id);
+    return false;
+  }
+
+  // A queued copy is rewritten in place and costs no extra record
+  int32_t p = findPending(id);
+  if (p >= 0 && pending[p].record.type == SAMPLE_RECORD_DATA) {
+    pending[p].record.sample = sample;
+    coalescedWrites++;
+  } else {
+    // Look the position up again afterwards since compaction may drop entries
+    if (!ensureCapacity()) {
+      return false;
+    }
+    int32_t pos = findPosition(id);
+    if (pos < 0) {
+      return false;
+    }
+    if (compacting && (size_t)pos < compactCursor) {
+      abortCompaction("copied sample updated");
+    }
+    if (!queueRecord(SAMPLE_RECORD_DATA, id, &sample, true)) {
+      return false;
+    }
+  }
+
+  int32_t pos = findPosition(id);
+  index[pos].slot = SLOT_PENDING;
+  index[pos].timestamp = sample.timestamp;
+  index[pos].codeHash = hashCode(sample.paintCode);
+  index[pos].calVersion = cachedVersion(sample);
+  labRemove(id);
+  labInsert(id, sample);
+  return true;
+}
+
+bool SampleStore::remove(uint32_t id) {
+  StoreLock guard(lock);
+  if (!initialized) {
+    return false;
+  }
+  int32_t pos = findPosition(id);
+  if (pos < 0) {
+    return false;
+  }
+
+  int32_t p = findPending(id);
+  if (p >= 0 && !pending[p].supersedes) {
+    // Never reached flash: dropping the queued insert is the whole delete
+    pending.erase(pending.begin() + p);
+    freeBytes += RECORD_SIZE;
+    coalescedWrites++;
+  } else if (p >= 0) {
+    // Queued update of a logged sample becomes its tombstone
+    pending[p].record.type = SAMPLE_RECORD_TOMBSTONE;
+    memset(&pending[p].record.sample, 0, sizeof(ColorSample));
+    coalescedWrites++;
+  } else {
+    // Deletes must work on a full store, so only the record itself has to fit
+    if (freeBytes < RECORD_SIZE) {
+      LOG_STORAGE_ERROR("No flash left for tombstone of sample %u", id);
+      return false;
+    }
+    if (compacting && (size_t)pos < compactCursor) {
+      abortCompaction("copied sample deleted");
+    }
+    if (!queueRecord(SAMPLE_RECORD_TOMBSTONE, id, nullptr, true)) {
+      return false;
+    }
+    pos = findPosition(id);
+    if (pos < 0) {
+      return true;
+    }
+  }
+
+  index.erase(index.begin() + pos);
+  labRemove(id);
+  return true;
+}
+
+bool SampleStore::clear() {
+  StoreLock guard(lock);
+  if (compacting) {
+    abortCompaction("store cleared");
+  }
+  if (appendFile) {
+    appendFile.close();
+  }
+  LittleFS.remove(logPath);
+
+  // Keep nextId so ids held by in-flight requests never alias new samples
+  pending.clear();
+  index.clear();
+  index.shrink_to_fit();
+  labIndex.clear();
+  labIndex.shrink_to_fit();
+  slotCount = 0;
+  deadSlots = 0;
+  corruptSlots = 0;
+  logTorn = false;
+  refreshFreeBytes();
+  return openAppend();
+}
+
+// ============================================================================
+// READS
+// ============================================================================
+
+bool SampleStore::readAt(size_t position, ColorSample& sample, uint32_t* id) {
+  StoreLock guard(lock);
+  if (position >= index.size()) {
+    return false;
+  }
+  File file = LittleFS.open(logPath, "r");
+  if (!file) {
+    return false;
+  }
+  SampleRecord record;
+  bool ok = readEntry(file, index[position], record);
+  file.close();
+  if (!ok) {
+    LOG_STORAGE_ERROR("Sample %u unreadable at slot %u", index[position].id, index[position].slot);
+    return false;
+  }
+  sample = record.sample;
+  refreshColor(sample);
+  if (id) {
+    *id = record.id;
+  }
+  return true;
+}
+
+bool SampleStore::readById(uint32_t id, ColorSample& sample) {
+  StoreLock guard(lock);
+  int32_t pos = findPosition(id);
+  return pos >= 0 && readAt((size_t)pos, sample);
+}
+
+// Reads the listed samples under the lock with their colors refreshed; ids
+// deleted since they were listed are left out
+void SampleStore::readBatch(const uint32_t* ids, size_t count, std::vector<VisitRecord>& records) {
+  records.clear();
+  StoreLock guard(lock);
+  File file = LittleFS.open(logPath, "r");
+  if (!file) {
+    return;
+  }
+  SampleRecord record;
+  for (size_t i = 0; i < count; i++) {
+    int32_t pos = findPosition(ids[i]);
+    if (pos < 0) {
+      continue;
+    }
+    if (!readEntry(file, index[pos], record)) {
+      LOG_STORAGE_ERROR("Sample %u unreadable at slot %u", index[pos].id, index[pos].slot);
+      continue;
+    }
+    VisitRecord visit;
+    visit.id = record.id;
+    visit.sample = record.sample;
+    refreshColor(visit.sample);
+    records.push_back(visit);
+  }
+  file.close();
+}
+
+size_t SampleStore::forEach(size_t start, size_t limit,
+                            bool (*visitor)(uint32_t id, const ColorSample& sample, void* ctx), void* ctx) {
+  uint32_t ids[SAMPLE_STORE_VISIT_BATCH];
+  std::vector<VisitRecord> records;
+  records.reserve(SAMPLE_STORE_VISIT_BATCH);
+  size_t visited = 0;
+  size_t consumed = 0;
+  uint32_t lastId = 0;
+
+  // Positions shift when samples are deleted between batches, so each batch
+  // resumes after the last id listed rather than at a position
+  while (consumed < limit) {
+    size_t count = 0;
+    {
+      StoreLock guard(lock);
+      size_t pos = consumed == 0 ? start : positionAfter(lastId);
+      while (pos < index.size() && count < SAMPLE_STORE_VISIT_BATCH && consumed < limit) {
+        ids[count++] = index[pos++].id;
+        consumed++;
+      }
+    }
+    if (count == 0) {
+      break;
+    }
+    lastId = ids[count - 1];
+
+    readBatch(ids, count, records);
+    for (const VisitRecord& record : records) {
+      visited++;
+      if (!visitor(record.id, record.sample, ctx)) {
+        return visited;
+      }
+    }
+  }
+  return visited;
+}
+
+uint32_t SampleStore::hashCode(const char* code) {
+  if (!code || !code[0]) {
+    return 0;
+  }
+  uint32_t hash = 2166136261u;
+  for (const char* c = code; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return hash ? hash : 1;
+}
+
+bool SampleStore::matchesQuery(const SampleIndexEntry& entry, const SampleQuery& query, uint32_t codeHash) const {
+  if (query.since && entry.timestamp < query.since) {
+    return false;
+  }
+  if (query.code && entry.codeHash != codeHash) {
+    return false;
+  }
+  return true;
+}
+
+// Totals and the ids of one page, from the index alone
+SampleQueryResult SampleStore::selectPage(const SampleQuery& query, uint32_t codeHash, std::vector<uint32_t>& page) {
+  StoreLock guard(lock);
+  SampleQueryResult result = {0, 0, 0, false};
+
+  // Filters are evaluated on the in-RAM index, so the total costs no flash reads
+  if (query.since || query.code) {
+    for (size_t i = 0; i < index.size(); i++) {
+      if (matchesQuery(index[i], query, codeHash)) {
+        result.total++;
+      }
+    }
+  } else {
+    result.total = index.size();
+  }
+  if (index.empty() || query.limit == 0) {
+    return result;
+  }
+
+  // Resolve the starting position from the cursor (exclusive) by binary search
+  int32_t pos;
+  int32_t step = query.newestFirst ? -1 : 1;
+  if (query.cursor == 0) {
+    pos = query.newestFirst ? (int32_t)index.size() - 1 : 0;
+  } else {
+    size_t lo = 0;
+    size_t hi = index.size();
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (index[mid].id < query.cursor) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    // lo is the first entry with id >= cursor
+    if (query.newestFirst) {
+      pos = (int32_t)lo - 1;
+    } else {
+      pos = (lo < index.size() && index[lo].id == query.cursor) ? (int32_t)lo + 1 : (int32_t)lo;
+    }
+  }
+
+  uint32_t skipped = 0;
+  for (; pos >= 0 && pos < (int32_t)index.size(); pos += step) {
+    if (!matchesQuery(index[pos], query, codeHash)) {
+      continue;
+    }
+    if (skipped < query.offset) {
+      skipped++;
+      continue;
+    }
+    if (page.size() == query.limit) {
+      result.hasMore = true;
+      break;
+    }
+    page.push_back(index[pos].id);
+  }
+  if (result.hasMore) {
+    result.nextCursor = page.back();
+  }
+  return result;
+}
+
+SampleQueryResult SampleStore::query(const SampleQuery& query,
+                                     bool (*visitor)(uint32_t id, const ColorSample& sample, void* ctx), void* ctx) {
+  uint32_t codeHash = query.code ? hashCode(query.code) : 0;
+  std::vector<uint32_t> page;
+  page.reserve(query.limit);
+  SampleQueryResult result = selectPage(query, codeHash, page);
+
+  // Records are read a batch at a time under the lock; the visitor runs outside it
+  std::vector<VisitRecord> records;
+  records.reserve(SAMPLE_STORE_VISIT_BATCH);
+  for (size_t first = 0; first < page.size(); first += SAMPLE_STORE_VISIT_BATCH) {
+    readBatch(&page[first], min(page.size() - first, (size_t)SAMPLE_STORE_VISIT_BATCH), records);
+    for (const VisitRecord& record : records) {
+      // Hash matches are confirmed against the record to rule out collisions
+      if (query.code && strncmp(record.sample.paintCode, query.code, SAMPLE_CODE_LENGTH) != 0) {
+        continue;
+      }
+      result.returned++;
+      if (!visitor(record.id, record.sample, ctx)) {
+        return result;
+      }
+    }
+  }
+  return result;
+}
+
+// ============================================================================
+// SPATIAL INDEX
+// ============================================================================
+
+void SampleStore::labInsert(uint32_t id, const ColorSample& sample) {
+  SampleLabKey key = makeLabKey(id, sample);
+  labIndex.insert(std::upper_bound(labIndex.begin(), labIndex.end(), key, labKeyLess), key);
+}
+
+void SampleStore::labRemove(uint32_t id) {
+  // Keys are ordered by L, not id; a linear scan costs no more than the erase itself
+  for (size_t i = 0; i < labIndex.size(); i++) {
+    if (labIndex[i].id == id) {
+      labIndex.erase(labIndex.begin() + i);
+      return;
+    }
+  }
+}
+
+void SampleStore::labSort() {
+  std::sort(labIndex.begin(), labIndex.end(), labKeyLess);
+}
+
+size_t SampleStore::nearest(const CIE_Lab& target, float maxDeltaE, SampleNeighbor* results, size_t maxResults,
+                            uint32_t* scanned) const {
+  StoreLock guard(lock);
+  size_t found = 0;
+  uint32_t scored = 0;
+  if (maxResults == 0 || labIndex.empty()) {
+    if (scanned) *scanned = 0;
+    return 0;
+  }
+
+  // deltaE2000^2 >= (dL / SL)^2, so anything outside this L* slab cannot match
+  float window = maxDeltaE * DE2000_SL_MAX;
+  SampleLabKey lowKey = {0, (int16_t)constrain(lroundf((target.L - window) * 100.0f), -32768L, 32767L), 0, 0};
+  int32_t highL = constrain(lroundf((target.L + window) * 100.0f), -32768L, 32767L);
+
+  for (auto it = std::lower_bound(labIndex.begin(), labIndex.end(), lowKey, labKeyLess);
+       it != labIndex.end() && it->L <= highL; ++it) {
+    CIE_Lab lab = {it->L / 100.0f, it->a / 100.0f, it->b / 100.0f};
+    float dE = calculateDeltaE2000(target, lab);
+    scored++;
+    if (dE > maxDeltaE) {
+      continue;
+    }
+    if (found == maxResults && dE >= results[found - 1].deltaE) {
+      continue;
+    }
+
+    // Keep the best maxResults hits sorted by insertion
+    size_t pos = (found < maxResults) ? found++ : found - 1;
+    while (pos > 0 && results[pos - 1].deltaE > dE) {
+      results[pos] = results[pos - 1];
+      pos--;
+    }
+    results[pos] = {it->id, dE};
+  }
+
+  if (scanned) *scanned = scored;
+  return found;
+}
+
+// ============================================================================
+// RECALIBRATION
+// ============================================================================
+
+void SampleStore::setColorModel(uint32_t version, SampleColorModel model, void* ctx) {
+  StoreLock guard(lock);
+  if (version != colorVersion) {
+    recomputeCursor = 0;
+  }
+  colorModel = model;
+  colorModelCtx = ctx;
+  colorVersion = version;
+  LOG_STORAGE_INFO("Sample color model set to calibration v%u - %u samples to recompute",
+                   version, staleCount());
+}
+
+uint32_t SampleStore::staleCount() const {
+  StoreLock guard(lock);
+  uint32_t stale = 0;
+  for (size_t i = 0; i < index.size(); i++) {
+    if (isStale(index[i])) {
+      stale++;
+    }
+  }
+  return stale;
+}
+
+size_t SampleStore::recomputeStale(size_t maxSamples) {
+  StoreLock guard(lock);
+  // Rewriting samples already copied would abort a running compaction
+  if (!initialized || !colorModel || compacting || index.empty()) {
+    return 0;
+  }
+
+  std::vector<SampleRecord> records(SAMPLE_RECOMPUTE_BATCH);
+  SampleMeasurement raw[SAMPLE_RECOMPUTE_BATCH];
+  uint8_t rgb[SAMPLE_RECOMPUTE_BATCH][3];
+  size_t done = 0;
+
+  while (done < maxSamples) {
+    // Gather one batch of stale samples, resuming where the last call stopped.
+    // The log is reopened per batch since the updates below may flush into it.
+    File file = LittleFS.open(logPath, "r");
+    size_t n = 0;
+    for (size_t scanned = 0; scanned < index.size() && n < SAMPLE_RECOMPUTE_BATCH && done + n < maxSamples;
+         scanned++) {
+      if (recomputeCursor >= index.size()) {
+        recomputeCursor = 0;
+      }
+      const SampleIndexEntry& entry = index[recomputeCursor++];
+      if (isStale(entry) && readEntry(file, entry, records[n])) {
+        raw[n] = records[n].sample.raw;
+        n++;
+      }
+    }
+    file.close();
+    if (n == 0) {
+      break;
+    }
+
+    colorModel(raw, n, rgb, colorModelCtx);
+    for (size_t i = 0; i < n; i++) {
+      ColorSample sample = records[i].sample;
+      sample.r = rgb[i][0];
+      sample.g = rgb[i][1];
+      sample.b = rgb[i][2];
+      sample.raw.calVersion = colorVersion;
+      if (!update(records[i].id, sample)) {
+        maxSamples = done;  // Out of space; the rest stays stale for now
+        break;
+      }
+      done++;
+    }
+    esp_task_wdt_reset();
+  }
+
+  recomputed += done;
+  if (done > 0) {
+    LOG_STORAGE_DEBUG("Recomputed %u samples for calibration v%u", (unsigned)done, colorVersion);
+  }
+  return done;
+}
+
+// ============================================================================
+// COMPACTION
+// ============================================================================
+
+bool SampleStore::shouldCompact() const {
+  return deadSlots >= SAMPLE_STORE_COMPACT_MIN_DEAD &&
+         (float)deadSlots >= (float)slotCount * SAMPLE_STORE_COMPACT_RATIO;
+}
+
+void SampleStore::abortCompaction(const char* reason) {
+  if (compactFile) {
+    compactFile.close();
+  }
+  LittleFS.remove(compactPath);
+  compacting = false;
+  compactCursor = 0;
+  LOG_STORAGE_INFO("Sample log compaction aborted: %s", reason);
+}
+
+bool SampleStore::compactStep(size_t batch) {
+  // Queued records get log slots first so the copy below sees every sample;
+  // only a torn log (being repaired here) leaves them pending
+  flushLocked();
+
+  if (!compacting) {
+    compactFile = LittleFS.open(compactPath, "w");
+    if (!compactFile) {
+      LOG_STORAGE_ERROR("Failed to open compaction file %s", compactPath);
+      return false;
+    }
+    compacting = true;
+    compactCursor = 0;
+    LOG_STORAGE_INFO("Sample log compaction started - Records:%u Dead:%u", slotCount, deadSlots);
+  }
+
+  File source = LittleFS.open(logPath, "r");
+  if (!source) {
+    abortCompaction("log unreadable");
+    return false;
+  }
+
+  // Inserts made while compacting land at the end of the index and are picked up here
+  SampleRecord record;
+  size_t copied = 0;
+  while (compactCursor < index.size() && copied < batch) {
+    if (index[compactCursor].slot == SLOT_PENDING) {
+      compactCursor++;
+      continue;
+    }
+    if (!readSlot(source, index[compactCursor].slot, record)) {
+      LOG_STORAGE_ERROR("Dropping unreadable sample %u during compaction", index[compactCursor].id);
+      labRemove(index[compactCursor].id);
+      index.erase(index.begin() + compactCursor);
+      continue;
+    }
+    if (compactFile.write((const uint8_t*)&record, RECORD_SIZE) != RECORD_SIZE) {
+      source.close();
+      abortCompaction("scratch write failed");
+      return false;
+    }
+    compactCursor++;
+    copied++;
+  }
+  source.close();
+
+  if (compactCursor >= index.size()) {
+    finishCompaction();
+  }
+  return true;
+}
+
+void SampleStore::finishCompaction() {
+  compactFile.close();
+  appendFile.close();
+
+  // LittleFS rename replaces the destination atomically
+  if (!LittleFS.rename(compactPath, logPath)) {
+    LOG_STORAGE_ERROR("Compaction rename failed - keeping existing log");
+    LittleFS.remove(compactPath);
+    compacting = false;
+    openAppend();
+    return;
+  }
+
+  uint32_t reclaimed = deadSlots;
+  uint32_t slot = 0;
+  for (size_t i = 0; i < index.size(); i++) {
+    if (index[i].slot != SLOT_PENDING) {
+      index[i].slot = slot++;
+    }
+  }
+  slotCount = slot;
+  deadSlots = 0;
+  logTorn = false;
+
+  // Still-queued records now refer to a log without older copies of their ids
+  for (size_t i = 0; i < pending.size();) {
+    if (pending[i].record.type == SAMPLE_RECORD_TOMBSTONE) {
+      pending.erase(pending.begin() + i);
+    } else {
+      pending[i++].supersedes = false;
+    }
+  }
+  corruptSlots = 0;
+  compacting = false;
+  compactCursor = 0;
+  compactions++;
+
+  openAppend();
+  refreshFreeBytes();
+  LOG_STORAGE_INFO("Sample log compaction finished - Samples:%u Reclaimed:%u records Free:%u bytes",
+                   (unsigned)index.size(), reclaimed, (unsigned)freeBytes);
+}
+
+void SampleStore::maintenance() {
+  StoreLock guard(lock);
+  if (!initialized) {
+    return;
+  }
+  // Catch cached colors up with a recalibration before reclaiming space
+  if (!compacting && recomputeStale(SAMPLE_RECOMPUTE_BATCH) > 0) {
+    return;
+  }
+  if (!compacting && !shouldCompact()) {
+    return;
+  }
+  compactStep(SAMPLE_STORE_COMPACT_BATCH);
+}
+
+bool SampleStore::compactNow() {
+  LOG_PERF_START();
+  StoreLock guard(lock);
+  do {
+    if (!compactStep(SAMPLE_STORE_SCAN_BATCH)) {
+      return false;
+    }
+    esp_task_wdt_reset();
+  } while (compacting);
+  LOG_PERF_END("Sample log compaction");
+  return true;
+}
+
+// ============================================================================
+// MIGRATION, DIAGNOSTICS AND BENCHMARK
+// ============================================================================
+
+int SampleStore::migrateFromPreferences(Preferences& prefs) {
+  StoreLock guard(lock);
+  if (!initialized || !prefs.isKey(PREF_SAMPLE_COUNT)) {
+    return 0;
+  }
+
+  // Legacy keys are removed only after a complete import, so samples already in
+  // the log here came from an interrupted migration and are imported again
+  if (!index.empty()) {
+    LOG_STORAGE_INFO("Restarting interrupted legacy sample migration");
+    clear();
+  }
+
+  uint32_t legacyCount = min(prefs.getUInt(PREF_SAMPLE_COUNT, 0), (uint32_t)MAX_SAMPLES);
+  uint32_t legacyIndex = prefs.getUInt(PREF_SAMPLE_INDEX, 0);
+  // A full ring buffer keeps its oldest entry at the write index
+  uint32_t start = legacyCount == MAX_SAMPLES ? legacyIndex % MAX_SAMPLES : 0;
+
+  int imported = 0;
+  for (uint32_t i = 0; i < legacyCount; i++) {
+    String key = String(PREF_SAMPLE_PREFIX) + String((start + i) % MAX_SAMPLES);
+    LegacyColorSample legacy;
+    if (prefs.getBytesLength(key.c_str()) != sizeof(LegacyColorSample) ||
+        prefs.getBytes(key.c_str(), &legacy, sizeof(LegacyColorSample)) != sizeof(LegacyColorSample)) {
+      LOG_STORAGE_ERROR("Legacy sample %s unreadable - skipped", key.c_str());
+      continue;
+    }
+    ColorSample sample;
+    fromLegacy(legacy, sample);
+    uint32_t id;
+    if (!append(sample, id)) {
+      LOG_STORAGE_ERROR("Legacy sample migration stopped after %d samples", imported);
+      return imported;
+    }
+    imported++;
+  }
+
+  // The legacy copy is the only one until the imported samples are on flash
+  if (!flushLocked()) {
+    LOG_STORAGE_ERROR("Legacy sample migration could not be flushed - keeping Preferences copy");
+    return imported;
+  }
+
+  for (uint32_t i = 0; i < MAX_SAMPLES; i++) {
+    String key = String(PREF_SAMPLE_PREFIX) + String(i);
+    if (prefs.isKey(key.c_str())) {
+      prefs.remove(key.c_str());
+    }
+  }
+  prefs.remove(PREF_SAMPLE_COUNT);
+  prefs.remove(PREF_SAMPLE_INDEX);
+
+  LOG_STORAGE_INFO("Migrated %d legacy samples from Preferences to %s", imported, logPath);
+  return imported;
+}
+
+void SampleStore::getStats(JsonObject stats) const {
+  StoreLock guard(lock);
+  stats["samples"] = index.size();
+  stats["records"] = slotCount;
+  stats["deadRecords"] = deadSlots;
+  stats["corruptRecords"] = corruptSlots;
+  stats["recordSize"] = RECORD_SIZE;
+  stats["logBytes"] = (uint32_t)(slotCount * RECORD_SIZE);
+  stats["freeBytes"] = freeBytes;
+  stats["compacting"] = compacting;
+  stats["compactions"] = compactions;
+  stats["indexBytes"] = (uint32_t)(index.capacity() * sizeof(SampleIndexEntry));
+  stats["labIndexBytes"] = (uint32_t)(labIndex.capacity() * sizeof(SampleLabKey));
+  stats["pendingRecords"] = pending.size();
+  stats["flushes"] = flushes;
+  stats["flushedRecords"] = flushedRecords;
+  stats["coalescedWrites"] = coalescedWrites;
+  stats["lastFlushUs"] = lastFlushUs;
+  stats["colorVersion"] = colorVersion;
+  stats["staleSamples"] = staleCount();
+  stats["recomputed"] = recomputed;
+}
+
+SampleStoreBenchmark SampleStore::runBenchmark(uint32_t count, const char* path) {
+  SampleStoreBenchmark result;
+  memset(&result, 0, sizeof(result));
+
+  String scratchPath = String(path) + ".tmp";
+  LittleFS.remove(path);
+  LittleFS.remove(scratchPath.c_str());
+
+  SampleStore bench(path, scratchPath.c_str());
+  if (!bench.begin()) {
+    return result;
+  }
+
+  ColorSample sample;
+  memset(&sample, 0, sizeof(sample));
+  strcpy(sample.paintName, "Benchmark");
+  strcpy(sample.paintCode, "BENCH");
+
+  LOG_STORAGE_INFO("Sample store benchmark - inserting %u samples", count);
+  unsigned long start = millis();
+  for (uint32_t i = 0; i < count; i++) {
+    sample.r = i & 0xFF;
+    sample.g = (i >> 8) & 0xFF;
+    sample.b = (i * 7) & 0xFF;
+    sample.timestamp = i;
+    uint32_t id;
+    if (!bench.append(sample, id)) {
+      break;
+    }
+    result.count++;
+    if ((i & 0xFF) == 0) {
+      esp_task_wdt_reset();
+    }
+  }
+  bench.flush();
+  result.insertMs = millis() - start;
+
+  // Delete every tenth sample
+  start = millis();
+  for (uint32_t id = 1; id <= result.count; id += 10) {
+    if (bench.remove(id)) {
+      result.deleted++;
+    }
+    if ((id & 0xFF) == 1) {
+      esp_task_wdt_reset();
+    }
+  }
+  bench.flush();
+  result.deleteMs = millis() - start;
+  result.logBytes = bench.slotCount * RECORD_SIZE;
+
+  start = millis();
+  bool reloaded = bench.begin();
+  result.bootLoadMs = millis() - start;
+
+  start = millis();
+  bench.compactNow();
+  result.compactMs = millis() - start;
+
+  // Average of a spread of nearest-neighbour queries over the loaded store
+  SampleNeighbor hits[SAMPLE_NEAR_DEFAULT_LIMIT];
+  unsigned long nearStart = micros();
+  for (uint32_t q = 0; q < 16; q++) {
+    CIE_Lab target = convertSRGBToLab(q * 16, 255 - q * 16, (q * 53) & 0xFF);
+    bench.nearest(target, SAMPLE_NEAR_DEFAULT_DELTA_E, hits, SAMPLE_NEAR_DEFAULT_LIMIT);
+  }
+  result.nearUs = (micros() - nearStart) / 16;
+
+  result.success = reloaded && bench.count() == result.count - result.deleted;
+  bench.end();
+
+  LittleFS.remove(path);
+  LittleFS.remove(scratchPath.c_str());
+
+  LOG_STORAGE_INFO("Sample store benchmark - N:%u Insert:%ums Delete(%u):%ums BootLoad:%ums Compact:%ums Near:%uus Log:%u bytes",
+                   result.count, result.insertMs, result.deleted, result.deleteMs,
+                   result.bootLoadMs, result.compactMs, result.nearUs, result.logBytes);
+  return result;
+}
+
+SampleRecomputeBenchmark SampleStore::runRecomputeBenchmark(uint32_t count, SampleColorModel model, void* ctx,
+                                                           const char* path) {
+  SampleRecomputeBenchmark result;
+  memset(&result, 0, sizeof(result));
+  if (!model) {
+    return result;
+  }
+
+  String scratchPath = String(path) + ".tmp";
+  LittleFS.remove(path);
+  LittleFS.remove(scratchPath.c_str());
+
+  SampleStore bench(path, scratchPath.c_str());
+  if (!bench.begin()) {
+    return result;
+  }
+
+  // Synthetic measurements spread over the sensor range, captured under calibration v1
+  SampleMeasurement raw[SAMPLE_RECOMPUTE_BATCH];
+  for (uint32_t i = 0; i < SAMPLE_RECOMPUTE_BATCH; i++) {
+    memset(&raw[i], 0, sizeof(raw[i]));
+    raw[i].x = 400 + i * 997;
+    raw[i].y = 300 + i * 1013;
+    raw[i].z = 200 + i * 1031;
+    raw[i].ir1 = 50 + i * 17;
+    raw[i].ir2 = 40 + i * 13;
+    raw[i].readings = 40;
+    raw[i].calVersion = 1;
+  }
+
+  ColorSample sample;
+  memset(&sample, 0, sizeof(sample));
+  strcpy(sample.paintName, "Benchmark");
+  for (uint32_t i = 0; i < count; i++) {
+    sample.raw = raw[i % SAMPLE_RECOMPUTE_BATCH];
+    sample.timestamp = i;
+    uint32_t id;
+    if (!bench.append(sample, id)) {
+      break;
+    }
+    result.count++;
+    if ((i & 0xFF) == 0) {
+      esp_task_wdt_reset();
+    }
+  }
+  bench.flush();
+
+  // Conversion cost alone: batched calls versus one call per sample
+  uint8_t rgb[SAMPLE_RECOMPUTE_BATCH][3];
+  unsigned long start = micros();
+  for (uint32_t done = 0; done < result.count; done += SAMPLE_RECOMPUTE_BATCH) {
+    model(raw, min((uint32_t)SAMPLE_RECOMPUTE_BATCH, result.count - done), rgb, ctx);
+  }
+  result.convertUs = micros() - start;
+
+  start = micros();
+  for (uint32_t i = 0; i < result.count; i++) {
+    model(&raw[i % SAMPLE_RECOMPUTE_BATCH], 1, rgb, ctx);
+  }
+  result.singleUs = micros() - start;
+  esp_task_wdt_reset();
+
+  // Full sweep as run after a recalibration: read, convert, rewrite, flush
+  bench.setColorModel(2, model, ctx);
+  start = millis();
+  result.recomputed = bench.recomputeStale(result.count);
+  bench.flush();
+  result.totalMs = millis() - start;
+
+  result.success = result.recomputed == result.count && bench.staleCount() == 0;
+  bench.end();
+
+  LittleFS.remove(path);
+  LittleFS.remove(scratchPath.c_str());
+
+  LOG_STORAGE_INFO("Recompute benchmark - N:%u Batched:%uus Single:%uus Sweep:%ums",
+                   result.count, result.convertUs, result.singleUs, result.totalMs);
+  return result;
+}
@@ -0,0 +1,431 @@
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include <new>
+#include "config.h"
+#include "logging.h"
+#include "cie1931.h"
+
+/**
+ * @brief Log-structured sample store on LittleFS
+ *
+ * Samples are appended to a single log file as fixed-size, CRC-protected
+ * records. Updates append a new copy of the record and deletes append a
+ * tombstone, so every mutation costs exactly one record write. An in-RAM
+ * index (id -> record slot) is rebuilt from the log at boot, and dead
+ * records are reclaimed by an incremental compaction driven from loop().
+ *
+ * Mutations are write-behind: they update the index immediately and queue
+ * the record in a small pending buffer, where repeated writes to the same
+ * sample coalesce. flush() appends the whole buffer in one write and is
+ * called by the persistence task, so every public method takes the store
+ * lock. forEach() and query() hold it only while reading each batch of
+ * SAMPLE_STORE_VISIT_BATCH records, so a visitor writing to a slow client
+ * does not stall the persistence task or the match worker.
+ */
+
+// Averaged raw sensor measurement behind a sample, kept so its color can be
+// recomputed after recalibration
+struct __attribute__((packed)) SampleMeasurement {
+  uint16_t x, y, z;        // Averaged raw channel counts
+  uint16_t ir1, ir2;
+  uint16_t sigma[5];       // Per-channel std dev x SAMPLE_SIGMA_SCALE (X, Y, Z, IR1, IR2)
+  uint16_t readings;       // Readings averaged (0 = no raw data)
+  uint8_t atime;           // Integration time register at capture
+  uint8_t again;           // Gain setting at capture
+  uint32_t calVersion;     // Calibration the cached r, g, b were computed with
+};
+
+// Sample storage structure; r, g, b are a cache when raw data is present
+struct ColorSample {
+  uint8_t r, g, b;
+  uint32_t timestamp;
+  char paintName[SAMPLE_NAME_LENGTH];
+  char paintCode[SAMPLE_CODE_LENGTH];
+  float lrv;
+  SampleMeasurement raw;
+};
+
+// Converts raw measurements to display RGB for the current calibration.
+// Called with batches so per-calibration constants are set up once per batch.
+typedef void (*SampleColorModel)(const SampleMeasurement* raw, size_t count, uint8_t (*rgb)[3], void* ctx);
+
+// Record types written to the log
+enum SampleRecordType : uint8_t {
+  SAMPLE_RECORD_DATA = 1,       // Insert or full replacement of a sample
+  SAMPLE_RECORD_TOMBSTONE = 2   // Deletion marker for a sample id
+};
+
+#define SAMPLE_RECORD_MAGIC 0x5352    // "SR"
+#define SAMPLE_RECORD_VERSION 2       // 2: adds SampleMeasurement (v1 logs are upgraded at boot)
+
+// On-flash record layout (fixed size so slot N lives at N * sizeof(SampleRecord))
+struct __attribute__((packed)) SampleRecord {
+  uint16_t magic;          // SAMPLE_RECORD_MAGIC
+  uint8_t type;            // SampleRecordType
+  uint8_t version;         // SAMPLE_RECORD_VERSION
+  uint32_t id;             // Stable sample id (monotonic, never reused while referenced)
+  ColorSample sample;      // Payload (zeroed for tombstones)
+  uint32_t crc;            // CRC32 over all preceding bytes
+};
+
+// Queued record that has not reached flash yet
+struct SamplePendingRecord {
+  SampleRecord record;     // Sealed at flush time
+  bool supersedes;         // An older copy of this id exists in the log
+};
+
+// In-RAM index entry, ordered by id (which is also insertion order)
+struct SampleIndexEntry {
+  uint32_t id;             // Sample id
+  uint32_t slot;           // Record slot of the live copy in the log
+  uint32_t timestamp;      // Copy of the sample timestamp for range filters
+  uint32_t codeHash;       // FNV-1a of the paint code (0 = no code) for code filters
+  uint32_t calVersion;     // Calibration of the cached color (0 = no raw data to recompute from)
+};
+
+// Spatial index entry: fixed-point Lab (x100) of a sample, kept sorted by L
+struct SampleLabKey {
+  uint32_t id;             // Sample id
+  int16_t L;               // L* x 100
+  int16_t a;               // a* x 100
+  int16_t b;               // b* x 100
+};
+
+// One /samples/near hit
+struct SampleNeighbor {
+  uint32_t id;             // Sample id
+  float deltaE;            // CIEDE2000 distance to the query color
+};
+
+// Keeps large indexes out of internal RAM when PSRAM is fitted
+template <typename T>
+struct PsramAllocator {
+  typedef T value_type;
+  PsramAllocator() = default;
+  template <typename U> PsramAllocator(const PsramAllocator<U>&) {}
+  T* allocate(size_t n) {
+    void* p = psramFound() ? ps_malloc(n * sizeof(T)) : nullptr;
+    if (!p) p = malloc(n * sizeof(T));
+    if (!p) throw std::bad_alloc();
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, size_t) { free(p); }
+  template <typename U> bool operator==(const PsramAllocator<U>&) const { return true; }
+  template <typename U> bool operator!=(const PsramAllocator<U>&) const { return false; }
+};
+
+// Listing query over the index; only matching records in the page are read from flash
+struct SampleQuery {
+  uint32_t cursor;         // Continue after this sample id (0 = start at the newest/oldest end)
+  uint32_t offset;         // Matching samples to skip before the page
+  uint16_t limit;          // Page size
+  uint32_t since;          // Only samples with timestamp >= since (0 = no bound)
+  const char* code;        // Exact paint code filter (nullptr = any)
+  bool newestFirst;        // Walk from the newest sample backwards
+};
+
+struct SampleQueryResult {
+  uint32_t total;          // Samples matching the filters
+  uint16_t returned;       // Samples passed to the visitor
+  uint32_t nextCursor;     // Cursor for the following page (0 = none)
+  bool hasMore;
+};
+
+// Result of a store benchmark run
+struct SampleStoreBenchmark {
+  uint32_t count;          // Samples inserted
+  uint32_t deleted;        // Samples deleted
+  uint32_t insertMs;       // Total insert time
+  uint32_t deleteMs;       // Total delete time
+  uint32_t bootLoadMs;     // Index rebuild time from the resulting log
+  uint32_t compactMs;      // Full compaction time
+  uint32_t nearUs;         // Average /samples/near query time (default radius)
+  uint32_t logBytes;       // Log size before compaction
+  bool success;
+};
+
+// Result of a recalibration recompute benchmark
+struct SampleRecomputeBenchmark {
+  uint32_t count;          // Samples with raw data in the scratch store
+  uint32_t recomputed;     // Samples recomputed by the batch sweep
+  uint32_t convertUs;      // Time spent in the color model (batched)
+  uint32_t singleUs;       // Same conversions one sample per call, for comparison
+  uint32_t totalMs;        // Full sweep including reads and record writes
+  bool success;
+};
+
+class SampleStore {
+private:
+  const char* logPath;
+  const char* compactPath;
+
+  std::vector<SampleIndexEntry, PsramAllocator<SampleIndexEntry>> index;
+  std::vector<SampleLabKey, PsramAllocator<SampleLabKey>> labIndex;
+  File appendFile;
+  std::vector<SamplePendingRecord> pending;
+  SemaphoreHandle_t lock;
+
+  uint32_t nextId;
+  Preferences* idPrefs;     // Holds the id high-water mark; null keeps it in RAM only
+  uint32_t idReserved;      // Ids below this are already reserved in NVS
+  uint32_t slotCount;       // Records in the log (live + dead)
+  uint32_t deadSlots;       // Superseded records and tombstones
+  uint32_t corruptSlots;    // Records skipped during the last index rebuild
+  size_t freeBytes;         // Cached free flash minus queued records
+  bool initialized;
+  bool logTorn;             // A partial record was written; appends wait for compaction
+
+  // Write-behind statistics
+  uint32_t flushes;
+  uint32_t flushedRecords;
+  uint32_t coalescedWrites;
+  uint32_t lastFlushUs;
+
+  // Lazy recompute of cached colors after recalibration
+  SampleColorModel colorModel;
+  void* colorModelCtx;
+  uint32_t colorVersion;
+  size_t recomputeCursor;
+  uint32_t recomputed;
+
+  // Incremental compaction state
+  bool compacting;
+  File compactFile;
+  size_t compactCursor;     // Next index position to copy
+  uint32_t compactions;
+
+  bool upgradeLog();
+  bool rebuildIndex(bool& tornTail);
+  bool openAppend();
+  bool reserveId();
+  bool queueRecord(uint8_t type, uint32_t id, const ColorSample* sample, bool supersedes);
+  int32_t findPending(uint32_t id) const;
+  bool flushLocked();
+  bool readSlot(File& file, uint32_t slot, SampleRecord& record);
+  bool readEntry(File& file, const SampleIndexEntry& entry, SampleRecord& record);
+  void refreshColor(ColorSample& sample) const;
+  bool isStale(const SampleIndexEntry& entry) const;
+  int32_t findPosition(uint32_t id) const;
+  size_t positionAfter(uint32_t id) const;
+  // A sample read for a visitor, unpacked so it can be passed by reference
+  struct VisitRecord {
+    uint32_t id;
+    ColorSample sample;
+  };
+
+  void readBatch(const uint32_t* ids, size_t count, std::vector<VisitRecord>& records);
+  bool ensureCapacity();
+  bool shouldCompact() const;
+  bool compactStep(size_t batch);
+  void finishCompaction();
+  void abortCompaction(const char* reason);
+  void refreshFreeBytes();
+
+  void labInsert(uint32_t id, const ColorSample& sample);
+  void labRemove(uint32_t id);
+  void labSort();
+
+  bool matchesQuery(const SampleIndexEntry& entry, const SampleQuery& query, uint32_t codeHash) const;
+  SampleQueryResult selectPage(const SampleQuery& query, uint32_t codeHash, std::vector<uint32_t>& page);
+
+  static void sealRecord(SampleRecord& record);
+  static bool validRecord(const SampleRecord& record);
+
+public:
+  /**
+   * @brief Constructor
+   * @param path Log file path on LittleFS
+   * @param tmpPath Scratch file used while compacting
+   */
+  SampleStore(const char* path = SAMPLE_STORE_PATH, const char* tmpPath = SAMPLE_STORE_COMPACT_PATH);
+  ~SampleStore();
+
+  /**
+   * @brief Open the log and rebuild the in-RAM index (LittleFS must be mounted)
+   *
+   * Ids are handed out above a high-water mark kept in NVS, reserved
+   * SAMPLE_STORE_ID_RESERVE at a time. Deleted ids that compaction removed
+   * from the log are therefore never reused after a reboot.
+   *
+   * @param prefs Open Preferences namespace for the high-water mark; null keeps it in RAM only
+   * @return true if the store is usable
+   */
+  bool begin(Preferences* prefs = nullptr);
+
+  /**
+   * @brief Flush queued records and close open file handles
+   */
+  void end();
+
+  /**
+   * @brief Append all queued records to the log in one write
+   * @return true if nothing is left pending
+   */
+  bool flush();
+
+  /**
+   * @brief Import samples from the legacy Preferences ring buffer, once
+   * @param prefs Open Preferences namespace holding sample0..N keys
+   * @return Number of samples imported
+   */
+  int migrateFromPreferences(Preferences& prefs);
+
+  /**
+   * @brief Append a new sample (queued; one record write at the next flush)
+   * @param sample Sample data
+   * @param outId Receives the assigned sample id
+   * @return true if accepted (flash space is reserved up front)
+   */
+  bool append(const ColorSample& sample, uint32_t& outId);
+
+  /**
+   * @brief Replace an existing sample (coalesces with a queued copy)
+   * @param id Sample id
+   * @param sample New sample data
+   * @return true if accepted
+   */
+  bool update(uint32_t id, const ColorSample& sample);
+
+  /**
+   * @brief Delete a sample by writing a tombstone
+   * @param id Sample id
+   * @return true if the sample existed; a still-queued sample is simply dropped
+   */
+  bool remove(uint32_t id);
+
+  /**
+   * @brief Remove every sample and truncate the log
+   * @return true if successful
+   */
+  bool clear();
+
+  /**
+   * @brief Read a sample by its position in insertion order (0 = oldest)
+   */
+  bool readAt(size_t position, ColorSample& sample, uint32_t* id = nullptr);
+
+  /**
+   * @brief Read a sample by id
+   */
+  bool readById(uint32_t id, ColorSample& sample);
+
+  /**
+   * @brief Visit samples in insertion order, a batch of records at a time
+   *
+   * The lock is released while the visitor runs. Samples deleted meanwhile
+   * are skipped and samples appended meanwhile may be included.
+   * @param start First position to visit
+   * @param limit Maximum number of samples to visit
+   * @param visitor Called per sample; return false to stop early
+   * @return Number of samples visited
+   */
+  size_t forEach(size_t start, size_t limit, bool (*visitor)(uint32_t id, const ColorSample& sample, void* ctx), void* ctx);
+
+  /**
+   * @brief Page through samples with filters, reading only the returned records
+   * @param query Cursor, paging and filter parameters
+   * @param visitor Called per returned sample in page order
+   * @return Totals and the cursor for the next page
+   */
+  SampleQueryResult query(const SampleQuery& query, bool (*visitor)(uint32_t id, const ColorSample& sample, void* ctx), void* ctx);
+
+  /**
+   * @brief Find the samples closest to a color by CIEDE2000
+   *
+   * Candidates are pruned on the L-sorted spatial index (CIEDE2000 is never
+   * smaller than |dL| / max(SL)), so only the L* slab around the target is
+   * scored. No flash is read.
+   *
+   * @param target Query color
+   * @param maxDeltaE Search radius
+   * @param results Receives up to maxResults hits, nearest first
+   * @param maxResults Capacity of results
+   * @param scanned Optional count of candidates scored
+   * @return Number of hits written to results
+   */
+  size_t nearest(const CIE_Lab& target, float maxDeltaE, SampleNeighbor* results, size_t maxResults,
+                 uint32_t* scanned = nullptr) const;
+
+  /**
+   * @brief Hash used by the index for paint code filters
+   */
+  static uint32_t hashCode(const char* code);
+
+  /**
+   * @brief Set the calibration used for displayed colors
+   *
+   * Samples captured under another calibration version are recomputed from
+   * their raw measurement whenever they are read, and maintenance() rewrites
+   * them in batches so the cached color (and the Lab index) catches up.
+   *
+   * @param version Current calibration version (non-zero)
+   * @param model Batch conversion from raw measurement to RGB
+   * @param ctx Passed to the model
+   */
+  void setColorModel(uint32_t version, SampleColorModel model, void* ctx);
+
+  /**
+   * @brief Recompute and rewrite stale samples through the batch path
+   * @param maxSamples Upper bound for this call
+   * @return Number of samples rewritten
+   */
+  size_t recomputeStale(size_t maxSamples);
+
+  /**
+   * @brief Samples whose cached color predates the current calibration
+   */
+  uint32_t staleCount() const;
+
+  /**
+   * @brief Run one bounded recompute or compaction step; call regularly from loop()
+   */
+  void maintenance();
+
+  /**
+   * @brief Compact the whole log synchronously
+   * @return true if successful
+   */
+  bool compactNow();
+
+  // Index and queue lookups take the store lock; other tasks may be mutating them
+  size_t count() const;
+  size_t pendingCount() const;
+  bool isInitialized() const { return initialized; }
+  int32_t positionOf(uint32_t id) const;
+  uint32_t idAt(size_t position) const;
+  uint32_t getSlotCount() const { return slotCount; }
+  uint32_t getDeadSlots() const { return deadSlots; }
+  bool isCompacting() const { return compacting; }
+
+  /**
+   * @brief Add store statistics to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+
+  /**
+   * @brief Time insert/delete/boot-load/compaction on a scratch log
+   * @param count Number of samples to insert
+   * @param path Scratch log path (removed afterwards)
+   * @return Benchmark results
+   */
+  static SampleStoreBenchmark runBenchmark(uint32_t count, const char* path = SAMPLE_STORE_BENCH_PATH);
+
+  /**
+   * @brief Time a full recalibration sweep on a scratch log
+   * @param count Number of samples with raw data to insert
+   * @param model Color model under test
+   * @param ctx Passed to the model
+   * @param path Scratch log path (removed afterwards)
+   * @return Benchmark results
+   */
+  static SampleRecomputeBenchmark runRecomputeBenchmark(uint32_t count, SampleColorModel model, void* ctx,
+                                                        const char* path = SAMPLE_STORE_BENCH_PATH);
+};
+
+#endif // SAMPLE_STORE_H
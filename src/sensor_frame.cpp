@@ -0,0 +1,106 @@
+#include "sensor_frame.h"
+#include "logging.h"
+
+SensorFrameCache::SensorFrameCache() {
+  memset(&latest, 0, sizeof(latest));
+  valid = false;
+  reader = nullptr;
+  readerCtx = nullptr;
+  seq = 0;
+  memset(published, 0, sizeof(published));
+  hits = 0;
+  reads = 0;
+  readFailures = 0;
+  lastReadUs = 0;
+}
+
+void SensorFrameCache::begin(SensorFrameReader frameReader, void* ctx) {
+  reader = frameReader;
+  readerCtx = ctx;
+}
+
+void SensorFrameCache::publish(const SensorFrame& frame) {
+  latest = frame;
+  latest.capturedAt = millis();
+  latest.seq = ++seq;
+  valid = true;
+  if (frame.source < FRAME_SOURCE_COUNT) {
+    published[frame.source]++;
+  }
+}
+
+bool SensorFrameCache::get(SensorFrame& out, uint32_t maxAgeMs, bool needIR2, bool* fresh) {
+  if (fresh) {
+    *fresh = false;
+  }
+  if (valid && millis() - latest.capturedAt <= maxAgeMs && (latest.hasIR2 || !needIR2)) {
+    hits++;
+    out = latest;
+    return true;
+  }
+
+  if (reader) {
+    SensorFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.source = FRAME_SOURCE_POLL;
+    uint32_t startUs = micros();
+    bool ok = reader(frame, needIR2, readerCtx);
+    lastReadUs = micros() - startUs;
+    if (ok) {
+      reads++;
+      publish(frame);
+      out = latest;
+      if (fresh) {
+        *fresh = true;
+      }
+      LOG_SENSOR_DEBUG("Sensor frame %u read on demand in %lu us", latest.seq, (unsigned long)lastReadUs);
+      return true;
+    }
+    readFailures++;
+    LOG_SENSOR_ERROR("On-demand sensor read failed - serving %s frame", valid ? "cached" : "no");
+  }
+
+  if (!valid) {
+    return false;
+  }
+  out = latest;
+  return true;
+}
+
+void SensorFrameCache::describe(const SensorFrame& frame, bool fresh, JsonObject out) {
+  out["seq"] = frame.seq;
+  out["ageMs"] = millis() - frame.capturedAt;
+  out["source"] = sourceName(frame.source);
+  out["fresh"] = fresh;
+  out["atime"] = frame.atime;
+  out["again"] = frame.again;
+  out["illumination"] = frame.illumination;
+}
+
+const char* SensorFrameCache::sourceName(SensorFrameSource source) {
+  switch (source) {
+    case FRAME_SOURCE_SCAN: return "scan";
+    case FRAME_SOURCE_ENHANCED_SCAN: return "enhancedScan";
+    case FRAME_SOURCE_BRIGHTNESS: return "brightness";
+    case FRAME_SOURCE_CALIBRATION: return "calibration";
+    case FRAME_SOURCE_POLL: return "poll";
+    case FRAME_SOURCE_SWEEP: return "sweep";
+    case FRAME_SOURCE_DRIFT: return "drift";
+    default: return "unknown";
+  }
+}
+
+void SensorFrameCache::getStats(JsonObject stats) const {
+  stats["valid"] = valid;
+  stats["seq"] = seq;
+  stats["ageMs"] = ageMs();
+  stats["source"] = valid ? sourceName(latest.source) : "none";
+  stats["hits"] = hits;
+  stats["reads"] = reads;
+  stats["readFailures"] = readFailures;
+  stats["lastReadUs"] = lastReadUs;
+  JsonObject bySource = stats["published"].to<JsonObject>();
+  for (uint8_t i = 0; i < FRAME_SOURCE_COUNT; i++) {
+    bySource[sourceName((SensorFrameSource)i)] = published[i];
+  }
+}
@@ -0,0 +1,112 @@
+#ifndef SENSOR_FRAME_H
+#define SENSOR_FRAME_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// What produced a frame
+enum SensorFrameSource : uint8_t {
+  FRAME_SOURCE_SCAN = 0,          // Averaged /scan reading
+  FRAME_SOURCE_ENHANCED_SCAN,     // /enhanced-scan result
+  FRAME_SOURCE_BRIGHTNESS,        // Auto-brightness control reading
+  FRAME_SOURCE_CALIBRATION,       // White/black reference average
+  FRAME_SOURCE_POLL,              // On-demand read for an endpoint whose max-age the cache missed
+  FRAME_SOURCE_SWEEP,             // Patch sweep conversion
+  FRAME_SOURCE_DRIFT,             // White tile drift check
+  FRAME_SOURCE_COUNT
+};
+
+/**
+ * @brief One set of TCS3430 channel readings and the conditions they were taken in
+ */
+struct SensorFrame {
+  uint16_t x;
+  uint16_t y;
+  uint16_t z;
+  uint16_t ir1;
+  uint16_t ir2;                // Only meaningful with hasIR2 (the IR2 mux swap costs two integrations)
+  uint8_t status;              // STATUS register, only meaningful with hasStatus
+  bool hasIR2;
+  bool hasStatus;
+  uint16_t atime;
+  uint8_t again;
+  uint8_t illumination;        // Illumination LED PWM level while reading (0 = off)
+  SensorFrameSource source;
+  uint32_t capturedAt;         // millis(), set by publish()
+  uint32_t seq;                // Set by publish(), increments per frame
+};
+
+/**
+ * @brief Reads the sensor as it is, without touching the LEDs
+ * @param withIR2 Also read IR2 (slow)
+ * @return false if the sensor could not be read
+ */
+typedef bool (*SensorFrameReader)(SensorFrame& frame, bool withIR2, void* ctx);
+
+/**
+ * @brief Latest sensor frame shared by the read-only endpoints
+ *
+ * Every place that already reads the sensor (scans, brightness control,
+ * calibration) publishes what it read. /raw, /live-metrics, /status and
+ * /sensor-diagnostics answer from the cached frame, and only read the sensor
+ * themselves when the caller's max-age is shorter than the frame's age (or
+ * the frame lacks IR2 and the endpoint needs it). Such reads leave the LEDs
+ * as they are, so polling never changes the lighting a scan depends on.
+ *
+ * Published and read from the loop task only (web handlers and scans run
+ * there); not thread-safe.
+ */
+class SensorFrameCache {
+private:
+  SensorFrame latest;
+  bool valid;
+  SensorFrameReader reader;
+  void* readerCtx;
+  uint32_t seq;
+  uint32_t published[FRAME_SOURCE_COUNT];
+  uint32_t hits;
+  uint32_t reads;
+  uint32_t readFailures;
+  uint32_t lastReadUs;
+
+public:
+  SensorFrameCache();
+
+  /**
+   * @brief Set the reader used when a cached frame is too old
+   */
+  void begin(SensorFrameReader reader, void* ctx);
+
+  /**
+   * @brief Replace the cached frame; stamps capturedAt and seq
+   */
+  void publish(const SensorFrame& frame);
+
+  /**
+   * @brief Latest frame no older than maxAgeMs, reading the sensor if the cache cannot serve it
+   * @param needIR2 A cached frame without IR2 does not qualify
+   * @param fresh Set when the sensor was read for this call
+   * @return false if there is no frame and the read failed
+   *
+   * A failed read falls back to the cached frame, however old.
+   */
+  bool get(SensorFrame& out, uint32_t maxAgeMs, bool needIR2, bool* fresh = nullptr);
+
+  bool hasFrame() const { return valid; }
+  uint32_t ageMs() const { return valid ? millis() - latest.capturedAt : 0; }
+
+  /**
+   * @brief Add a frame's provenance (age, source, sequence, capture settings) to a JSON object
+   */
+  static void describe(const SensorFrame& frame, bool fresh, JsonObject out);
+
+  static const char* sourceName(SensorFrameSource source);
+
+  /**
+   * @brief Add cache hit and read counters to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // SENSOR_FRAME_H
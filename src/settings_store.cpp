@@ -0,0 +1,189 @@
+#include "settings_store.h"
+#include <esp_rom_crc.h>
+
+SettingsStore::SettingsStore() {
+  prefs = nullptr;
+  memset(&saved, 0, sizeof(saved));
+  haveSaved = false;
+  source = SETTINGS_FROM_DEFAULTS;
+  storedVersion = 0;
+  loadUs = 0;
+  lastSaveUs = 0;
+  saves = 0;
+  unchangedSaves = 0;
+  crcFailures = 0;
+}
+
+void SettingsStore::defaults(DeviceSettings& settings) {
+  memset(&settings, 0, sizeof(settings));
+  settings.atime = DEFAULT_ATIME;
+  settings.again = DEFAULT_AGAIN;
+  settings.brightness = DEFAULT_BRIGHTNESS;
+  settings.calibrated = 0;
+  settings.autoZeroMode = DEFAULT_AUTO_ZERO_MODE;
+  settings.autoZeroFreq = DEFAULT_AUTO_ZERO_FREQUENCY;
+  settings.waitTime = DEFAULT_WAIT_TIME;
+  settings.enhancedLEDMode = 1;
+  settings.manualLEDIntensity = 128;
+}
+
+void SettingsStore::upgradeSettings(DeviceSettings& settings, uint16_t fromVersion) {
+  // One case per layout step, falling through to the current version. Fields
+  // appended after fromVersion already hold defaults here; derive them from
+  // older fields when a plain default is wrong. v1 is the first blob layout.
+  switch (fromVersion) {
+    default:
+      break;
+  }
+}
+
+// ============================================================================
+// BLOB I/O
+// ============================================================================
+
+bool SettingsStore::readBlob(DeviceSettings& settings) {
+  uint8_t blob[SETTINGS_BLOB_MAX];
+  size_t len = prefs->getBytes(PREF_SETTINGS_BLOB, blob, sizeof(blob));
+  if (len < sizeof(SettingsBlobHeader)) {
+    return false;
+  }
+
+  SettingsBlobHeader header;
+  memcpy(&header, blob, sizeof(header));
+  const uint8_t* payload = blob + sizeof(header);
+  if (header.magic != SETTINGS_BLOB_MAGIC || header.size != len - sizeof(header) ||
+      esp_rom_crc32_le(0, payload, header.size) != header.crc) {
+    crcFailures++;
+    LOG_STORAGE_ERROR("Settings blob rejected - Magic:0x%04X Version:%u Size:%u/%u",
+                      header.magic, header.version, header.size, (unsigned)(len - sizeof(header)));
+    return false;
+  }
+
+  // Known prefix only: newer fields are ignored, missing ones keep defaults
+  defaults(settings);
+  memcpy(&settings, payload, min((size_t)header.size, sizeof(settings)));
+  storedVersion = header.version;
+  if (header.version > SETTINGS_BLOB_VERSION) {
+    LOG_STORAGE_INFO("Settings blob v%u is newer than firmware v%u - reading known fields",
+                     header.version, SETTINGS_BLOB_VERSION);
+  } else if (header.version < SETTINGS_BLOB_VERSION) {
+    upgradeSettings(settings, header.version);
+  }
+  return true;
+}
+
+bool SettingsStore::writeBlob(const DeviceSettings& settings) {
+  uint8_t blob[sizeof(SettingsBlobHeader) + sizeof(DeviceSettings)];
+  SettingsBlobHeader header;
+  header.magic = SETTINGS_BLOB_MAGIC;
+  header.version = SETTINGS_BLOB_VERSION;
+  header.size = sizeof(DeviceSettings);
+  header.reserved = 0;
+  header.crc = esp_rom_crc32_le(0, (const uint8_t*)&settings, sizeof(settings));
+  memcpy(blob, &header, sizeof(header));
+  memcpy(blob + sizeof(header), &settings, sizeof(settings));
+
+  unsigned long start = micros();
+  bool ok = prefs->putBytes(PREF_SETTINGS_BLOB, blob, sizeof(blob)) == sizeof(blob);
+  lastSaveUs = micros() - start;
+  if (!ok) {
+    LOG_STORAGE_ERROR("Failed to write settings blob");
+    return false;
+  }
+  saved = settings;
+  haveSaved = true;
+  saves++;
+  return true;
+}
+
+bool SettingsStore::importLegacyKeys(DeviceSettings& settings) {
+  static const char* const legacyKeys[] = {
+    PREF_ATIME, PREF_AGAIN, PREF_BRIGHTNESS, PREF_CALIBRATED, PREF_AUTO_ZERO_MODE,
+    PREF_AUTO_ZERO_FREQ, PREF_WAIT_TIME, PREF_ENHANCED_LED_MODE, PREF_MANUAL_LED_INTENSITY
+  };
+
+  bool found = false;
+  for (const char* key : legacyKeys) {
+    if (prefs->isKey(key)) {
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    return false;
+  }
+
+  defaults(settings);
+  settings.atime = prefs->getUInt(PREF_ATIME, DEFAULT_ATIME);
+  settings.again = prefs->getUInt(PREF_AGAIN, DEFAULT_AGAIN);
+  settings.brightness = prefs->getUInt(PREF_BRIGHTNESS, DEFAULT_BRIGHTNESS);
+  settings.calibrated = prefs->getBool(PREF_CALIBRATED, false);
+  settings.autoZeroMode = prefs->getUInt(PREF_AUTO_ZERO_MODE, DEFAULT_AUTO_ZERO_MODE);
+  settings.autoZeroFreq = prefs->getUInt(PREF_AUTO_ZERO_FREQ, DEFAULT_AUTO_ZERO_FREQUENCY);
+  settings.waitTime = prefs->getUInt(PREF_WAIT_TIME, DEFAULT_WAIT_TIME);
+  settings.enhancedLEDMode = prefs->getBool(PREF_ENHANCED_LED_MODE, true);
+  settings.manualLEDIntensity = prefs->getUChar(PREF_MANUAL_LED_INTENSITY, 128);
+
+  // Old keys go only once the blob holds their values
+  if (!writeBlob(settings)) {
+    LOG_STORAGE_ERROR("Settings migration failed - keeping per-setting keys");
+    return true;
+  }
+  for (const char* key : legacyKeys) {
+    prefs->remove(key);
+  }
+  LOG_STORAGE_INFO("Migrated per-setting keys to settings blob v%u", SETTINGS_BLOB_VERSION);
+  return true;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool SettingsStore::load(Preferences& preferences, DeviceSettings& settings) {
+  prefs = &preferences;
+  unsigned long start = micros();
+
+  if (readBlob(settings)) {
+    source = SETTINGS_FROM_BLOB;
+    saved = settings;
+    haveSaved = true;
+    if (storedVersion < SETTINGS_BLOB_VERSION) {
+      // Rewrite now so the upgrade hooks run once, not on every boot
+      writeBlob(settings);
+      LOG_STORAGE_INFO("Settings blob upgraded from v%u to v%u", storedVersion, SETTINGS_BLOB_VERSION);
+    }
+  } else if (importLegacyKeys(settings)) {
+    source = SETTINGS_FROM_LEGACY_KEYS;
+  } else {
+    defaults(settings);
+    source = SETTINGS_FROM_DEFAULTS;
+  }
+
+  loadUs = micros() - start;
+  return source != SETTINGS_FROM_DEFAULTS;
+}
+
+bool SettingsStore::save(const DeviceSettings& settings) {
+  if (!prefs) {
+    return false;
+  }
+  if (haveSaved && memcmp(&saved, &settings, sizeof(settings)) == 0) {
+    unchangedSaves++;
+    return true;
+  }
+  return writeBlob(settings);
+}
+
+void SettingsStore::getStats(JsonObject stats) const {
+  static const char* const sources[] = {"defaults", "blob", "legacyKeys"};
+  stats["source"] = sources[source];
+  stats["version"] = SETTINGS_BLOB_VERSION;
+  stats["storedVersion"] = storedVersion;
+  stats["blobBytes"] = sizeof(SettingsBlobHeader) + sizeof(DeviceSettings);
+  stats["loadUs"] = loadUs;
+  stats["lastSaveUs"] = lastSaveUs;
+  stats["saves"] = saves;
+  stats["unchangedSaves"] = unchangedSaves;
+  stats["crcFailures"] = crcFailures;
+}
@@ -0,0 +1,109 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+
+/**
+ * @brief Device settings persisted as one versioned, CRC-checked NVS blob
+ *
+ * The whole settings struct is read and written as a single Preferences key
+ * (a header followed by the payload), so boot costs one NVS lookup instead
+ * of one per setting.
+ *
+ * Payload fields are append-only. A blob written by newer firmware is read
+ * through the prefix this firmware knows (forward compatibility); a shorter
+ * blob from older firmware keeps defaults for the missing tail and then runs
+ * the upgrade hooks in upgradeSettings() for each version step (backward
+ * compatibility). The per-setting keys used before the blob existed are
+ * imported once and removed.
+ */
+
+#define SETTINGS_BLOB_MAGIC 0x5354    // "ST"
+#define SETTINGS_BLOB_VERSION 1       // Bump when appending fields; add a case to upgradeSettings()
+
+struct __attribute__((packed)) SettingsBlobHeader {
+  uint16_t magic;          // SETTINGS_BLOB_MAGIC
+  uint16_t version;        // Payload layout version that wrote the blob
+  uint16_t size;           // Payload bytes that follow the header
+  uint16_t reserved;
+  uint32_t crc;            // CRC32 over the payload bytes
+};
+
+// Payload; only ever append fields (see above)
+struct __attribute__((packed)) DeviceSettings {
+  uint16_t atime;
+  uint8_t again;
+  uint8_t brightness;
+  uint8_t calibrated;
+  uint8_t autoZeroMode;
+  uint8_t autoZeroFreq;
+  uint8_t waitTime;
+  uint8_t enhancedLEDMode;
+  uint8_t manualLEDIntensity;
+};
+
+// Where the settings in RAM came from at boot
+enum SettingsSource : uint8_t {
+  SETTINGS_FROM_DEFAULTS = 0,
+  SETTINGS_FROM_BLOB = 1,
+  SETTINGS_FROM_LEGACY_KEYS = 2   // Imported from per-setting keys this boot
+};
+
+class SettingsStore {
+private:
+  Preferences* prefs;
+  DeviceSettings saved;           // Last blob written or read, to skip identical writes
+  bool haveSaved;
+  SettingsSource source;
+  uint16_t storedVersion;         // Version of the blob found at boot (0 = none)
+  uint32_t loadUs;
+  uint32_t lastSaveUs;
+  uint32_t saves;
+  uint32_t unchangedSaves;
+  uint32_t crcFailures;
+
+  bool readBlob(DeviceSettings& settings);
+  bool writeBlob(const DeviceSettings& settings);
+  bool importLegacyKeys(DeviceSettings& settings);
+  static void upgradeSettings(DeviceSettings& settings, uint16_t fromVersion);
+
+public:
+  SettingsStore();
+
+  /**
+   * @brief Fill settings with firmware defaults
+   */
+  static void defaults(DeviceSettings& settings);
+
+  /**
+   * @brief Load settings with a single blob read
+   *
+   * Falls back to importing the old per-setting keys (once), then to
+   * defaults. Any version upgrade is written back immediately.
+   *
+   * @param preferences Open Preferences namespace, kept for save()
+   * @param settings Receives the loaded settings
+   * @return true if settings came from storage rather than defaults
+   */
+  bool load(Preferences& preferences, DeviceSettings& settings);
+
+  /**
+   * @brief Write settings as one blob; identical settings are not rewritten
+   * @return true if the stored blob matches settings afterwards
+   */
+  bool save(const DeviceSettings& settings);
+
+  SettingsSource getSource() const { return source; }
+  uint32_t getLoadUs() const { return loadUs; }
+
+  /**
+   * @brief Add load/save statistics to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,271 @@
+#include "task_monitor.h"
+#include "logging.h"
+#include <esp_timer.h>
+#include <esp_freertos_hooks.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#if configUSE_TRACE_FACILITY
+// Filled by uxTaskGetSystemState(); static to keep ~1.5 KB off the loop stack
+static TaskStatus_t taskStatus[TASK_MONITOR_STATUS_SLOTS];
+#endif
+
+#if !defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) && TASK_MONITOR_IDLE_HOOKS
+#define TASK_MONITOR_ESTIMATE_LOAD 1
+#endif
+
+#ifdef TASK_MONITOR_ESTIMATE_LOAD
+// Idle-loop passes per core; returning false keeps the idle task counting
+// instead of waiting for the next interrupt
+static volatile uint32_t idleCount[2];
+static bool idleHookCore0() {
+  idleCount[0]++;
+  return false;
+}
+static bool idleHookCore1() {
+  idleCount[1]++;
+  return false;
+}
+#endif
+
+TaskMonitor::TaskMonitor() {
+  memset(history, 0, sizeof(history));
+  historyHead = 0;
+  historyCount = 0;
+  memset(previous, 0, sizeof(previous));
+  previousCount = 0;
+  previousTotal = 0;
+  lastCollectMs = 0;
+  overflowLogged = false;
+  idleHooks = false;
+  memset(idlePrevious, 0, sizeof(idlePrevious));
+  idleMaxRate[0] = 0.0f;
+  idleMaxRate[1] = 0.0f;
+  loopStartUs = 0;
+  loopIterations = 0;
+  loopTotalUs = 0;
+  loopMaxUs = 0;
+  loopMaxGapUs = 0;
+}
+
+void TaskMonitor::begin() {
+#ifdef TASK_MONITOR_ESTIMATE_LOAD
+  idleHooks = esp_register_freertos_idle_hook_for_cpu(idleHookCore0, 0) == ESP_OK;
+#if portNUM_PROCESSORS > 1
+  idleHooks = idleHooks && esp_register_freertos_idle_hook_for_cpu(idleHookCore1, 1) == ESP_OK;
+#endif
+  if (!idleHooks) {
+    LOG_SYS_ERROR("Task monitor: idle hooks not registered - core load unavailable");
+  }
+  idlePrevious[0] = idleCount[0];
+  idlePrevious[1] = idleCount[1];
+  lastCollectMs = millis();
+#endif
+}
+
+void TaskMonitor::beginLoop() {
+  uint32_t now = (uint32_t)esp_timer_get_time();
+  if (loopStartUs != 0 && now - loopStartUs > loopMaxGapUs) {
+    loopMaxGapUs = now - loopStartUs;
+  }
+  loopStartUs = now;
+}
+
+void TaskMonitor::endLoop() {
+  uint32_t us = (uint32_t)esp_timer_get_time() - loopStartUs;
+  loopIterations++;
+  loopTotalUs += us;
+  if (us > loopMaxUs) {
+    loopMaxUs = us;
+  }
+}
+
+void TaskMonitor::service() {
+  if (millis() - lastCollectMs < TASK_MONITOR_INTERVAL_MS) {
+    return;
+  }
+  collect();
+}
+
+void TaskMonitor::collect() {
+  uint32_t now = millis();
+  Snapshot& snap = history[historyHead];
+  memset(&snap, 0, sizeof(snap));
+  snap.atMs = now;
+  snap.intervalMs = now - lastCollectMs;
+  snap.loopIterations = loopIterations;
+  snap.loopMeanUs = loopIterations ? (uint32_t)(loopTotalUs / loopIterations) : 0;
+  snap.loopMaxUs = loopMaxUs;
+  snap.loopMaxGapUs = loopMaxGapUs;
+  lastCollectMs = now;
+  loopIterations = 0;
+  loopTotalUs = 0;
+  loopMaxUs = 0;
+  loopMaxGapUs = 0;
+  estimateCoreLoad(snap);
+
+#if configUSE_TRACE_FACILITY
+  if (uxTaskGetNumberOfTasks() > TASK_MONITOR_STATUS_SLOTS) {
+    if (!overflowLogged) {
+      LOG_SYS_ERROR("Task monitor: %u tasks exceed TASK_MONITOR_STATUS_SLOTS (%u)",
+                    (unsigned)uxTaskGetNumberOfTasks(), (unsigned)TASK_MONITOR_STATUS_SLOTS);
+      overflowLogged = true;
+    }
+    return;
+  }
+  uint32_t total = 0;
+  UBaseType_t count = uxTaskGetSystemState(taskStatus, TASK_MONITOR_STATUS_SLOTS, &total);
+  if (count == 0) {
+    return;
+  }
+
+  // The counters wrap; unsigned differences stay correct across one wrap
+  uint32_t totalDelta = total - previousTotal;
+  snap.runtimeStats = total != 0 && previousCount > 0 && totalDelta > 0;
+
+  TaskEntry entries[TASK_MONITOR_STATUS_SLOTS];
+  for (UBaseType_t i = 0; i < count; i++) {
+    const TaskStatus_t& status = taskStatus[i];
+    TaskEntry& entry = entries[i];
+    strncpy(entry.name, status.pcTaskName, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entry.stackFreeMin = status.usStackHighWaterMark > 0xFFFF ? 0xFFFF : status.usStackHighWaterMark;
+    BaseType_t affinity = xTaskGetAffinity(status.xHandle);
+    entry.core = affinity == tskNO_AFFINITY ? -1 : (int8_t)affinity;
+    entry.priority = (uint8_t)status.uxCurrentPriority;
+    entry.state = (uint8_t)status.eCurrentState;
+    entry.cpuPermille = 0;
+
+    if (snap.runtimeStats) {
+      for (uint8_t p = 0; p < previousCount; p++) {
+        if (previous[p].handle == status.xHandle) {
+          uint32_t delta = status.ulRunTimeCounter - previous[p].runtime;
+          uint64_t permille = (uint64_t)delta * 1000 / totalDelta;
+          entry.cpuPermille = permille > 1000 ? 1000 : (uint16_t)permille;
+          break;
+        }
+      }
+      // Each core's idle task shows how much of that core was free
+      if (strncmp(entry.name, "IDLE", 4) == 0 && entry.core >= 0 && entry.core < 2) {
+        snap.coreLoadPermille[entry.core] = 1000 - entry.cpuPermille;
+      }
+    }
+  }
+
+  for (UBaseType_t i = 0; i < count; i++) {
+    previous[i].handle = taskStatus[i].xHandle;
+    previous[i].runtime = taskStatus[i].ulRunTimeCounter;
+  }
+  previousCount = count;
+  previousTotal = total;
+
+  // Busiest first; without run time stats, least stack headroom first
+  bool byCpu = snap.runtimeStats;
+  std::sort(entries, entries + count, [byCpu](const TaskEntry& a, const TaskEntry& b) {
+    return byCpu ? a.cpuPermille > b.cpuPermille : a.stackFreeMin < b.stackFreeMin;
+  });
+  snap.taskCount = count < TASK_MONITOR_MAX_TASKS ? count : TASK_MONITOR_MAX_TASKS;
+  snap.tasksOmitted = count - snap.taskCount;
+  memcpy(snap.tasks, entries, sizeof(TaskEntry) * snap.taskCount);
+#endif
+
+  historyHead = (historyHead + 1) % TASK_MONITOR_HISTORY;
+  if (historyCount < TASK_MONITOR_HISTORY) {
+    historyCount++;
+  }
+}
+
+void TaskMonitor::estimateCoreLoad(Snapshot& snap) {
+#ifdef TASK_MONITOR_ESTIMATE_LOAD
+  if (!idleHooks || snap.intervalMs == 0) {
+    return;
+  }
+  // The first interval only sets the baseline rate; against itself it would read 0 %
+  bool baseline = idleMaxRate[0] > 0.0f;
+  for (uint8_t core = 0; core < portNUM_PROCESSORS && core < 2; core++) {
+    uint32_t count = idleCount[core];
+    float rate = (float)(count - idlePrevious[core]) / snap.intervalMs;
+    idlePrevious[core] = count;
+    if (rate > idleMaxRate[core]) {
+      idleMaxRate[core] = rate;
+    }
+    float idle = idleMaxRate[core] > 0.0f ? rate / idleMaxRate[core] : 1.0f;
+    snap.coreLoadPermille[core] = (uint16_t)roundf((1.0f - idle) * 1000.0f);
+  }
+  snap.loadEstimated = baseline;
+#else
+  (void)snap;
+#endif
+}
+
+// Stack sizes of the tasks this firmware creates; others are not known
+uint32_t TaskMonitor::configuredStack(const char* name) {
+  if (strcmp(name, "sensorBoot") == 0) return BOOT_SENSOR_TASK_STACK;
+  if (strcmp(name, "persist") == 0) return PERSIST_TASK_STACK;
+  if (strcmp(name, "match") == 0) return MATCH_TASK_STACK;
+  if (strcmp(name, "matchLane") == 0) return MATCH_LANE_TASK_STACK;
+#ifdef CONFIG_ARDUINO_LOOP_STACK_SIZE
+  if (strcmp(name, "loopTask") == 0) return CONFIG_ARDUINO_LOOP_STACK_SIZE;
+#endif
+  return 0;
+}
+
+const char* TaskMonitor::stateName(uint8_t state) {
+  switch (state) {
+    case 0: return "running";
+    case 1: return "ready";
+    case 2: return "blocked";
+    case 3: return "suspended";
+    case 4: return "deleted";
+    default: return "unknown";
+  }
+}
+
+void TaskMonitor::getStats(JsonObject stats, uint8_t snapshots) const {
+  stats["available"] = (bool)configUSE_TRACE_FACILITY;
+  stats["intervalMs"] = TASK_MONITOR_INTERVAL_MS;
+  if (snapshots > historyCount) {
+    snapshots = historyCount;
+  }
+
+  JsonArray list = stats["snapshots"].to<JsonArray>();
+  for (uint8_t n = 0; n < snapshots; n++) {
+    const Snapshot& snap = history[(historyHead + TASK_MONITOR_HISTORY - 1 - n) % TASK_MONITOR_HISTORY];
+    JsonObject out = list.add<JsonObject>();
+    out["atMs"] = snap.atMs;
+    out["intervalMs"] = snap.intervalMs;
+    out["runtimeStats"] = snap.runtimeStats;
+    if (snap.runtimeStats || snap.loadEstimated) {
+      out["coreLoadSource"] = snap.runtimeStats ? "runtimeStats" : "idleHook";
+      JsonArray cores = out["coreLoadPercent"].to<JsonArray>();
+      cores.add(snap.coreLoadPermille[0] / 10.0f);
+      cores.add(snap.coreLoadPermille[1] / 10.0f);
+    }
+
+    JsonObject loopStats = out["loop"].to<JsonObject>();
+    loopStats["iterations"] = snap.loopIterations;
+    loopStats["meanUs"] = snap.loopMeanUs;
+    loopStats["maxUs"] = snap.loopMaxUs;
+    loopStats["maxGapUs"] = snap.loopMaxGapUs;
+
+    out["tasksOmitted"] = snap.tasksOmitted;
+    JsonArray tasks = out["tasks"].to<JsonArray>();
+    for (uint8_t i = 0; i < snap.taskCount; i++) {
+      const TaskEntry& entry = snap.tasks[i];
+      JsonObject task = tasks.add<JsonObject>();
+      task["name"] = entry.name;
+      if (snap.runtimeStats) {
+        task["cpuPercent"] = entry.cpuPermille / 10.0f;
+      }
+      task["stackFreeMin"] = entry.stackFreeMin;
+      uint32_t stackSize = configuredStack(entry.name);
+      if (stackSize) {
+        task["stackSize"] = stackSize;
+        task["stackUsedPercent"] = roundf(100.0f * (stackSize - entry.stackFreeMin) / stackSize);
+      }
+      task["core"] = entry.core;
+      task["priority"] = entry.priority;
+      task["state"] = stateName(entry.state);
+    }
+  }
+}
@@ -0,0 +1,121 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+/**
+ * @brief Periodic FreeRTOS task telemetry: CPU share, stack headroom, core and loop() timing
+ *
+ * Every TASK_MONITOR_INTERVAL_MS, service() reads uxTaskGetSystemState() and
+ * stores one snapshot in a ring of TASK_MONITOR_HISTORY. A snapshot holds,
+ * for each task, its share of one core since the previous snapshot, its stack
+ * high-water mark (the least free stack ever seen, in bytes), its pinned core
+ * and its priority. It also holds the busy share of each core and the
+ * loop() iteration times over the same interval.
+ *
+ * CPU shares come from the FreeRTOS run time counters, which exist only when
+ * the sdkconfig enables CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS. Task shares
+ * sum to 200% on the dual-core S3, and a core's load is 100% minus its idle
+ * task's share.
+ *
+ * The stock arduino-esp32 sdkconfig leaves the counters off, and per-task
+ * shares are then left out. With TASK_MONITOR_IDLE_HOOKS set, each core's
+ * load is estimated from an idle hook instead. The hook counts idle-loop
+ * passes, and the load is 1 minus the count rate over the highest rate seen
+ * so far, which is the nearest thing to a fully idle interval. No load is
+ * reported for the first interval, which only sets that baseline, and the
+ * estimate reads high until the device has had one quiet interval. While the
+ * hooks are registered, the idle tasks spin instead of waiting for an
+ * interrupt, so the option is off by default.
+ *
+ * Used only from the loop task (collection and the handlers), so there is no
+ * locking.
+ */
+class TaskMonitor {
+private:
+  struct TaskEntry {
+    char name[TASK_MONITOR_NAME_LENGTH];
+    uint16_t cpuPermille;        // Of one core over the snapshot interval
+    uint16_t stackFreeMin;       // High-water mark in bytes, saturated at 65535
+    int8_t core;                 // -1 when not pinned
+    uint8_t priority;
+    uint8_t state;               // eTaskState
+  };
+
+  struct Snapshot {
+    uint32_t atMs;
+    uint32_t intervalMs;
+    bool runtimeStats;           // CPU shares valid for this snapshot
+    bool loadEstimated;          // coreLoadPermille from the idle hooks
+    uint16_t coreLoadPermille[2];
+    uint8_t taskCount;
+    uint8_t tasksOmitted;        // Tasks beyond TASK_MONITOR_MAX_TASKS, lowest CPU first
+    uint32_t loopIterations;
+    uint32_t loopMeanUs;         // loop() body, excluding the trailing delay
+    uint32_t loopMaxUs;
+    uint32_t loopMaxGapUs;       // Longest start-to-start time, delay included
+    TaskEntry tasks[TASK_MONITOR_MAX_TASKS];
+  };
+
+  // Run time counters from the previous collection, for the deltas
+  struct Previous {
+    void* handle;
+    uint32_t runtime;
+  };
+
+  Snapshot history[TASK_MONITOR_HISTORY];
+  uint8_t historyHead;           // Next slot to write
+  uint8_t historyCount;
+
+  Previous previous[TASK_MONITOR_STATUS_SLOTS];
+  uint8_t previousCount;
+  uint32_t previousTotal;
+  uint32_t lastCollectMs;
+  bool overflowLogged;
+
+  // Idle hook counts at the last collection and the highest rate seen (passes per ms)
+  bool idleHooks;
+  uint32_t idlePrevious[2];
+  float idleMaxRate[2];
+
+  // loop() timing since the last collection
+  uint32_t loopStartUs;
+  uint32_t loopIterations;
+  uint64_t loopTotalUs;
+  uint32_t loopMaxUs;
+  uint32_t loopMaxGapUs;
+
+  void collect();
+  void estimateCoreLoad(Snapshot& snap);
+  static uint32_t configuredStack(const char* name);
+  static const char* stateName(uint8_t state);
+
+public:
+  TaskMonitor();
+
+  /**
+   * @brief Register the idle hooks when TASK_MONITOR_IDLE_HOOKS is set and run time stats are not compiled in
+   */
+  void begin();
+
+  /**
+   * @brief Mark the start and end of one loop() pass
+   */
+  void beginLoop();
+  void endLoop();
+
+  /**
+   * @brief Collect a snapshot when the interval has elapsed; call from loop()
+   */
+  void service();
+
+  /**
+   * @brief Add the newest snapshots to a JSON object, newest first
+   * @param snapshots How many to include (clamped to what is stored)
+   */
+  void getStats(JsonObject stats, uint8_t snapshots) const;
+};
+
+#endif // TASK_MONITOR_H
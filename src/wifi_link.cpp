@@ -0,0 +1,303 @@
+#include "wifi_link.h"
+#include <esp_rom_crc.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include <time.h>
+
+// Survives soft resets (ESP.restart, watchdog), cleared by power loss; the
+// magic and CRC tell a kept copy from uninitialised memory
+RTC_NOINIT_ATTR static WiFiLinkCache rtcCache;
+
+WiFiLink::WiFiLink() {
+  ssid = nullptr;
+  password = nullptr;
+  prefs = nullptr;
+  memset(&cache, 0, sizeof(cache));
+  cacheValid = false;
+  cacheSource = WIFI_CACHE_NONE;
+  fastFailed = false;
+  cachedIpApplied = false;
+  leaseClockValid = false;
+  state = WIFI_LINK_IDLE;
+  attemptFast = false;
+  attemptStartMs = 0;
+  outageStartMs = 0;
+  backoffMs = 0;
+  backoffUntilMs = 0;
+  attempts = 0;
+  failures = 0;
+  disconnects = 0;
+  fastConnects = 0;
+  lastConnectMs = 0;
+  lastConnectFast = false;
+  cacheWrites = 0;
+}
+
+void WiFiLink::begin(const char* networkSsid, const char* networkPassword, Preferences& preferences) {
+  ssid = networkSsid;
+  password = networkPassword;
+  prefs = &preferences;
+
+  // The link is managed here; the driver's own reconnect would race it
+  WiFi.setAutoReconnect(false);
+
+  cacheValid = loadCache();
+  leaseClockValid = cacheSource == WIFI_CACHE_RTC;
+  if (cacheValid) {
+    LOG_NET_INFO("Fast connect cache from %s - Channel:%u BSSID:%02X:%02X:%02X:%02X:%02X:%02X",
+                 cacheSource == WIFI_CACHE_RTC ? "RTC" : "NVS", cache.channel,
+                 cache.bssid[0], cache.bssid[1], cache.bssid[2],
+                 cache.bssid[3], cache.bssid[4], cache.bssid[5]);
+  } else {
+    LOG_NET_INFO("No fast connect cache - first connection will scan");
+  }
+
+  outageStartMs = millis();
+  startAttempt(outageStartMs);
+}
+
+// ============================================================================
+// STATE MACHINE
+// ============================================================================
+
+WiFiLinkEvent WiFiLink::update() {
+  if (state == WIFI_LINK_IDLE) {
+    return WIFI_LINK_EVENT_NONE;
+  }
+
+  uint32_t now = millis();
+  bool connected = WiFi.status() == WL_CONNECTED;
+
+  switch (state) {
+    case WIFI_LINK_CONNECTING: {
+      if (connected) {
+        onConnected(now);
+        return WIFI_LINK_EVENT_CONNECTED;
+      }
+      uint32_t timeout = attemptFast ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_ATTEMPT_TIMEOUT_MS;
+      if (now - attemptStartMs < timeout) {
+        return WIFI_LINK_EVENT_NONE;
+      }
+
+      failures++;
+      if (attemptFast) {
+        // AP moved channel, was replaced or the lease is gone - try normally right away
+        LOG_NET_ERROR("Fast connect timed out after %ums (status %d) - falling back to full connect",
+                      (unsigned)timeout, WiFi.status());
+        fastFailed = true;
+        startAttempt(now);
+        return WIFI_LINK_EVENT_ATTEMPT_FAILED;
+      }
+
+      backoffMs = backoffMs ? min(backoffMs * 2, (uint32_t)WIFI_BACKOFF_MAX_MS) : WIFI_BACKOFF_MIN_MS;
+      backoffUntilMs = now + backoffMs;
+      state = WIFI_LINK_BACKOFF;
+      WiFi.disconnect();
+      LOG_NET_ERROR("WiFi attempt %lu timed out (status %d) - retrying in %lums",
+                    (unsigned long)attempts, WiFi.status(), (unsigned long)backoffMs);
+      return WIFI_LINK_EVENT_ATTEMPT_FAILED;
+    }
+
+    case WIFI_LINK_BACKOFF:
+      if ((long)(now - backoffUntilMs) >= 0) {
+        startAttempt(now);
+      }
+      return WIFI_LINK_EVENT_NONE;
+
+    case WIFI_LINK_CONNECTED:
+      if (connected && cachedIpApplied && !leaseReusable()) {
+        // Another client may be handed this address once the lease runs out
+        LOG_NET_INFO("Reused lease reached its renewal time - reconnecting through DHCP");
+        outageStartMs = now;
+        startAttempt(now);
+        return WIFI_LINK_EVENT_NONE;
+      }
+      if (connected) {
+        return WIFI_LINK_EVENT_NONE;
+      }
+      disconnects++;
+      outageStartMs = now;
+      backoffMs = 0;
+      LOG_NET_ERROR("WiFi connection lost (status %d) - reconnecting", WiFi.status());
+      startAttempt(now);
+      return WIFI_LINK_EVENT_DISCONNECTED;
+
+    default:
+      return WIFI_LINK_EVENT_NONE;
+  }
+}
+
+void WiFiLink::startAttempt(uint32_t now) {
+  if (attempts > 0) {
+    WiFi.disconnect();
+  }
+  attempts++;
+  attemptStartMs = now;
+  attemptFast = cacheValid && !fastFailed;
+  state = WIFI_LINK_CONNECTING;
+
+  applyCachedIp(attemptFast);
+  if (attemptFast) {
+    WiFi.begin(ssid, password, cache.channel, cache.bssid, true);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+  LOG_NET_DEBUG("WiFi attempt %lu started (%s)", (unsigned long)attempts, attemptFast ? "fast" : "full");
+}
+
+void WiFiLink::applyCachedIp(bool useCache) {
+#if USE_STATIC_IP
+  // The configured static address always wins over a cached lease
+  (void)useCache;
+#else
+  if (useCache && WIFI_FAST_CONNECT_REUSE_IP && cache.ip != 0 && leaseReusable()) {
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet),
+                IPAddress(cache.dns1), IPAddress(cache.dns2));
+    cachedIpApplied = true;
+  } else if (cachedIpApplied) {
+    // All-zero config switches the interface back to DHCP
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+    cachedIpApplied = false;
+  }
+#endif
+}
+
+bool WiFiLink::leaseReusable() const {
+  if (!leaseClockValid || cache.leaseS == 0) {
+    return false;
+  }
+  // Renewal (T1) is half the lease; a clock set backwards counts as expired
+  uint32_t nowS = (uint32_t)time(nullptr);
+  return nowS >= cache.leaseStartS && nowS - cache.leaseStartS < cache.leaseS / 2;
+}
+
+// Lease length of the station's current DHCP binding, 0 without one
+uint32_t WiFiLink::dhcpLeaseSeconds() {
+  esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  if (!netif) {
+    return 0;
+  }
+  struct netif* lwipNetif = (struct netif*)esp_netif_get_netif_impl(netif);
+  struct dhcp* dhcp = lwipNetif ? netif_dhcp_data(lwipNetif) : nullptr;
+  if (!dhcp || dhcp->state != DHCP_STATE_BOUND) {
+    return 0;
+  }
+  return dhcp->offered_t0_lease;
+}
+
+void WiFiLink::onConnected(uint32_t now) {
+  state = WIFI_LINK_CONNECTED;
+  backoffMs = 0;
+  lastConnectMs = now - outageStartMs;
+  lastConnectFast = attemptFast;
+  if (attemptFast) {
+    fastConnects++;
+  }
+
+  WiFiLinkCache fresh;
+  memset(&fresh, 0, sizeof(fresh));
+  fresh.magic = WIFI_LINK_CACHE_MAGIC;
+  fresh.version = WIFI_LINK_CACHE_VERSION;
+  fresh.channel = (uint8_t)WiFi.channel();
+  uint8_t* bssid = WiFi.BSSID();
+  if (bssid) {
+    memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+  }
+  fresh.ip = WiFi.localIP();
+  fresh.gateway = WiFi.gatewayIP();
+  fresh.subnet = WiFi.subnetMask();
+  fresh.dns1 = WiFi.dnsIP(0);
+  fresh.dns2 = WiFi.dnsIP(1);
+  if (cachedIpApplied) {
+    // Reusing the lease does not renew it; keep the original grant
+    fresh.leaseStartS = cache.leaseStartS;
+    fresh.leaseS = cache.leaseS;
+  } else {
+    fresh.leaseStartS = (uint32_t)time(nullptr);
+    fresh.leaseS = dhcpLeaseSeconds();
+    leaseClockValid = true;
+  }
+  fresh.crc = cacheCrc(fresh);
+  storeCache(fresh);
+  fastFailed = false;
+
+  LOG_NET_INFO("WiFi connected in %lums (%s, attempt %lu)", (unsigned long)lastConnectMs,
+               lastConnectFast ? "fast" : "full", (unsigned long)attempts);
+}
+
+// ============================================================================
+// CACHE
+// ============================================================================
+
+uint32_t WiFiLink::cacheCrc(const WiFiLinkCache& entry) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&entry, offsetof(WiFiLinkCache, crc));
+}
+
+bool WiFiLink::loadCache() {
+  if (rtcCache.magic == WIFI_LINK_CACHE_MAGIC && rtcCache.version == WIFI_LINK_CACHE_VERSION &&
+      cacheCrc(rtcCache) == rtcCache.crc) {
+    memcpy(&cache, &rtcCache, sizeof(cache));
+    cacheSource = WIFI_CACHE_RTC;
+    return true;
+  }
+
+  WiFiLinkCache stored;
+  if (prefs->getBytes(PREF_WIFI_CACHE, &stored, sizeof(stored)) == sizeof(stored) &&
+      stored.magic == WIFI_LINK_CACHE_MAGIC && stored.version == WIFI_LINK_CACHE_VERSION &&
+      cacheCrc(stored) == stored.crc) {
+    memcpy(&cache, &stored, sizeof(cache));
+    memcpy(&rtcCache, &stored, sizeof(rtcCache));
+    cacheSource = WIFI_CACHE_NVS;
+    return true;
+  }
+
+  cacheSource = WIFI_CACHE_NONE;
+  return false;
+}
+
+void WiFiLink::storeCache(const WiFiLinkCache& fresh) {
+  memcpy(&rtcCache, &fresh, sizeof(rtcCache));
+  if (cacheValid && memcmp(&cache, &fresh, sizeof(cache)) == 0) {
+    return;  // Same AP and lease - no flash write
+  }
+
+  memcpy(&cache, &fresh, sizeof(cache));
+  cacheValid = true;
+  if (prefs->putBytes(PREF_WIFI_CACHE, &fresh, sizeof(fresh)) == sizeof(fresh)) {
+    cacheWrites++;
+    LOG_NET_DEBUG("Fast connect cache updated - Channel:%u", fresh.channel);
+  } else {
+    LOG_NET_ERROR("Failed to store fast connect cache");
+  }
+}
+
+void WiFiLink::getStats(JsonObject stats) const {
+  static const char* const stateNames[] = {"idle", "connecting", "connected", "backoff"};
+  static const char* const sourceNames[] = {"none", "rtc", "nvs"};
+
+  stats["state"] = stateNames[state];
+  stats["attempts"] = attempts;
+  stats["failures"] = failures;
+  stats["disconnects"] = disconnects;
+  stats["fastConnects"] = fastConnects;
+  stats["lastConnectMs"] = lastConnectMs;
+  stats["lastConnectFast"] = lastConnectFast;
+  stats["backoffMs"] = state == WIFI_LINK_BACKOFF ? backoffMs : 0;
+
+  JsonObject cacheStats = stats["cache"].to<JsonObject>();
+  cacheStats["valid"] = cacheValid;
+  cacheStats["source"] = sourceNames[cacheSource];
+  cacheStats["writes"] = cacheWrites;
+  if (cacheValid) {
+    char bssid[18];
+    snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X",
+             cache.bssid[0], cache.bssid[1], cache.bssid[2],
+             cache.bssid[3], cache.bssid[4], cache.bssid[5]);
+    cacheStats["bssid"] = bssid;
+    cacheStats["channel"] = cache.channel;
+    cacheStats["leaseS"] = cache.leaseS;
+    cacheStats["leaseReusable"] = leaseReusable();
+  }
+  stats["ipReused"] = cachedIpApplied;
+}
@@ -0,0 +1,138 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "logging.h"
+
+/**
+ * @brief Non-blocking Wi-Fi station connection with fast reconnect
+ *
+ * The BSSID, channel and IP configuration of the last good connection are
+ * cached in RTC memory (kept across soft resets) and NVS (kept across power
+ * cycles). With a valid cache the first attempt is directed at that access
+ * point on that channel, skipping the scan. If that attempt does not connect
+ * the cache is ignored and a normal attempt follows; further failures back
+ * off exponentially.
+ *
+ * A fast connect also reuses the previous DHCP lease as a static address, but
+ * only until the lease's renewal time (half the lease) measured from when
+ * DHCP granted it. The ESP32 system clock keeps running across soft resets,
+ * so that age is known for an RTC copy of the cache. After a power cycle it
+ * is not, and DHCP runs. A reconnect on a reused lease never refreshes its
+ * grant time. If the renewal time passes while connected on a reused
+ * address, the link reconnects through DHCP.
+ *
+ * update() is polled from loop() and never waits; it also notices a dropped
+ * connection and starts reconnecting.
+ */
+
+#define WIFI_LINK_CACHE_MAGIC 0x574C   // "WL"
+#define WIFI_LINK_CACHE_VERSION 2
+
+struct __attribute__((packed)) WiFiLinkCache {
+  uint16_t magic;          // WIFI_LINK_CACHE_MAGIC
+  uint8_t version;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t ip;             // Network byte order as stored by IPAddress
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns1;
+  uint32_t dns2;
+  uint32_t leaseStartS;    // System clock (time()) when DHCP granted the lease
+  uint32_t leaseS;         // Lease length from the DHCP server, 0 if unknown
+  uint32_t crc;            // CRC32 over everything before this field
+};
+
+enum WiFiLinkState : uint8_t {
+  WIFI_LINK_IDLE = 0,
+  WIFI_LINK_CONNECTING = 1,
+  WIFI_LINK_CONNECTED = 2,
+  WIFI_LINK_BACKOFF = 3      // Waiting before the next attempt
+};
+
+// What changed during an update() call
+enum WiFiLinkEvent : uint8_t {
+  WIFI_LINK_EVENT_NONE = 0,
+  WIFI_LINK_EVENT_CONNECTED = 1,
+  WIFI_LINK_EVENT_DISCONNECTED = 2,
+  WIFI_LINK_EVENT_ATTEMPT_FAILED = 3
+};
+
+// Where the fast-connect cache came from at boot
+enum WiFiLinkCacheSource : uint8_t {
+  WIFI_CACHE_NONE = 0,
+  WIFI_CACHE_RTC = 1,
+  WIFI_CACHE_NVS = 2
+};
+
+class WiFiLink {
+private:
+  const char* ssid;
+  const char* password;
+  Preferences* prefs;
+
+  WiFiLinkCache cache;
+  bool cacheValid;
+  WiFiLinkCacheSource cacheSource;
+  bool fastFailed;           // Skip the cache until the next successful connect
+  bool cachedIpApplied;      // The previous lease is configured as a static address
+  bool leaseClockValid;      // leaseStartS is on this clock (RTC copy, or granted this boot)
+
+  WiFiLinkState state;
+  bool attemptFast;
+  uint32_t attemptStartMs;
+  uint32_t outageStartMs;    // begin() or the moment the link dropped
+  uint32_t backoffMs;
+  uint32_t backoffUntilMs;
+
+  uint32_t attempts;
+  uint32_t failures;
+  uint32_t disconnects;
+  uint32_t fastConnects;
+  uint32_t lastConnectMs;    // Outage start to connected, last connection
+  bool lastConnectFast;
+  uint32_t cacheWrites;
+
+  void startAttempt(uint32_t now);
+  void onConnected(uint32_t now);
+  void applyCachedIp(bool useCache);
+  bool leaseReusable() const;
+  static uint32_t dhcpLeaseSeconds();
+  bool loadCache();
+  void storeCache(const WiFiLinkCache& fresh);
+  static uint32_t cacheCrc(const WiFiLinkCache& entry);
+
+public:
+  WiFiLink();
+
+  /**
+   * @brief Load the fast-connect cache and start the first attempt
+   *
+   * The caller sets mode, hostname and any static IP first.
+   *
+   * @param preferences Open Preferences namespace holding the NVS copy
+   */
+  void begin(const char* ssid, const char* password, Preferences& preferences);
+
+  /**
+   * @brief Advance the connection state machine; call every loop()
+   */
+  WiFiLinkEvent update();
+
+  bool isConnected() const { return state == WIFI_LINK_CONNECTED; }
+  WiFiLinkState getState() const { return state; }
+  uint32_t getLastConnectMs() const { return lastConnectMs; }
+  bool wasLastConnectFast() const { return lastConnectFast; }
+
+  /**
+   * @brief Add connection state, counters and cache details to a JSON object
+   */
+  void getStats(JsonObject stats) const;
+};
+
+#endif // WIFI_LINK_H
@@ -24,6 +24,7 @@ export interface DeviceStatus {
 }
 
 export interface ColorSample {
+  id?: number; // Stable id assigned by the device sample log
   r: number;
   g: number;
   b: number;
@@ -31,6 +32,77 @@ export interface ColorSample {
   paintName: string;
   paintCode: string;
   lrv: number;
+  matchState?: MatchState;
+  raw?: SampleMeasurement; // Present when the sample was saved straight from a scan
+}
+
+// Paint lookup progress; "pending" until the device's match worker has an answer,
+// "provisional" while an on-device catalog answer waits for a remote backend
+export type MatchState = 'pending' | 'provisional' | 'matched' | 'unmatched';
+
+// Returned by /save before the paint lookup has run
+export interface SaveSampleResponse {
+  success: boolean;
+  id: number;
+  matchState: MatchState;
+  queueDepth: number;
+}
+
+// Payload of the "match" event on /events
+export interface MatchEvent {
+  id: number;
+  matchState: MatchState;
+  paintName?: string;
+  paintCode?: string;
+  lrv?: number;
+  alternates?: string[]; // Runner-up paint codes, closest first
+  source?: string; // Backend that answered: "http", "appsScript" or "catalog"
+}
+
+// Averaged sensor reading kept with a sample so its color can be recomputed
+export interface SampleMeasurement {
+  x: number;
+  y: number;
+  z: number;
+  ir1: number;
+  ir2: number;
+  sigma: number[]; // Std dev per channel (X, Y, Z, IR1, IR2)
+  readings: number;
+  atime: number;
+  again: number;
+  calVersion: number;
+}
+
+export type TransferFormat = 'ndjson' | 'csv';
+
+// Summary returned by /samples/import and /calibration/import
+export interface TransferImportResult {
+  success: boolean;
+  format: TransferFormat;
+  lines: number;
+  imported: number;
+  skipped: number;  // Header and comment rows
+  invalid: number;  // Malformed rows
+  rejected: number; // Valid rows the device could not apply (e.g. storage full)
+  ms: number;
+  message?: string;
+}
+
+export interface SamplePageQuery {
+  cursor?: number | null; // Continue after this sample id
+  limit?: number;
+  offset?: number;
+  since?: number;
+  code?: string;
+  order?: 'asc' | 'desc';
+}
+
+export interface SamplePage {
+  samples: ColorSample[];
+  total: number;
+  returned: number;
+  hasMore: boolean;
+  nextCursor: number | null;
 }
 
 export interface ScannedColorData {
@@ -41,6 +113,7 @@ export interface ScannedColorData {
   y: number;
   z: number;
   ir: number;
+  scanId?: number; // Pass back to /save to keep the raw measurement
 }
 
 export enum CalibrationState {